@@ -0,0 +1,3 @@
+#include "../../../src/version.h"
+
+const char *application_name_and_version = "Disassembler 1.0.0-SNAPSHOTba48b4e-Debug\n";
@@ -0,0 +1,9 @@
+org 0x100
+
+addr0100:
+call func1_addr0108
+mov ax,0x4C00
+int 0x21
+
+func1_addr0108:
+ret
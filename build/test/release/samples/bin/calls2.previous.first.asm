@@ -0,0 +1,605 @@
+org 0x100
+
+addr0100:
+call func1_addr0231
+call func38_addr02C5
+call func75_addr0359
+call func12_addr025D
+call func49_addr02F1
+call func86_addr0385
+call func23_addr0289
+call func60_addr031D
+call func97_addr03B1
+call func34_addr02B5
+call func71_addr0349
+call func8_addr024D
+call func45_addr02E1
+call func82_addr0375
+call func19_addr0279
+call func56_addr030D
+call func93_addr03A1
+call func30_addr02A5
+call func67_addr0339
+call func4_addr023D
+call func41_addr02D1
+call func78_addr0365
+call func15_addr0269
+call func52_addr02FD
+call func89_addr0391
+call func26_addr0295
+call func63_addr0329
+call func100_addr03BD
+call func37_addr02C1
+call func74_addr0355
+call func11_addr0259
+call func48_addr02ED
+call func85_addr0381
+call func22_addr0285
+call func59_addr0319
+call func96_addr03AD
+call func33_addr02B1
+call func70_addr0345
+call func7_addr0249
+call func44_addr02DD
+call func81_addr0371
+call func18_addr0275
+call func55_addr0309
+call func92_addr039D
+call func29_addr02A1
+call func66_addr0335
+call func3_addr0239
+call func40_addr02CD
+call func77_addr0361
+call func14_addr0265
+call func51_addr02F9
+call func88_addr038D
+call func25_addr0291
+call func62_addr0325
+call func99_addr03B9
+call func36_addr02BD
+call func73_addr0351
+call func10_addr0255
+call func47_addr02E9
+call func84_addr037D
+call func21_addr0281
+call func58_addr0315
+call func95_addr03A9
+call func32_addr02AD
+call func69_addr0341
+call func6_addr0245
+call func43_addr02D9
+call func80_addr036D
+call func17_addr0271
+call func54_addr0305
+call func91_addr0399
+call func28_addr029D
+call func65_addr0331
+call func2_addr0235
+call func39_addr02C9
+call func76_addr035D
+call func13_addr0261
+call func50_addr02F5
+call func87_addr0389
+call func24_addr028D
+call func61_addr0321
+call func98_addr03B5
+call func35_addr02B9
+call func72_addr034D
+call func9_addr0251
+call func46_addr02E5
+call func83_addr0379
+call func20_addr027D
+call func57_addr0311
+call func94_addr03A5
+call func31_addr02A9
+call func68_addr033D
+call func5_addr0241
+call func42_addr02D5
+call func79_addr0369
+call func16_addr026D
+call func53_addr0301
+call func90_addr0395
+call func27_addr0299
+call func64_addr032D
+mov ax,0x4C00
+int 0x21
+
+func1_addr0231:
+mov al,0x00
+nop
+ret
+
+func2_addr0235:
+mov al,0x01
+nop
+ret
+
+func3_addr0239:
+mov al,0x02
+nop
+ret
+
+func4_addr023D:
+mov al,0x03
+nop
+ret
+
+func5_addr0241:
+mov al,0x04
+nop
+ret
+
+func6_addr0245:
+mov al,0x05
+nop
+ret
+
+func7_addr0249:
+mov al,0x06
+nop
+ret
+
+func8_addr024D:
+mov al,0x07
+nop
+ret
+
+func9_addr0251:
+mov al,0x08
+nop
+ret
+
+func10_addr0255:
+mov al,0x09
+nop
+ret
+
+func11_addr0259:
+mov al,0x0A
+nop
+ret
+
+func12_addr025D:
+mov al,0x0B
+nop
+ret
+
+func13_addr0261:
+mov al,0x0C
+nop
+ret
+
+func14_addr0265:
+mov al,0x0D
+nop
+ret
+
+func15_addr0269:
+mov al,0x0E
+nop
+ret
+
+func16_addr026D:
+mov al,0x0F
+nop
+ret
+
+func17_addr0271:
+mov al,0x10
+nop
+ret
+
+func18_addr0275:
+mov al,0x11
+nop
+ret
+
+func19_addr0279:
+mov al,0x12
+nop
+ret
+
+func20_addr027D:
+mov al,0x13
+nop
+ret
+
+func21_addr0281:
+mov al,0x14
+nop
+ret
+
+func22_addr0285:
+mov al,0x15
+nop
+ret
+
+func23_addr0289:
+mov al,0x16
+nop
+ret
+
+func24_addr028D:
+mov al,0x17
+nop
+ret
+
+func25_addr0291:
+mov al,0x18
+nop
+ret
+
+func26_addr0295:
+mov al,0x19
+nop
+ret
+
+func27_addr0299:
+mov al,0x1A
+nop
+ret
+
+func28_addr029D:
+mov al,0x1B
+nop
+ret
+
+func29_addr02A1:
+mov al,0x1C
+nop
+ret
+
+func30_addr02A5:
+mov al,0x1D
+nop
+ret
+
+func31_addr02A9:
+mov al,0x1E
+nop
+ret
+
+func32_addr02AD:
+mov al,0x1F
+nop
+ret
+
+func33_addr02B1:
+mov al,0x20
+nop
+ret
+
+func34_addr02B5:
+mov al,0x21
+nop
+ret
+
+func35_addr02B9:
+mov al,0x22
+nop
+ret
+
+func36_addr02BD:
+mov al,0x23
+nop
+ret
+
+func37_addr02C1:
+mov al,0x24
+nop
+ret
+
+func38_addr02C5:
+mov al,0x25
+nop
+ret
+
+func39_addr02C9:
+mov al,0x26
+nop
+ret
+
+func40_addr02CD:
+mov al,0x27
+nop
+ret
+
+func41_addr02D1:
+mov al,0x28
+nop
+ret
+
+func42_addr02D5:
+mov al,0x29
+nop
+ret
+
+func43_addr02D9:
+mov al,0x2A
+nop
+ret
+
+func44_addr02DD:
+mov al,0x2B
+nop
+ret
+
+func45_addr02E1:
+mov al,0x2C
+nop
+ret
+
+func46_addr02E5:
+mov al,0x2D
+nop
+ret
+
+func47_addr02E9:
+mov al,0x2E
+nop
+ret
+
+func48_addr02ED:
+mov al,0x2F
+nop
+ret
+
+func49_addr02F1:
+mov al,0x30
+nop
+ret
+
+func50_addr02F5:
+mov al,0x31
+nop
+ret
+
+func51_addr02F9:
+mov al,0x32
+nop
+ret
+
+func52_addr02FD:
+mov al,0x33
+nop
+ret
+
+func53_addr0301:
+mov al,0x34
+nop
+ret
+
+func54_addr0305:
+mov al,0x35
+nop
+ret
+
+func55_addr0309:
+mov al,0x36
+nop
+ret
+
+func56_addr030D:
+mov al,0x37
+nop
+ret
+
+func57_addr0311:
+mov al,0x38
+nop
+ret
+
+func58_addr0315:
+mov al,0x39
+nop
+ret
+
+func59_addr0319:
+mov al,0x3A
+nop
+ret
+
+func60_addr031D:
+mov al,0x3B
+nop
+ret
+
+func61_addr0321:
+mov al,0x3C
+nop
+ret
+
+func62_addr0325:
+mov al,0x3D
+nop
+ret
+
+func63_addr0329:
+mov al,0x3E
+nop
+ret
+
+func64_addr032D:
+mov al,0x3F
+nop
+ret
+
+func65_addr0331:
+mov al,0x40
+nop
+ret
+
+func66_addr0335:
+mov al,0x41
+nop
+ret
+
+func67_addr0339:
+mov al,0x42
+nop
+ret
+
+func68_addr033D:
+mov al,0x43
+nop
+ret
+
+func69_addr0341:
+mov al,0x44
+nop
+ret
+
+func70_addr0345:
+mov al,0x45
+nop
+ret
+
+func71_addr0349:
+mov al,0x46
+nop
+ret
+
+func72_addr034D:
+mov al,0x47
+nop
+ret
+
+func73_addr0351:
+mov al,0x48
+nop
+ret
+
+func74_addr0355:
+mov al,0x49
+nop
+ret
+
+func75_addr0359:
+mov al,0x4A
+nop
+ret
+
+func76_addr035D:
+mov al,0x4B
+nop
+ret
+
+func77_addr0361:
+mov al,0x4C
+nop
+ret
+
+func78_addr0365:
+mov al,0x4D
+nop
+ret
+
+func79_addr0369:
+mov al,0x4E
+nop
+ret
+
+func80_addr036D:
+mov al,0x4F
+nop
+ret
+
+func81_addr0371:
+mov al,0x50
+nop
+ret
+
+func82_addr0375:
+mov al,0x51
+nop
+ret
+
+func83_addr0379:
+mov al,0x52
+nop
+ret
+
+func84_addr037D:
+mov al,0x53
+nop
+ret
+
+func85_addr0381:
+mov al,0x54
+nop
+ret
+
+func86_addr0385:
+mov al,0x55
+nop
+ret
+
+func87_addr0389:
+mov al,0x56
+nop
+ret
+
+func88_addr038D:
+mov al,0x57
+nop
+ret
+
+func89_addr0391:
+mov al,0x58
+nop
+ret
+
+func90_addr0395:
+mov al,0x59
+nop
+ret
+
+func91_addr0399:
+mov al,0x5A
+nop
+ret
+
+func92_addr039D:
+mov al,0x5B
+nop
+ret
+
+func93_addr03A1:
+mov al,0x5C
+nop
+ret
+
+func94_addr03A5:
+mov al,0x5D
+nop
+ret
+
+func95_addr03A9:
+mov al,0x5E
+nop
+ret
+
+func96_addr03AD:
+mov al,0x5F
+nop
+ret
+
+func97_addr03B1:
+mov al,0x60
+nop
+ret
+
+func98_addr03B5:
+mov al,0x61
+nop
+ret
+
+func99_addr03B9:
+mov al,0x62
+nop
+ret
+
+func100_addr03BD:
+mov al,0x63
+nop
+ret
@@ -0,0 +1,1487 @@
+#include "ancache.h"
+#include "printd.h"
+#include "refdefs.h"
+#include "version.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Characters at the beginning of every cache file.
+ */
+#define ANALYSIS_CACHE_MAGIC "DISASMAC"
+#define ANALYSIS_CACHE_MAGIC_LENGTH 8
+
+/**
+ * Version of the layout of the cache files, that is also part of the key.
+ * This must be increased whenever the layout changes, or whenever the analysis may find different results
+ * for the same image, so that files written by previous versions are not loaded.
+ */
+#define ANALYSIS_CACHE_FORMAT_VERSION 3
+
+#define ANALYSIS_CACHE_REF_FLAGS_MASK (REF_FLAG_TARGET_TYPE_MASK | REF_FLAG_WHERE_IN_INSTRUCTION_MASK | REF_FLAG_ACCESS_MASK)
+
+/**
+ * All numbers in the file are unsigned and little endian, encoded in groups of 7 bits,
+ * where the highest bit of each byte is set if more groups follow.
+ */
+#define ANALYSIS_CACHE_NUMBER_GROUP_BITS 7
+#define ANALYSIS_CACHE_NUMBER_GROUP_MASK 0x7F
+#define ANALYSIS_CACHE_NUMBER_CONTINUE_BIT 0x80
+
+/**
+ * Variables and segment starts may be out of the buffer, like the PSP in front of 'bin' images,
+ * but never further than the whole real mode address space.
+ */
+#define ANALYSIS_CACHE_MAX_DISTANCE_OUT_OF_BUFFER 0x110000L
+
+/**
+ * Number of bytes of the image read at once while comparing it with the one stored in a cache file.
+ */
+#define ANALYSIS_CACHE_COMPARED_CHUNK_SIZE 4096
+
+/**
+ * Two independent 32-bit hashes of the same data, FNV-1a and sdbm, combined into a 64-bit key.
+ */
+struct AnalysisCacheHash {
+	unsigned long fnv;
+	unsigned long sdbm;
+};
+
+static void initialize_cache_hash(struct AnalysisCacheHash *hash) {
+	hash->fnv = 2166136261UL;
+	hash->sdbm = 0;
+}
+
+static void hash_cache_bytes(struct AnalysisCacheHash *hash, const char *data, unsigned long size) {
+	unsigned long fnv = hash->fnv;
+	unsigned long sdbm = hash->sdbm;
+	unsigned long index;
+	for (index = 0; index < size; index++) {
+		const unsigned long byte = (unsigned char) data[index];
+		fnv = ((fnv ^ byte) * 16777619UL) & 0xFFFFFFFFUL;
+		sdbm = (byte + (sdbm << 6) + (sdbm << 16) - sdbm) & 0xFFFFFFFFUL;
+	}
+
+	hash->fnv = fnv;
+	hash->sdbm = sdbm;
+}
+
+static void hash_cache_number(struct AnalysisCacheHash *hash, unsigned long value) {
+	char bytes[4];
+	bytes[0] = value & 0xFF;
+	bytes[1] = (value >> 8) & 0xFF;
+	bytes[2] = (value >> 16) & 0xFF;
+	bytes[3] = (value >> 24) & 0xFF;
+	hash_cache_bytes(hash, bytes, sizeof(bytes));
+}
+
+/**
+ * Compose the key for the given image, analysed by this build with the options of the given session.
+ */
+static void compose_image_cache_key(const struct SegmentReadResult *read_result, const struct DisasmSession *session, char *key) {
+	struct AnalysisCacheHash hash;
+	unsigned int index;
+
+	initialize_cache_hash(&hash);
+	hash_cache_number(&hash, ANALYSIS_CACHE_FORMAT_VERSION);
+
+	/* Any other build may analyse the same image differently, even if the format version was not increased */
+	hash_cache_bytes(&hash, application_name_and_version, strlen(application_name_and_version));
+	hash_cache_number(&hash, read_result->size);
+	hash_cache_bytes(&hash, read_result->buffer, read_result->size);
+	hash_cache_number(&hash, read_result->relocation_count);
+	for (index = 0; index < read_result->relocation_count; index++) {
+		hash_cache_number(&hash, read_result->relocation_table[index].segment);
+		hash_cache_number(&hash, read_result->relocation_table[index].offset);
+	}
+
+	hash_cache_number(&hash, read_result->relative_cs);
+	hash_cache_number(&hash, read_result->ip);
+	hash_cache_number(&hash, ds_should_match_cs_at_segment_start(read_result));
+	hash_cache_number(&hash, session->work_list.order);
+	hash_cache_number(&hash, session->work_list.widening_threshold);
+	hash_cache_number(&hash, session->work_list.iteration_limit);
+	hash_cache_number(&hash, session->track_provenance);
+	sprintf(key, "%08lx%08lx", hash.fnv, hash.sdbm);
+}
+
+void compose_analysis_cache_key(const struct DisasmSession *session, char *key) {
+	assert(session->state != DISASM_SESSION_STATE_EMPTY);
+	compose_image_cache_key(&session->read_result, session, key);
+}
+
+void compose_previous_build_cache_key(const struct DisasmSession *session, const struct DisasmSession *previous_session, char *key) {
+	assert(session->state != DISASM_SESSION_STATE_EMPTY && previous_session->state != DISASM_SESSION_STATE_EMPTY);
+	compose_image_cache_key(&previous_session->read_result, session, key);
+}
+
+/**
+ * Writes numbers and positions into a cache file, remembering whether any of them failed,
+ * so that it only needs to be checked once all of them are written.
+ * All written bytes are hashed, so that a checksum can be written at the end to detect corrupted files.
+ */
+struct AnalysisCacheWriter {
+	FILE *file;
+	const struct SegmentReadResult *read_result;
+	struct AnalysisCacheHash hash;
+	int failed;
+};
+
+static void write_cache_number(struct AnalysisCacheWriter *writer, unsigned long value) {
+	do {
+		int byte = value & ANALYSIS_CACHE_NUMBER_GROUP_MASK;
+		value >>= ANALYSIS_CACHE_NUMBER_GROUP_BITS;
+		if (value) {
+			byte |= ANALYSIS_CACHE_NUMBER_CONTINUE_BIT;
+		}
+
+		if (putc(byte, writer->file) == EOF) {
+			writer->failed = 1;
+		}
+		else {
+			const char written = byte;
+			hash_cache_bytes(&writer->hash, &written, 1);
+		}
+	} while (value);
+}
+
+static void write_cache_bytes(struct AnalysisCacheWriter *writer, const char *data, unsigned long size) {
+	if (size && fwrite(data, 1, size, writer->file) != size) {
+		writer->failed = 1;
+	}
+	else {
+		hash_cache_bytes(&writer->hash, data, size);
+	}
+}
+
+/**
+ * Positions are written as their offset from the start of the buffer.
+ * As it can be negative, its absolute value is shifted to the left, and the lowest bit is set for negative ones.
+ */
+static void write_cache_position(struct AnalysisCacheWriter *writer, const char *position) {
+	const long offset = position - writer->read_result->buffer;
+	if (offset < -ANALYSIS_CACHE_MAX_DISTANCE_OUT_OF_BUFFER || offset > (long) writer->read_result->size + ANALYSIS_CACHE_MAX_DISTANCE_OUT_OF_BUFFER) {
+		DEBUG_PRINT0("Unable to save a position too far from the buffer into the analysis cache.\n");
+		writer->failed = 1;
+	}
+	else {
+		write_cache_number(writer, (offset < 0)? ((unsigned long) -offset << 1) - 1 : (unsigned long) offset << 1);
+	}
+}
+
+/**
+ * Positions that may be missing are written as 0, or as 1 followed by the position.
+ */
+static void write_cache_optional_position(struct AnalysisCacheWriter *writer, const char *position) {
+	write_cache_number(writer, position? 1 : 0);
+	if (position) {
+		write_cache_position(writer, position);
+	}
+}
+
+static void save_cache_registers(struct AnalysisCacheWriter *writer, const struct Registers *regs) {
+	unsigned int index;
+
+	write_cache_number(writer, regs->al);
+	write_cache_number(writer, regs->ah);
+	write_cache_number(writer, regs->cl);
+	write_cache_number(writer, regs->ch);
+	write_cache_number(writer, regs->dl);
+	write_cache_number(writer, regs->dh);
+	write_cache_number(writer, regs->bl);
+	write_cache_number(writer, regs->bh);
+	write_cache_number(writer, regs->sp);
+	write_cache_number(writer, regs->bp);
+	write_cache_number(writer, regs->si);
+	write_cache_number(writer, regs->di);
+	write_cache_number(writer, regs->es);
+	write_cache_number(writer, regs->cs);
+	write_cache_number(writer, regs->ss);
+	write_cache_number(writer, regs->ds);
+	write_cache_number(writer, regs->merged);
+	write_cache_number(writer, regs->defined);
+	write_cache_number(writer, regs->relative);
+	write_cache_number(writer, is_provenance_tracked_in_registers(regs));
+	for (index = 0; is_provenance_tracked_in_registers(regs) && index < 16; index++) {
+		write_cache_optional_position(writer, regs->provenance->value_origin[index]);
+		write_cache_optional_position(writer, regs->provenance->last_update[index]);
+	}
+}
+
+/**
+ * Everything hashed by compose_image_cache_key is written as well, in the same order, and compared on load,
+ * so that an analysis is never loaded for another image or other options whose key happens to be the same.
+ * Signed values are written as their lowest 32 bits.
+ */
+static void save_cache_identity(struct AnalysisCacheWriter *writer, const struct DisasmSession *session) {
+	const struct SegmentReadResult *read_result = writer->read_result;
+	unsigned int index;
+
+	write_cache_number(writer, strlen(application_name_and_version));
+	write_cache_bytes(writer, application_name_and_version, strlen(application_name_and_version));
+	write_cache_number(writer, read_result->size);
+	write_cache_bytes(writer, read_result->buffer, read_result->size);
+	write_cache_number(writer, read_result->relocation_count);
+	for (index = 0; index < read_result->relocation_count; index++) {
+		write_cache_number(writer, read_result->relocation_table[index].segment);
+		write_cache_number(writer, read_result->relocation_table[index].offset);
+	}
+
+	write_cache_number(writer, (unsigned long) read_result->relative_cs & 0xFFFFFFFFUL);
+	write_cache_number(writer, read_result->ip);
+	write_cache_number(writer, ds_should_match_cs_at_segment_start(read_result));
+	write_cache_number(writer, session->work_list.order);
+	write_cache_number(writer, session->work_list.widening_threshold);
+	write_cache_number(writer, session->work_list.iteration_limit);
+	write_cache_number(writer, session->track_provenance);
+}
+
+/**
+ * Words are written from the bottom of the stack, so that they can be pushed again in the same order.
+ */
+static void save_cache_stack(struct AnalysisCacheWriter *writer, const struct Stack *stack) {
+	const unsigned int word_count = get_word_count_in_stack(stack);
+	unsigned int index;
+
+	write_cache_number(writer, word_count);
+	for (index = word_count; index > 0; index--) {
+		write_cache_number(writer, get_from_top(stack, index - 1));
+		write_cache_number(writer, get_word_flags_from_top(stack, index - 1));
+		write_cache_optional_position(writer, get_value_origin_from_top(stack, index - 1));
+	}
+}
+
+/**
+ * Each value is written after its key and whether it is undefined (0), defined (1) or relative (2).
+ * Values of undefined entries are not written.
+ */
+static void save_cache_var_values(struct AnalysisCacheWriter *writer, const struct GlobalVariableWordValueMap *var_values) {
+	unsigned int index;
+
+	write_cache_number(writer, var_values->entry_count);
+	for (index = 0; index < var_values->entry_count; index++) {
+		write_cache_position(writer, var_values->keys[index]);
+		if (is_gvwvalue_defined_relative_at_index(var_values, index)) {
+			write_cache_number(writer, 2);
+			write_cache_number(writer, get_gvwvalue_at_index(var_values, index));
+		}
+		else if (is_gvwvalue_defined_at_index(var_values, index)) {
+			write_cache_number(writer, 1);
+			write_cache_number(writer, get_gvwvalue_at_index(var_values, index));
+		}
+		else {
+			write_cache_number(writer, 0);
+		}
+	}
+}
+
+/**
+ * Origins are written along with their states, so that blocks not reached by the changes in a later build
+ * can keep them when the analysis is restarted for that build.
+ */
+static void save_cache_blocks(struct AnalysisCacheWriter *writer, const struct ProgramContent *pcontent) {
+	const struct CodeBlock *blocks = get_pcontent_blocks(pcontent);
+	const unsigned int block_count = get_pcontent_block_count(pcontent);
+	unsigned int block_index;
+
+	for (block_index = 0; block_index < block_count; block_index++) {
+		const struct CodeBlock *block = blocks + block_index;
+		const struct CodeBlockOriginList *origin_list = get_cblock_origin_list(block);
+		unsigned int origin_index;
+
+		write_cache_number(writer, get_cblock_relative_cs(block));
+		write_cache_number(writer, get_cblock_ip(block));
+		write_cache_position(writer, get_cblock_start(block));
+		write_cache_number(writer, get_cblock_size(block));
+		write_cache_number(writer, origin_list->origin_count);
+		for (origin_index = 0; origin_index < origin_list->origin_count; origin_index++) {
+			const struct CodeBlockOrigin *origin = origin_list->sorted_origins[origin_index];
+			const int origin_type = get_cborigin_type(origin);
+			write_cache_number(writer, origin->flags);
+			write_cache_optional_position(writer, (origin_type == CBORIGIN_TYPE_JUMP || origin_type == CBORIGIN_TYPE_INTERRUPTION)? get_cborigin_instruction(origin) : NULL);
+			save_cache_registers(writer, get_cborigin_registers(origin));
+			save_cache_stack(writer, get_cborigin_stack(origin));
+			save_cache_var_values(writer, get_cborigin_var_values(origin));
+		}
+	}
+}
+
+static void save_cache_variables(struct AnalysisCacheWriter *writer, const struct GlobalVariableList *vars) {
+	unsigned int var_index;
+
+	write_cache_number(writer, vars->variable_count);
+	for (var_index = 0; var_index < vars->variable_count; var_index++) {
+		const struct GlobalVariable *var = vars->sorted_variables[var_index];
+		write_cache_position(writer, get_gvar_start(var));
+		write_cache_number(writer, get_gvar_relative_address(var));
+		write_cache_number(writer, get_gvar_type(var));
+		if (get_gvar_type(var) & GVAR_TYPE_ARRAY) {
+			write_cache_position(writer, get_gvar_end(var));
+		}
+	}
+}
+
+/**
+ * Targets are written as the index of the block, or the index of the variable among the sorted ones.
+ */
+static void save_cache_references(struct AnalysisCacheWriter *writer, const struct ProgramContent *pcontent) {
+	const struct Reference *refs = get_pcontent_refs(pcontent);
+	const unsigned int refs_count = get_pcontent_refs_count(pcontent);
+	unsigned int ref_index;
+
+	for (ref_index = 0; ref_index < refs_count; ref_index++) {
+		const struct Reference *ref = refs + ref_index;
+		const struct CodeBlock *target_block = get_cblock_from_ref_target(ref);
+		write_cache_number(writer, ref->flags);
+		if (target_block) {
+			write_cache_number(writer, target_block - get_pcontent_blocks(pcontent));
+		}
+		else {
+			const int var_index = index_of_gvar_with_start(get_pcontent_vars(pcontent), get_gvar_start(get_gvar_from_ref_target(ref)));
+			if (var_index < 0) {
+				writer->failed = 1;
+				return;
+			}
+
+			write_cache_number(writer, var_index);
+		}
+
+		write_cache_position(writer, get_ref_instruction(ref));
+	}
+}
+
+static void save_cache_segment_starts(struct AnalysisCacheWriter *writer, const struct SegmentStartList *segment_start_list) {
+	unsigned int index;
+
+	write_cache_number(writer, segment_start_list->count);
+	for (index = 0; index < segment_start_list->count; index++) {
+		write_cache_position(writer, segment_start_list->start[index]);
+	}
+}
+
+/**
+ * Blocks of each function are written as their index among all blocks, shifted to the left.
+ * The lowest bit tells whether the block is a starting block of the function.
+ */
+static void save_cache_functions(struct AnalysisCacheWriter *writer, const struct ProgramContent *pcontent, const struct FunctionList *func_list) {
+	unsigned int func_index;
+
+	write_cache_number(writer, func_list->func_count);
+	for (func_index = 0; func_index < func_list->func_count; func_index++) {
+		struct Function *func = func_list->sorted_funcs[func_index];
+		const packed_data_t *included_block_start = get_func_included_block_start(func);
+		unsigned int block_index;
+
+		write_cache_number(writer, func->flags);
+		write_cache_number(writer, func->return_size);
+		write_cache_number(writer, function_uses_bp(func)? func->min_known_word_argument_count : 0);
+		write_cache_number(writer, func->block_count);
+		for (block_index = 0; block_index < func->block_count; block_index++) {
+			const int index = index_of_block_with_start(get_pcontent_blocks(pcontent), get_pcontent_block_count(pcontent), get_cblock_start(func->blocks + block_index));
+			if (index < 0) {
+				writer->failed = 1;
+				return;
+			}
+
+			write_cache_number(writer, ((unsigned long) index << 1) | (get_bitset_value(included_block_start, block_index)? 1 : 0));
+		}
+	}
+}
+
+int save_analysis_cache(const struct DisasmSession *session, FILE *file) {
+	struct AnalysisCacheWriter writer;
+	char key[ANALYSIS_CACHE_KEY_LENGTH + 1];
+
+	assert(session->state == DISASM_SESSION_STATE_FUNCTIONS_FOUND);
+	writer.file = file;
+	writer.read_result = &session->read_result;
+	initialize_cache_hash(&writer.hash);
+	writer.failed = 0;
+
+	compose_analysis_cache_key(session, key);
+	if (fwrite(ANALYSIS_CACHE_MAGIC, 1, ANALYSIS_CACHE_MAGIC_LENGTH, file) != ANALYSIS_CACHE_MAGIC_LENGTH ||
+			fwrite(key, 1, ANALYSIS_CACHE_KEY_LENGTH, file) != ANALYSIS_CACHE_KEY_LENGTH) {
+		return 1;
+	}
+
+	write_cache_number(&writer, ANALYSIS_CACHE_FORMAT_VERSION);
+	save_cache_identity(&writer, session);
+	write_cache_number(&writer, get_pcontent_block_count(session->pcontent));
+	write_cache_number(&writer, get_pcontent_refs_count(session->pcontent));
+	save_cache_blocks(&writer, session->pcontent);
+	save_cache_variables(&writer, get_pcontent_vars(session->pcontent));
+	save_cache_references(&writer, session->pcontent);
+	save_cache_segment_starts(&writer, &session->segment_start_list);
+	save_cache_functions(&writer, session->pcontent, &session->func_list);
+	write_cache_number(&writer, writer.hash.fnv);
+	return writer.failed || ferror(file);
+}
+
+/**
+ * Reads numbers and positions from a cache file, checking that each of them is within its expected range.
+ * Once anything fails, all following reads return 0, so that it only needs to be checked once in a while.
+ */
+struct AnalysisCacheReader {
+	FILE *file;
+	const struct SegmentReadResult *read_result;
+	struct AnalysisCacheHash hash;
+	int failed;
+
+	/**
+	 * State of the origin being read, before it is interned in the snapshot store of the session.
+	 */
+	struct Registers regs;
+	struct RegisterProvenance provenance;
+	struct Stack stack;
+	struct GlobalVariableWordValueMap var_values;
+};
+
+static unsigned long read_cache_number(struct AnalysisCacheReader *reader, unsigned long max_value) {
+	unsigned long value = 0;
+	unsigned int shift = 0;
+	int byte;
+
+	if (reader->failed) {
+		return 0;
+	}
+
+	do {
+		/* Numbers never exceed 32 bits, which fit in 5 groups */
+		char read_byte;
+		if (shift > 4 * ANALYSIS_CACHE_NUMBER_GROUP_BITS || (byte = getc(reader->file)) == EOF) {
+			reader->failed = 1;
+			return 0;
+		}
+
+		read_byte = byte;
+		hash_cache_bytes(&reader->hash, &read_byte, 1);
+		value |= ((unsigned long) (byte & ANALYSIS_CACHE_NUMBER_GROUP_MASK)) << shift;
+		shift += ANALYSIS_CACHE_NUMBER_GROUP_BITS;
+	} while (byte & ANALYSIS_CACHE_NUMBER_CONTINUE_BIT);
+
+	if (value > max_value) {
+		reader->failed = 1;
+		return 0;
+	}
+
+	return value;
+}
+
+/**
+ * Read a number that must be the given one.
+ */
+static void check_cache_number(struct AnalysisCacheReader *reader, unsigned long expected) {
+	if (read_cache_number(reader, 0xFFFFFFFFUL) != expected) {
+		reader->failed = 1;
+	}
+}
+
+/**
+ * Read as many bytes as the given data has, that must match it.
+ */
+static void check_cache_bytes(struct AnalysisCacheReader *reader, const char *data, unsigned long size) {
+	char chunk[ANALYSIS_CACHE_COMPARED_CHUNK_SIZE];
+	while (size && !reader->failed) {
+		const unsigned long chunk_size = (size < ANALYSIS_CACHE_COMPARED_CHUNK_SIZE)? size : ANALYSIS_CACHE_COMPARED_CHUNK_SIZE;
+		if (fread(chunk, 1, chunk_size, reader->file) != chunk_size || memcmp(chunk, data, chunk_size)) {
+			reader->failed = 1;
+			return;
+		}
+
+		hash_cache_bytes(&reader->hash, chunk, chunk_size);
+		data += chunk_size;
+		size -= chunk_size;
+	}
+}
+
+/**
+ * Returns the position at the offset read, that must be within the given ones.
+ */
+static const char *read_cache_position(struct AnalysisCacheReader *reader, long min_offset, long max_offset) {
+	const unsigned long value = read_cache_number(reader, 0xFFFFFFFFUL);
+	const long offset = (value & 1)? -(long) ((value + 1) >> 1) : (long) (value >> 1);
+	if (offset < min_offset || offset > max_offset) {
+		reader->failed = 1;
+		return reader->read_result->buffer;
+	}
+
+	return reader->read_result->buffer + offset;
+}
+
+static const char *read_cache_position_in_buffer(struct AnalysisCacheReader *reader) {
+	return read_cache_position(reader, 0, (long) reader->read_result->size - 1);
+}
+
+static const char *read_cache_position_near_buffer(struct AnalysisCacheReader *reader) {
+	return read_cache_position(reader, -ANALYSIS_CACHE_MAX_DISTANCE_OUT_OF_BUFFER, (long) reader->read_result->size + ANALYSIS_CACHE_MAX_DISTANCE_OUT_OF_BUFFER);
+}
+
+static const char *read_cache_optional_position_near_buffer(struct AnalysisCacheReader *reader) {
+	return read_cache_number(reader, 1)? read_cache_position_near_buffer(reader) : NULL;
+}
+
+/**
+ * Check that the file was written for the given image, analysed with the options of the given session,
+ * as written by save_cache_identity.
+ */
+static void check_cache_identity(struct AnalysisCacheReader *reader, const struct SegmentReadResult *read_result, const struct DisasmSession *session) {
+	unsigned int index;
+
+	check_cache_number(reader, strlen(application_name_and_version));
+	check_cache_bytes(reader, application_name_and_version, strlen(application_name_and_version));
+	check_cache_number(reader, read_result->size);
+	check_cache_bytes(reader, read_result->buffer, read_result->size);
+	check_cache_number(reader, read_result->relocation_count);
+	for (index = 0; index < read_result->relocation_count; index++) {
+		check_cache_number(reader, read_result->relocation_table[index].segment);
+		check_cache_number(reader, read_result->relocation_table[index].offset);
+	}
+
+	check_cache_number(reader, (unsigned long) read_result->relative_cs & 0xFFFFFFFFUL);
+	check_cache_number(reader, read_result->ip);
+	check_cache_number(reader, ds_should_match_cs_at_segment_start(read_result));
+	check_cache_number(reader, session->work_list.order);
+	check_cache_number(reader, session->work_list.widening_threshold);
+	check_cache_number(reader, session->work_list.iteration_limit);
+	check_cache_number(reader, session->track_provenance);
+}
+
+/**
+ * Registers keep the provenance read only if the snapshot store of the session tracks it.
+ */
+static void load_cache_registers(struct AnalysisCacheReader *reader, struct Registers *regs) {
+	unsigned int index;
+
+	initialize_registers(regs, &reader->provenance);
+	regs->al = read_cache_number(reader, 0xFF);
+	regs->ah = read_cache_number(reader, 0xFF);
+	regs->cl = read_cache_number(reader, 0xFF);
+	regs->ch = read_cache_number(reader, 0xFF);
+	regs->dl = read_cache_number(reader, 0xFF);
+	regs->dh = read_cache_number(reader, 0xFF);
+	regs->bl = read_cache_number(reader, 0xFF);
+	regs->bh = read_cache_number(reader, 0xFF);
+	regs->sp = read_cache_number(reader, 0xFFFF);
+	regs->bp = read_cache_number(reader, 0xFFFF);
+	regs->si = read_cache_number(reader, 0xFFFF);
+	regs->di = read_cache_number(reader, 0xFFFF);
+	regs->es = read_cache_number(reader, 0xFFFF);
+	regs->cs = read_cache_number(reader, 0xFFFF);
+	regs->ss = read_cache_number(reader, 0xFFFF);
+	regs->ds = read_cache_number(reader, 0xFFFF);
+	regs->merged = read_cache_number(reader, 0xFFFF);
+	regs->defined = read_cache_number(reader, 0xFFFF);
+	regs->relative = read_cache_number(reader, 0xFFFF);
+	if (read_cache_number(reader, 1)) {
+		for (index = 0; index < 16; index++) {
+			reader->provenance.value_origin[index] = read_cache_optional_position_near_buffer(reader);
+			reader->provenance.last_update[index] = read_cache_optional_position_near_buffer(reader);
+		}
+	}
+	else {
+		regs->provenance = NULL;
+	}
+}
+
+static void load_cache_stack(struct AnalysisCacheReader *reader, struct Stack *stack) {
+	const unsigned int word_count = read_cache_number(reader, 0xFFFF);
+	unsigned int index;
+
+	clear_stack(stack);
+	for (index = 0; index < word_count && !reader->failed; index++) {
+		const uint16_t value = read_cache_number(reader, 0xFFFF);
+		const unsigned int flags = read_cache_number(reader, 0xFFFF);
+		const char *value_origin = read_cache_optional_position_near_buffer(reader);
+		if (reader->failed || push_word_with_flags_in_stack(stack, value_origin, value, flags)) {
+			reader->failed = 1;
+			return;
+		}
+	}
+}
+
+static void load_cache_var_values(struct AnalysisCacheReader *reader, struct GlobalVariableWordValueMap *var_values) {
+	const unsigned int entry_count = read_cache_number(reader, 0xFFFFFFFFUL);
+	unsigned int index;
+
+	clear_gvwvmap(var_values);
+	for (index = 0; index < entry_count && !reader->failed; index++) {
+		const char *key = read_cache_position_near_buffer(reader);
+		const unsigned int definition = read_cache_number(reader, 2);
+		const uint16_t value = definition? read_cache_number(reader, 0xFFFF) : 0;
+		int error_code;
+
+		if (definition == 2) {
+			error_code = put_gvar_in_gvwvmap_relative(var_values, key, value);
+		}
+		else if (definition == 1) {
+			error_code = put_gvar_in_gvwvmap(var_values, key, value);
+		}
+		else {
+			error_code = put_gvar_in_gvwvmap_undefined(var_values, key);
+		}
+
+		if (reader->failed || error_code) {
+			reader->failed = 1;
+			return;
+		}
+	}
+}
+
+/**
+ * Blocks must be sorted by their start, and none of them can be empty.
+ * Their origin lists are allocated in the arena of the session, and their states are interned in its snapshot store.
+ */
+static void load_cache_blocks(struct AnalysisCacheReader *reader, struct DisasmSession *session, struct CodeBlock *blocks, unsigned int block_count) {
+	const unsigned int size = session->read_result.size;
+	struct CodeBlockOriginList *origin_lists;
+	const char *previous_start = NULL;
+	unsigned int block_index;
+
+	if (!block_count) {
+		return;
+	}
+
+	origin_lists = allocate_in_arena(&session->arena, block_count * sizeof(struct CodeBlockOriginList));
+	if (!origin_lists) {
+		reader->failed = 1;
+		return;
+	}
+
+	for (block_index = 0; block_index < block_count && !reader->failed; block_index++) {
+		struct CodeBlockOriginList *origin_list = origin_lists + block_index;
+		const unsigned int relative_cs = read_cache_number(reader, 0xFFFFFFFFUL);
+		const unsigned int ip = read_cache_number(reader, 0xFFFFFFFFUL);
+		const char *start = read_cache_position_in_buffer(reader);
+		const unsigned int block_size = read_cache_number(reader, size - (start - reader->read_result->buffer));
+		const unsigned int origin_count = read_cache_number(reader, 0xFFFFFFFFUL);
+		unsigned int origin_index;
+
+		/* Relative CS may be negative, as in 'bin' images */
+		if (!block_size || ip > 0xFFFF || (relative_cs > 0xFFFF && relative_cs < 0xFFFF0000UL) || (previous_start && start <= previous_start)) {
+			reader->failed = 1;
+			return;
+		}
+
+		initialize_cborigin_list_in_arena(origin_list, &session->arena);
+		origin_list->snapshots = &session->snapshots;
+		for (origin_index = 0; origin_index < origin_count && !reader->failed; origin_index++) {
+			const unsigned int flags = read_cache_number(reader, 0xFFFFFFFFUL);
+			const char *instruction = read_cache_number(reader, 1)? read_cache_position_in_buffer(reader) : NULL;
+			struct CodeBlockOrigin *origin;
+
+			load_cache_registers(reader, &reader->regs);
+			load_cache_stack(reader, &reader->stack);
+			load_cache_var_values(reader, &reader->var_values);
+			if (reader->failed || !(origin = prepare_new_cborigin(origin_list)) ||
+					initialize_cborigin_with_flags(origin, &session->snapshots, flags, instruction, &reader->regs, &reader->stack, &reader->var_values) ||
+					((get_cborigin_type(origin) == CBORIGIN_TYPE_JUMP || get_cborigin_type(origin) == CBORIGIN_TYPE_INTERRUPTION) && !instruction) ||
+					insert_cborigin(origin_list, origin)) {
+				reader->failed = 1;
+				return;
+			}
+		}
+
+		initialize_cblock(blocks + block_index, relative_cs, ip, start, start + block_size, origin_list);
+		previous_start = start;
+	}
+}
+
+static int is_valid_cache_gvar_type(unsigned int var_type) {
+	return var_type == GVAR_TYPE_BYTE ||
+			var_type == GVAR_TYPE_WORD ||
+			var_type == GVAR_TYPE_BYTE_STRING ||
+			var_type == GVAR_TYPE_WORD_STRING ||
+			var_type == GVAR_TYPE_DOLLAR_TERMINATED_STRING ||
+			var_type == GVAR_TYPE_FAR_POINTER;
+}
+
+static void load_cache_variables(struct AnalysisCacheReader *reader, struct GlobalVariableList *vars) {
+	const unsigned int var_count = read_cache_number(reader, 0xFFFFFFFFUL);
+	unsigned int var_index;
+
+	for (var_index = 0; var_index < var_count && !reader->failed; var_index++) {
+		const char *start = read_cache_position_near_buffer(reader);
+		const unsigned int relative_address = read_cache_number(reader, 0xFFFFFFFFUL);
+		const unsigned int var_type = read_cache_number(reader, 0xFFFFFFFFUL);
+		struct GlobalVariable *var;
+
+		if (reader->failed || !is_valid_cache_gvar_type(var_type) || !(var = prepare_new_gvar(vars))) {
+			reader->failed = 1;
+			return;
+		}
+
+		initialize_gvar(var, start, relative_address, var_type);
+		if (var_type & GVAR_TYPE_ARRAY) {
+			const char *end = read_cache_position_near_buffer(reader);
+			if (end <= start) {
+				reader->failed = 1;
+				return;
+			}
+
+			set_gvar_end(var, end);
+		}
+
+		if (reader->failed || insert_gvar(vars, var)) {
+			reader->failed = 1;
+			return;
+		}
+	}
+}
+
+/**
+ * References must be sorted by their instruction, as they are in the analysis result.
+ */
+static void load_cache_references(struct AnalysisCacheReader *reader, const struct CodeBlock *blocks, unsigned int block_count, const struct GlobalVariableList *vars, struct Reference *refs, unsigned int refs_count) {
+	const char *previous_instruction = NULL;
+	unsigned int ref_index;
+
+	for (ref_index = 0; ref_index < refs_count && !reader->failed; ref_index++) {
+		const unsigned int flags = read_cache_number(reader, ANALYSIS_CACHE_REF_FLAGS_MASK);
+		const int targets_block = (flags & REF_FLAG_TARGET_TYPE_MASK) == REF_FLAG_TARGET_IS_CBLOCK;
+		const unsigned int target_count = targets_block? block_count : vars->variable_count;
+		const unsigned int target_index = read_cache_number(reader, target_count);
+		const char *instruction = read_cache_position_in_buffer(reader);
+
+		if (reader->failed || target_index == target_count || (previous_instruction && instruction <= previous_instruction)) {
+			reader->failed = 1;
+			return;
+		}
+
+		if (targets_block) {
+			initialize_ref(refs + ref_index, blocks + target_index, flags, instruction);
+		}
+		else {
+			initialize_ref(refs + ref_index, vars->sorted_variables[target_index], flags, instruction);
+		}
+
+		previous_instruction = instruction;
+	}
+}
+
+static void load_cache_segment_starts(struct AnalysisCacheReader *reader, struct SegmentStartList *segment_start_list) {
+	const unsigned int count = read_cache_number(reader, 0xFFFFFFFFUL);
+	unsigned int index;
+
+	for (index = 0; index < count && !reader->failed; index++) {
+		const char *start = read_cache_position_near_buffer(reader);
+		if (reader->failed || insert_segment_start(segment_start_list, start)) {
+			reader->failed = 1;
+			return;
+		}
+	}
+}
+
+/**
+ * Blocks of each function must be sorted by their start, as they are found by find_functions.
+ */
+static void load_cache_functions(struct AnalysisCacheReader *reader, const struct CodeBlock *blocks, unsigned int block_count, struct FunctionList *func_list) {
+	const unsigned int func_count = read_cache_number(reader, block_count);
+	unsigned int func_index;
+
+	for (func_index = 0; func_index < func_count && !reader->failed; func_index++) {
+		const unsigned int flags = read_cache_number(reader, 0xFFFFFFFFUL);
+		const unsigned int return_size = read_cache_number(reader, 0xFFFFFFFFUL);
+		const unsigned int min_known_word_argument_count = read_cache_number(reader, 0xFFFFFFFFUL);
+		const unsigned int func_block_count = read_cache_number(reader, block_count);
+		struct Function *func;
+		packed_data_t *included_block_start;
+		unsigned int func_block_index;
+		int previous_index = -1;
+
+		if (reader->failed || !func_block_count || !(func = prepare_new_func(func_list))) {
+			reader->failed = 1;
+			return;
+		}
+
+		if (initialize_func(func, func_block_count)) {
+			reader->failed = 1;
+			return;
+		}
+
+		func->flags = flags;
+		func->return_size = return_size;
+		func->min_known_word_argument_count = min_known_word_argument_count;
+		func->blocks = malloc(sizeof(struct CodeBlock) * func_block_count);
+		if (!func->blocks) {
+			free_func_content(func);
+			reader->failed = 1;
+			return;
+		}
+
+		included_block_start = get_func_included_block_start(func);
+		for (func_block_index = 0; func_block_index < func_block_count; func_block_index++) {
+			const unsigned long value = read_cache_number(reader, ((unsigned long) block_count << 1) - 1);
+			const int index = value >> 1;
+			if (reader->failed || index <= previous_index) {
+				free_func_content(func);
+				reader->failed = 1;
+				return;
+			}
+
+			func->blocks[func_block_index] = blocks[index];
+			set_bitset_value(included_block_start, func_block_index, value & 1);
+			previous_index = index;
+		}
+
+		if (insert_func(func_list, func)) {
+			free_func_content(func);
+			reader->failed = 1;
+			return;
+		}
+	}
+}
+
+/**
+ * Restore the analysis from the given file, that must have been saved with the given key for the given image.
+ * This is the one opened in the session, unless the analysis belongs to a previous build.
+ */
+static int load_analysis_cache_with_key(struct DisasmSession *session, const struct SegmentReadResult *image, FILE *file, const char *key) {
+	const unsigned int size = session->read_result.size;
+	struct AnalysisCacheReader reader;
+	char magic[ANALYSIS_CACHE_MAGIC_LENGTH];
+	char file_key[ANALYSIS_CACHE_KEY_LENGTH];
+	unsigned int block_count;
+	unsigned int refs_count;
+	char *pcontent_raw;
+	struct CodeBlock *blocks;
+	struct Reference *refs;
+	unsigned long checksum;
+
+	assert(session->state == DISASM_SESSION_STATE_OPENED);
+	reader.file = file;
+	reader.read_result = &session->read_result;
+	initialize_cache_hash(&reader.hash);
+	reader.failed = 0;
+	initialize_stack(&reader.stack);
+	initialize_gvwvmap(&reader.var_values);
+
+	if (fread(magic, 1, ANALYSIS_CACHE_MAGIC_LENGTH, file) != ANALYSIS_CACHE_MAGIC_LENGTH ||
+			memcmp(magic, ANALYSIS_CACHE_MAGIC, ANALYSIS_CACHE_MAGIC_LENGTH) ||
+			fread(file_key, 1, ANALYSIS_CACHE_KEY_LENGTH, file) != ANALYSIS_CACHE_KEY_LENGTH ||
+			memcmp(file_key, key, ANALYSIS_CACHE_KEY_LENGTH) ||
+			read_cache_number(&reader, ANALYSIS_CACHE_FORMAT_VERSION) != ANALYSIS_CACHE_FORMAT_VERSION) {
+		return 1;
+	}
+
+	check_cache_identity(&reader, image, session);
+	if (reader.failed) {
+		DEBUG_PRINT0("Analysis cache belongs to another image or options with the same key. Discarding it.\n");
+		return 1;
+	}
+
+	/* Each block takes at least one byte, and so does each instruction with a reference */
+	block_count = read_cache_number(&reader, size);
+	refs_count = read_cache_number(&reader, size);
+	if (reader.failed) {
+		return 1;
+	}
+
+	/* Laid out as compose_pcontent does, so that it is released in the same way */
+	pcontent_raw = malloc(sizeof(struct ProgramContent) + block_count * sizeof(struct CodeBlock) + refs_count * sizeof(struct Reference));
+	if (!pcontent_raw) {
+		return 1;
+	}
+
+	blocks = (struct CodeBlock *) (pcontent_raw + sizeof(struct ProgramContent));
+	refs = (struct Reference *) (pcontent_raw + sizeof(struct ProgramContent) + block_count * sizeof(struct CodeBlock));
+	initialize_func_list(&session->func_list);
+	load_cache_blocks(&reader, session, blocks, block_count);
+	load_cache_variables(&reader, &session->gvar_list);
+	load_cache_references(&reader, blocks, block_count, &session->gvar_list, refs, refs_count);
+	load_cache_segment_starts(&reader, &session->segment_start_list);
+	load_cache_functions(&reader, blocks, block_count, &session->func_list);
+	checksum = reader.hash.fnv;
+	session->pcontent = (struct ProgramContent *) pcontent_raw;
+	clear_stack(&reader.stack);
+	clear_gvwvmap(&reader.var_values);
+	if (read_cache_number(&reader, 0xFFFFFFFFUL) != checksum || reader.failed || getc(file) != EOF) {
+		DEBUG_PRINT0("Analysis cache is not valid. Discarding it.\n");
+		clear_func_list(&session->func_list);
+		discard_disasm_session_analysis(session);
+		return 1;
+	}
+
+	initialize_pcontent(session->pcontent, block_count, refs_count, blocks, &session->gvar_list, refs);
+
+	/* Blocks are never split, as nothing is evaluated */
+	session->cblock_list.checkpoint_trail = NULL;
+	session->cblock_list.checked_blocks = NULL;
+	session->printer_err.func_list = &session->func_list;
+	session->state = DISASM_SESSION_STATE_FUNCTIONS_FOUND;
+	return 0;
+}
+
+int load_analysis_cache(struct DisasmSession *session, FILE *file) {
+	char key[ANALYSIS_CACHE_KEY_LENGTH + 1];
+
+	assert(session->state == DISASM_SESSION_STATE_OPENED);
+	compose_analysis_cache_key(session, key);
+	return load_analysis_cache_with_key(session, &session->read_result, file, key);
+}
+
+/**
+ * Whether both images have the same size, relocations and entry point, so that positions in the analysis
+ * of one of them are at the same offset in the other one.
+ */
+static int have_same_layout(const struct SegmentReadResult *read_result, const struct SegmentReadResult *previous) {
+	return read_result->size == previous->size &&
+			read_result->relocation_count == previous->relocation_count &&
+			(!read_result->relocation_count || !memcmp(read_result->relocation_table, previous->relocation_table, read_result->relocation_count * sizeof(struct FarPointer))) &&
+			read_result->relative_cs == previous->relative_cs &&
+			read_result->ip == previous->ip &&
+			ds_should_match_cs_at_segment_start(read_result) == ds_should_match_cs_at_segment_start(previous);
+}
+
+/**
+ * Blocks and variables loaded from the analysis of a previous build that cannot be kept for the current one,
+ * as they are reached by the bytes that changed between both builds.
+ */
+struct AnalysisCacheInvalidation {
+	const char *buffer;
+	const char *previous_buffer;
+	unsigned int size;
+	const struct CodeBlock *blocks;
+	unsigned int block_count;
+
+	/**
+	 * Bytes of the buffer that differ from the previous one.
+	 */
+	packed_data_t *changed_bytes;
+
+	/**
+	 * Blocks that must be evaluated again, and the number of them.
+	 */
+	packed_data_t *invalid_blocks;
+	unsigned int invalid_count;
+
+	/**
+	 * Blocks whose call return origins may not be reached anymore, or not with the same state,
+	 * as the function called just before them may have changed.
+	 */
+	packed_data_t *stale_returns;
+
+	/**
+	 * Blocks whose origins were already walked backwards looking for the calls to their function,
+	 * and the indexes of the ones still pending to be walked.
+	 */
+	packed_data_t *walked_blocks;
+	unsigned int *pending_walks;
+
+	/**
+	 * Variables whose bytes changed.
+	 */
+	packed_data_t *invalid_vars;
+};
+
+static int has_changed_bytes_in_range(const struct AnalysisCacheInvalidation *invalidation, const char *start, const char *end) {
+	const long first = (start < invalidation->buffer)? 0 : start - invalidation->buffer;
+	const long last = (end > invalidation->buffer + invalidation->size)? (long) invalidation->size : end - invalidation->buffer;
+	long index;
+
+	for (index = first; index < last; index++) {
+		if (get_bitset_value(invalidation->changed_bytes, index)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Returns the index of the loaded block containing the given position, or -1 if there is none.
+ */
+static int index_of_cache_block_containing(const struct AnalysisCacheInvalidation *invalidation, const char *position) {
+	int first = 0;
+	int last = invalidation->block_count;
+
+	while (last > first) {
+		const int index = (first + last) / 2;
+		const struct CodeBlock *block = invalidation->blocks + index;
+		if (get_cblock_end(block) <= position) {
+			first = index + 1;
+		}
+		else if (get_cblock_start(block) > position) {
+			last = index;
+		}
+		else {
+			return index;
+		}
+	}
+
+	return -1;
+}
+
+static void invalidate_cache_block(struct AnalysisCacheInvalidation *invalidation, int index) {
+	if (index >= 0 && !get_bitset_value(invalidation->invalid_blocks, index)) {
+		set_bitset_value(invalidation->invalid_blocks, index, 1);
+		invalidation->invalid_count++;
+	}
+}
+
+/**
+ * Whether the given position is not within any loaded block, or it is within one that must be evaluated again.
+ */
+static int is_cache_position_invalid(const struct AnalysisCacheInvalidation *invalidation, const char *position) {
+	const int index = index_of_cache_block_containing(invalidation, position);
+	return index < 0 || get_bitset_value(invalidation->invalid_blocks, index);
+}
+
+/**
+ * Whether the given origin of the block at the given index comes from a block that must be evaluated again,
+ * so that it may not be reached anymore, or not with the same state.
+ *
+ * The OS origin never changes, as the entry point is the same in both builds.
+ */
+static int is_cache_origin_stale(const struct AnalysisCacheInvalidation *invalidation, unsigned int block_index, const struct CodeBlockOrigin *origin) {
+	const struct CodeBlock *block = invalidation->blocks + block_index;
+	const int origin_type = get_cborigin_type(origin);
+
+	if (origin_type == CBORIGIN_TYPE_JUMP || origin_type == CBORIGIN_TYPE_INTERRUPTION) {
+		return is_cache_position_invalid(invalidation, get_cborigin_instruction(origin));
+	}
+	else if (origin_type == CBORIGIN_TYPE_CONTINUE) {
+		return !block_index || get_cblock_end(block - 1) != get_cblock_start(block) || get_bitset_value(invalidation->invalid_blocks, block_index - 1);
+	}
+	else if (origin_type == CBORIGIN_TYPE_CALL_RETURN) {
+		return get_bitset_value(invalidation->stale_returns, block_index) ||
+				is_cache_position_invalid(invalidation, get_cblock_start(block) - get_cborigin_behind_count(origin));
+	}
+
+	return 0;
+}
+
+static void mark_cache_call_return_as_stale(struct AnalysisCacheInvalidation *invalidation, const char *return_position) {
+	const int index = index_of_block_with_start(invalidation->blocks, invalidation->block_count, return_position);
+	if (index >= 0) {
+		set_bitset_value(invalidation->stale_returns, index, 1);
+		invalidate_cache_block(invalidation, index);
+	}
+}
+
+static void push_cache_block_to_walk(struct AnalysisCacheInvalidation *invalidation, unsigned int *pending_count, int index) {
+	if (index >= 0 && !get_bitset_value(invalidation->walked_blocks, index)) {
+		set_bitset_value(invalidation->walked_blocks, index, 1);
+		invalidation->pending_walks[(*pending_count)++] = index;
+	}
+}
+
+/**
+ * Mark as stale the call return origins of the blocks where the function containing the given block may return to.
+ *
+ * The origins are walked backwards in the same way update_call_origins does when a function returns.
+ * The opcodes of the calls are taken from the previous build, as they are the ones that originated the loaded origins.
+ */
+static void walk_cache_call_origins(struct AnalysisCacheInvalidation *invalidation, unsigned int block_index) {
+	unsigned int pending_count = 0;
+
+	push_cache_block_to_walk(invalidation, &pending_count, block_index);
+	while (pending_count) {
+		const unsigned int index = invalidation->pending_walks[--pending_count];
+		const struct CodeBlock *block = invalidation->blocks + index;
+		const struct CodeBlockOriginList *origin_list = get_cblock_origin_list(block);
+		unsigned int origin_index;
+
+		for (origin_index = 0; origin_index < origin_list->origin_count; origin_index++) {
+			const struct CodeBlockOrigin *origin = origin_list->sorted_origins[origin_index];
+			const int origin_type = get_cborigin_type(origin);
+			if (origin_type == CBORIGIN_TYPE_CONTINUE || origin_type == CBORIGIN_TYPE_CALL_RETURN) {
+				if (index > 0 && get_cblock_end(block - 1) == get_cblock_start(block)) {
+					push_cache_block_to_walk(invalidation, &pending_count, index - 1);
+				}
+			}
+			else if (origin_type == CBORIGIN_TYPE_JUMP) {
+				const char *instruction = get_cborigin_instruction(origin);
+				const long offset = instruction - invalidation->buffer;
+				const int opcode0 = invalidation->previous_buffer[offset] & 0xFF;
+				const int opcode1 = (offset + 1 < (long) invalidation->size)? invalidation->previous_buffer[offset + 1] & 0xFF : 0;
+
+				if (opcode0 == 0xE8) { /* CALL */
+					mark_cache_call_return_as_stale(invalidation, instruction + 3);
+				}
+				else if (opcode0 == 0xE9 || (opcode0 & 0xF0) == 0x70 || (opcode0 & 0xFC) == 0xE0 || opcode0 == 0xEB || (opcode0 == 0xFF && (opcode1 & 0x38) == 0x20)) { /* JMP and its variants */
+					push_cache_block_to_walk(invalidation, &pending_count, index_of_cache_block_containing(invalidation, instruction));
+				}
+				else if (opcode0 == 0xFF && (opcode1 & 0x38) == 0x10) {
+					unsigned int instruction_length = 2;
+					if (opcode1 < 0xC0) {
+						if (opcode1 >= 0x80 || (opcode1 & 0xC7) == 0x06) {
+							instruction_length = 4;
+						}
+						else if ((opcode1 & 0xC0) == 0x40) {
+							instruction_length = 3;
+						}
+					}
+
+					mark_cache_call_return_as_stale(invalidation, instruction + instruction_length);
+				}
+			}
+		}
+	}
+}
+
+/**
+ * Invalidate the blocks holding a reference to any invalid variable or block.
+ */
+static void invalidate_cache_referencing_blocks(struct AnalysisCacheInvalidation *invalidation, const struct ProgramContent *pcontent) {
+	const struct Reference *refs = get_pcontent_refs(pcontent);
+	const unsigned int refs_count = get_pcontent_refs_count(pcontent);
+	const struct GlobalVariableList *vars = get_pcontent_vars(pcontent);
+	unsigned int index;
+
+	for (index = 0; index < refs_count; index++) {
+		const struct Reference *ref = refs + index;
+		const struct CodeBlock *target_block = get_cblock_from_ref_target(ref);
+		const int invalid_target = target_block?
+				get_bitset_value(invalidation->invalid_blocks, target_block - invalidation->blocks) :
+				get_bitset_value(invalidation->invalid_vars, index_of_gvar_with_start(vars, get_gvar_start(get_gvar_from_ref_target(ref))));
+
+		if (invalid_target) {
+			invalidate_cache_block(invalidation, index_of_cache_block_containing(invalidation, get_ref_instruction(ref)));
+		}
+	}
+}
+
+/**
+ * Find all blocks that must be evaluated again: the ones containing any changed byte, the ones referencing
+ * any variable containing a changed byte, and, transitively, all blocks reached from any of them,
+ * including the ones where the functions containing them return to.
+ */
+static void find_invalid_cache_blocks(struct AnalysisCacheInvalidation *invalidation, const struct ProgramContent *pcontent) {
+	const struct GlobalVariableList *vars = get_pcontent_vars(pcontent);
+	unsigned int previous_invalid_count;
+	unsigned int index;
+
+	for (index = 0; index < invalidation->size; index++) {
+		if (invalidation->buffer[index] != invalidation->previous_buffer[index]) {
+			set_bitset_value(invalidation->changed_bytes, index, 1);
+		}
+	}
+
+	for (index = 0; index < invalidation->block_count; index++) {
+		const struct CodeBlock *block = invalidation->blocks + index;
+		if (has_changed_bytes_in_range(invalidation, get_cblock_start(block), get_cblock_end(block))) {
+			invalidate_cache_block(invalidation, index);
+		}
+	}
+
+	for (index = 0; index < vars->variable_count; index++) {
+		const struct GlobalVariable *var = vars->sorted_variables[index];
+		if (has_changed_bytes_in_range(invalidation, get_gvar_start(var), get_gvar_end(var))) {
+			set_bitset_value(invalidation->invalid_vars, index, 1);
+		}
+	}
+
+	do {
+		previous_invalid_count = invalidation->invalid_count;
+		for (index = 0; index < invalidation->block_count; index++) {
+			if (get_bitset_value(invalidation->invalid_blocks, index)) {
+				walk_cache_call_origins(invalidation, index);
+			}
+		}
+
+		for (index = 0; index < invalidation->block_count; index++) {
+			const struct CodeBlockOriginList *origin_list = get_cblock_origin_list(invalidation->blocks + index);
+			unsigned int origin_index;
+			for (origin_index = 0; origin_index < origin_list->origin_count && !get_bitset_value(invalidation->invalid_blocks, index); origin_index++) {
+				if (is_cache_origin_stale(invalidation, index, origin_list->sorted_origins[origin_index])) {
+					invalidate_cache_block(invalidation, index);
+				}
+			}
+		}
+
+		invalidate_cache_referencing_blocks(invalidation, pcontent);
+	} while (invalidation->invalid_count != previous_invalid_count);
+}
+
+static int allocate_cache_invalidation(struct AnalysisCacheInvalidation *invalidation, const struct DisasmSession *session, const char *previous_buffer) {
+	const unsigned int var_count = get_pcontent_vars(session->pcontent)->variable_count;
+	invalidation->buffer = session->read_result.buffer;
+	invalidation->previous_buffer = previous_buffer;
+	invalidation->size = session->read_result.size;
+	invalidation->blocks = get_pcontent_blocks(session->pcontent);
+	invalidation->block_count = get_pcontent_block_count(session->pcontent);
+	invalidation->invalid_count = 0;
+	invalidation->changed_bytes = allocate_bitset(invalidation->size);
+	invalidation->invalid_blocks = allocate_bitset(invalidation->block_count + 1);
+	invalidation->stale_returns = allocate_bitset(invalidation->block_count + 1);
+	invalidation->walked_blocks = allocate_bitset(invalidation->block_count + 1);
+	invalidation->pending_walks = malloc((invalidation->block_count + 1) * sizeof(unsigned int));
+	invalidation->invalid_vars = allocate_bitset(var_count + 1);
+	return !invalidation->changed_bytes || !invalidation->invalid_blocks || !invalidation->stale_returns ||
+			!invalidation->walked_blocks || !invalidation->pending_walks || !invalidation->invalid_vars;
+}
+
+static void free_cache_invalidation(struct AnalysisCacheInvalidation *invalidation) {
+	free(invalidation->changed_bytes);
+	free(invalidation->invalid_blocks);
+	free(invalidation->stale_returns);
+	free(invalidation->walked_blocks);
+	free(invalidation->pending_walks);
+	free(invalidation->invalid_vars);
+}
+
+/**
+ * Add to the mutable block list of the session a block for each loaded block that is still reached,
+ * and return them in the given array, at the same index as the loaded ones, or NULL for the ones not reached anymore.
+ *
+ * Valid blocks keep all their origins, and they are marked as evaluated, so that they are only evaluated again
+ * if a new state is merged into them. Invalid blocks only keep the origins that are not stale, and their end is unknown,
+ * so that they are read again. The ones without any origin left are not added, as they will be found again if still reached.
+ */
+static int seed_cache_blocks(struct DisasmSession *session, const struct AnalysisCacheInvalidation *invalidation, struct MutableCodeBlock **new_blocks) {
+	unsigned int index;
+
+	for (index = 0; index < invalidation->block_count; index++) {
+		const struct CodeBlock *block = invalidation->blocks + index;
+		const struct CodeBlockOriginList *origin_list = get_cblock_origin_list(block);
+		const int is_valid = !get_bitset_value(invalidation->invalid_blocks, index);
+		struct MutableCodeBlock *new_block = NULL;
+		struct CodeBlockOriginList *new_origin_list = NULL;
+		unsigned int origin_index;
+		int error_code;
+
+		new_blocks[index] = NULL;
+		for (origin_index = 0; origin_index < origin_list->origin_count; origin_index++) {
+			const struct CodeBlockOrigin *origin = origin_list->sorted_origins[origin_index];
+			struct CodeBlockOrigin *new_origin;
+			if (!is_valid && is_cache_origin_stale(invalidation, index, origin)) {
+				continue;
+			}
+
+			if (!new_block) {
+				if (!(new_block = prepare_new_cblock(&session->cblock_list)) ||
+						(error_code = initialize_mcblock(new_block, &session->arena, &session->snapshots, get_cblock_relative_cs(block), get_cblock_ip(block), get_cblock_start(block)))) {
+					return 1;
+				}
+
+				new_origin_list = get_mcblock_origin_list(new_block);
+			}
+
+			if (!(new_origin = prepare_new_cborigin(new_origin_list)) ||
+					(error_code = initialize_cborigin_with_flags(new_origin, &session->snapshots, origin->flags, origin->instruction, get_cborigin_registers(origin), get_cborigin_stack(origin), get_cborigin_var_values(origin))) ||
+					(error_code = insert_cborigin(new_origin_list, new_origin))) {
+				return 1;
+			}
+		}
+
+		if (!new_block) {
+			DEBUG_PRINT2("Block at +%x:%x is not reached anymore.\n", get_cblock_relative_cs(block), get_cblock_ip(block));
+			continue;
+		}
+
+		if ((error_code = update_mcblock_joined_state(new_block))) {
+			return error_code;
+		}
+
+		if (is_valid) {
+			set_mcblock_end(new_block, get_cblock_end(block));
+			mark_mcblock_as_being_evaluated(new_block);
+			mark_mcblock_as_evaluated(new_block);
+		}
+
+		if ((error_code = insert_cblock(&session->cblock_list, new_block))) {
+			return error_code;
+		}
+
+		new_blocks[index] = new_block;
+	}
+
+	return 0;
+}
+
+/**
+ * Whether the given variable starts right where an invalid block ends, as the tail of an image ending
+ * in the middle of an instruction does. Those variables are found again when the block is evaluated.
+ */
+static int is_cache_gvar_after_invalid_block(const struct AnalysisCacheInvalidation *invalidation, const struct GlobalVariable *var) {
+	const int index = index_of_cache_block_containing(invalidation, get_gvar_start(var) - 1);
+	return index >= 0 && get_bitset_value(invalidation->invalid_blocks, index) && get_cblock_end(invalidation->blocks + index) == get_gvar_start(var);
+}
+
+/**
+ * Add into the given list the loaded variables that are still referenced from valid blocks,
+ * and the ones that were never referenced, unless they come right after an invalid block.
+ * Variables whose bytes changed are only dropped if they are referenced, as the blocks referencing them are invalid.
+ *
+ * Array ends found along the evaluation are kept. The ones matching the start of the next variable,
+ * or the end of the image, were most likely given once the fixpoint was reached, so they are left unknown
+ * to be given again after the new fixpoint, as new variables may be found in between.
+ */
+static int seed_cache_variables(struct DisasmSession *session, const struct AnalysisCacheInvalidation *invalidation, struct GlobalVariableList *new_vars) {
+	const struct GlobalVariableList *vars = get_pcontent_vars(session->pcontent);
+	const struct Reference *refs = get_pcontent_refs(session->pcontent);
+	const unsigned int refs_count = get_pcontent_refs_count(session->pcontent);
+	packed_data_t *referenced;
+	packed_data_t *kept;
+	unsigned int index;
+	int error_code = 0;
+
+	referenced = allocate_bitset(vars->variable_count + 1);
+	kept = allocate_bitset(vars->variable_count + 1);
+	if (!referenced || !kept) {
+		free(referenced);
+		free(kept);
+		return 1;
+	}
+
+	for (index = 0; index < refs_count; index++) {
+		const struct Reference *ref = refs + index;
+		if (!get_cblock_from_ref_target(ref)) {
+			const int var_index = index_of_gvar_with_start(vars, get_gvar_start(get_gvar_from_ref_target(ref)));
+			set_bitset_value(referenced, var_index, 1);
+			if (!is_cache_position_invalid(invalidation, get_ref_instruction(ref))) {
+				set_bitset_value(kept, var_index, 1);
+			}
+		}
+	}
+
+	for (index = 0; index < vars->variable_count && !error_code; index++) {
+		const struct GlobalVariable *var = vars->sorted_variables[index];
+		struct GlobalVariable *new_var;
+		if (get_bitset_value(referenced, index)? !get_bitset_value(kept, index) : is_cache_gvar_after_invalid_block(invalidation, var)) {
+			continue;
+		}
+
+		if (!(new_var = prepare_new_gvar(new_vars))) {
+			error_code = 1;
+			break;
+		}
+
+		initialize_gvar(new_var, get_gvar_start(var), get_gvar_relative_address(var), get_gvar_type(var));
+		if ((get_gvar_type(var) & GVAR_TYPE_ARRAY) && get_gvar_end(var) != invalidation->buffer + invalidation->size &&
+				(index + 1 == vars->variable_count || get_gvar_end(var) != get_gvar_start(vars->sorted_variables[index + 1]))) {
+			set_gvar_end(new_var, get_gvar_end(var));
+		}
+
+		error_code = insert_gvar(new_vars, new_var);
+	}
+
+	free(referenced);
+	free(kept);
+	return error_code;
+}
+
+/**
+ * Add to the mutable reference list of the session the loaded references found in valid blocks,
+ * pointing to the new blocks and variables.
+ */
+static int seed_cache_references(struct DisasmSession *session, const struct AnalysisCacheInvalidation *invalidation, struct MutableCodeBlock **new_blocks, const struct GlobalVariableList *new_vars) {
+	const struct Reference *refs = get_pcontent_refs(session->pcontent);
+	const unsigned int refs_count = get_pcontent_refs_count(session->pcontent);
+	unsigned int index;
+
+	for (index = 0; index < refs_count; index++) {
+		const struct Reference *ref = refs + index;
+		const struct CodeBlock *target_block = get_cblock_from_ref_target(ref);
+		struct MutableReference *new_ref;
+		void *target;
+
+		if (is_cache_position_invalid(invalidation, get_ref_instruction(ref))) {
+			continue;
+		}
+
+		if (target_block) {
+			target = new_blocks[target_block - invalidation->blocks];
+		}
+		else {
+			const int var_index = index_of_gvar_with_start(new_vars, get_gvar_start(get_gvar_from_ref_target(ref)));
+			target = (var_index >= 0)? new_vars->sorted_variables[var_index] : NULL;
+		}
+
+		if (!target) {
+			continue;
+		}
+
+		if (!(new_ref = prepare_new_ref(&session->ref_list))) {
+			return 1;
+		}
+
+		initialize_mref_with_flags(new_ref, target, ref->flags, get_ref_instruction(ref));
+		if (insert_ref(&session->ref_list, new_ref)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Replace the loaded analysis by the mutable lists of the session, seeded with everything that is still valid,
+ * and evaluate again all invalid blocks from there. Segment starts are kept as loaded, as it is not known which
+ * blocks found them.
+ */
+static int restart_cache_analysis(struct DisasmSession *session, const struct AnalysisCacheInvalidation *invalidation) {
+	struct MutableCodeBlock **new_blocks = malloc((invalidation->block_count + 1) * sizeof(struct MutableCodeBlock *));
+	struct GlobalVariableList new_vars;
+	unsigned int index;
+	int error_code;
+
+	if (!new_blocks) {
+		return 1;
+	}
+
+	session->cblock_list.checkpoint_trail = &session->checkpoint_trail;
+	session->cblock_list.checked_blocks = &session->checked_blocks;
+	initialize_gvar_list_in_arena(&new_vars, &session->arena);
+	error_code = seed_cache_blocks(session, invalidation, new_blocks) ||
+			seed_cache_variables(session, invalidation, &new_vars) ||
+			seed_cache_references(session, invalidation, new_blocks, &new_vars);
+	free(new_blocks);
+	if (error_code) {
+		return error_code;
+	}
+
+	/* The new origins took their own references to the loaded states */
+	for (index = 0; index < invalidation->block_count; index++) {
+		const struct CodeBlockOriginList *origin_list = get_cblock_origin_list(invalidation->blocks + index);
+		unsigned int origin_index;
+		for (origin_index = 0; origin_index < origin_list->origin_count; origin_index++) {
+			release_state_snapshot(&session->snapshots, origin_list->sorted_origins[origin_index]->state);
+		}
+	}
+
+	clear_func_list(&session->func_list);
+	free(session->pcontent);
+	session->pcontent = NULL;
+	session->gvar_list = new_vars;
+	session->printer_err.func_list = NULL;
+	session->state = DISASM_SESSION_STATE_OPENED;
+	return analyse_disasm_session(session) || find_disasm_session_functions(session);
+}
+
+int load_previous_build_analysis_cache(struct DisasmSession *session, const struct DisasmSession *previous_session, FILE *file, unsigned int *invalid_block_count) {
+	struct AnalysisCacheInvalidation invalidation;
+	char key[ANALYSIS_CACHE_KEY_LENGTH + 1];
+	int error_code;
+
+	assert(session->state == DISASM_SESSION_STATE_OPENED && previous_session->state != DISASM_SESSION_STATE_EMPTY);
+	if (!have_same_layout(&session->read_result, &previous_session->read_result)) {
+		DEBUG_PRINT0("Previous build has a different layout. Its analysis cannot be reused.\n");
+		return 1;
+	}
+
+	compose_previous_build_cache_key(session, previous_session, key);
+	if (load_analysis_cache_with_key(session, &previous_session->read_result, file, key)) {
+		return 1;
+	}
+
+	if (allocate_cache_invalidation(&invalidation, session, previous_session->read_result.buffer)) {
+		free_cache_invalidation(&invalidation);
+		discard_disasm_session_analysis(session);
+		return 1;
+	}
+
+	find_invalid_cache_blocks(&invalidation, session->pcontent);
+	*invalid_block_count = invalidation.invalid_count;
+	error_code = 0;
+	if (invalidation.invalid_count) {
+		DEBUG_PRINT2("%u of %u blocks are reached by the changed bytes. Evaluating them again.\n", invalidation.invalid_count, invalidation.block_count);
+		if ((error_code = restart_cache_analysis(session, &invalidation))) {
+			discard_disasm_session_analysis(session);
+		}
+	}
+
+	free_cache_invalidation(&invalidation);
+	return error_code;
+}
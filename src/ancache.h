@@ -0,0 +1,67 @@
+#ifndef _ANALYSIS_CACHE_H_
+#define _ANALYSIS_CACHE_H_
+
+#include <stdio.h>
+#include "session.h"
+
+/**
+ * Number of characters of the key identifying an analysis in the cache, without the null terminator.
+ */
+#define ANALYSIS_CACHE_KEY_LENGTH 16
+
+/**
+ * Write into the given key the hash of everything that determines the analysis of the image opened in the session:
+ * the application name and version, the image itself, its relocations, its entry point and the options that may change the result.
+ * Renames and output options are not included, as they only affect the dump.
+ *
+ * The given key must have room for ANALYSIS_CACHE_KEY_LENGTH characters plus the null terminator.
+ * The image must be already opened.
+ */
+void compose_analysis_cache_key(const struct DisasmSession *session, char *key);
+
+/**
+ * Write into the given key the one that the image opened in the previous session had when it was analysed
+ * with the options of the given session. Both images must be already opened.
+ */
+void compose_previous_build_cache_key(const struct DisasmSession *session, const struct DisasmSession *previous_session, char *key);
+
+/**
+ * Write the blocks, variables, references, segment starts and functions found in the session into the given file.
+ * Code blocks origins are stored along with their states, so that the analysis of a later build can be restarted from them.
+ * The image and everything else hashed into the key is stored as well, so that it can be compared when loaded.
+ *
+ * The functions of the session must be already found.
+ * This will return 0 on success, or any other value on failure.
+ */
+int save_analysis_cache(const struct DisasmSession *session, FILE *file);
+
+/**
+ * Restore the analysis written by save_analysis_cache for the image opened in the session,
+ * leaving the session ready to be dumped, as if find_disasm_session_functions had been called.
+ *
+ * The image must be opened, but not analysed yet. The image and options stored in the file are compared with
+ * the ones of the session, as different ones may have the same key. If the file does not belong to the same image and options,
+ * or its contents are not valid, this will return any value different from 0, and the session will remain
+ * opened, so that the image can still be analysed. This will return 0 on success.
+ */
+int load_analysis_cache(struct DisasmSession *session, FILE *file);
+
+/**
+ * Restore the analysis written by save_analysis_cache for the image opened in the previous session,
+ * which must be an earlier build of the image opened in the session, and update it for the current build.
+ *
+ * The analysis is only reused when both images have the same size, relocations and entry point.
+ * Blocks containing any changed byte, or referencing any variable containing one, must be evaluated again,
+ * and so must all blocks reached from them, including the ones where their functions return to, as their states may change.
+ * Everything else is kept, and the evaluation restarts from the invalid blocks until a new fixpoint is reached.
+ * The number of blocks of the previous analysis that were evaluated again is written in the given count,
+ * being 0 when none of the changed bytes was analysed, and then the analysis is reused as it was.
+ *
+ * The result matches the one of analysing the image from scratch in most cases. But, as the states kept are merged with the new ones,
+ * instead of replacing them, some values may be unknown when they would have been known by a whole analysis.
+ *
+ * This will return 0 on success. Otherwise, this will return any other value, and the session will remain opened.
+ */
+int load_previous_build_analysis_cache(struct DisasmSession *session, const struct DisasmSession *previous_session, FILE *file, unsigned int *invalid_block_count);
+
+#endif /* _ANALYSIS_CACHE_H_ */
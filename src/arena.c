@@ -0,0 +1,243 @@
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_CHUNK_SIZE 0x10000
+#define ARENA_MIN_CLASS_SIZE 16
+#define ARENA_MAX_CLASS_SIZE (((size_t) ARENA_MIN_CLASS_SIZE) << (ARENA_SIZE_CLASS_COUNT - 1))
+
+/**
+ * Placed just before each allocation, keeping the number of usable bytes after it.
+ * The other members are only there to ensure that the allocation is properly aligned for any type.
+ */
+union ArenaHeader {
+	size_t size;
+	long long_value;
+	double double_value;
+	void *pointer_value;
+};
+
+struct ArenaChunk {
+	struct ArenaChunk *next;
+
+	/**
+	 * Number of bytes available after this struct.
+	 */
+	size_t data_size;
+
+	/**
+	 * Not used. Only ensures that the data after this struct is properly aligned.
+	 */
+	union ArenaHeader alignment;
+};
+
+/**
+ * Released allocations keep the pointer to the next one in the free list in the place of the data.
+ */
+#define NEXT_RELEASED(header) (*((union ArenaHeader **) ((header) + 1)))
+
+void initialize_arena(struct Arena *arena) {
+	int i;
+	arena->chunks = NULL;
+	arena->next = NULL;
+	arena->end = NULL;
+	for (i = 0; i < ARENA_SIZE_CLASS_COUNT; i++) {
+		arena->free_lists[i] = NULL;
+	}
+
+	arena->large_free_list = NULL;
+	arena->spare_chunks = NULL;
+	arena->used_bytes = 0;
+	arena->peak_bytes = 0;
+	arena->reserved_bytes = 0;
+	arena->heap_allocation_count = NULL;
+}
+
+static int size_class_for(size_t size) {
+	int size_class = 0;
+	size_t class_size = ARENA_MIN_CLASS_SIZE;
+	while (class_size < size) {
+		class_size <<= 1;
+		size_class++;
+	}
+
+	return size_class;
+}
+
+static union ArenaHeader *take_from_chunk(struct Arena *arena, size_t size) {
+	const size_t required = sizeof(union ArenaHeader) + size;
+	union ArenaHeader *header;
+
+	if (!arena->next || (size_t) (arena->end - arena->next) < required) {
+		struct ArenaChunk **link = &arena->spare_chunks;
+		struct ArenaChunk *chunk;
+		while (*link && (*link)->data_size < required) {
+			link = &(*link)->next;
+		}
+
+		chunk = *link;
+		if (chunk) {
+			*link = chunk->next;
+		}
+		else {
+			const size_t chunk_data_size = (required > ARENA_CHUNK_SIZE)? required : ARENA_CHUNK_SIZE;
+			chunk = malloc(sizeof(struct ArenaChunk) + chunk_data_size);
+			if (arena->heap_allocation_count) {
+				++*arena->heap_allocation_count;
+			}
+
+			if (!chunk) {
+				return NULL;
+			}
+
+			chunk->data_size = chunk_data_size;
+			arena->reserved_bytes += sizeof(struct ArenaChunk) + chunk_data_size;
+		}
+
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+		arena->next = (char *) (chunk + 1);
+		arena->end = arena->next + chunk->data_size;
+	}
+
+	header = (union ArenaHeader *) arena->next;
+	arena->next += required;
+	header->size = size;
+	return header;
+}
+
+void *allocate_in_arena(struct Arena *arena, size_t size) {
+	union ArenaHeader *header;
+
+	if (!arena) {
+		return malloc(size);
+	}
+
+	if (size <= ARENA_MAX_CLASS_SIZE) {
+		const int size_class = size_class_for(size);
+		header = arena->free_lists[size_class];
+		if (header) {
+			arena->free_lists[size_class] = NEXT_RELEASED(header);
+		}
+		else if (!(header = take_from_chunk(arena, ((size_t) ARENA_MIN_CLASS_SIZE) << size_class))) {
+			return NULL;
+		}
+	}
+	else {
+		union ArenaHeader **link = &arena->large_free_list;
+		size = (size + sizeof(union ArenaHeader) - 1) / sizeof(union ArenaHeader) * sizeof(union ArenaHeader);
+		while (*link && (*link)->size < size) {
+			link = &NEXT_RELEASED(*link);
+		}
+
+		header = *link;
+		if (header) {
+			*link = NEXT_RELEASED(header);
+		}
+		else if (!(header = take_from_chunk(arena, size))) {
+			return NULL;
+		}
+	}
+
+	arena->used_bytes += sizeof(union ArenaHeader) + header->size;
+	if (arena->used_bytes > arena->peak_bytes) {
+		arena->peak_bytes = arena->used_bytes;
+	}
+
+	return header + 1;
+}
+
+void *reallocate_in_arena(struct Arena *arena, void *pointer, size_t size) {
+	union ArenaHeader *header;
+	void *new_pointer;
+
+	if (!arena) {
+		return realloc(pointer, size);
+	}
+
+	if (!pointer) {
+		return allocate_in_arena(arena, size);
+	}
+
+	header = ((union ArenaHeader *) pointer) - 1;
+	if (size <= header->size) {
+		return pointer;
+	}
+
+	new_pointer = allocate_in_arena(arena, size);
+	if (new_pointer) {
+		memcpy(new_pointer, pointer, header->size);
+		release_in_arena(arena, pointer);
+	}
+
+	return new_pointer;
+}
+
+void release_in_arena(struct Arena *arena, void *pointer) {
+	union ArenaHeader *header;
+
+	if (!arena) {
+		free(pointer);
+		return;
+	}
+
+	if (!pointer) {
+		return;
+	}
+
+	header = ((union ArenaHeader *) pointer) - 1;
+	arena->used_bytes -= sizeof(union ArenaHeader) + header->size;
+	if (header->size <= ARENA_MAX_CLASS_SIZE) {
+		const int size_class = size_class_for(header->size);
+		NEXT_RELEASED(header) = arena->free_lists[size_class];
+		arena->free_lists[size_class] = header;
+	}
+	else {
+		NEXT_RELEASED(header) = arena->large_free_list;
+		arena->large_free_list = header;
+	}
+}
+
+size_t get_arena_peak_bytes(const struct Arena *arena) {
+	return arena->peak_bytes;
+}
+
+unsigned long get_arena_heap_allocation_count(const struct Arena *arena) {
+	return (arena && arena->heap_allocation_count)? *arena->heap_allocation_count : 0;
+}
+
+void reset_arena(struct Arena *arena) {
+	int i;
+	while (arena->chunks) {
+		struct ArenaChunk *chunk = arena->chunks;
+		arena->chunks = chunk->next;
+		chunk->next = arena->spare_chunks;
+		arena->spare_chunks = chunk;
+	}
+
+	arena->next = NULL;
+	arena->end = NULL;
+	for (i = 0; i < ARENA_SIZE_CLASS_COUNT; i++) {
+		arena->free_lists[i] = NULL;
+	}
+
+	arena->large_free_list = NULL;
+	arena->used_bytes = 0;
+	arena->peak_bytes = 0;
+}
+
+static void free_chunks(struct ArenaChunk *chunk) {
+	while (chunk) {
+		struct ArenaChunk *next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+}
+
+void clear_arena(struct Arena *arena) {
+	unsigned long *heap_allocation_count = arena->heap_allocation_count;
+	free_chunks(arena->chunks);
+	free_chunks(arena->spare_chunks);
+	initialize_arena(arena);
+	arena->heap_allocation_count = heap_allocation_count;
+}
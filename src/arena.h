@@ -0,0 +1,126 @@
+#ifndef _ARENA_H_
+#define _ARENA_H_
+
+#include <stddef.h>
+
+/**
+ * Number of size classes for small allocations.
+ * Sizes are rounded to the next power of 2, from 16 bytes up to 1 MiB.
+ */
+#define ARENA_SIZE_CLASS_COUNT 17
+
+/**
+ * Region of memory where all the objects of an analysis session can be allocated.
+ *
+ * Memory is requested to the system in big chunks, and all of them are
+ * returned at once when the arena is cleared. This way, there is no need to
+ * free each object one by one when the session finishes.
+ *
+ * Objects can still be released or reallocated before the arena is cleared.
+ * Released memory is not returned to the system, but kept in free lists
+ * to be reused by following allocations of a similar size.
+ *
+ * All the allocation methods accept a NULL arena. In that case, they behave
+ * exactly like malloc, realloc and free, and their calls are not counted.
+ */
+struct Arena {
+	/**
+	 * Linked list of all chunks requested to the system, the most recent first.
+	 */
+	struct ArenaChunk *chunks;
+
+	/**
+	 * First position available for new allocations within the most recent chunk.
+	 */
+	char *next;
+
+	/**
+	 * First position outside the most recent chunk.
+	 */
+	char *end;
+
+	/**
+	 * Linked lists of released allocations, one per size class.
+	 */
+	union ArenaHeader *free_lists[ARENA_SIZE_CLASS_COUNT];
+
+	/**
+	 * Linked list of released allocations bigger than the largest size class.
+	 */
+	union ArenaHeader *large_free_list;
+
+	/**
+	 * Chunks that were in use before the arena was reset, to be used again before requesting new ones to the system.
+	 */
+	struct ArenaChunk *spare_chunks;
+
+	/**
+	 * Bytes currently allocated and not released, including headers.
+	 */
+	size_t used_bytes;
+
+	/**
+	 * Maximum value that used_bytes has reached since this arena was initialized, reset or cleared.
+	 */
+	size_t peak_bytes;
+
+	/**
+	 * Total bytes requested to the system.
+	 */
+	size_t reserved_bytes;
+
+	/**
+	 * Counter incremented each time this arena requests memory to the system, or NULL if they are not counted.
+	 * Several arenas can share the same counter.
+	 */
+	unsigned long *heap_allocation_count;
+};
+
+/**
+ * Set all its values. After this, the arena will be empty, but ready.
+ */
+void initialize_arena(struct Arena *arena);
+
+/**
+ * Returns a pointer to a new memory region of at least the given size, or NULL in case of failure.
+ */
+void *allocate_in_arena(struct Arena *arena, size_t size);
+
+/**
+ * Returns a pointer to a memory region of at least the given size, keeping the content of the given one.
+ *
+ * The given pointer must be NULL, or one returned by allocate_in_arena or reallocate_in_arena on the same arena.
+ * As in realloc, the given pointer should not be used after calling this method, unless NULL is returned.
+ */
+void *reallocate_in_arena(struct Arena *arena, void *pointer, size_t size);
+
+/**
+ * Marks the given memory region as available to be reused by following allocations.
+ * The given pointer must be NULL, or one returned by allocate_in_arena or reallocate_in_arena on the same arena.
+ */
+void release_in_arena(struct Arena *arena, void *pointer);
+
+/**
+ * Returns the maximum number of bytes allocated at the same time in this arena.
+ */
+size_t get_arena_peak_bytes(const struct Arena *arena);
+
+/**
+ * Returns the value of the heap allocation counter of the given arena, or 0 if the arena is NULL or it has no counter.
+ * Allocations served from memory already reserved by the arena are not counted.
+ */
+unsigned long get_arena_heap_allocation_count(const struct Arena *arena);
+
+/**
+ * Releases all allocations at once, but keeps the memory reserved, so that following allocations do not need to request it again to the system.
+ * All pointers returned by this arena will be invalid after calling this method.
+ */
+void reset_arena(struct Arena *arena);
+
+/**
+ * Returns all the memory to the system at once, and restores this arena to its initial state, keeping its heap allocation counter.
+ * All pointers returned by this arena will be invalid after calling this method.
+ */
+void clear_arena(struct Arena *arena);
+
+#endif /* _ARENA_H_ */
@@ -5,7 +5,19 @@
 #define PAGE_ARRAY_GRANULARITY 8
 #define ORIGINS_PER_PAGE 4
 
-DEFINE_STRUCT_LIST_INITIALIZE_METHOD(CodeBlockOrigin, cborigin, origin)
+void initialize_cborigin_list_in_arena(struct CodeBlockOriginList *list, struct Arena *arena) {
+	list->origin_count = 0;
+	list->page_array = NULL;
+	list->sorted_origins = NULL;
+	list->arena = arena;
+	list->snapshots = NULL;
+}
+
+void initialize_cborigin_list(struct CodeBlockOriginList *list) {
+	initialize_cborigin_list_in_arena(list, NULL);
+}
+
+DEFINE_STRUCT_LIST_GET_UNSORTED_METHOD(CodeBlockOrigin, cborigin, ORIGINS_PER_PAGE)
 
 int index_of_cborigin_with_type_interruption(const struct CodeBlockOriginList *list) {
 	int first = 0;
@@ -107,52 +119,6 @@ int insert_cborigin(struct CodeBlockOriginList *list, struct CodeBlockOrigin *ne
 
 DEFINE_STRUCT_LIST_CLEAR_METHOD(CodeBlockOrigin, cborigin, origin, ORIGINS_PER_PAGE)
 
-void accumulate_registers_from_cbolist(struct Registers *regs, const struct CodeBlockOriginList *list) {
-	if (list->origin_count) {
-		int i;
-		copy_registers(regs, get_cborigin_registers_const(list->sorted_origins[0]));
-		for (i = 1; i < list->origin_count; i++) {
-			merge_registers(regs, get_cborigin_registers_const(list->sorted_origins[i]));
-		}
-	}
-}
-
-int accumulate_stack_from_cbolist(struct Stack *stack, const struct CodeBlockOriginList *list) {
-	initialize_stack(stack);
-	if (list->origin_count) {
-		int error_code;
-		int i;
-		if ((error_code = copy_stack(stack, get_cborigin_stack(list->sorted_origins[0])))) {
-			return error_code;
-		}
-
-		for (i = 1; i < list->origin_count; i++) {
-			merge_stacks(stack, get_cborigin_stack(list->sorted_origins[i]));
-		}
-	}
-
-	return 0;
-}
-
-int accumulate_gvwvmap_from_cbolist(struct GlobalVariableWordValueMap *map, const struct CodeBlockOriginList *list) {
-	initialize_gvwvmap(map);
-	if (list->origin_count) {
-		int error_code;
-		int i;
-		if ((error_code = copy_gvwvmap(map, get_cborigin_var_values(list->sorted_origins[0])))) {
-			return error_code;
-		}
-
-		for (i = 1; i < list->origin_count; i++) {
-			if ((error_code = merge_gvwvmap(map, get_cborigin_var_values(list->sorted_origins[i])))) {
-				return error_code;
-			}
-		}
-	}
-
-	return 0;
-}
-
 int index_of_first_cborigin_of_type_call_return(const struct CodeBlockOriginList *list) {
 	int index;
 	for (index = 0; index < list->origin_count; index++) {
@@ -229,7 +195,7 @@ int add_call_return_type_cborigin(struct CodeBlockOriginList *list, unsigned int
 			return 1;
 		}
 
-		if ((error_code = initialize_cborigin_as_call_return(new_origin, behind_count, regs, stack, var_values))) {
+		if ((error_code = initialize_cborigin_as_call_return(new_origin, list->snapshots, behind_count, regs, stack, var_values))) {
 			return error_code;
 		}
 
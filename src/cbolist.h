@@ -38,6 +38,17 @@ struct CodeBlockOriginList {
 	 * to hold all of them.
 	 */
 	unsigned int origin_count;
+
+	/**
+	 * Arena where all pages and arrays are allocated, or NULL to allocate them directly with malloc.
+	 */
+	struct Arena *arena;
+
+	/**
+	 * Store where the states of all origins in this list are interned.
+	 * This is NULL after initializing the list, and must be set before adding any origin.
+	 */
+	struct StateSnapshotStore *snapshots;
 };
 
 DECLARE_STRUCT_LIST_METHODS(CodeBlockOrigin, cborigin, origin, instruction);
@@ -58,10 +69,6 @@ int index_of_cborigin_of_type_continue(const struct CodeBlockOriginList *list);
 int index_of_first_cborigin_of_type_call_return(const struct CodeBlockOriginList *list);
 int index_of_cborigin_of_type_call_return(const struct CodeBlockOriginList *list, unsigned int behind_count);
 
-void accumulate_registers_from_cbolist(struct Registers *regs, const struct CodeBlockOriginList *list);
-int accumulate_stack_from_cbolist(struct Stack *stack, const struct CodeBlockOriginList *list);
-int accumulate_gvwvmap_from_cbolist(struct GlobalVariableWordValueMap *map, const struct CodeBlockOriginList *list);
-
 int add_call_return_type_cborigin(struct CodeBlockOriginList *list, unsigned int behind_count, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values);
 
 #endif /* _CODE_BLOCK_ORIGIN_LIST_H_ */
@@ -1,4 +1,5 @@
 #include "cborigin.h"
+#include "stats.h"
 #include <assert.h>
 
 #define CBORIGIN_TYPE_MASK 7
@@ -24,54 +25,70 @@ const char *CBORIGIN_TYPE_NAME[] = {
 
 #include <stdlib.h>
 
-void initialize_cborigin_as_os(struct CodeBlockOrigin *origin, uint16_t relative_cs, int ds_defined_like_cs) {
+int initialize_cborigin_as_os(struct CodeBlockOrigin *origin, struct StateSnapshotStore *snapshots, uint16_t relative_cs, int ds_defined_like_cs) {
+	struct Registers regs;
+	struct Stack empty_stack;
+	struct GlobalVariableWordValueMap empty_var_values;
+	STATS_INCREMENT(snapshots->stats, origins_created);
+
 	origin->flags = CBORIGIN_TYPE_OS;
-	set_all_registers_undefined(&origin->regs);
-	set_register_cs_relative(&origin->regs, NULL, NULL, relative_cs);
+	initialize_registers(&regs, NULL);
+	set_register_cs_relative(&regs, NULL, NULL, relative_cs);
 	if (ds_defined_like_cs) {
-		set_register_ds_relative(&origin->regs, NULL, NULL, relative_cs);
+		set_register_ds_relative(&regs, NULL, NULL, relative_cs);
 	}
-	initialize_stack(&origin->stack);
-	initialize_gvwvmap(&origin->var_values);
+
+	initialize_stack(&empty_stack);
+	initialize_gvwvmap(&empty_var_values);
+	origin->state = intern_state_snapshot(snapshots, &regs, &empty_stack, &empty_var_values);
+	return !origin->state;
 }
 
-int initialize_cborigin_as_interruption(struct CodeBlockOrigin *origin, const struct Registers *regs, const struct GlobalVariableWordValueMap *var_values) {
+int initialize_cborigin_as_interruption(struct CodeBlockOrigin *origin, struct StateSnapshotStore *snapshots, const char *instruction, const struct Registers *regs, const struct GlobalVariableWordValueMap *var_values) {
+	struct Stack empty_stack;
+	STATS_INCREMENT(snapshots->stats, origins_created);
+
 	origin->flags = CBORIGIN_TYPE_INTERRUPTION;
-	copy_registers(&origin->regs, regs);
-	initialize_stack(&origin->stack);
-	initialize_gvwvmap(&origin->var_values);
-	return copy_gvwvmap(&origin->var_values, var_values);
-}
-
-static int initialize_cborigin_structs(struct CodeBlockOrigin *origin, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
-	int error_code;
-	copy_registers(&origin->regs, regs);
-	initialize_stack(&origin->stack);
-	if ((error_code = copy_stack(&origin->stack, stack))) {
-		return error_code;
-	}
+	origin->instruction = instruction;
+	initialize_stack(&empty_stack);
+	origin->state = intern_state_snapshot(snapshots, regs, &empty_stack, var_values);
+	return !origin->state;
+}
 
-	initialize_gvwvmap(&origin->var_values);
-	return copy_gvwvmap(&origin->var_values, var_values);
+static int initialize_cborigin_state(struct CodeBlockOrigin *origin, struct StateSnapshotStore *snapshots, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
+	STATS_INCREMENT(snapshots->stats, origins_created);
+	origin->state = intern_state_snapshot(snapshots, regs, stack, var_values);
+	return !origin->state;
 }
 
-int initialize_cborigin_as_continue(struct CodeBlockOrigin *origin, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
+int initialize_cborigin_as_continue(struct CodeBlockOrigin *origin, struct StateSnapshotStore *snapshots, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
 	origin->flags = CBORIGIN_TYPE_CONTINUE;
-	return initialize_cborigin_structs(origin, regs, stack, var_values);
+	return initialize_cborigin_state(origin, snapshots, regs, stack, var_values);
 }
 
-int initialize_cborigin_as_call_return(struct CodeBlockOrigin *origin, unsigned int behind_count, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
+int initialize_cborigin_as_call_return(struct CodeBlockOrigin *origin, struct StateSnapshotStore *snapshots, unsigned int behind_count, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
 	unsigned int shifted = behind_count << CBORIGIN_BEHIND_COUNT_SHIFT;
 	assert((shifted & CBORIGIN_BEHIND_COUNT_MASK) == shifted);
 	origin->flags = CBORIGIN_TYPE_CALL_RETURN | (behind_count << CBORIGIN_BEHIND_COUNT_SHIFT);
-	return initialize_cborigin_structs(origin, regs, stack, var_values);
+	return initialize_cborigin_state(origin, snapshots, regs, stack, var_values);
 }
 
-int initialize_cborigin_as_jump(struct CodeBlockOrigin *origin, const char *instruction, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
-	int error_code;
+int initialize_cborigin_as_jump(struct CodeBlockOrigin *origin, struct StateSnapshotStore *snapshots, const char *instruction, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
 	origin->flags = CBORIGIN_TYPE_JUMP;
 	origin->instruction = instruction;
-	return initialize_cborigin_structs(origin, regs, stack, var_values);
+	return initialize_cborigin_state(origin, snapshots, regs, stack, var_values);
+}
+
+int initialize_cborigin_with_flags(struct CodeBlockOrigin *origin, struct StateSnapshotStore *snapshots, unsigned int flags, const char *instruction, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
+	const unsigned int type = flags & CBORIGIN_TYPE_MASK;
+	if (type > CBORIGIN_TYPE_JUMP || (flags & ~(CBORIGIN_TYPE_MASK | CBORIGIN_BEHIND_COUNT_MASK)) ||
+			(type != CBORIGIN_TYPE_CALL_RETURN && (flags & CBORIGIN_BEHIND_COUNT_MASK))) {
+		return 1;
+	}
+
+	origin->flags = flags;
+	origin->instruction = (type == CBORIGIN_TYPE_JUMP || type == CBORIGIN_TYPE_INTERRUPTION)? instruction : NULL;
+	return initialize_cborigin_state(origin, snapshots, regs, stack, var_values);
 }
 
 int get_cborigin_type(const struct CodeBlockOrigin *origin) {
@@ -79,24 +96,45 @@ int get_cborigin_type(const struct CodeBlockOrigin *origin) {
 }
 
 const char *get_cborigin_instruction(const struct CodeBlockOrigin *origin) {
-	assert(get_cborigin_type(origin) == CBORIGIN_TYPE_JUMP);
+	assert(get_cborigin_type(origin) == CBORIGIN_TYPE_JUMP || get_cborigin_type(origin) == CBORIGIN_TYPE_INTERRUPTION);
 	return origin->instruction;
 }
 
-const struct Registers *get_cborigin_registers_const(const struct CodeBlockOrigin *origin) {
-	return &origin->regs;
+const struct Registers *get_cborigin_registers(const struct CodeBlockOrigin *origin) {
+	return &origin->state->regs;
+}
+
+const struct Stack *get_cborigin_stack(const struct CodeBlockOrigin *origin) {
+	return &origin->state->stack;
+}
+
+const struct GlobalVariableWordValueMap *get_cborigin_var_values(const struct CodeBlockOrigin *origin) {
+	return &origin->state->var_values;
+}
+
+int prepare_cborigin_for_update(struct CodeBlockOrigin *origin, struct StateSnapshotStore *snapshots) {
+	struct StateSnapshot *state = make_state_snapshot_writable(snapshots, origin->state);
+	if (!state) {
+		return 1;
+	}
+
+	origin->state = state;
+	return 0;
 }
 
-struct Registers *get_cborigin_registers(struct CodeBlockOrigin *origin) {
-	return &origin->regs;
+struct Registers *get_cborigin_writable_registers(struct CodeBlockOrigin *origin) {
+	assert(origin->state->reference_count == 1 && !origin->state->interned);
+	return &origin->state->regs;
 }
 
-struct Stack *get_cborigin_stack(struct CodeBlockOrigin *origin) {
-	return &origin->stack;
+struct Stack *get_cborigin_writable_stack(struct CodeBlockOrigin *origin) {
+	assert(origin->state->reference_count == 1 && !origin->state->interned);
+	return &origin->state->stack;
 }
 
-struct GlobalVariableWordValueMap *get_cborigin_var_values(struct CodeBlockOrigin *origin) {
-	return &origin->var_values;
+struct GlobalVariableWordValueMap *get_cborigin_writable_var_values(struct CodeBlockOrigin *origin) {
+	assert(origin->state->reference_count == 1 && !origin->state->interned);
+	return &origin->state->var_values;
 }
 
 int get_cborigin_behind_count(const struct CodeBlockOrigin *origin) {
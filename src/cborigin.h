@@ -1,9 +1,7 @@
 #ifndef _CODE_BLOCK_ORIGIN_H_
 #define _CODE_BLOCK_ORIGIN_H_
 
-#include "register.h"
-#include "stack.h"
-#include "gvwvmap.h"
+#include "snapshot.h"
 
 /**
  * Denotes that this block is accessed directly by the OS. This is mainly saying that this block is the starting point of our executable.
@@ -15,7 +13,8 @@
 /**
  * Denotes that this block is accessed as a interruption handler.
  *
- * When the type is selected. value in instruction should be ignored.
+ * When the type is selected. instruction field will point to the instruction
+ * that set this block as the handler, if known.
  */
 #define CBORIGIN_TYPE_INTERRUPTION 1
 
@@ -72,68 +71,79 @@ struct CodeBlockOrigin {
 	unsigned int flags;
 
 	/**
-	 * Instruction that performs the jump or call to this block.
+	 * Instruction that performs the jump or call to this block, or the one setting it as an interruption handler.
 	 *
-	 * The value in this field is only valid if this origin has type JUMP.
+	 * The value in this field is only valid if this origin has type JUMP or INTERRUPTION.
 	 * Call get_cborigin_type method to determine the correct type before relaying on this field.
 	 */
 	const char *instruction;
 
 	/**
-	 * State of the registers when the block is accessed by this origin.
+	 * State of the registers, stack and global variables when the block is accessed by this origin.
 	 *
 	 * In case cs is set to undefined, it means that values in regs and var_values are completelly unknown for now.
 	 * This is a typical situation reached when the origin is the result of a call return, and we do not know yet what the function is returning.
+	 *
+	 * This snapshot may be shared with other origins reached with the same state, so it must not be modified
+	 * without calling prepare_cborigin_for_update first.
 	 */
-	struct Registers regs;
-
-	struct Stack stack;
-
-	/**
-	 * State of all known global variables when the block is accessed by this origin.
-	 */
-	struct GlobalVariableWordValueMap var_values;
+	struct StateSnapshot *state;
 };
 
 /**
  * Initialize the given origin setting its type to os.
  * This method will assume that all the contents in the given origin struct is rubbish and can be overridden without problem.
+ * Its state will be taken from the given store, sharing it with any other origin having the same state.
  * This method will set all registers undefined, except for the given CS and DS if ds_defined_like_cs is different from 0.
  * This method will will initialize its stack and var_values completelly empty.
+ * This method will return 0 if all goes OK.
  */
-void initialize_cborigin_as_os(struct CodeBlockOrigin *origin, uint16_t relative_cs, int ds_defined_like_cs);
+int initialize_cborigin_as_os(struct CodeBlockOrigin *origin, struct StateSnapshotStore *snapshots, uint16_t relative_cs, int ds_defined_like_cs);
 
 /**
- * Initialize the given origin setting its type to interruption.
+ * Initialize the given origin setting its type to interruption, and the given instruction as the one setting the handler.
  * This method will assume that all the contents in the given origin struct is rubbish and can be overridden without problem.
- * This method will copy the given registers and variable values into the origin, and will reset the contained stack to an empty one.
+ * Its state will be taken from the given store, sharing it with any other origin having the same state.
+ * This method will take the given registers and variable values as the origin state, with an empty stack.
  * This method will return 0 if all goes OK.
  */
-int initialize_cborigin_as_interruption(struct CodeBlockOrigin *origin, const struct Registers *regs, const struct GlobalVariableWordValueMap *var_values);
+int initialize_cborigin_as_interruption(struct CodeBlockOrigin *origin, struct StateSnapshotStore *snapshots, const char *instruction, const struct Registers *regs, const struct GlobalVariableWordValueMap *var_values);
 
 /**
  * Initialize the given origin setting its type to continue.
  * This method will assume that all the contents in the given origin struct is rubbish and can be overridden without problem.
- * This method will copy the given registers, stack and variable values into the origin.
+ * Its state will be taken from the given store, sharing it with any other origin having the same state.
+ * This method will take the given registers, stack and variable values as the origin state.
  * This method will return 0 if all goes OK.
  */
-int initialize_cborigin_as_continue(struct CodeBlockOrigin *origin, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values);
+int initialize_cborigin_as_continue(struct CodeBlockOrigin *origin, struct StateSnapshotStore *snapshots, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values);
 
 /**
  * Initialize the given origin setting its type to call return.
  * This method will assume that all the contents in the given origin struct is rubbish and can be overridden without problem.
- * This method will copy the given registers, stack and variable values into the origin.
+ * Its state will be taken from the given store, sharing it with any other origin having the same state.
+ * This method will take the given registers, stack and variable values as the origin state.
  * This method will return 0 if all goes OK.
  */
-int initialize_cborigin_as_call_return(struct CodeBlockOrigin *origin, unsigned int behind_count, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values);
+int initialize_cborigin_as_call_return(struct CodeBlockOrigin *origin, struct StateSnapshotStore *snapshots, unsigned int behind_count, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values);
 
 /**
  * Initialize the given origin setting its type to jump, and the given instruction as the one performing the jump.
  * This method will assume that all the contents in the given origin struct is rubbish and can be overridden without problem.
- * This method will copy the given registers, stack and variable values into the origin.
+ * Its state will be taken from the given store, sharing it with any other origin having the same state.
+ * This method will take the given registers, stack and variable values as the origin state.
  * This method will return 0 if all goes OK.
  */
-int initialize_cborigin_as_jump(struct CodeBlockOrigin *origin, const char *instruction, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values);
+int initialize_cborigin_as_jump(struct CodeBlockOrigin *origin, struct StateSnapshotStore *snapshots, const char *instruction, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values);
+
+/**
+ * Initialize the given origin with the flags and instruction of an origin found by a previous analysis of the same image.
+ * This method will assume that all the contents in the given origin struct is rubbish and can be overridden without problem.
+ * Its state will be taken from the given store, sharing it with any other origin having the same state.
+ * This method will take the given registers, stack and variable values as the origin state.
+ * This method will return 0 if all goes OK, or any other value if the given flags do not match any valid origin.
+ */
+int initialize_cborigin_with_flags(struct CodeBlockOrigin *origin, struct StateSnapshotStore *snapshots, unsigned int flags, const char *instruction, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values);
 
 /**
  * Return the type of code block origin. They can be any of the values represented by CODE_BLOCK_ORIGIN_TYPE_*.
@@ -141,30 +151,51 @@ int initialize_cborigin_as_jump(struct CodeBlockOrigin *origin, const char *inst
 int get_cborigin_type(const struct CodeBlockOrigin *origin);
 
 /**
- * Return a pointer to the instruction that performs the jump or call to the block.
- * This method should only be called if the origin type is JUMP.
+ * Return a pointer to the instruction that performs the jump or call to the block,
+ * or the one that set the block as an interruption handler.
+ * This method should only be called if the origin type is JUMP or INTERRUPTION.
  */
 const char *get_cborigin_instruction(const struct CodeBlockOrigin *origin);
 
 /**
  * Return a pointer to the registers for this origin.
  */
-const struct Registers *get_cborigin_registers_const(const struct CodeBlockOrigin *origin);
+const struct Registers *get_cborigin_registers(const struct CodeBlockOrigin *origin);
 
 /**
- * Return a pointer to the registers for this origin.
+ * Return a pointer to the stack for this origin.
  */
-struct Registers *get_cborigin_registers(struct CodeBlockOrigin *origin);
+const struct Stack *get_cborigin_stack(const struct CodeBlockOrigin *origin);
 
 /**
- * Return a pointer to the stack for this origin.
+ * Return a pointer to the word variable values for this origin.
  */
-struct Stack *get_cborigin_stack(struct CodeBlockOrigin *origin);
+const struct GlobalVariableWordValueMap *get_cborigin_var_values(const struct CodeBlockOrigin *origin);
 
 /**
- * Return a pointer to the word variable values for this origin.
+ * Ensure that the state of this origin is not shared with any other origin, so that it can be modified.
+ * The given store must be the one used to initialize the origin.
+ * This method will return 0 if all goes OK.
+ */
+int prepare_cborigin_for_update(struct CodeBlockOrigin *origin, struct StateSnapshotStore *snapshots);
+
+/**
+ * Return a pointer to the registers for this origin, that can be modified.
+ * prepare_cborigin_for_update must be called before.
+ */
+struct Registers *get_cborigin_writable_registers(struct CodeBlockOrigin *origin);
+
+/**
+ * Return a pointer to the stack for this origin, that can be modified.
+ * prepare_cborigin_for_update must be called before.
+ */
+struct Stack *get_cborigin_writable_stack(struct CodeBlockOrigin *origin);
+
+/**
+ * Return a pointer to the word variable values for this origin, that can be modified.
+ * prepare_cborigin_for_update must be called before.
  */
-struct GlobalVariableWordValueMap *get_cborigin_var_values(struct CodeBlockOrigin *origin);
+struct GlobalVariableWordValueMap *get_cborigin_writable_var_values(struct CodeBlockOrigin *origin);
 
 /**
  * Return the number of bytes that must be substrated to the start of this
@@ -0,0 +1,160 @@
+#include "checkpt.h"
+
+#define CHECKPOINT_ARRAY_GRANULARITY 32
+#define CHECKPOINT_MEMORY_ARRAY_GRANULARITY 8
+
+void initialize_checkpoint_trail_in_arena(struct StateCheckpointTrail *trail, struct Arena *arena) {
+	trail->block = NULL;
+	trail->checkpoints = NULL;
+	trail->checkpoint_count = 0;
+	trail->initialized_count = 0;
+	trail->capacity = 0;
+	trail->memories = NULL;
+	trail->memory_count = 0;
+	trail->initialized_memory_count = 0;
+	trail->memory_capacity = 0;
+	trail->hit_count = 0;
+	trail->miss_count = 0;
+	trail->arena = arena;
+}
+
+void start_checkpoint_trail(struct StateCheckpointTrail *trail, const struct MutableCodeBlock *block) {
+	trail->block = block;
+	trail->checkpoint_count = 0;
+	trail->memory_count = 0;
+}
+
+/**
+ * Set in memory_index the memory holding the given stack and values, recording a new one if they differ from the last one.
+ * This will return 0 on success, or any other value if memory cannot be allocated.
+ */
+static int record_checkpoint_memory(struct StateCheckpointTrail *trail, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values, unsigned int *memory_index) {
+	struct StateCheckpointMemory *memory;
+	int error_code;
+
+	if (trail->memory_count) {
+		memory = trail->memories + trail->memory_count - 1;
+		if (are_stacks_equal(&memory->stack, stack) && are_gvwvmaps_equal(&memory->var_values, var_values)) {
+			*memory_index = trail->memory_count - 1;
+			return 0;
+		}
+	}
+
+	if (trail->memory_count == trail->memory_capacity) {
+		const unsigned int new_capacity = trail->memory_capacity + CHECKPOINT_MEMORY_ARRAY_GRANULARITY;
+		struct StateCheckpointMemory *new_memories = reallocate_in_arena(trail->arena, trail->memories, new_capacity * sizeof(struct StateCheckpointMemory));
+		if (!new_memories) {
+			return 1;
+		}
+
+		trail->memories = new_memories;
+		trail->memory_capacity = new_capacity;
+	}
+
+	memory = trail->memories + trail->memory_count;
+	if (trail->memory_count == trail->initialized_memory_count) {
+		initialize_stack_in_arena(&memory->stack, trail->arena);
+		initialize_gvwvmap_in_arena(&memory->var_values, trail->arena);
+		trail->initialized_memory_count++;
+	}
+
+	if ((error_code = copy_stack(&memory->stack, stack)) ||
+			(error_code = copy_gvwvmap(&memory->var_values, var_values))) {
+		return error_code;
+	}
+
+	*memory_index = trail->memory_count++;
+	return 0;
+}
+
+int record_checkpoint(struct StateCheckpointTrail *trail, unsigned int offset, int next_instruction_potentially_reached, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
+	struct StateCheckpoint *checkpoint;
+	int error_code;
+
+	if (trail->checkpoint_count == trail->capacity) {
+		const unsigned int new_capacity = trail->capacity + CHECKPOINT_ARRAY_GRANULARITY;
+		struct StateCheckpoint *new_checkpoints = reallocate_in_arena(trail->arena, trail->checkpoints, new_capacity * sizeof(struct StateCheckpoint));
+		if (!new_checkpoints) {
+			return 1;
+		}
+
+		trail->checkpoints = new_checkpoints;
+		trail->capacity = new_capacity;
+	}
+
+	checkpoint = trail->checkpoints + trail->checkpoint_count;
+	if (trail->checkpoint_count == trail->initialized_count) {
+		struct RegisterProvenance *provenance = NULL;
+		if (is_provenance_tracked_in_registers(regs) && !(provenance = allocate_in_arena(trail->arena, sizeof(struct RegisterProvenance)))) {
+			return 1;
+		}
+
+		initialize_registers(&checkpoint->regs, provenance);
+		trail->initialized_count++;
+	}
+
+	if ((error_code = record_checkpoint_memory(trail, stack, var_values, &checkpoint->memory_index))) {
+		return error_code;
+	}
+
+	checkpoint->offset = offset;
+	checkpoint->next_instruction_potentially_reached = next_instruction_potentially_reached;
+	copy_registers(&checkpoint->regs, regs);
+	trail->checkpoint_count++;
+	return 0;
+}
+
+const struct StateCheckpoint *get_checkpoint_at(const struct StateCheckpointTrail *trail, const struct MutableCodeBlock *block, const char *position) {
+	unsigned int offset;
+	unsigned int first = 0;
+	unsigned int last = trail->checkpoint_count;
+
+	if (block != trail->block || position <= get_mcblock_start(block)) {
+		return NULL;
+	}
+
+	offset = position - get_mcblock_start(block);
+	while (last > first) {
+		const unsigned int index = (first + last) / 2;
+		const unsigned int this_offset = trail->checkpoints[index].offset;
+		if (this_offset < offset) {
+			first = index + 1;
+		}
+		else if (this_offset > offset) {
+			last = index;
+		}
+		else {
+			return trail->checkpoints + index;
+		}
+	}
+
+	return NULL;
+}
+
+const struct Stack *get_checkpoint_stack(const struct StateCheckpointTrail *trail, const struct StateCheckpoint *checkpoint) {
+	return &trail->memories[checkpoint->memory_index].stack;
+}
+
+const struct GlobalVariableWordValueMap *get_checkpoint_var_values(const struct StateCheckpointTrail *trail, const struct StateCheckpoint *checkpoint) {
+	return &trail->memories[checkpoint->memory_index].var_values;
+}
+
+void clear_checkpoint_trail(struct StateCheckpointTrail *trail) {
+	const unsigned long hit_count = trail->hit_count;
+	const unsigned long miss_count = trail->miss_count;
+	unsigned int index;
+	for (index = 0; index < trail->initialized_count; index++) {
+		release_in_arena(trail->arena, trail->checkpoints[index].regs.provenance);
+	}
+
+	for (index = 0; index < trail->initialized_memory_count; index++) {
+		clear_stack(&trail->memories[index].stack);
+		clear_gvwvmap(&trail->memories[index].var_values);
+	}
+
+	release_in_arena(trail->arena, trail->checkpoints);
+	release_in_arena(trail->arena, trail->memories);
+	initialize_checkpoint_trail_in_arena(trail, trail->arena);
+	trail->hit_count = hit_count;
+	trail->miss_count = miss_count;
+}
@@ -0,0 +1,142 @@
+#ifndef _STATE_CHECKPOINT_H_
+#define _STATE_CHECKPOINT_H_
+
+#include "mcblock.h"
+#include "register.h"
+#include "stack.h"
+#include "gvwvmap.h"
+#include "arena.h"
+
+/**
+ * Stack and global variable values shared by consecutive checkpoints.
+ * Most instructions do not change them, so they are only copied when they differ from the previous checkpoint.
+ */
+struct StateCheckpointMemory {
+	struct Stack stack;
+	struct GlobalVariableWordValueMap var_values;
+};
+
+/**
+ * Abstract state found right after evaluating an instruction within a block.
+ */
+struct StateCheckpoint {
+	/**
+	 * Position of the first byte after the evaluated instruction, relative to the block start.
+	 */
+	unsigned int offset;
+
+	/**
+	 * Whether the instruction at the given offset can be reached from the evaluated one by just continuing the execution.
+	 */
+	int next_instruction_potentially_reached;
+
+	struct Registers regs;
+
+	/**
+	 * Index of the stack and global variable values of this checkpoint within the memories of its trail.
+	 */
+	unsigned int memory_index;
+};
+
+/**
+ * Checkpoints recorded at each instruction boundary while evaluating a block.
+ *
+ * When a jump lands in the middle of the block being evaluated, the block must be split.
+ * As nothing before the split point has changed, the state recorded at that point can be
+ * given directly to the new block, instead of evaluating again all instructions before it.
+ *
+ * Only the block currently being evaluated is tracked. Checkpoints are overwritten each time
+ * a new evaluation starts, reusing the memory already allocated for them.
+ * Registers are recorded on each checkpoint, while stack and global variable values are only
+ * recorded when they change, being shared by all the checkpoints in between.
+ */
+struct StateCheckpointTrail {
+	/**
+	 * Block whose evaluation is being recorded, or NULL if none.
+	 */
+	const struct MutableCodeBlock *block;
+
+	/**
+	 * Checkpoints sorted by their offset. Only the first checkpoint_count are valid.
+	 */
+	struct StateCheckpoint *checkpoints;
+	unsigned int checkpoint_count;
+
+	/**
+	 * Number of checkpoints whose registers have been initialized, and therefore can be reused.
+	 */
+	unsigned int initialized_count;
+
+	/**
+	 * Number of checkpoints that fit in the allocated array.
+	 */
+	unsigned int capacity;
+
+	/**
+	 * Distinct stack and global variable values recorded along the checkpoints. Only the first memory_count are valid.
+	 */
+	struct StateCheckpointMemory *memories;
+	unsigned int memory_count;
+
+	/**
+	 * Number of memories whose stack and map have been initialized, and therefore can be reused.
+	 */
+	unsigned int initialized_memory_count;
+
+	/**
+	 * Number of memories that fit in the allocated array.
+	 */
+	unsigned int memory_capacity;
+
+	/**
+	 * Number of block splits where the state at the split point was taken from a checkpoint,
+	 * and number of splits where the block had to be evaluated again instead.
+	 */
+	unsigned long hit_count;
+	unsigned long miss_count;
+
+	/**
+	 * Arena where all checkpoints and their states are allocated, or NULL to allocate them directly with malloc.
+	 */
+	struct Arena *arena;
+};
+
+/**
+ * Set all its values. After this, the trail will be empty and not tracking any block.
+ */
+void initialize_checkpoint_trail_in_arena(struct StateCheckpointTrail *trail, struct Arena *arena);
+
+/**
+ * Discard all checkpoints and start recording the evaluation of the given block.
+ */
+void start_checkpoint_trail(struct StateCheckpointTrail *trail, const struct MutableCodeBlock *block);
+
+/**
+ * Record the state found after evaluating an instruction of the tracked block.
+ * Offsets must be recorded in increasing order.
+ * Returns 0 on success, or any other value if memory cannot be allocated.
+ */
+int record_checkpoint(struct StateCheckpointTrail *trail, unsigned int offset, int next_instruction_potentially_reached, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values);
+
+/**
+ * Returns the checkpoint recorded at the given position of the given block,
+ * or NULL if the block is not the tracked one, or no instruction finished at that position.
+ */
+const struct StateCheckpoint *get_checkpoint_at(const struct StateCheckpointTrail *trail, const struct MutableCodeBlock *block, const char *position);
+
+/**
+ * Returns the stack recorded in the given checkpoint of this trail.
+ */
+const struct Stack *get_checkpoint_stack(const struct StateCheckpointTrail *trail, const struct StateCheckpoint *checkpoint);
+
+/**
+ * Returns the global variable values recorded in the given checkpoint of this trail.
+ */
+const struct GlobalVariableWordValueMap *get_checkpoint_var_values(const struct StateCheckpointTrail *trail, const struct StateCheckpoint *checkpoint);
+
+/**
+ * Free all memory allocated for the checkpoints. Hit and miss counts are kept.
+ */
+void clear_checkpoint_trail(struct StateCheckpointTrail *trail);
+
+#endif /* _STATE_CHECKPOINT_H_ */
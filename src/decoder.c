@@ -0,0 +1,368 @@
+#include "decoder.h"
+
+#define NONE {0, 0, 0, 0}
+#define OP(immediate_length) {OPCODE_FLAG_VALID, immediate_length, 0, 0}
+#define PREFIX {OPCODE_FLAG_VALID | OPCODE_FLAG_SEGMENT_PREFIX, 0, 0, 0}
+#define MODRM(immediate_length, invalid_memory_regs, invalid_register_regs) {OPCODE_FLAG_VALID | OPCODE_FLAG_MODRM, immediate_length, invalid_memory_regs, invalid_register_regs}
+
+/* Only test (reg 0) has immediate data. Reg 1 is not defined */
+#define MODRM_TEST(immediate_length) {OPCODE_FLAG_VALID | OPCODE_FLAG_MODRM | OPCODE_FLAG_IMMEDIATE_ONLY_ON_REG0, immediate_length, 0x02, 0x02}
+
+const struct OpcodeDescriptor opcode_descriptors[256] = {
+	MODRM(0, 0, 0), /* 00 */
+	MODRM(0, 0, 0), /* 01 */
+	MODRM(0, 0, 0), /* 02 */
+	MODRM(0, 0, 0), /* 03 */
+	OP(1), /* 04 */
+	OP(2), /* 05 */
+	OP(0), /* 06 */
+	OP(0), /* 07 */
+	MODRM(0, 0, 0), /* 08 */
+	MODRM(0, 0, 0), /* 09 */
+	MODRM(0, 0, 0), /* 0A */
+	MODRM(0, 0, 0), /* 0B */
+	OP(1), /* 0C */
+	OP(2), /* 0D */
+	OP(0), /* 0E */
+	NONE, /* 0F */
+	MODRM(0, 0, 0), /* 10 */
+	MODRM(0, 0, 0), /* 11 */
+	MODRM(0, 0, 0), /* 12 */
+	MODRM(0, 0, 0), /* 13 */
+	OP(1), /* 14 */
+	OP(2), /* 15 */
+	OP(0), /* 16 */
+	OP(0), /* 17 */
+	MODRM(0, 0, 0), /* 18 */
+	MODRM(0, 0, 0), /* 19 */
+	MODRM(0, 0, 0), /* 1A */
+	MODRM(0, 0, 0), /* 1B */
+	OP(1), /* 1C */
+	OP(2), /* 1D */
+	OP(0), /* 1E */
+	OP(0), /* 1F */
+	MODRM(0, 0, 0), /* 20 */
+	MODRM(0, 0, 0), /* 21 */
+	MODRM(0, 0, 0), /* 22 */
+	MODRM(0, 0, 0), /* 23 */
+	OP(1), /* 24 */
+	OP(2), /* 25 */
+	PREFIX, /* 26 */
+	NONE, /* 27 */
+	MODRM(0, 0, 0), /* 28 */
+	MODRM(0, 0, 0), /* 29 */
+	MODRM(0, 0, 0), /* 2A */
+	MODRM(0, 0, 0), /* 2B */
+	OP(1), /* 2C */
+	OP(2), /* 2D */
+	PREFIX, /* 2E */
+	NONE, /* 2F */
+	MODRM(0, 0, 0), /* 30 */
+	MODRM(0, 0, 0), /* 31 */
+	MODRM(0, 0, 0), /* 32 */
+	MODRM(0, 0, 0), /* 33 */
+	OP(1), /* 34 */
+	OP(2), /* 35 */
+	PREFIX, /* 36 */
+	NONE, /* 37 */
+	MODRM(0, 0, 0), /* 38 */
+	MODRM(0, 0, 0), /* 39 */
+	MODRM(0, 0, 0), /* 3A */
+	MODRM(0, 0, 0), /* 3B */
+	OP(1), /* 3C */
+	OP(2), /* 3D */
+	PREFIX, /* 3E */
+	NONE, /* 3F */
+	OP(0), /* 40 */
+	OP(0), /* 41 */
+	OP(0), /* 42 */
+	OP(0), /* 43 */
+	OP(0), /* 44 */
+	OP(0), /* 45 */
+	OP(0), /* 46 */
+	OP(0), /* 47 */
+	OP(0), /* 48 */
+	OP(0), /* 49 */
+	OP(0), /* 4A */
+	OP(0), /* 4B */
+	OP(0), /* 4C */
+	OP(0), /* 4D */
+	OP(0), /* 4E */
+	OP(0), /* 4F */
+	OP(0), /* 50 */
+	OP(0), /* 51 */
+	OP(0), /* 52 */
+	OP(0), /* 53 */
+	OP(0), /* 54 */
+	OP(0), /* 55 */
+	OP(0), /* 56 */
+	OP(0), /* 57 */
+	OP(0), /* 58 */
+	OP(0), /* 59 */
+	OP(0), /* 5A */
+	OP(0), /* 5B */
+	OP(0), /* 5C */
+	OP(0), /* 5D */
+	OP(0), /* 5E */
+	OP(0), /* 5F */
+	NONE, /* 60 */
+	NONE, /* 61 */
+	NONE, /* 62 */
+	NONE, /* 63 */
+	NONE, /* 64 */
+	NONE, /* 65 */
+	NONE, /* 66 */
+	NONE, /* 67 */
+	NONE, /* 68 */
+	NONE, /* 69 */
+	NONE, /* 6A */
+	NONE, /* 6B */
+	NONE, /* 6C */
+	NONE, /* 6D */
+	NONE, /* 6E */
+	NONE, /* 6F */
+	OP(1), /* 70 */
+	OP(1), /* 71 */
+	OP(1), /* 72 */
+	OP(1), /* 73 */
+	OP(1), /* 74 */
+	OP(1), /* 75 */
+	OP(1), /* 76 */
+	OP(1), /* 77 */
+	OP(1), /* 78 */
+	OP(1), /* 79 */
+	OP(1), /* 7A */
+	OP(1), /* 7B */
+	OP(1), /* 7C */
+	OP(1), /* 7D */
+	OP(1), /* 7E */
+	OP(1), /* 7F */
+	MODRM(1, 0, 0), /* 80 */
+	MODRM(2, 0, 0), /* 81 */
+	NONE, /* 82 */
+	MODRM(1, 0, 0), /* 83 */
+	NONE, /* 84 */
+	NONE, /* 85 */
+	MODRM(0, 0, 0), /* 86 */
+	MODRM(0, 0, 0), /* 87 */
+	MODRM(0, 0, 0), /* 88 */
+	MODRM(0, 0, 0), /* 89 */
+	MODRM(0, 0, 0), /* 8A */
+	MODRM(0, 0, 0), /* 8B */
+	MODRM(0, 0xF0, 0xF0), /* 8C */
+	MODRM(0, 0, 0xFF), /* 8D */
+	MODRM(0, 0xF0, 0xF0), /* 8E */
+	MODRM(0, 0xFE, 0xFF), /* 8F */
+	OP(0), /* 90 */
+	OP(0), /* 91 */
+	OP(0), /* 92 */
+	OP(0), /* 93 */
+	OP(0), /* 94 */
+	OP(0), /* 95 */
+	OP(0), /* 96 */
+	OP(0), /* 97 */
+	OP(0), /* 98 */
+	OP(0), /* 99 */
+	NONE, /* 9A */
+	NONE, /* 9B */
+	NONE, /* 9C */
+	NONE, /* 9D */
+	NONE, /* 9E */
+	NONE, /* 9F */
+	OP(2), /* A0 */
+	OP(2), /* A1 */
+	OP(2), /* A2 */
+	OP(2), /* A3 */
+	OP(0), /* A4 */
+	OP(0), /* A5 */
+	OP(0), /* A6 */
+	OP(0), /* A7 */
+	OP(1), /* A8 */
+	OP(2), /* A9 */
+	OP(0), /* AA */
+	OP(0), /* AB */
+	OP(0), /* AC */
+	OP(0), /* AD */
+	OP(0), /* AE */
+	OP(0), /* AF */
+	OP(1), /* B0 */
+	OP(1), /* B1 */
+	OP(1), /* B2 */
+	OP(1), /* B3 */
+	OP(1), /* B4 */
+	OP(1), /* B5 */
+	OP(1), /* B6 */
+	OP(1), /* B7 */
+	OP(2), /* B8 */
+	OP(2), /* B9 */
+	OP(2), /* BA */
+	OP(2), /* BB */
+	OP(2), /* BC */
+	OP(2), /* BD */
+	OP(2), /* BE */
+	OP(2), /* BF */
+	NONE, /* C0 */
+	NONE, /* C1 */
+	OP(2), /* C2 */
+	OP(0), /* C3 */
+	MODRM(0, 0, 0xFF), /* C4 */
+	MODRM(0, 0, 0xFF), /* C5 */
+	MODRM(1, 0xFE, 0xFE), /* C6 */
+	MODRM(2, 0xFE, 0xFE), /* C7 */
+	NONE, /* C8 */
+	NONE, /* C9 */
+	NONE, /* CA */
+	OP(0), /* CB */
+	NONE, /* CC */
+	OP(1), /* CD */
+	NONE, /* CE */
+	NONE, /* CF */
+	MODRM(0, 0x40, 0x40), /* D0 */
+	MODRM(0, 0x40, 0x40), /* D1 */
+	MODRM(0, 0x40, 0x40), /* D2 */
+	MODRM(0, 0x40, 0x40), /* D3 */
+	NONE, /* D4 */
+	NONE, /* D5 */
+	NONE, /* D6 */
+	NONE, /* D7 */
+	NONE, /* D8 */
+	NONE, /* D9 */
+	NONE, /* DA */
+	NONE, /* DB */
+	NONE, /* DC */
+	NONE, /* DD */
+	NONE, /* DE */
+	NONE, /* DF */
+	OP(1), /* E0 */
+	OP(1), /* E1 */
+	OP(1), /* E2 */
+	OP(1), /* E3 */
+	NONE, /* E4 */
+	NONE, /* E5 */
+	NONE, /* E6 */
+	NONE, /* E7 */
+	OP(2), /* E8 */
+	OP(2), /* E9 */
+	OP(4), /* EA */
+	OP(1), /* EB */
+	NONE, /* EC */
+	NONE, /* ED */
+	NONE, /* EE */
+	NONE, /* EF */
+	NONE, /* F0 */
+	NONE, /* F1 */
+	OP(0), /* F2 */
+	OP(0), /* F3 */
+	NONE, /* F4 */
+	NONE, /* F5 */
+	MODRM_TEST(1), /* F6 */
+	MODRM_TEST(2), /* F7 */
+	OP(0), /* F8 */
+	OP(0), /* F9 */
+	OP(0), /* FA */
+	OP(0), /* FB */
+	OP(0), /* FC */
+	OP(0), /* FD */
+	MODRM(0, 0xFC, 0xFC), /* FE */
+	MODRM(0, 0x80, 0xA8)  /* FF */
+};
+
+static unsigned int displacement_length_for(int modrm) {
+	if (modrm < 0xC0) {
+		if (modrm >= 0x80 || (modrm & 0xC7) == 0x06) {
+			return 2;
+		}
+		else if ((modrm & 0xC0) == 0x40) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static unsigned int read_little_endian(const char *data, unsigned int length) {
+	unsigned int value = 0;
+	while (length > 0) {
+		value = (value << 8) | (data[--length] & 0xFF);
+	}
+
+	return value;
+}
+
+int decode_next_instruction(struct Reader *reader, struct DecodedInstruction *instruction) {
+	const char *data = reader->buffer + reader->buffer_index;
+	const unsigned int available = reader->buffer_size - reader->buffer_index;
+	const struct OpcodeDescriptor *descriptor;
+	unsigned int index = 0;
+
+	if (reader->buffer_index >= reader->buffer_size) {
+		return READ_ERROR_MAX_EXCEEDED;
+	}
+
+	instruction->segment_index = DECODED_SEGMENT_INDEX_UNDEFINED;
+	instruction->prefix_count = 0;
+	while (1) {
+		const int value0 = data[index++] & 0xFF;
+		descriptor = opcode_descriptors + value0;
+		instruction->opcode = value0;
+		if (!(descriptor->flags & OPCODE_FLAG_VALID)) {
+			return READ_ERROR_UNKNOWN_OPCODE;
+		}
+
+		if (!(descriptor->flags & OPCODE_FLAG_SEGMENT_PREFIX)) {
+			break;
+		}
+
+		if (index >= available) {
+			return READ_ERROR_MAX_EXCEEDED;
+		}
+
+		instruction->segment_index = (value0 >> 3) & 0x03;
+		instruction->prefix_count++;
+	}
+
+	instruction->modrm = 0;
+	instruction->displacement = 0;
+	instruction->displacement_length = 0;
+	instruction->immediate_length = descriptor->immediate_length;
+	if (descriptor->flags & OPCODE_FLAG_MODRM) {
+		int modrm;
+		unsigned char invalid_regs;
+		if (index >= available) {
+			return READ_ERROR_MAX_EXCEEDED;
+		}
+
+		modrm = data[index++] & 0xFF;
+		invalid_regs = (modrm >= 0xC0)? descriptor->invalid_register_regs : descriptor->invalid_memory_regs;
+		if (invalid_regs & (1 << ((modrm >> 3) & 0x07))) {
+			return READ_ERROR_UNKNOWN_OPCODE;
+		}
+
+		instruction->modrm = modrm;
+		instruction->displacement_length = displacement_length_for(modrm);
+		if ((descriptor->flags & OPCODE_FLAG_IMMEDIATE_ONLY_ON_REG0) && (modrm & 0x38)) {
+			instruction->immediate_length = 0;
+		}
+	}
+
+	if (index + instruction->displacement_length + instruction->immediate_length > available) {
+		return READ_ERROR_MAX_EXCEEDED;
+	}
+
+	if (instruction->displacement_length == 1) {
+		instruction->displacement = (data[index] & 0x80)? (data[index] & 0xFF) - 0x100 : (data[index] & 0xFF);
+	}
+	else if (instruction->displacement_length == 2) {
+		instruction->displacement = read_little_endian(data + index, 2);
+	}
+
+	index += instruction->displacement_length;
+	instruction->immediate = (instruction->immediate_length == 4)?
+			read_little_endian(data + index, 2) | (((unsigned long) read_little_endian(data + index + 2, 2)) << 16) :
+			read_little_endian(data + index, instruction->immediate_length);
+	index += instruction->immediate_length;
+
+	instruction->length = index;
+	reader->buffer_index += index;
+	return 0;
+}
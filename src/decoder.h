@@ -0,0 +1,134 @@
+#ifndef _DECODER_H_
+#define _DECODER_H_
+
+#include "reader.h"
+
+#define READ_ERROR_MAX_EXCEEDED 1
+#define READ_ERROR_UNKNOWN_OPCODE 2
+
+/**
+ * The opcode is a valid 8086 instruction, or a segment prefix.
+ */
+#define OPCODE_FLAG_VALID 1
+
+/**
+ * The opcode is followed by a ModR/M byte, that may be followed by a displacement.
+ */
+#define OPCODE_FLAG_MODRM 2
+
+/**
+ * The opcode is a segment override prefix, and it is followed by the actual opcode.
+ */
+#define OPCODE_FLAG_SEGMENT_PREFIX 4
+
+/**
+ * The immediate value is only present when the reg field of the ModR/M byte is 0.
+ * This is the case of test, that shares its opcode with not, neg, mul and div.
+ */
+#define OPCODE_FLAG_IMMEDIATE_ONLY_ON_REG0 8
+
+/**
+ * Static information about a single opcode byte.
+ */
+struct OpcodeDescriptor {
+	/**
+	 * Combination of OPCODE_FLAG constants.
+	 */
+	unsigned char flags;
+
+	/**
+	 * Number of bytes of immediate data after the opcode, or after the ModR/M byte and its displacement.
+	 */
+	unsigned char immediate_length;
+
+	/**
+	 * Bitset indexed by the reg field of the ModR/M byte. Set bits mark invalid
+	 * instructions when the ModR/M byte refers to a memory address.
+	 */
+	unsigned char invalid_memory_regs;
+
+	/**
+	 * Bitset indexed by the reg field of the ModR/M byte. Set bits mark invalid
+	 * instructions when the ModR/M byte refers to a register (mod == 3).
+	 */
+	unsigned char invalid_register_regs;
+};
+
+/**
+ * Table with one descriptor for each possible opcode byte.
+ */
+extern const struct OpcodeDescriptor opcode_descriptors[256];
+
+#define DECODED_SEGMENT_INDEX_UNDEFINED -1
+
+/**
+ * Result of decoding a single instruction, including any segment prefix.
+ */
+struct DecodedInstruction {
+	/**
+	 * Segment from the last segment override prefix (0 for ES, 1 for CS, 2 for SS and 3 for DS),
+	 * or DECODED_SEGMENT_INDEX_UNDEFINED if there is no prefix.
+	 */
+	int segment_index;
+
+	/**
+	 * Displacement after the ModR/M byte. 8-bit displacements are sign extended.
+	 * This is 0 if there is no displacement.
+	 */
+	int displacement;
+
+	/**
+	 * Immediate data, in little endian. This is 0 if there is no immediate data.
+	 * Far pointers keep the offset in the lower 16 bits and the segment in the upper 16 bits.
+	 */
+	unsigned long immediate;
+
+	/**
+	 * Total number of bytes of the instruction, including prefixes.
+	 */
+	unsigned char length;
+
+	/**
+	 * Number of segment override prefixes before the opcode.
+	 */
+	unsigned char prefix_count;
+
+	unsigned char opcode;
+
+	/**
+	 * ModR/M byte. Only relevant if the descriptor for the opcode has OPCODE_FLAG_MODRM.
+	 */
+	unsigned char modrm;
+
+	unsigned char displacement_length;
+	unsigned char immediate_length;
+};
+
+/**
+ * Decode the instruction pointed by the given Reader, and add to the reader index the length of the instruction found.
+ *
+ * This method will return 0 if all goes fine, READ_ERROR_MAX_EXCEEDED if the
+ * end of the buffer is reached but the instruction is not yet complete, or
+ * READ_ERROR_UNKNOWN_OPCODE if the opcode is not a known 8086 instruction.
+ * In case of error, the reader index is not modified. If the error is an
+ * unknown opcode, segment_index, prefix_count and opcode will still describe
+ * the bytes read until the unknown opcode was found.
+ */
+int decode_next_instruction(struct Reader *reader, struct DecodedInstruction *instruction);
+
+/**
+ * Returns the mod field of the ModR/M byte.
+ */
+#define DECODED_MOD(instruction) (((instruction)->modrm >> 6) & 0x03)
+
+/**
+ * Returns the reg field of the ModR/M byte.
+ */
+#define DECODED_REG(instruction) (((instruction)->modrm >> 3) & 0x07)
+
+/**
+ * Returns the r/m field of the ModR/M byte.
+ */
+#define DECODED_RM(instruction) ((instruction)->modrm & 0x07)
+
+#endif /* _DECODER_H_ */
@@ -0,0 +1,88 @@
+#include "dicache.h"
+#include <string.h>
+
+void initialize_dicache_in_arena(struct DecodedInstructionCache *cache, struct Arena *arena, const char *buffer, unsigned int buffer_size) {
+	cache->buffer = buffer;
+	cache->buffer_size = buffer_size;
+	cache->pages = NULL;
+	cache->arena = arena;
+	cache->hit_count = 0;
+	cache->miss_count = 0;
+}
+
+void initialize_dicache(struct DecodedInstructionCache *cache, const char *buffer, unsigned int buffer_size) {
+	initialize_dicache_in_arena(cache, NULL, buffer, buffer_size);
+}
+
+static unsigned int get_page_count(const struct DecodedInstructionCache *cache) {
+	return (cache->buffer_size + DICACHE_PAGE_SIZE - 1) / DICACHE_PAGE_SIZE;
+}
+
+static void store_in_dicache(struct DecodedInstructionCache *cache, unsigned int offset, const struct DecodedInstruction *instruction) {
+	struct DecodedInstruction *page;
+	if (!cache->pages) {
+		/* Failing to allocate the cache is not an error. Instructions will be decoded every time */
+		if (!(cache->pages = allocate_in_arena(cache->arena, get_page_count(cache) * sizeof(struct DecodedInstruction *)))) {
+			return;
+		}
+
+		memset(cache->pages, 0, get_page_count(cache) * sizeof(struct DecodedInstruction *));
+	}
+
+	page = cache->pages[offset / DICACHE_PAGE_SIZE];
+	if (!page) {
+		if (!(page = allocate_in_arena(cache->arena, DICACHE_PAGE_SIZE * sizeof(struct DecodedInstruction)))) {
+			return;
+		}
+
+		memset(page, 0, DICACHE_PAGE_SIZE * sizeof(struct DecodedInstruction));
+
+		cache->pages[offset / DICACHE_PAGE_SIZE] = page;
+	}
+
+	page[offset % DICACHE_PAGE_SIZE] = *instruction;
+}
+
+int decode_next_cached_instruction(struct DecodedInstructionCache *cache, struct Reader *reader, struct DecodedInstruction *instruction) {
+	const char *position = reader->buffer + reader->buffer_index;
+	unsigned int offset;
+	int error_code;
+
+	if (!cache || reader->buffer_index >= reader->buffer_size || position < cache->buffer || position >= cache->buffer + cache->buffer_size) {
+		return decode_next_instruction(reader, instruction);
+	}
+
+	offset = position - cache->buffer;
+	if (cache->pages && cache->pages[offset / DICACHE_PAGE_SIZE]) {
+		const struct DecodedInstruction *cached = cache->pages[offset / DICACHE_PAGE_SIZE] + (offset % DICACHE_PAGE_SIZE);
+
+		/* The same instruction may not fit in a reader with a smaller buffer */
+		if (cached->length && cached->length <= reader->buffer_size - reader->buffer_index) {
+			*instruction = *cached;
+			reader->buffer_index += cached->length;
+			cache->hit_count++;
+			return 0;
+		}
+	}
+
+	cache->miss_count++;
+	if (!(error_code = decode_next_instruction(reader, instruction))) {
+		store_in_dicache(cache, offset, instruction);
+	}
+
+	return error_code;
+}
+
+void clear_dicache(struct DecodedInstructionCache *cache) {
+	if (cache->pages) {
+		const unsigned int page_count = get_page_count(cache);
+		unsigned int i;
+		for (i = 0; i < page_count; i++) {
+			release_in_arena(cache->arena, cache->pages[i]);
+		}
+
+		release_in_arena(cache->arena, cache->pages);
+	}
+
+	initialize_dicache_in_arena(cache, cache->arena, NULL, 0);
+}
@@ -0,0 +1,80 @@
+#ifndef _DECODED_INSTRUCTION_CACHE_H_
+#define _DECODED_INSTRUCTION_CACHE_H_
+
+#include "arena.h"
+#include "decoder.h"
+
+/**
+ * Number of consecutive positions of the image covered by each page of the cache.
+ */
+#define DICACHE_PAGE_SIZE 256
+
+/**
+ * Decoded instructions of a loaded image, indexed by their position within it.
+ *
+ * The same instruction is decoded once on each evaluation of its block, and
+ * twice more when dumping it. This cache keeps the result of the first decode,
+ * so all later ones can be resolved without reading the opcode bytes again.
+ *
+ * Pages of the cache are only allocated when an instruction within their range is decoded.
+ */
+struct DecodedInstructionCache {
+	/**
+	 * Start of the loaded image.
+	 */
+	const char *buffer;
+
+	/**
+	 * Size in bytes of the loaded image.
+	 */
+	unsigned int buffer_size;
+
+	/**
+	 * Array of pages, each one covering DICACHE_PAGE_SIZE positions, or NULL if nothing has been cached yet.
+	 * Pages are NULL until any instruction within their range is decoded.
+	 * Positions where no instruction has been decoded yet have length 0.
+	 */
+	struct DecodedInstruction **pages;
+
+	/**
+	 * Arena where the pages are allocated. It can be NULL.
+	 */
+	struct Arena *arena;
+
+	/**
+	 * Number of decodes resolved from the cache.
+	 */
+	unsigned long hit_count;
+
+	/**
+	 * Number of decodes that required reading the instruction bytes.
+	 */
+	unsigned long miss_count;
+};
+
+/**
+ * Set all its values. After this, the cache will be empty, but ready to decode instructions within the given image.
+ * Its pages will be allocated in the given arena, that can be NULL.
+ */
+void initialize_dicache_in_arena(struct DecodedInstructionCache *cache, struct Arena *arena, const char *buffer, unsigned int buffer_size);
+
+/**
+ * Set all its values. After this, the cache will be empty, but ready to decode instructions within the given image.
+ */
+void initialize_dicache(struct DecodedInstructionCache *cache, const char *buffer, unsigned int buffer_size);
+
+/**
+ * Decode the instruction pointed by the given Reader, as decode_next_instruction does,
+ * but taking the result from the cache if the instruction has been decoded before.
+ *
+ * The given cache can be NULL. In that case, this behaves exactly like decode_next_instruction.
+ * Instructions out of the image, or that cannot be decoded, are never cached.
+ */
+int decode_next_cached_instruction(struct DecodedInstructionCache *cache, struct Reader *reader, struct DecodedInstruction *instruction);
+
+/**
+ * Free all the allocated memory and restores the cache to its initial state, keeping its arena.
+ */
+void clear_dicache(struct DecodedInstructionCache *cache);
+
+#endif /* _DECODED_INSTRUCTION_CACHE_H_ */
@@ -1,226 +1,415 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
-#include <stdint.h>
-#include "mcblist.h"
-#include "gvlist.h"
-#include "finder.h"
-#include "dumpers.h"
+#include "ancache.h"
+#include "arena.h"
+#include "mcbwlist.h"
+#include "printd.h"
 #include "printu.h"
-#include "mreflist.h"
-#include "register.h"
 #include "renames.h"
-#include "stack.h"
-#include "itable.h"
-#include "srresult.h"
-#include "sslist.h"
+#include "session.h"
+#include "stats.h"
 #include "version.h"
-#include "funcfind.h"
-#include "printd.h"
-#include "printu.h"
+#include "workers.h"
+
+/**
+ * Maximum number of fields in each line of the batch manifest: input file, output file, format and rename map.
+ */
+#define BATCH_MANIFEST_MAX_FIELD_COUNT 4
+
+#define BATCH_MANIFEST_LINE_MAX_LENGTH 4096
+
+#define ANALYSIS_CACHE_FILE_EXTENSION ".cache"
 
 static void print_help(const char *executedFile) {
 	printf("Syntax: %s <options>\nPossible options:\n", executedFile);
+	printf("  --batch <filename>\n                    Disassembles all files listed in this manifest. Each line contains the input file, the output\n                    file, the format and, optionally, the rename map, separated by tabs. File names may contain\n                    spaces, but not tabs. Empty lines and lines starting with '#' are ignored.\n                    It cannot be combined with -i, -f, -o, -r, --previous or --stats.\n");
+	printf("  --block-order     Order in which pending code blocks are evaluated. It can be:\n                        'allocation' for the order in which blocks were found (default)\n                        'start' for the order of their positions in the file.\n");
+	printf("  --cache-dir <directory>\n                    Reuses the analysis of any image already disassembled with the same options, stored in this\n                    directory, and stores there the analysis of any new one. The directory must exist.\n");
+	printf("  --extra-fixpoint-passes <count>\n                    Number of times all blocks are evaluated again after the fixpoint is reached,\n                    reporting the heap allocations performed on each pass. Default is 0.\n");
 	printf("  -f or --format    Format of the input file. It can be:\n                        'bin' for plain 16bits executable without header\n                        'dos' for 16bits executable with MZ header.\n");
 	printf("  -h or --help      Show this help.\n");
 	printf("  -i <filename>     Uses this file as input.\n");
+	printf("  -j <count>        Number of files of the batch manifest disassembled at the same time, each one by a different\n                    process. Default is 1, which disassembles them one after another within this process.\n                    It requires --batch.\n");
+	printf("  --iteration-limit <count>\n                    Maximum number of evaluation iterations. 0 means no limit. Default is %d.\n", MCBWLIST_DEFAULT_ITERATION_LIMIT);
+	printf("  --no-provenance   Do not track the instructions where register values are set. This makes the analysis\n                    faster, but immediate values later used as addresses, like DOS messages, are not referenced.\n");
 	printf("  -o <filename>     Uses this file as output.\n                    If not defined, the result will be printed in the standard output.\n");
+	printf("  --previous <filename>\n                    Previous build of the input file, whose analysis is stored in the cache directory. If the input\n                    file is not cached yet, that analysis is reused, evaluating again only the blocks reached by\n                    the changed bytes.\n                    It requires -i and --cache-dir.\n");
 	printf("  -r                Uses this file as the map of naming replacements for the output.\n");
+	printf("  --stats <filename>\n                    Writes the time spent on each phase and the analysis counters into this file, in JSON format.\n");
+	printf("  --widening-threshold <count>\n                    Number of evaluations of a block after which its input values are widened. 0 disables widening. Default is %d.\n", MCBWLIST_DEFAULT_WIDENING_THRESHOLD);
 }
 
-struct dos_header {
-	uint16_t magic; /* Must be "MZ" */
-	uint16_t bytes_in_last_page;
-	uint16_t pages_count;
-	uint16_t relocations_count;
-	uint16_t header_paragraphs;
-	uint16_t required_paragraphs;
-	uint16_t desired_paragraphs;
-	uint16_t initial_stack_segment;
-	uint16_t initial_stack_pointer;
-	uint16_t checksum;
-	uint16_t initial_ip;
-	uint16_t initial_cs;
-	uint16_t relocation_table_offset;
-};
-
-static int read_file(struct SegmentReadResult *result, const char *filename, const char *format) {
-	FILE *file;
-	if (strcmp(format, "bin") && strcmp(format, "dos")) {
-		fprintf(stderr, "Undefined format '%s'. It must be 'bin' or 'dos'\n", format);
-		return 1;
+/**
+ * Returns the name of the file where the analysis with the given key is cached within the given directory.
+ * The returned name must be freed. This will return NULL if memory cannot be allocated.
+ */
+static char *compose_analysis_cache_filename(const char *cache_dir, const char *key) {
+	char *cache_filename = malloc(strlen(cache_dir) + ANALYSIS_CACHE_KEY_LENGTH + sizeof(ANALYSIS_CACHE_FILE_EXTENSION) + 1);
+	if (cache_filename) {
+		strcpy(cache_filename, cache_dir);
+		strcat(cache_filename, "/");
+		strcat(cache_filename, key);
+		strcat(cache_filename, ANALYSIS_CACHE_FILE_EXTENSION);
 	}
 
-	file = fopen(filename, "r");
+	return cache_filename;
+}
+
+/**
+ * Load the analysis of the image opened in the session from the given file, if it exists and it is valid.
+ * This will return 0 if the analysis was loaded, or any other value if the image must be analysed.
+ */
+static int load_analysis_cache_file(struct DisasmSession *session, const char *cache_filename) {
+	int error_code;
+	FILE *file = fopen(cache_filename, "rb");
 	if (!file) {
-		fprintf(stderr, "Unable to open file\n");
 		return 1;
 	}
 
-	if (!strcmp(format, "dos")) {
-		unsigned int header_size;
-		struct dos_header header;
-		unsigned int file_size;
+	error_code = load_analysis_cache(session, file);
+	fclose(file);
+	if (error_code) {
+		fprintf(stderr, "Discarding invalid analysis cache file %s\n", cache_filename);
+	}
+	else {
+		fprintf(stderr, "Analysis loaded from %s\n", cache_filename);
+	}
 
-		/* This is assuming that the processor running this is also little endian */
-		if (fread(&header, 1, sizeof(header), file) < sizeof(header)) {
-			fprintf(stderr, "Unexpected end of file\n");
-			fclose(file);
-			return 1;
-		}
+	return error_code;
+}
 
-		if (header.magic != 0x5A4D ||
-				header.bytes_in_last_page >= 0x200 ||
-				header.required_paragraphs > header.desired_paragraphs) {
-			fprintf(stderr, "Invalid dos file\n");
-			fclose(file);
-			return 1;
+/**
+ * Load the analysis of the given previous build of the image opened in the session from the cache directory,
+ * evaluating again the blocks reached by the bytes that changed.
+ * This will return 0 if the analysis was loaded, or any other value if the image must be analysed.
+ */
+static int load_previous_build_analysis(struct DisasmSession *session, const char *previous_filename, const char *format, const char *cache_dir) {
+	struct DisasmSession previous_session;
+	char key[ANALYSIS_CACHE_KEY_LENGTH + 1];
+	char *cache_filename = NULL;
+	FILE *file = NULL;
+	unsigned int invalid_block_count;
+	int error_code;
+
+	initialize_disasm_session(&previous_session);
+	if ((error_code = open_disasm_session_from_file(&previous_session, previous_filename, format))) {
+		clear_disasm_session(&previous_session);
+		return error_code;
+	}
+
+	compose_previous_build_cache_key(session, &previous_session, key);
+	if (!(cache_filename = compose_analysis_cache_filename(cache_dir, key)) || !(file = fopen(cache_filename, "rb"))) {
+		error_code = 1;
+	}
+	else {
+		error_code = load_previous_build_analysis_cache(session, &previous_session, file, &invalid_block_count);
+		fclose(file);
+	}
+
+	if (error_code) {
+		fprintf(stderr, "Unable to reuse the analysis of %s\n", previous_filename);
+	}
+	else if (invalid_block_count) {
+		fprintf(stderr, "Analysis of %s reused from %s, evaluating again %u blocks reached by the changed bytes\n", previous_filename, cache_filename, invalid_block_count);
+	}
+	else {
+		fprintf(stderr, "Analysis of %s reused from %s, as none of the changed bytes was analysed\n", previous_filename, cache_filename);
+	}
+
+	free(cache_filename);
+	clear_disasm_session(&previous_session);
+	return error_code;
+}
+
+/**
+ * Store the analysis of the session into the given file.
+ * Not being able to store it is not critical, it is just reported and the file is removed.
+ */
+static void save_analysis_cache_file(const struct DisasmSession *session, const char *cache_filename) {
+	FILE *file = fopen(cache_filename, "wb");
+	if (!file) {
+		fprintf(stderr, "Unable to create analysis cache file %s\n", cache_filename);
+		return;
+	}
+
+	if (save_analysis_cache(session, file) | fclose(file)) {
+		fprintf(stderr, "Unable to write analysis cache file %s\n", cache_filename);
+		remove(cache_filename);
+	}
+}
+
+/**
+ * Disassemble the given file, writing the result into the given output file, or into the standard output if NULL.
+ *
+ * If a cache directory is given, the analysis is loaded from it when the same image has already been analysed
+ * with the same options. Otherwise, the analysis of the given previous build is reused when possible,
+ * or the image is analysed, and the analysis is stored there once its functions are found.
+ *
+ * The session is reset before returning, so that it can be used again for the next file,
+ * reusing the memory reserved for this one.
+ */
+static int disassemble_file(
+		struct DisasmSession *session,
+		const char *filename,
+		const char *format,
+		const char *out_filename,
+		const char *renames_filename,
+		const char *stats_filename,
+		const char *cache_dir,
+		const char *previous_filename) {
+	const unsigned long heap_allocations_before = session->heap_allocation_count;
+	char key[ANALYSIS_CACHE_KEY_LENGTH + 1];
+	char *cache_filename = NULL;
+	struct FilePrinter printer_out;
+	struct RenameMap renames;
+	struct AnalysisStats stats;
+	int error_code;
+
+	if (renames_filename) {
+		DEBUG_PRINT1("Reading rename map from %s.\n", renames_filename);
+		if ((error_code = read_renames_file(&renames, renames_filename))) {
+			return error_code;
 		}
 
-		result->relocation_count = header.relocations_count;
-		if (header.relocations_count > 0) {
-			result->relocation_table = malloc(sizeof(struct FarPointer) * header.relocations_count);
-			if (!result->relocation_table) {
-				fprintf(stderr, "Unable to allocate memory for relocation table\n");
-				fclose(file);
-				return 1;
-			}
+#ifdef DEBUG
+		print_rename_map(&renames);
+#endif /* DEBUG */
+	}
+	else {
+		initialize_rename_map(&renames);
+	}
 
-			if (fseek(file, header.relocation_table_offset, SEEK_SET)) {
-				fprintf(stderr, "Unable to seek file at %d for relocation table\n", header.relocation_table_offset);
-				free(result->relocation_table);
-				fclose(file);
-				return 1;
-			}
+	session->renames = &renames;
+	initialize_stats(&stats);
+	if (stats_filename) {
+		session->stats = &stats;
+	}
 
-			if (fread(result->relocation_table, sizeof(struct FarPointer), header.relocations_count, file) != header.relocations_count) {
-				fprintf(stderr, "Unable to read relocation table from file\n");
-				free(result->relocation_table);
-				fclose(file);
-				return 1;
-			}
+	start_stats_phase(&stats, STATS_PHASE_READ_FILE);
+	error_code = open_disasm_session_from_file(session, filename, format);
+	end_stats_phase(&stats);
+	if (error_code) {
+		session->stats = NULL;
+		session->renames = &session->empty_renames;
+		free_rename_map(&renames);
+		return error_code;
+	}
+
+	if (cache_dir) {
+		compose_analysis_cache_key(session, key);
+		if (!(cache_filename = compose_analysis_cache_filename(cache_dir, key))) {
+			fprintf(stderr, "Unable to allocate memory\n");
+			error_code = 1;
+			goto end;
 		}
+	}
 
-		header_size = header.header_paragraphs * 16;
-		if (header.bytes_in_last_page) {
-			file_size = (header.pages_count - 1) * 512 + header.bytes_in_last_page;
+	/* Loading the cache replaces the analysis, so it is measured as part of it */
+	start_stats_phase(&stats, STATS_PHASE_COMPOSE_PCONTENT);
+	if (cache_filename && !load_analysis_cache_file(session, cache_filename)) {
+		end_stats_phase(&stats);
+	}
+	else if (cache_filename && previous_filename && !load_previous_build_analysis(session, previous_filename, format, cache_dir)) {
+		end_stats_phase(&stats);
+		save_analysis_cache_file(session, cache_filename);
+	}
+	else {
+		error_code = analyse_disasm_session(session);
+		end_stats_phase(&stats);
+		if (error_code) {
+			goto end;
 		}
-		else {
-			file_size = header.pages_count * 512;
+
+		start_stats_phase(&stats, STATS_PHASE_FIND_FUNCTIONS);
+		error_code = find_disasm_session_functions(session);
+		end_stats_phase(&stats);
+		if (error_code) {
+			goto end;
 		}
 
-		result->size = file_size - header_size;
+		if (cache_filename) {
+			save_analysis_cache_file(session, cache_filename);
+		}
+	}
 
-		result->buffer = malloc(result->size);
-		if (!result->buffer) {
-			fprintf(stderr, "Unable to allocate memory\n");
-			fclose(file);
-			if (result->relocation_count) {
-				free(result->relocation_table);
-			}
-			return 1;
+	if (out_filename) {
+		initialize_printer(&printer_out, fopen(out_filename, "w"));
+		if (!printer_out.file) {
+			fprintf(stderr, "Unable to open output file\n");
+			error_code = 1;
+			goto end;
 		}
+	}
+	else {
+		initialize_printer(&printer_out, stdout);
+	}
 
-		if (fseek(file, header_size, SEEK_SET)) {
-			fprintf(stderr, "Unable to seek file after header\n");
-			free(result->buffer);
-			fclose(file);
-			if (result->relocation_count) {
-				free(result->relocation_table);
-			}
-			return 1;
+	/* Not being able to allocate the buffer is not critical, the printer will just write each token directly */
+	set_printer_buffered(&printer_out, PRINTER_DEFAULT_BUFFER_SIZE);
+
+	start_stats_phase(&stats, STATS_PHASE_DUMP);
+	error_code = dump_disasm_session_to_printer(session, &printer_out);
+	if (clear_printer(&printer_out)) {
+		fprintf(stderr, "Unable to write output file\n");
+		if (!error_code) {
+			error_code = 1;
 		}
+	}
 
-		if (fread(result->buffer, 1, result->size, file) != result->size) {
-			fprintf(stderr, "Unable to read code and data from file\n");
-			free(result->buffer);
-			fclose(file);
-			if (result->relocation_count) {
-				free(result->relocation_table);
-			}
-			return 1;
+	end_stats_phase(&stats);
+
+	if (printer_out.file != stdout) {
+		fclose(printer_out.file);
+	}
+
+	end:
+	if (stats_filename) {
+		FILE *stats_file;
+		stats.fixpoint_iterations = session->work_list.iteration_count;
+		stats.widened_blocks = session->work_list.widened_count;
+		stats.peak_arena_bytes = get_arena_peak_bytes(&session->arena);
+		stats.heap_allocations = session->heap_allocation_count - heap_allocations_before;
+		stats.instruction_cache_hits = session->instruction_cache.hit_count;
+		stats.instruction_cache_misses = session->instruction_cache.miss_count;
+		session->stats = NULL;
+
+		stats_file = fopen(stats_filename, "w");
+		if (!stats_file || write_stats_json(&stats, filename, format, stats_file)) {
+			fprintf(stderr, "Unable to write stats file\n");
 		}
 
-		result->relative_cs = header.initial_cs;
-		result->ip = header.initial_ip;
-		result->flags = 0;
-
-		if (header.relocations_count > 0) {
-			int i;
-			result->sorted_relocations = malloc(sizeof(const char *) * header.relocations_count);
-			if (!result->sorted_relocations) {
-				fprintf(stderr, "Unable to allocate memory for the sorted relocations\n");
-				free(result->buffer);
-				free(result->relocation_table);
-				fclose(file);
-				return 1;
-			}
+		if (stats_file) {
+			fclose(stats_file);
+		}
+	}
 
-			for (i = 0; i < header.relocations_count; i++) {
-				struct FarPointer *ptr = result->relocation_table + i;
-				const char *relocation = result->buffer + ptr->segment * 16 + ptr->offset;
-
-				int first = 0;
-				int last = i;
-				unsigned int j;
-
-				while (last > first) {
-					int index = (first + last) / 2;
-					const char *this_relocation = result->sorted_relocations[index];
-					if (this_relocation < relocation) {
-						first = index + 1;
-					}
-					else if (this_relocation > relocation) {
-						last = index;
-					}
-					else {
-						first = index;
-						last = index;
-					}
-				}
+	fprintf(stderr, "Peak arena usage: %lu bytes\n", (unsigned long) get_arena_peak_bytes(&session->arena));
+	fprintf(stderr, "Heap allocations: %lu\n", session->heap_allocation_count - heap_allocations_before);
+	fprintf(stderr, "Decoded instruction cache: %lu hits, %lu misses\n", session->instruction_cache.hit_count, session->instruction_cache.miss_count);
+	fprintf(stderr, "Split checkpoints: %lu hits, %lu misses\n", session->checkpoint_trail.hit_count, session->checkpoint_trail.miss_count);
+	reset_disasm_session(session);
+	session->renames = &session->empty_renames;
+	free_rename_map(&renames);
+	free(cache_filename);
+	return error_code;
+}
 
-				for (j = header.relocations_count; j > first; j--) {
-					result->sorted_relocations[j] = result->sorted_relocations[j - 1];
-				}
+/**
+ * Split the given line of the batch manifest into its tab-separated fields, removing the line break.
+ * This returns the number of fields found, storing up to max_count of them.
+ */
+static unsigned int split_batch_manifest_line(char *line, const char **fields, unsigned int max_count) {
+	unsigned int field_count = 0;
+	char *position;
+
+	line[strcspn(line, "\r\n")] = '\0';
+	if (!*line) {
+		return 0;
+	}
 
-				result->sorted_relocations[first] = relocation;
-			}
+	for (position = line; position; field_count++) {
+		char *separator = strchr(position, '\t');
+		if (field_count < max_count) {
+			fields[field_count] = position;
+		}
+
+		if (separator) {
+			*separator = '\0';
+			position = separator + 1;
+		}
+		else {
+			position = NULL;
 		}
 	}
-	else {
-		if (fseek(file, 0, SEEK_END)) {
-			fprintf(stderr, "Unable to seek file to its end.\n");
-			fclose(file);
-			return 1;
+
+	return field_count;
+}
+
+/**
+ * Disassemble all the files listed in the given manifest, using the same session.
+ *
+ * Each line of the manifest contains the input file, the output file, the format and, optionally,
+ * the map of naming replacements, separated by tabs. Empty lines and lines starting with '#' are ignored.
+ * Files that cannot be disassembled are reported, but they do not prevent the following ones to be disassembled.
+ * All files share the given cache directory, if any. A cache file written by two workers at once is detected
+ * by its checksum when loaded, and the image is analysed again.
+ *
+ * If more than one worker is allowed, each file is disassembled by a worker process forked from this one.
+ * Otherwise, or if workers are not supported, files are disassembled within this process, one after another.
+ * This will return 0 if all files were disassembled, or any other value otherwise.
+ */
+static int disassemble_batch(struct DisasmSession *session, const char *manifest_filename, const char *cache_dir, unsigned int worker_count) {
+	char line[BATCH_MANIFEST_LINE_MAX_LENGTH];
+	const char *fields[BATCH_MANIFEST_MAX_FIELD_COUNT];
+	unsigned int line_number = 0;
+	unsigned int failed_count = 0;
+	struct WorkerPool pool;
+	FILE *manifest = fopen(manifest_filename, "r");
+	if (!manifest) {
+		fprintf(stderr, "Unable to open batch manifest\n");
+		return 1;
+	}
+
+	initialize_worker_pool(&pool, worker_count);
+
+	while (fgets(line, sizeof(line), manifest)) {
+		unsigned int field_count;
+		int error_code;
+
+		line_number++;
+		if (!strchr(line, '\n') && !feof(manifest)) {
+			fprintf(stderr, "Line %u of batch manifest is too long\n", line_number);
+			failed_count++;
+			break;
 		}
 
-		result->size = ftell(file);
-		if (fseek(file, 0, SEEK_SET)) {
-			fprintf(stderr, "Unable to seek file to its beginning.\n");
-			fclose(file);
-			return 1;
+		field_count = split_batch_manifest_line(line, fields, BATCH_MANIFEST_MAX_FIELD_COUNT);
+		if (!field_count || fields[0][0] == '#') {
+			continue;
 		}
 
-		result->relocation_count = 0;
-		result->buffer = malloc(result->size);
-		if (!result->buffer) {
-			fprintf(stderr, "Unable to allocate memory\n");
-			fclose(file);
-			return 1;
+		if (field_count < BATCH_MANIFEST_MAX_FIELD_COUNT - 1 || field_count > BATCH_MANIFEST_MAX_FIELD_COUNT ||
+				!*fields[0] || !*fields[1] || !*fields[2] || (field_count == BATCH_MANIFEST_MAX_FIELD_COUNT && !*fields[3])) {
+			fprintf(stderr, "Line %u of batch manifest must contain the input file, the output file, the format and, optionally, the rename map, separated by tabs\n", line_number);
+			failed_count++;
+			continue;
 		}
 
-		if (fread(result->buffer, 1, result->size, file) != result->size) {
-			fprintf(stderr, "Unable to read code and data from file\n");
-			free(result->buffer);
-			fclose(file);
-			return 1;
+		switch (start_worker(&pool)) {
+			case WORKER_STARTED_IN_PARENT:
+				break;
+
+			case WORKER_STARTED_IN_CHILD:
+				/* The manifest is left open, as closing it could move the position where the parent is reading it */
+				if ((error_code = disassemble_file(session, fields[0], fields[2], fields[1], (field_count == BATCH_MANIFEST_MAX_FIELD_COUNT)? fields[3] : NULL, NULL, cache_dir, NULL))) {
+					fprintf(stderr, "Unable to disassemble %s\n", fields[0]);
+				}
+
+				clear_disasm_session(session);
+				finish_worker(error_code);
+				break;
+
+			default:
+				if (disassemble_file(session, fields[0], fields[2], fields[1], (field_count == BATCH_MANIFEST_MAX_FIELD_COUNT)? fields[3] : NULL, NULL, cache_dir, NULL)) {
+					fprintf(stderr, "Unable to disassemble %s\n", fields[0]);
+					failed_count++;
+				}
 		}
+	}
 
-		result->ip = 0x100;
-		result->relative_cs = -0x10;
-		mark_ds_matches_cs_at_start(result);
+	if (ferror(manifest)) {
+		fprintf(stderr, "Unable to read batch manifest\n");
+		failed_count++;
 	}
-	fclose(file);
-	return 0;
+
+	fclose(manifest);
+	failed_count += wait_for_workers(&pool);
+	if (failed_count) {
+		fprintf(stderr, "%u entries of the batch manifest failed\n", failed_count);
+	}
+
+	return failed_count != 0;
 }
 
 int main(int argc, const char *argv[]) {
@@ -228,23 +417,72 @@ int main(int argc, const char *argv[]) {
 	const char *format = NULL;
 	const char *out_filename = NULL;
 	const char *renames_filename = NULL;
+	const char *stats_filename = NULL;
+	const char *batch_filename = NULL;
+	const char *cache_dir = NULL;
+	const char *previous_filename = NULL;
+	unsigned long worker_count = 0;
 	int i;
-	struct SegmentReadResult read_result;
 	int error_code;
-	struct MutableCodeBlockList cblock_list;
-	struct GlobalVariableList gvar_list;
-	struct SegmentStartList segment_start_list;
-	struct MutableReferenceList ref_list;
-	struct FunctionList func_list;
-	struct FilePrinter printer_out;
-	struct FilePrinter printer_err;
-	struct RenameMap renames;
-	struct ProgramContent *pcontent;
+	struct DisasmSession session;
 
 	printf("%s", application_name_and_version);
+	initialize_disasm_session(&session);
 
 	for (i = 1; i < argc; i++) {
-		if (!strcmp(argv[i], "-f") || !strcmp(argv[i], "--format")) {
+		if (!strcmp(argv[i], "--batch")) {
+			if (++i < argc) {
+				batch_filename = argv[i];
+			}
+			else {
+				fprintf(stderr, "Missing file name after %s argument\n", argv[i - 1]);
+				print_help(argv[0]);
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[i], "--block-order")) {
+			if (++i < argc && !strcmp(argv[i], "allocation")) {
+				set_mcbwlist_order(&session.work_list, MCBWLIST_ORDER_ALLOCATION);
+			}
+			else if (i < argc && !strcmp(argv[i], "start")) {
+				set_mcbwlist_order(&session.work_list, MCBWLIST_ORDER_START);
+			}
+			else {
+				fprintf(stderr, "Missing or invalid block order after %s argument\n", argv[i - 1]);
+				print_help(argv[0]);
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[i], "--cache-dir")) {
+			if (++i < argc) {
+				cache_dir = argv[i];
+			}
+			else {
+				fprintf(stderr, "Missing directory name after %s argument\n", argv[i - 1]);
+				print_help(argv[0]);
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[i], "--extra-fixpoint-passes") || !strcmp(argv[i], "--iteration-limit") || !strcmp(argv[i], "--widening-threshold")) {
+			char *end;
+			unsigned long value;
+			if (++i >= argc || ((value = strtoul(argv[i], &end, 10)), *end != '\0' || end == argv[i])) {
+				fprintf(stderr, "Missing or invalid number after %s argument\n", argv[i - 1]);
+				print_help(argv[0]);
+				return 1;
+			}
+
+			if (!strcmp(argv[i - 1], "--extra-fixpoint-passes")) {
+				set_mcbwlist_extra_pass_count(&session.work_list, value);
+			}
+			else if (!strcmp(argv[i - 1], "--iteration-limit")) {
+				set_mcbwlist_iteration_limit(&session.work_list, value);
+			}
+			else {
+				set_mcbwlist_widening_threshold(&session.work_list, value);
+			}
+		}
+		else if (!strcmp(argv[i], "-f") || !strcmp(argv[i], "--format")) {
 			if (++i < argc) {
 				format = argv[i];
 			}
@@ -268,6 +506,17 @@ int main(int argc, const char *argv[]) {
 				return 1;
 			}
 		}
+		else if (!strcmp(argv[i], "-j")) {
+			char *end;
+			if (++i >= argc || ((worker_count = strtoul(argv[i], &end, 10)), *end != '\0' || end == argv[i] || !worker_count)) {
+				fprintf(stderr, "Missing or invalid number of workers after %s argument\n", argv[i - 1]);
+				print_help(argv[0]);
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[i], "--no-provenance")) {
+			session.track_provenance = 0;
+		}
 		else if (!strcmp(argv[i], "-o")) {
 			if (++i < argc) {
 				out_filename = argv[i];
@@ -278,6 +527,26 @@ int main(int argc, const char *argv[]) {
 				return 1;
 			}
 		}
+		else if (!strcmp(argv[i], "--previous")) {
+			if (++i < argc) {
+				previous_filename = argv[i];
+			}
+			else {
+				fprintf(stderr, "Missing file name after %s argument\n", argv[i - 1]);
+				print_help(argv[0]);
+				return 1;
+			}
+		}
+		else if (!strcmp(argv[i], "--stats")) {
+			if (++i < argc) {
+				stats_filename = argv[i];
+			}
+			else {
+				fprintf(stderr, "Missing file name after %s argument\n", argv[i - 1]);
+				print_help(argv[0]);
+				return 1;
+			}
+		}
 		else if (!strcmp(argv[i], "-r")) {
 			if (++i < argc) {
 				renames_filename = argv[i];
@@ -295,133 +564,43 @@ int main(int argc, const char *argv[]) {
 		}
 	}
 
-	if (!filename) {
-		fprintf(stderr, "Argument -i is required\n");
+	if (previous_filename && !cache_dir) {
+		fprintf(stderr, "Argument --previous requires --cache-dir\n");
 		print_help(argv[0]);
 		return 1;
 	}
 
-	if (!format) {
-		fprintf(stderr, "Argument -f or --format is required\n");
+	if (worker_count && !batch_filename) {
+		fprintf(stderr, "Argument -j requires --batch\n");
 		print_help(argv[0]);
 		return 1;
 	}
 
-	if (renames_filename) {
-		DEBUG_PRINT1("Reading rename map from %s.\n", renames_filename);
-		if ((error_code = read_renames_file(&renames, renames_filename))) {
-			return error_code;
+	if (batch_filename) {
+		if (filename || format || out_filename || renames_filename || stats_filename || previous_filename) {
+			fprintf(stderr, "Argument --batch cannot be combined with -i, -f, -o, -r, --previous or --stats\n");
+			print_help(argv[0]);
+			return 1;
 		}
 
-#ifdef DEBUG
-		print_rename_map(&renames);
-#endif /* DEBUG */
-	}
-	else {
-		renames.entry_count = 0;
-	}
-
-	if ((error_code = read_file(&read_result, filename, format))) {
+		error_code = disassemble_batch(&session, batch_filename, cache_dir, worker_count? worker_count : 1);
+		clear_disasm_session(&session);
 		return error_code;
 	}
 
-	initialize_cblock_list(&cblock_list);
-	initialize_gvar_list(&gvar_list);
-	initialize_segment_start_list(&segment_start_list);
-	initialize_ref_list(&ref_list);
-
-	if (ds_should_match_cs_at_segment_start(&read_result)) {
-		set_printer_bin_format(&printer_err);
-	}
-	else {
-		set_printer_dos_format(&printer_err);
-	}
-
-	printer_err.buffer_start = read_result.buffer;
-	printer_err.file = stderr;
-	printer_err.func_list = NULL;
-	printer_err.renames = &renames;
-
-	pcontent = compose_pcontent(&read_result, &printer_err, &cblock_list, &gvar_list, &segment_start_list, &ref_list);
-	if (!pcontent) {
-		goto end0;
-	}
-
-	DEBUG_PRINT1("Found %d blocks.\n", get_pcontent_block_count(pcontent));
-	initialize_func_list(&func_list);
-
-	if ((error_code = find_functions(get_pcontent_blocks(pcontent), get_pcontent_block_count(pcontent), &func_list))) {
-		goto end;
-	}
-#ifdef DEBUG
-	print_funclist(&func_list);
-#endif /* DEBUG */
-
-	printer_err.func_list = &func_list;
-	if (ds_should_match_cs_at_segment_start(&read_result)) {
-		set_printer_bin_format(&printer_out);
-	}
-	else {
-		set_printer_dos_format(&printer_out);
-	}
-
-	printer_out.buffer_start = read_result.buffer;
-	printer_out.func_list = &func_list;
-	printer_out.renames = &renames;
-	if (out_filename) {
-		printer_out.file = fopen(out_filename, "w");
-		if (!printer_out.file) {
-			fprintf(stderr, "Unable to open output file\n");
-			goto end;
-		}
-	}
-	else {
-		printer_out.file = stdout;
-	}
-
-	if (!strcmp(format, "bin")) {
-		print(&printer_out, "org 0x100\n");
-	}
-
-	error_code = dump(
-			read_result.buffer,
-			read_result.relative_cs? 0x100 : 0,
-			pcontent,
-			segment_start_list.start,
-			segment_start_list.count,
-			read_result.sorted_relocations,
-			read_result.relocation_count,
-			&func_list,
-			&printer_out,
-			&printer_err);
-
-	if (printer_out.file != stdout) {
-		fclose(printer_out.file);
-	}
-
-	end:
-	clear_func_list(&func_list);
-	free(pcontent);
-
-	end0:
-	if (read_result.relocation_count) {
-		free(read_result.sorted_relocations);
-		free(read_result.relocation_table);
+	if (!filename) {
+		fprintf(stderr, "Argument -i is required\n");
+		print_help(argv[0]);
+		return 1;
 	}
 
-	for (i = 0; i < cblock_list.block_count; i++) {
-		struct CodeBlockOriginList *origin_list = get_mcblock_origin_list(cblock_list.sorted_blocks[i]);
-		int j;
-		for (j = 0; j < origin_list->origin_count; j++) {
-			clear_gvwvmap(get_cborigin_var_values(origin_list->sorted_origins[j]));
-		}
-		clear_cborigin_list(origin_list);
+	if (!format) {
+		fprintf(stderr, "Argument -f or --format is required\n");
+		print_help(argv[0]);
+		return 1;
 	}
 
-	clear_ref_list(&ref_list);
-	clear_segment_start_list(&segment_start_list);
-	clear_gvar_list(&gvar_list);
-	clear_cblock_list(&cblock_list);
-	free(read_result.buffer);
+	error_code = disassemble_file(&session, filename, format, out_filename, renames_filename, stats_filename, cache_dir, previous_filename);
+	clear_disasm_session(&session);
 	return error_code;
 }
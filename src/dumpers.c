@@ -2,7 +2,7 @@
 #include "printu.h"
 #include "reader.h"
 #include "relocu.h"
-#include "counter.h"
+#include "dicache.h"
 #include "funclist.h"
 
 const char *BYTE_REGISTERS[] = {
@@ -129,666 +129,664 @@ static int dump_instruction(
 		struct Reader *reader,
 		const struct CodeBlock *block,
 		const struct Reference *reference,
-		const char **sorted_relocations,
-		unsigned int relocation_count,
+		const struct DecodedInstruction *decoded,
+		const struct SortedRelocations *sorted_relocations,
 		struct FunctionList *func_list,
 		struct FilePrinter *printer_out,
 		struct FilePrinter *printer_err) {
-	const char *segment = NULL;
-	while (1) {
-		const int value0 = read_next_byte(reader);
-		if (value0 >= 0 && value0 < 0x40 && (value0 & 0x06) != 0x06) {
-			print(printer_out, INSTRUCTION[value0 >> 3]);
-			print(printer_out, " ");
-			if ((value0 & 0x04) == 0x00) {
-				const char **registers;
-				int value1;
-				if (value0 & 0x01) {
-					registers = WORD_REGISTERS;
-				}
-				else {
-					registers = BYTE_REGISTERS;
-				}
-
-				value1 = read_next_byte(reader);
-				dump_address_register_combination(buffer, buffer_origin, reader, reference, printer_out, value0, value1, registers, segment, registers);
-				print(printer_out, "\n");
-				return 0;
-			}
-			else if ((value0 & 0x07) == 0x04) {
-				print(printer_out, BYTE_REGISTERS[0]);
-				print(printer_out, ",");
-				print_literal_hex_byte(printer_out, read_next_byte(reader));
-				print(printer_out, "\n");
-				return 0;
-			}
-			else {
-				/* (value0 & 0x07) == 0x05 */
-				print(printer_out, WORD_REGISTERS[0]);
-				print(printer_out, ",");
-				print_literal_hex_word(printer_out, read_next_word(reader));
-				print(printer_out, "\n");
-				return 0;
-			}
-		}
-		else if ((value0 & 0xE6) == 0x06 && value0 != 0x0F) {
+	const int value0 = decoded->opcode;
+	const char *segment = (decoded->segment_index == DECODED_SEGMENT_INDEX_UNDEFINED)? NULL : SEGMENT_REGISTERS[decoded->segment_index];
+
+	reader->buffer_index += decoded->prefix_count + 1;
+	if (value0 >= 0 && value0 < 0x40 && (value0 & 0x06) != 0x06) {
+		print(printer_out, INSTRUCTION[value0 >> 3]);
+		print(printer_out, " ");
+		if ((value0 & 0x04) == 0x00) {
+			const char **registers;
+			int value1;
 			if (value0 & 0x01) {
-				print(printer_out, "pop ");
+				registers = WORD_REGISTERS;
 			}
 			else {
-				print(printer_out, "push ");
+				registers = BYTE_REGISTERS;
 			}
-			print(printer_out, SEGMENT_REGISTERS[(value0 >> 3) & 0x03]);
+
+			value1 = read_next_byte(reader);
+			dump_address_register_combination(buffer, buffer_origin, reader, reference, printer_out, value0, value1, registers, segment, registers);
 			print(printer_out, "\n");
 			return 0;
 		}
-		else if ((value0 & 0xE7) == 0x26) {
-			segment = SEGMENT_REGISTERS[(value0 >> 3) & 0x03];
-		}
-		else if ((value0 & 0xF0) == 0x40) {
-			if (value0 & 0x08) {
-				print(printer_out, "dec ");
-			}
-			else {
-				print(printer_out, "inc ");
-			}
-			print(printer_out, WORD_REGISTERS[value0 & 0x07]);
+		else if ((value0 & 0x07) == 0x04) {
+			print(printer_out, BYTE_REGISTERS[0]);
+			print(printer_out, ",");
+			print_literal_hex_byte(printer_out, read_next_byte(reader));
 			print(printer_out, "\n");
 			return 0;
 		}
-		else if ((value0 & 0xF0) == 0x50) {
-			if (value0 & 0x08) {
-				print(printer_out, "pop ");
-			}
-			else {
-				print(printer_out, "push ");
-			}
-			print(printer_out, WORD_REGISTERS[value0 & 0x07]);
+		else {
+			/* (value0 & 0x07) == 0x05 */
+			print(printer_out, WORD_REGISTERS[0]);
+			print(printer_out, ",");
+			print_literal_hex_word(printer_out, read_next_word(reader));
 			print(printer_out, "\n");
 			return 0;
 		}
-		else if ((value0 & 0xF0) == 0x70) {
-			const int value1 = read_next_byte(reader);
-			const int target_ip = get_cblock_ip(block) + reader->buffer_index + ((value1 >= 0x80)? value1 - 256 : value1);
-
-			print(printer_out, JUMP_INSTRUCTIONS[value0 & 0x0F]);
-			print(printer_out, " ");
-			print_code_label(printer_out, target_ip, get_cblock_relative_cs(block));
-			print(printer_out, "\n");
-			return 0;
+	}
+	else if ((value0 & 0xE6) == 0x06 && value0 != 0x0F) {
+		if (value0 & 0x01) {
+			print(printer_out, "pop ");
 		}
-		else if ((value0 & 0xFE) == 0x80) {
-			const char **registers;
-			const int value1 = read_next_byte(reader);
-			print(printer_out, INSTRUCTION[(value1 >> 3) & 0x07]);
-			if ((value1 & 0xC0) != 0xC0) {
-				if (value0 & 1) {
-					print(printer_out, " word ");
-				}
-				else {
-					print(printer_out, " byte ");
-				}
-			}
-			else {
-				print(printer_out, " ");
-			}
+		else {
+			print(printer_out, "push ");
+		}
+		print(printer_out, SEGMENT_REGISTERS[(value0 >> 3) & 0x03]);
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if ((value0 & 0xF0) == 0x40) {
+		if (value0 & 0x08) {
+			print(printer_out, "dec ");
+		}
+		else {
+			print(printer_out, "inc ");
+		}
+		print(printer_out, WORD_REGISTERS[value0 & 0x07]);
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if ((value0 & 0xF0) == 0x50) {
+		if (value0 & 0x08) {
+			print(printer_out, "pop ");
+		}
+		else {
+			print(printer_out, "push ");
+		}
+		print(printer_out, WORD_REGISTERS[value0 & 0x07]);
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if ((value0 & 0xF0) == 0x70) {
+		const int value1 = read_next_byte(reader);
+		const int target_ip = get_cblock_ip(block) + reader->buffer_index + ((value1 >= 0x80)? value1 - 256 : value1);
 
-			registers = (value0 & 1)? WORD_REGISTERS : BYTE_REGISTERS;
-			dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, registers);
-			print(printer_out, ",");
+		print(printer_out, JUMP_INSTRUCTIONS[value0 & 0x0F]);
+		print(printer_out, " ");
+		print_code_label(printer_out, target_ip, get_cblock_relative_cs(block));
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if ((value0 & 0xFE) == 0x80) {
+		const char **registers;
+		const int value1 = read_next_byte(reader);
+		print(printer_out, INSTRUCTION[(value1 >> 3) & 0x07]);
+		if ((value1 & 0xC0) != 0xC0) {
 			if (value0 & 1) {
-				print_literal_hex_word(printer_out, read_next_word(reader));
+				print(printer_out, " word ");
 			}
 			else {
-				print_literal_hex_byte(printer_out, read_next_byte(reader));
+				print(printer_out, " byte ");
 			}
-			print(printer_out, "\n");
-			return 0;
 		}
-		else if (value0 == 0x83) {
-			const int value1 = read_next_byte(reader);
-			print(printer_out, INSTRUCTION[(value1 >> 3) & 0x07]);
-			print(printer_out, (value1 < 0xC0)? " word " : " ");
+		else {
+			print(printer_out, " ");
+		}
 
-			dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, WORD_REGISTERS);
-			print(printer_out, ",");
-			print_differential_hex_byte(printer_out, read_next_byte(reader));
-			print(printer_out, "\n");
-			return 0;
+		registers = (value0 & 1)? WORD_REGISTERS : BYTE_REGISTERS;
+		dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, registers);
+		print(printer_out, ",");
+		if (value0 & 1) {
+			print_literal_hex_word(printer_out, read_next_word(reader));
 		}
-		else if ((value0 & 0xFE) == 0x86 || (value0 & 0xFC) == 0x88) {
-			const char **registers = (value0 & 1)? WORD_REGISTERS : BYTE_REGISTERS;
-			const int value1 = read_next_byte(reader);
-			print(printer_out, (value0 < 0x88)? "xchg " : "mov ");
-			dump_address_register_combination(buffer, buffer_origin, reader, reference, printer_out, value0, value1, registers, segment, registers);
-			print(printer_out, "\n");
-			return 0;
+		else {
+			print_literal_hex_byte(printer_out, read_next_byte(reader));
 		}
-		else if ((value0 & 0xFD) == 0x8C) {
-			const int value1 = read_next_byte(reader);
-			if (value1 & 0x20) {
-				print(printer_out, "db ");
-				print_literal_hex_byte(printer_out, value0);
-				print(printer_out, " ");
-				print_literal_hex_byte(printer_out, value1);
-				print(printer_out, " ; Unknown instruction\n");
-				return 1;
-			}
-			else {
-				print(printer_out, "mov ");
-				dump_address_register_combination(buffer, buffer_origin, reader, reference, printer_out, value0, value1, SEGMENT_REGISTERS, segment, WORD_REGISTERS);
-				print(printer_out, "\n");
-				return 0;
-			}
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if (value0 == 0x83) {
+		const int value1 = read_next_byte(reader);
+		print(printer_out, INSTRUCTION[(value1 >> 3) & 0x07]);
+		print(printer_out, (value1 < 0xC0)? " word " : " ");
+
+		dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, WORD_REGISTERS);
+		print(printer_out, ",");
+		print_differential_hex_byte(printer_out, read_next_byte(reader));
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if ((value0 & 0xFE) == 0x86 || (value0 & 0xFC) == 0x88) {
+		const char **registers = (value0 & 1)? WORD_REGISTERS : BYTE_REGISTERS;
+		const int value1 = read_next_byte(reader);
+		print(printer_out, (value0 < 0x88)? "xchg " : "mov ");
+		dump_address_register_combination(buffer, buffer_origin, reader, reference, printer_out, value0, value1, registers, segment, registers);
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if ((value0 & 0xFD) == 0x8C) {
+		const int value1 = read_next_byte(reader);
+		if (value1 & 0x20) {
+			print(printer_out, "db ");
+			print_literal_hex_byte(printer_out, value0);
+			print(printer_out, " ");
+			print_literal_hex_byte(printer_out, value1);
+			print(printer_out, " ; Unknown instruction\n");
+			return 1;
 		}
-		else if (value0 == 0x8D) {
-			const int value1 = read_next_byte(reader);
-			if (value1 >= 0xC0) {
-				print(printer_out, "db ");
-				print_literal_hex_byte(printer_out, value0);
-				print(printer_out, " ");
-				print_literal_hex_byte(printer_out, value1);
-				print(printer_out, " ; Unknown instruction\n");
-				return 1;
-			}
-			else {
-				print(printer_out, "lea ");
-				print(printer_out, WORD_REGISTERS[(value1 >> 3) & 0x07]);
-				print(printer_out, ",");
-				dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, NULL);
-				print(printer_out, "\n");
-				return 0;
-			}
+		else {
+			print(printer_out, "mov ");
+			dump_address_register_combination(buffer, buffer_origin, reader, reference, printer_out, value0, value1, SEGMENT_REGISTERS, segment, WORD_REGISTERS);
+			print(printer_out, "\n");
+			return 0;
 		}
-		else if (value0 == 0x8F) {
-			const int value1 = read_next_byte(reader);
-			if (value1 & 0x38 || value1 >= 0xC0) {
-				print(printer_out, "db ");
-				print_literal_hex_byte(printer_out, value0);
-				print(printer_out, " ");
-				print_literal_hex_byte(printer_out, value1);
-				print(printer_out, " ; Unknown instruction\n");
-				return 1;
-			}
-			else {
-				print(printer_out, "pop ");
-				dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, NULL);
-				print(printer_out, "\n");
-				return 0;
-			}
+	}
+	else if (value0 == 0x8D) {
+		const int value1 = read_next_byte(reader);
+		if (value1 >= 0xC0) {
+			print(printer_out, "db ");
+			print_literal_hex_byte(printer_out, value0);
+			print(printer_out, " ");
+			print_literal_hex_byte(printer_out, value1);
+			print(printer_out, " ; Unknown instruction\n");
+			return 1;
 		}
-		else if (value0 == 0x90) {
-			print(printer_out, "nop\n");
+		else {
+			print(printer_out, "lea ");
+			print(printer_out, WORD_REGISTERS[(value1 >> 3) & 0x07]);
+			print(printer_out, ",");
+			dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, NULL);
+			print(printer_out, "\n");
 			return 0;
 		}
-		else if ((value0 & 0xF8) == 0x90) {
-			print(printer_out, "xchg ax,");
-			print(printer_out, WORD_REGISTERS[value0 & 0x07]);
+	}
+	else if (value0 == 0x8F) {
+		const int value1 = read_next_byte(reader);
+		if (value1 & 0x38 || value1 >= 0xC0) {
+			print(printer_out, "db ");
+			print_literal_hex_byte(printer_out, value0);
+			print(printer_out, " ");
+			print_literal_hex_byte(printer_out, value1);
+			print(printer_out, " ; Unknown instruction\n");
+			return 1;
+		}
+		else {
+			print(printer_out, "pop ");
+			dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, NULL);
 			print(printer_out, "\n");
 			return 0;
 		}
-		else if (value0 == 0x98) {
-			print(printer_out, "cbw\n");
-			return 0;
+	}
+	else if (value0 == 0x90) {
+		print(printer_out, "nop\n");
+		return 0;
+	}
+	else if ((value0 & 0xF8) == 0x90) {
+		print(printer_out, "xchg ax,");
+		print(printer_out, WORD_REGISTERS[value0 & 0x07]);
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if (value0 == 0x98) {
+		print(printer_out, "cbw\n");
+		return 0;
+	}
+	else if (value0 == 0x99) {
+		print(printer_out, "cwd\n");
+		return 0;
+	}
+	else if ((value0 & 0xFC) == 0xA0) {
+		const char **registers;
+		int addr_value;
+		print(printer_out, "mov ");
+		if (value0 & 1) {
+			registers = WORD_REGISTERS;
 		}
-		else if (value0 == 0x99) {
-			print(printer_out, "cwd\n");
-			return 0;
+		else {
+			registers = BYTE_REGISTERS;
 		}
-		else if ((value0 & 0xFC) == 0xA0) {
-			const char **registers;
-			int addr_value;
-			print(printer_out, "mov ");
-			if (value0 & 1) {
-				registers = WORD_REGISTERS;
+
+		addr_value = read_next_word(reader);
+		if ((value0 & 0xFE) == 0xA0) {
+			struct GlobalVariable *var;
+			print(printer_out, registers[0]);
+			print(printer_out, ",[");
+			if (segment) {
+				print(printer_out, segment);
+				print(printer_out, ":");
+			}
+
+			if (reference && (var = get_gvar_from_ref_target(reference)) && is_ref_in_instruction_address(reference)) {
+				const unsigned int reference_address = get_gvar_relative_address(var);
+				print_variable_label(printer_out, reference_address);
+
+				if (addr_value < reference_address + buffer_origin) {
+					print(printer_out, "-");
+					print_segment_label(printer_out, buffer + (reference_address + buffer_origin - addr_value));
+				}
+				else if (addr_value > reference_address + buffer_origin) {
+					print(printer_out, "+");
+					print_segment_label(printer_out, buffer + (addr_value - reference_address - buffer_origin));
+				}
 			}
 			else {
-				registers = BYTE_REGISTERS;
+				print_literal_hex_word(printer_out, addr_value);
 			}
 
-			addr_value = read_next_word(reader);
-			if ((value0 & 0xFE) == 0xA0) {
-				struct GlobalVariable *var;
-				print(printer_out, registers[0]);
-				print(printer_out, ",[");
-				if (segment) {
-					print(printer_out, segment);
-					print(printer_out, ":");
-				}
+			print(printer_out, "]");
+		}
+		else {
+			struct GlobalVariable *var;
 
-				if (reference && (var = get_gvar_from_ref_target(reference)) && is_ref_in_instruction_address(reference)) {
-					const unsigned int reference_address = get_gvar_relative_address(var);
-					print_variable_label(printer_out, reference_address);
+			print(printer_out, "[");
+			if (segment) {
+				print(printer_out, segment);
+				print(printer_out, ":");
+			}
 
-					if (addr_value < reference_address + buffer_origin) {
-						print(printer_out, "-");
-						print_segment_label(printer_out, buffer + (reference_address + buffer_origin - addr_value));
-					}
-					else if (addr_value > reference_address + buffer_origin) {
-						print(printer_out, "+");
-						print_segment_label(printer_out, buffer + (addr_value - reference_address - buffer_origin));
-					}
+			if (reference && (var = get_gvar_from_ref_target(reference)) && is_ref_in_instruction_address(reference)) {
+				const unsigned int reference_address = get_gvar_relative_address(var);
+				print_variable_label(printer_out, reference_address);
+
+				if (addr_value < reference_address + buffer_origin) {
+					print(printer_out, "-");
+					print_segment_label(printer_out, buffer + (reference_address + buffer_origin - addr_value));
 				}
-				else {
-					print_literal_hex_word(printer_out, addr_value);
+				else if (addr_value > reference_address + buffer_origin) {
+					print(printer_out, "+");
+					print_segment_label(printer_out, buffer + (addr_value - reference_address - buffer_origin));
 				}
-
-				print(printer_out, "]");
 			}
 			else {
-				struct GlobalVariable *var;
+				print_literal_hex_word(printer_out, addr_value);
+			}
+
+			print(printer_out, "],");
+			print(printer_out, registers[0]);
+		}
 
-				print(printer_out, "[");
-				if (segment) {
-					print(printer_out, segment);
-					print(printer_out, ":");
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if (value0 == 0xA4) {
+		print(printer_out, "movsb\n");
+		return 0;
+	}
+	else if (value0 == 0xA5) {
+		print(printer_out, "movsw\n");
+		return 0;
+	}
+	else if (value0 == 0xA6) {
+		print(printer_out, "cmpsb\n");
+		return 0;
+	}
+	else if (value0 == 0xA7) {
+		print(printer_out, "cmpsw\n");
+		return 0;
+	}
+	else if (value0 == 0xA8) {
+		print(printer_out, "test al,");
+		print_literal_hex_byte(printer_out, read_next_byte(reader));
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if (value0 == 0xA9) {
+		print(printer_out, "test ax,");
+		print_literal_hex_word(printer_out, read_next_word(reader));
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if (value0 == 0xAA) {
+		print(printer_out, "stosb\n");
+		return 0;
+	}
+	else if (value0 == 0xAB) {
+		print(printer_out, "stosw\n");
+		return 0;
+	}
+	else if (value0 == 0xAC) {
+		print(printer_out, "lodsb\n");
+		return 0;
+	}
+	else if (value0 == 0xAD) {
+		print(printer_out, "lodsw\n");
+		return 0;
+	}
+	else if (value0 == 0xAE) {
+		print(printer_out, "scasb\n");
+		return 0;
+	}
+	else if (value0 == 0xAF) {
+		print(printer_out, "scasw\n");
+		return 0;
+	}
+	else if ((value0 & 0xF0) == 0xB0) {
+		print(printer_out, "mov ");
+		if (value0 & 0x08) {
+			const char *relocation_query;
+			int offset_value;
+			int relocation_segment_present = 0;
+			struct GlobalVariable *var;
+			struct CodeBlock *ref_block;
+
+			print(printer_out, WORD_REGISTERS[value0 & 0x07]);
+			print(printer_out, ",");
+			relocation_query = reader->buffer + reader->buffer_index;
+			offset_value = read_next_word(reader);
+			if ((relocation_segment_present = is_relocation_present_in_sorted_relocations(sorted_relocations, relocation_query))) {
+				print(printer_out, RELOCATION_VALUE);
+			}
+
+			if (reference && (var = get_gvar_from_ref_target(reference)) && !is_ref_in_instruction_address(reference)) {
+				unsigned int ref_var_value = get_gvar_relative_address(var);
+				if (relocation_segment_present) {
+					print(printer_out, "+");
 				}
 
-				if (reference && (var = get_gvar_from_ref_target(reference)) && is_ref_in_instruction_address(reference)) {
-					const unsigned int reference_address = get_gvar_relative_address(var);
-					print_variable_label(printer_out, reference_address);
+				print_variable_label(printer_out, ref_var_value);
+			}
+			else if (reference && (ref_block = get_cblock_from_ref_target(reference))) {
+				if (relocation_segment_present) {
+					print(printer_out, "+");
+				}
 
-					if (addr_value < reference_address + buffer_origin) {
-						print(printer_out, "-");
-						print_segment_label(printer_out, buffer + (reference_address + buffer_origin - addr_value));
-					}
-					else if (addr_value > reference_address + buffer_origin) {
+				print_code_label(printer_out, get_cblock_ip(ref_block), get_cblock_relative_cs(ref_block));
+			}
+			else {
+				if (relocation_segment_present) {
+					if (offset_value) {
 						print(printer_out, "+");
-						print_segment_label(printer_out, buffer + (addr_value - reference_address - buffer_origin));
+						print_literal_hex_word(printer_out, offset_value);
 					}
 				}
 				else {
-					print_literal_hex_word(printer_out, addr_value);
+					print_literal_hex_word(printer_out, offset_value);
 				}
-
-				print(printer_out, "],");
-				print(printer_out, registers[0]);
 			}
-
-			print(printer_out, "\n");
-			return 0;
-		}
-		else if (value0 == 0xA4) {
-			print(printer_out, "movsb\n");
-			return 0;
-		}
-		else if (value0 == 0xA5) {
-			print(printer_out, "movsw\n");
-			return 0;
-		}
-		else if (value0 == 0xA6) {
-			print(printer_out, "cmpsb\n");
-			return 0;
 		}
-		else if (value0 == 0xA7) {
-			print(printer_out, "cmpsw\n");
-			return 0;
-		}
-		else if (value0 == 0xA8) {
-			print(printer_out, "test al,");
+		else {
+			print(printer_out, BYTE_REGISTERS[value0 & 0x07]);
+			print(printer_out, ",");
 			print_literal_hex_byte(printer_out, read_next_byte(reader));
-			print(printer_out, "\n");
-			return 0;
-		}
-		else if (value0 == 0xA9) {
-			print(printer_out, "test ax,");
-			print_literal_hex_word(printer_out, read_next_word(reader));
-			print(printer_out, "\n");
-			return 0;
-		}
-		else if (value0 == 0xAA) {
-			print(printer_out, "stosb\n");
-			return 0;
-		}
-		else if (value0 == 0xAB) {
-			print(printer_out, "stosw\n");
-			return 0;
 		}
-		else if (value0 == 0xAC) {
-			print(printer_out, "lodsb\n");
-			return 0;
-		}
-		else if (value0 == 0xAD) {
-			print(printer_out, "lodsw\n");
-			return 0;
-		}
-		else if (value0 == 0xAE) {
-			print(printer_out, "scasb\n");
-			return 0;
-		}
-		else if (value0 == 0xAF) {
-			print(printer_out, "scasw\n");
-			return 0;
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if (value0 == 0xC2) {
+		print(printer_out, "ret ");
+		print_literal_hex_word(printer_out, read_next_word(reader));
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if (value0 == 0xC3) {
+		print(printer_out, "ret\n");
+		return 0;
+	}
+	else if ((value0 & 0xFE) == 0xC4) {
+		const int value1 = read_next_byte(reader);
+		if ((value1 & 0xC0) == 0xC0) {
+			print(printer_out, "db ");
+			print_literal_hex_byte(printer_out, value0);
+			print(printer_out, " ");
+			print_literal_hex_byte(printer_out, value1);
+			print(printer_out, " ; Unknown instruction\n");
+			return 1;
 		}
-		else if ((value0 & 0xF0) == 0xB0) {
-			print(printer_out, "mov ");
-			if (value0 & 0x08) {
-				const char *relocation_query;
-				int offset_value;
-				int relocation_segment_present = 0;
-				struct GlobalVariable *var;
-				struct CodeBlock *ref_block;
-
-				print(printer_out, WORD_REGISTERS[value0 & 0x07]);
-				print(printer_out, ",");
-				relocation_query = reader->buffer + reader->buffer_index;
-				offset_value = read_next_word(reader);
-				if ((relocation_segment_present = is_relocation_present_in_sorted_relocations(sorted_relocations, relocation_count, relocation_query))) {
-					print(printer_out, RELOCATION_VALUE);
-				}
-
-				if (reference && (var = get_gvar_from_ref_target(reference)) && !is_ref_in_instruction_address(reference)) {
-					unsigned int ref_var_value = get_gvar_relative_address(var);
-					if (relocation_segment_present) {
-						print(printer_out, "+");
-					}
-
-					print_variable_label(printer_out, ref_var_value);
-				}
-				else if (reference && (ref_block = get_cblock_from_ref_target(reference))) {
-					if (relocation_segment_present) {
-						print(printer_out, "+");
-					}
-
-					print_code_label(printer_out, get_cblock_ip(ref_block), get_cblock_relative_cs(ref_block));
-				}
-				else {
-					if (relocation_segment_present) {
-						if (offset_value) {
-							print(printer_out, "+");
-							print_literal_hex_word(printer_out, offset_value);
-						}
-					}
-					else {
-						print_literal_hex_word(printer_out, offset_value);
-					}
-				}
+		else {
+			if (value0 & 1) {
+				print(printer_out, "lds ");
 			}
 			else {
-				print(printer_out, BYTE_REGISTERS[value0 & 0x07]);
-				print(printer_out, ",");
-				print_literal_hex_byte(printer_out, read_next_byte(reader));
+				print(printer_out, "les ");
 			}
+
+			print(printer_out, WORD_REGISTERS[(value1 >> 3) & 0x07]);
+			print(printer_out, ",");
+			dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, NULL);
 			print(printer_out, "\n");
 			return 0;
 		}
-		else if (value0 == 0xC2) {
-			print(printer_out, "ret ");
-			print_literal_hex_word(printer_out, read_next_word(reader));
-			print(printer_out, "\n");
-			return 0;
-		}
-		else if (value0 == 0xC3) {
-			print(printer_out, "ret\n");
-			return 0;
+	}
+	else if ((value0 & 0xFE) == 0xC6) {
+		const int value1 = read_next_byte(reader);
+		if (value1 & 0x38) {
+			print(printer_out, "db ");
+			print_literal_hex_byte(printer_out, value0);
+			print(printer_out, " ");
+			print_literal_hex_byte(printer_out, value1);
+			print(printer_out, " ; Unknown instruction\n");
+			return 1;
 		}
-		else if ((value0 & 0xFE) == 0xC4) {
-			const int value1 = read_next_byte(reader);
-			if ((value1 & 0xC0) == 0xC0) {
-				print(printer_out, "db ");
-				print_literal_hex_byte(printer_out, value0);
-				print(printer_out, " ");
-				print_literal_hex_byte(printer_out, value1);
-				print(printer_out, " ; Unknown instruction\n");
-				return 1;
-			}
-			else {
+		else {
+			print(printer_out, "mov ");
+			if ((value1 & 0xC0) != 0xC0) {
 				if (value0 & 1) {
-					print(printer_out, "lds ");
+					print(printer_out, "word ");
 				}
 				else {
-					print(printer_out, "les ");
+					print(printer_out, "byte ");
 				}
-
-				print(printer_out, WORD_REGISTERS[(value1 >> 3) & 0x07]);
-				print(printer_out, ",");
-				dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, NULL);
-				print(printer_out, "\n");
-				return 0;
 			}
-		}
-		else if ((value0 & 0xFE) == 0xC6) {
-			const int value1 = read_next_byte(reader);
-			if (value1 & 0x38) {
-				print(printer_out, "db ");
-				print_literal_hex_byte(printer_out, value0);
-				print(printer_out, " ");
-				print_literal_hex_byte(printer_out, value1);
-				print(printer_out, " ; Unknown instruction\n");
-				return 1;
+			dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, BYTE_REGISTERS);
+			print(printer_out, ",");
+			if (value0 & 1) {
+				print_literal_hex_word(printer_out, read_next_word(reader));
 			}
 			else {
-				print(printer_out, "mov ");
-				if ((value1 & 0xC0) != 0xC0) {
-					if (value0 & 1) {
-						print(printer_out, "word ");
-					}
-					else {
-						print(printer_out, "byte ");
-					}
-				}
-				dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, BYTE_REGISTERS);
-				print(printer_out, ",");
-				if (value0 & 1) {
-					print_literal_hex_word(printer_out, read_next_word(reader));
-				}
-				else {
-					print_literal_hex_byte(printer_out, read_next_byte(reader));
-				}
-				print(printer_out, "\n");
-				return 0;
+				print_literal_hex_byte(printer_out, read_next_byte(reader));
 			}
-		}
-		else if (value0 == 0xCB) {
-			print(printer_out, "retf\n");
-			return 0;
-		}
-		else if (value0 == 0xCD) {
-			print(printer_out, "int ");
-			print_literal_hex_byte(printer_out, read_next_byte(reader));
 			print(printer_out, "\n");
 			return 0;
 		}
-		else if ((value0 & 0xFC) == 0xD0) {
-			const int value1 = read_next_byte(reader);
-			if ((value1 & 0x38) == 0x30) {
-				print(printer_out, "db ");
-				print_literal_hex_byte(printer_out, value0);
+	}
+	else if (value0 == 0xCB) {
+		print(printer_out, "retf\n");
+		return 0;
+	}
+	else if (value0 == 0xCD) {
+		print(printer_out, "int ");
+		print_literal_hex_byte(printer_out, read_next_byte(reader));
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if ((value0 & 0xFC) == 0xD0) {
+		const int value1 = read_next_byte(reader);
+		if ((value1 & 0x38) == 0x30) {
+			print(printer_out, "db ");
+			print_literal_hex_byte(printer_out, value0);
+			print(printer_out, " ");
+			print_literal_hex_byte(printer_out, value1);
+			print(printer_out, " ; Unknown instruction\n");
+			return 1;
+		}
+		else {
+			const char **registers;
+			print(printer_out, SHIFT_INSTRUCTIONS[(value1 >> 3) & 0x07]);
+			if ((value0 & 0xC0) == 0xC0) {
 				print(printer_out, " ");
-				print_literal_hex_byte(printer_out, value1);
-				print(printer_out, " ; Unknown instruction\n");
-				return 1;
+			}
+			else if (value1 & 1) {
+				print(printer_out, " word ");
 			}
 			else {
-				const char **registers;
-				print(printer_out, SHIFT_INSTRUCTIONS[(value1 >> 3) & 0x07]);
-				if ((value0 & 0xC0) == 0xC0) {
-					print(printer_out, " ");
-				}
-				else if (value1 & 1) {
-					print(printer_out, " word ");
-				}
-				else {
-					print(printer_out, " byte ");
-				}
-
-				registers = (value0 & 1)? WORD_REGISTERS : BYTE_REGISTERS;
-				dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, registers);
-
-				if (value0 & 2) {
-					print(printer_out, ",cl\n");
-				}
-				else {
-					print(printer_out, ",1\n");
-				}
-				return 0;
+				print(printer_out, " byte ");
 			}
-		}
-		else if ((value0 & 0xFC) == 0xE0) {
-			const int value1 = read_next_byte(reader);
-			const int target_ip = get_cblock_ip(block) + reader->buffer_index + ((value1 >= 0x80)? value1 - 256 : value1);
 
-			print(printer_out, LOOP_INSTRUCTIONS[value0 & 0x0F]);
-			print(printer_out, " ");
-			print_code_label(printer_out, target_ip, get_cblock_relative_cs(block));
-			print(printer_out, "\n");
-			return 0;
-		}
-		else if ((value0 & 0xFE) == 0xE8) {
-			const int diff = read_next_word(reader);
-			const uint16_t target_ip = get_cblock_ip(block) + reader->buffer_index + diff;
+			registers = (value0 & 1)? WORD_REGISTERS : BYTE_REGISTERS;
+			dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, registers);
 
-			if (value0 & 1) {
-				print(printer_out, "jmp ");
+			if (value0 & 2) {
+				print(printer_out, ",cl\n");
 			}
 			else {
-				print(printer_out, "call ");
+				print(printer_out, ",1\n");
 			}
-
-			print_code_label(printer_out, target_ip, get_cblock_relative_cs(block));
-			print(printer_out, "\n");
 			return 0;
 		}
-		else if (value0 == 0xEA) {
-			const int offset = read_next_word(reader);
-			print(printer_out, "jmp ");
-			print_literal_hex_word(printer_out, read_next_word(reader));
-			print(printer_out, ":");
-			print_literal_hex_word(printer_out, offset);
-			print(printer_out, "\n");
-		}
-		else if (value0 == 0xEB) {
-			const int value1 = read_next_byte(reader);
-			const int target_ip = get_cblock_ip(block) + reader->buffer_index + ((value1 >= 0x80)? value1 - 256 : value1);
-			int index;
+	}
+	else if ((value0 & 0xFC) == 0xE0) {
+		const int value1 = read_next_byte(reader);
+		const int target_ip = get_cblock_ip(block) + reader->buffer_index + ((value1 >= 0x80)? value1 - 256 : value1);
 
+		print(printer_out, LOOP_INSTRUCTIONS[value0 & 0x0F]);
+		print(printer_out, " ");
+		print_code_label(printer_out, target_ip, get_cblock_relative_cs(block));
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if ((value0 & 0xFE) == 0xE8) {
+		const int diff = read_next_word(reader);
+		const uint16_t target_ip = get_cblock_ip(block) + reader->buffer_index + diff;
+
+		if (value0 & 1) {
 			print(printer_out, "jmp ");
-			print_code_label(printer_out, target_ip, get_cblock_relative_cs(block));
-			print(printer_out, "\n");
-			return 0;
 		}
-		else if (value0 == 0xF2) {
-			print(printer_out, "repne\n");
-			return 0;
+		else {
+			print(printer_out, "call ");
 		}
-		else if (value0 == 0xF3) {
-			print(printer_out, "repe\n");
-			return 0;
+
+		print_code_label(printer_out, target_ip, get_cblock_relative_cs(block));
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if (value0 == 0xEA) {
+		const int offset = read_next_word(reader);
+		print(printer_out, "jmp ");
+		print_literal_hex_word(printer_out, read_next_word(reader));
+		print(printer_out, ":");
+		print_literal_hex_word(printer_out, offset);
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if (value0 == 0xEB) {
+		const int value1 = read_next_byte(reader);
+		const int target_ip = get_cblock_ip(block) + reader->buffer_index + ((value1 >= 0x80)? value1 - 256 : value1);
+		int index;
+
+		print(printer_out, "jmp ");
+		print_code_label(printer_out, target_ip, get_cblock_relative_cs(block));
+		print(printer_out, "\n");
+		return 0;
+	}
+	else if (value0 == 0xF2) {
+		print(printer_out, "repne\n");
+		return 0;
+	}
+	else if (value0 == 0xF3) {
+		print(printer_out, "repe\n");
+		return 0;
+	}
+	else if ((value0 & 0xFE) == 0xF6) {
+		const int value1 = read_next_byte(reader);
+		if ((value1 & 0x38) == 0x08) {
+			print(printer_out, "db ");
+			print_literal_hex_byte(printer_out, value0);
+			print(printer_out, " ");
+			print_literal_hex_byte(printer_out, value1);
+			print(printer_out, " ; Unknown instruction\n");
+			return 1;
 		}
-		else if ((value0 & 0xFE) == 0xF6) {
-			const int value1 = read_next_byte(reader);
-			if ((value1 & 0x38) == 0x08) {
-				print(printer_out, "db ");
-				print_literal_hex_byte(printer_out, value0);
-				print(printer_out, " ");
-				print_literal_hex_byte(printer_out, value1);
-				print(printer_out, " ; Unknown instruction\n");
-				return 1;
-			}
-			else {
-				const char **registers;
-				print(printer_out, MATH_INSTRUCTION[(value1 >> 3) & 0x07]);
-				if ((value1 & 0xC0) != 0xC0) {
-					if (value0 & 1) {
-						print(printer_out, " word ");
-					}
-					else {
-						print(printer_out, " byte ");
-					}
+		else {
+			const char **registers;
+			print(printer_out, MATH_INSTRUCTION[(value1 >> 3) & 0x07]);
+			if ((value1 & 0xC0) != 0xC0) {
+				if (value0 & 1) {
+					print(printer_out, " word ");
 				}
 				else {
-					print(printer_out, " ");
+					print(printer_out, " byte ");
 				}
+			}
+			else {
+				print(printer_out, " ");
+			}
 
-				registers = (value0 & 1)? WORD_REGISTERS : BYTE_REGISTERS;
-				dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, registers);
-				if ((value1 & 0x38) == 0) {
-					print(printer_out, ",");
-					if (value0 & 1) {
-						print_literal_hex_word(printer_out, read_next_word(reader));
-					}
-					else {
-						print_literal_hex_byte(printer_out, read_next_byte(reader));
-					}
+			registers = (value0 & 1)? WORD_REGISTERS : BYTE_REGISTERS;
+			dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, registers);
+			if ((value1 & 0x38) == 0) {
+				print(printer_out, ",");
+				if (value0 & 1) {
+					print_literal_hex_word(printer_out, read_next_word(reader));
+				}
+				else {
+					print_literal_hex_byte(printer_out, read_next_byte(reader));
 				}
-				print(printer_out, "\n");
-				return 0;
 			}
-		}
-		else if (value0 == 0xF8) {
-			print(printer_out, "clc\n");
-			return 0;
-		}
-		else if (value0 == 0xF9) {
-			print(printer_out, "stc\n");
-			return 0;
-		}
-		else if (value0 == 0xFA) {
-			print(printer_out, "cli\n");
+			print(printer_out, "\n");
 			return 0;
 		}
-		else if (value0 == 0xFB) {
-			print(printer_out, "sti\n");
-			return 0;
+	}
+	else if (value0 == 0xF8) {
+		print(printer_out, "clc\n");
+		return 0;
+	}
+	else if (value0 == 0xF9) {
+		print(printer_out, "stc\n");
+		return 0;
+	}
+	else if (value0 == 0xFA) {
+		print(printer_out, "cli\n");
+		return 0;
+	}
+	else if (value0 == 0xFB) {
+		print(printer_out, "sti\n");
+		return 0;
+	}
+	else if (value0 == 0xFC) {
+		print(printer_out, "cld\n");
+		return 0;
+	}
+	else if (value0 == 0xFD) {
+		print(printer_out, "std\n");
+		return 0;
+	}
+	else if (value0 == 0xFE) {
+		const int value1 = read_next_byte(reader);
+		if (value1 & 0x30) {
+			print(printer_err, "Unknown opcode ");
+			print_literal_hex_byte(printer_err, value0);
+			print(printer_err, " ");
+			print_literal_hex_byte(printer_err, value1);
+			print(printer_err, "\n");
+			return 1;
 		}
-		else if (value0 == 0xFC) {
-			print(printer_out, "cld\n");
+		else {
+			print(printer_out, FF_INSTRUCTIONS[(value1 >> 3) & 0x07]);
+			print(printer_out, (value1 < 0xC0)? " byte " : " ");
+			dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, BYTE_REGISTERS);
+			print(printer_out, "\n");
 			return 0;
 		}
-		else if (value0 == 0xFD) {
-			print(printer_out, "std\n");
-			return 0;
+	}
+	else if (value0 == 0xFF) {
+		const int value1 = read_next_byte(reader);
+		if ((value1 & 0x38) == 0x38 || (value1 & 0xF8) == 0xD8 || (value1 & 0xF8) == 0xE8) {
+			print(printer_err, "Unknown opcode ");
+			print_literal_hex_byte(printer_err, value0);
+			print(printer_err, " ");
+			print_literal_hex_byte(printer_err, value1);
+			print(printer_err, "\n");
+			return 1;
 		}
-		else if (value0 == 0xFE) {
-			const int value1 = read_next_byte(reader);
-			if (value1 & 0x30) {
-				print(printer_err, "Unknown opcode ");
-				print_literal_hex_byte(printer_err, value0);
-				print(printer_err, " ");
-				print_literal_hex_byte(printer_err, value1);
-				print(printer_err, "\n");
-				return 1;
-			}
-			else {
-				print(printer_out, FF_INSTRUCTIONS[(value1 >> 3) & 0x07]);
-				print(printer_out, (value1 < 0xC0)? " byte " : " ");
-				dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, BYTE_REGISTERS);
-				print(printer_out, "\n");
-				return 0;
+		else {
+			print(printer_out, FF_INSTRUCTIONS[(value1 >> 3) & 0x07]);
+			if (value1 < 0xC0 && ((value1 & 0x08) == 0x00 || (value1 & 0x38) == 0x08)) {
+				print(printer_out, " word ");
 			}
-		}
-		else if (value0 == 0xFF) {
-			const int value1 = read_next_byte(reader);
-			if ((value1 & 0x38) == 0x38 || (value1 & 0xF8) == 0xD8 || (value1 & 0xF8) == 0xE8) {
-				print(printer_err, "Unknown opcode ");
-				print_literal_hex_byte(printer_err, value0);
-				print(printer_err, " ");
-				print_literal_hex_byte(printer_err, value1);
-				print(printer_err, "\n");
-				return 1;
+			else if (value1 < 0xC0 && ((value1 & 0x38) == 0x18 || (value1 & 0x38) == 0x28)) {
+				print(printer_out, " far16 ");
 			}
 			else {
-				print(printer_out, FF_INSTRUCTIONS[(value1 >> 3) & 0x07]);
-				if (value1 < 0xC0 && ((value1 & 0x08) == 0x00 || (value1 & 0x38) == 0x08)) {
-					print(printer_out, " word ");
-				}
-				else if (value1 < 0xC0 && ((value1 & 0x38) == 0x18 || (value1 & 0x38) == 0x28)) {
-					print(printer_out, " far16 ");
-				}
-				else {
-					print(printer_out, " ");
-				}
-				dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, WORD_REGISTERS);
-				print(printer_out, "\n");
-				return 0;
+				print(printer_out, " ");
 			}
+			dump_address(buffer, buffer_origin, reader, reference, printer_out, value1, segment, WORD_REGISTERS);
+			print(printer_out, "\n");
+			return 0;
 		}
-		else {
-			print(printer_out, "db ");
-			print_literal_hex_byte(printer_out, value0);
-			print(printer_out, " ; Unknown instruction\n");
-			return 1;
-		}
+	}
+	else {
+		print(printer_out, "db ");
+		print_literal_hex_byte(printer_out, value0);
+		print(printer_out, " ; Unknown instruction\n");
+		return 1;
 	}
 }
 
@@ -968,8 +966,8 @@ int dump(
 		const struct ProgramContent *pcontent,
 		const char **segment_starts,
 		unsigned int segment_start_count,
-		const char **sorted_relocations,
-		unsigned int relocation_count,
+		const struct SortedRelocations *sorted_relocations,
+		struct DecodedInstructionCache *instruction_cache,
 		struct FunctionList *func_list,
 		struct FilePrinter *printer_out,
 		struct FilePrinter *printer_err) {
@@ -1081,10 +1079,11 @@ int dump(
 			}
 			else {
 				const char *next_position;
+				struct DecodedInstruction decoded;
 				reader.buffer = position;
 				reader.buffer_index = 0;
 				reader.buffer_size = get_cblock_end(block) - position;
-				error_code = read_for_instruction_length(&reader);
+				error_code = decode_next_cached_instruction(instruction_cache, &reader, &decoded);
 				next_position = position + reader.buffer_index;
 
 				if (error_code || variable && next_position > get_gvar_start(variable)) {
@@ -1126,7 +1125,7 @@ int dump(
 						gvar_ref_count--;
 					}
 
-					unknown_opcode_found_in_block = dump_instruction(buffer, buffer_origin, &reader, block, reference, sorted_relocations, relocation_count, func_list, printer_out, printer_err);
+					unknown_opcode_found_in_block = dump_instruction(buffer, buffer_origin, &reader, block, reference, &decoded, sorted_relocations, func_list, printer_out, printer_err);
 					position = next_position;
 					if (position >= get_cblock_end(block)) {
 						unknown_opcode_found_in_block = 0;
@@ -1180,11 +1179,12 @@ int dump(
 			}
 			else {
 				const char *next_position = position;
+				struct DecodedInstruction decoded;
 				do {
 					reader.buffer = next_position;
 					reader.buffer_index = 0;
 					reader.buffer_size = get_cblock_end(block) - next_position;
-					error_code = read_for_instruction_length(&reader);
+					error_code = decode_next_cached_instruction(instruction_cache, &reader, &decoded);
 					next_position += reader.buffer_index;
 				}
 				while (error_code == 0 && next_position < current_variable_end);
@@ -1,9 +1,11 @@
 #ifndef _DUMPERS_H_
 #define _DUMPERS_H_
 
+#include "dicache.h"
 #include "pcontent.h"
 #include "funclist.h"
 #include "printu.h"
+#include "relocu.h"
 
 int dump(
 	const char *buffer,
@@ -11,8 +13,8 @@ int dump(
 	const struct ProgramContent *pcontent,
 	const char **segment_starts,
 	unsigned int segment_start_count,
-	const char **sorted_relocations,
-	unsigned int relocation_count,
+	const struct SortedRelocations *sorted_relocations,
+	struct DecodedInstructionCache *instruction_cache,
 	struct FunctionList *func_list,
 	struct FilePrinter *print_out,
 	struct FilePrinter *print_error);
@@ -0,0 +1,59 @@
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L
+#define FILEMAP_SUPPORTED
+#endif
+
+#include "filemap.h"
+
+#ifdef FILEMAP_SUPPORTED
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif /* FILEMAP_SUPPORTED */
+
+void initialize_file_map(struct FileMap *map) {
+	map->data = NULL;
+	map->size = 0;
+}
+
+#ifdef FILEMAP_SUPPORTED
+int map_file(struct FileMap *map, FILE *file) {
+	struct stat file_stat;
+	void *data;
+	const int fd = fileno(file);
+
+	initialize_file_map(map);
+	if (fd < 0 || fstat(fd, &file_stat) || !S_ISREG(file_stat.st_mode) || file_stat.st_size <= 0) {
+		return 1;
+	}
+
+	data = mmap(NULL, file_stat.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED) {
+		return 1;
+	}
+
+	map->data = data;
+	map->size = file_stat.st_size;
+	return 0;
+}
+
+void unmap_file(struct FileMap *map) {
+	if (map->data) {
+		munmap(map->data, map->size);
+	}
+
+	initialize_file_map(map);
+}
+#else
+int map_file(struct FileMap *map, FILE *file) {
+	initialize_file_map(map);
+	return 1;
+}
+
+void unmap_file(struct FileMap *map) {
+	initialize_file_map(map);
+}
+#endif /* FILEMAP_SUPPORTED */
+
+int is_file_mapped(const struct FileMap *map) {
+	return map->data != NULL;
+}
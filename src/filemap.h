@@ -0,0 +1,48 @@
+#ifndef _FILE_MAP_H_
+#define _FILE_MAP_H_
+
+#include <stdio.h>
+
+/**
+ * Whole content of a file mapped in memory.
+ *
+ * Mapping is only available on systems supporting mmap, and only for regular files.
+ * Callers should fall back to reading the file into their own buffers when map_file fails.
+ */
+struct FileMap {
+	/**
+	 * First byte of the file in memory, or NULL if no file is mapped.
+	 * Pages are mapped as private, so writing on them never modifies the file.
+	 */
+	char *data;
+
+	/**
+	 * Number of bytes mapped.
+	 */
+	unsigned long size;
+};
+
+/**
+ * Set all its values. After this, the map will be empty.
+ */
+void initialize_file_map(struct FileMap *map);
+
+/**
+ * Map the whole content of the given opened file.
+ * This will return 0 on success, or any other value if the file cannot be mapped, like pipes, empty files, or when mapping is not supported.
+ * On failure, the map will remain empty and the file position will not be modified.
+ */
+int map_file(struct FileMap *map, FILE *file);
+
+/**
+ * Whether the map has any file mapped.
+ */
+int is_file_mapped(const struct FileMap *map);
+
+/**
+ * Unmap the file, if any, restoring the map to its initial state.
+ * All pointers to the mapped data will be invalid after calling this method.
+ */
+void unmap_file(struct FileMap *map);
+
+#endif /* _FILE_MAP_H_ */
@@ -1,23 +1,16 @@
 #include "finder.h"
 #include "register.h"
 #include "gvwvmap.h"
+#include "decoder.h"
 #include "reader.h"
 #include "stack.h"
 #include "itable.h"
 #include "printu.h"
 #include "relocu.h"
+#include "stats.h"
+#include "checkpt.h"
 #include "printd.h"
-
-static void read_block_instruction_address(
-		struct Reader *reader,
-		int value1) {
-	if ((value1 & 0xC7) == 0x06 || (value1 & 0xC0) == 0x80) {
-		read_next_word(reader);
-	}
-	else if ((value1 & 0xC0) == 0x40) {
-		read_next_byte(reader);
-	}
-}
+#include <assert.h>
 
 static int ensure_call_return_origin(
 		struct MutableCodeBlockList *cblock_list,
@@ -27,135 +20,81 @@ static int ensure_call_return_origin(
 		const struct GlobalVariableWordValueMap *var_values,
 		int is_returning_far,
 		unsigned int instruction_length) {
-	int jmp_block_index = index_of_cblock_containing_origin_instruction(cblock_list, origin);
-	struct MutableCodeBlock *jmp_block = cblock_list->sorted_blocks[jmp_block_index];
+	struct MutableCodeBlock *jmp_block = get_cblock_containing_position(cblock_list, get_cborigin_instruction(origin));
 	const uint16_t expected_ip = get_mcblock_ip(jmp_block) + (get_cborigin_instruction(origin) + instruction_length - get_mcblock_start(jmp_block));
 	const int stack_top_matches_expected_ip = top_is_defined_absolute_in_stack(stack) && get_from_top(stack, 0) == expected_ip;
-	struct Stack *origin_stack = get_cborigin_stack(origin);
+	const struct Stack *origin_stack = get_cborigin_stack(origin);
 	const int origin_stack_top_matches_expected_ip = top_is_defined_absolute_in_stack(origin_stack) && get_from_top(origin_stack, 0) == expected_ip;
 	const int stack_matches_expected_cs = is_defined_relative_in_stack_from_top(stack, 1) && get_from_top(stack, 1) == get_mcblock_relative_cs(jmp_block);
 	const int origin_stack_matches_expected_cs = is_defined_relative_in_stack_from_top(origin_stack, 1) && get_from_top(origin_stack, 1) == get_mcblock_relative_cs(jmp_block);
 
 	if ((stack_top_matches_expected_ip || !top_is_defined_in_stack(stack) && origin_stack_top_matches_expected_ip) &&
 			(!is_returning_far || stack_matches_expected_cs || !is_defined_in_stack_from_top(stack, 1) && origin_stack_matches_expected_cs)) {
-		int return_block_index = index_of_cblock_with_start(cblock_list, get_cborigin_instruction(origin) + instruction_length);
+		struct MutableCodeBlock *return_block = get_cblock_with_start(cblock_list, get_cborigin_instruction(origin) + instruction_length);
+		struct Registers updated_regs;
+		struct RegisterProvenance updated_provenance;
+		struct Stack updated_stack;
 		int error_code;
 
-		if (return_block_index < 0) {
-			struct MutableCodeBlock *return_block = prepare_new_cblock(cblock_list);
-			struct CodeBlockOriginList *return_block_origin_list = get_mcblock_origin_list(return_block);
-			struct CodeBlockOrigin *return_origin;
-			struct Registers *return_origin_regs;
-			struct Stack *return_origin_stack;
-			struct GlobalVariableWordValueMap *return_origin_var_values;
-
-			initialize_mcblock(return_block, get_mcblock_relative_cs(jmp_block), expected_ip, get_cborigin_instruction(origin) + instruction_length);
-
-			return_origin = prepare_new_cborigin(return_block_origin_list);
-			if ((error_code = initialize_cborigin_as_call_return(return_origin, instruction_length, regs, stack, var_values))) {
-				return error_code;
-			}
-
-			return_origin_regs = get_cborigin_registers(return_origin);
-			return_origin_stack = get_cborigin_stack(return_origin);
+		/* State after returning, that is the state given to the return origin */
+		initialize_registers(&updated_regs, is_provenance_tracked_in_registers(regs)? &updated_provenance : NULL);
+		copy_registers(&updated_regs, regs);
+		if (is_register_sp_defined_relative(regs)) {
+			set_register_sp_relative(&updated_regs, NULL, NULL, get_register_sp(regs) + (is_returning_far? 4 : 2));
+		}
+		else if (is_register_sp_defined_absolute(regs)) {
+			set_register_sp(&updated_regs, NULL, NULL, get_register_sp(regs) + (is_returning_far? 4 : 2));
+		}
+		else if (is_register_sp_relative_from_bp(regs)) {
+			set_register_sp_relative_from_bp(&updated_regs, NULL, get_register_sp(regs) + (is_returning_far? 4 : 2));
+		}
 
-			if (is_register_sp_defined_relative(return_origin_regs)) {
-				set_register_sp_relative(return_origin_regs, NULL, NULL, get_register_sp(regs) + (is_returning_far? 4 : 2));
-			}
-			else if (is_register_sp_defined_absolute(return_origin_regs)) {
-				set_register_sp(return_origin_regs, NULL, NULL, get_register_sp(regs) + (is_returning_far? 4 : 2));
-			}
-			else if (is_register_sp_relative_from_bp(return_origin_regs)) {
-				set_register_sp_relative_from_bp(return_origin_regs, NULL, get_register_sp(regs) + (is_returning_far? 4 : 2));
-			}
+		initialize_stack_in_arena(&updated_stack, cblock_list->arena);
+		if ((error_code = copy_stack(&updated_stack, stack))) {
+			clear_stack(&updated_stack);
+			return error_code;
+		}
 
-			pop_from_stack(return_origin_stack);
+		pop_from_stack(&updated_stack);
+		if (is_returning_far) {
+			pop_from_stack(&updated_stack);
+		}
 
-			if (is_returning_far) {
-				pop_from_stack(return_origin_stack);
-			}
+		if (!return_block) {
+			struct CodeBlockOriginList *return_block_origin_list;
+			struct CodeBlockOrigin *return_origin;
 
-			if ((error_code = insert_cborigin(return_block_origin_list, return_origin))) {
+			return_block = prepare_new_cblock(cblock_list);
+			return_block_origin_list = get_mcblock_origin_list(return_block);
+			if ((error_code = initialize_mcblock(return_block, cblock_list->arena, cblock_list->snapshots, get_mcblock_relative_cs(jmp_block), expected_ip, get_cborigin_instruction(origin) + instruction_length))) {
 				return error_code;
 			}
 
-			if ((error_code = insert_cblock(cblock_list, return_block))) {
-				return error_code;
+			return_origin = prepare_new_cborigin(return_block_origin_list);
+			if (!(error_code = initialize_cborigin_as_call_return(return_origin, return_block_origin_list->snapshots, instruction_length, &updated_regs, &updated_stack, var_values)) &&
+					!(error_code = insert_cborigin(return_block_origin_list, return_origin))) {
+				error_code = insert_cblock(cblock_list, return_block);
 			}
 		}
 		else {
-			struct MutableCodeBlock *return_block = cblock_list->sorted_blocks[return_block_index];
 			struct CodeBlockOriginList *return_block_origin_list = get_mcblock_origin_list(return_block);
 			int call_return_origin_index = index_of_cborigin_of_type_call_return(return_block_origin_list, instruction_length);
 			if (call_return_origin_index < 0) {
 				struct CodeBlockOrigin *return_origin = prepare_new_cborigin(return_block_origin_list);
-				struct Registers *return_origin_regs = get_cborigin_registers(return_origin);
-				struct Stack *return_origin_stack = get_cborigin_stack(return_origin);
-				struct GlobalVariableWordValueMap *return_origin_var_values = get_cborigin_var_values(return_origin);
-
-				if ((error_code = initialize_cborigin_as_call_return(return_origin, instruction_length, regs, stack, var_values))) {
-					return error_code;
-				}
-
-				if (is_register_sp_defined_relative(return_origin_regs)) {
-					set_register_sp_relative(return_origin_regs, NULL, NULL, get_register_sp(regs) + (is_returning_far? 4 : 2));
-				}
-				else if (is_register_sp_defined_absolute(return_origin_regs)) {
-					set_register_sp(return_origin_regs, NULL, NULL, get_register_sp(regs) + (is_returning_far? 4 : 2));
-				}
-				else if (is_register_sp_relative_from_bp(return_origin_regs)) {
-					set_register_sp_relative_from_bp(return_origin_regs, NULL, get_register_sp(regs) + (is_returning_far? 4 : 2));
-				}
-
-				pop_from_stack(return_origin_stack);
-				if (is_returning_far) {
-					pop_from_stack(return_origin_stack);
-				}
-
-				if ((error_code = insert_cborigin(return_block_origin_list, return_origin))) {
-					return error_code;
+				if (!(error_code = initialize_cborigin_as_call_return(return_origin, return_block_origin_list->snapshots, instruction_length, &updated_regs, &updated_stack, var_values))) {
+					error_code = insert_cborigin(return_block_origin_list, return_origin);
 				}
 			}
 			else {
 				struct CodeBlockOrigin *call_return_origin = return_block_origin_list->sorted_origins[call_return_origin_index];
-				struct Registers *call_return_origin_regs = get_cborigin_registers(call_return_origin);
-				struct Stack *call_return_origin_stack = get_cborigin_stack(call_return_origin);
-				struct GlobalVariableWordValueMap *call_return_origin_var_values = get_cborigin_var_values(call_return_origin);
-
-				int error_code;
-				struct Registers updated_regs;
-				struct Stack updated_stack;
-				copy_registers(&updated_regs, regs);
-				if (is_register_sp_defined_relative(regs)) {
-					set_register_sp_relative(&updated_regs, NULL, NULL, get_register_sp(regs) + (is_returning_far? 4 : 2));
-				}
-				else if (is_register_sp_defined_absolute(regs)) {
-					set_register_sp(&updated_regs, NULL, NULL, get_register_sp(regs) + (is_returning_far? 4 : 2));
-				}
-				else if (is_register_sp_relative_from_bp(regs)) {
-					set_register_sp_relative_from_bp(&updated_regs, NULL, get_register_sp(regs) + (is_returning_far? 4 : 2));
-				}
-
-				initialize_stack(&updated_stack);
-				if ((error_code = copy_stack(&updated_stack, stack))) {
-					return error_code;
-				}
-				pop_from_stack(&updated_stack);
-				if (is_returning_far) {
-					pop_from_stack(&updated_stack);
-				}
-
-				if (changes_on_merging_registers(call_return_origin_regs, &updated_regs) || changes_on_merging_stacks(call_return_origin_stack, &updated_stack) || changes_on_merging_gvwvmap(call_return_origin_var_values, var_values)) {
-					merge_registers(call_return_origin_regs, &updated_regs);
-					merge_stacks(call_return_origin_stack, &updated_stack);
-					if ((error_code = merge_gvwvmap(call_return_origin_var_values, var_values))) {
-						return error_code;
-					}
-
-					invalidate_mcblock_check(return_block);
+				if (changes_on_merging_state_in_mcblock_origin(return_block, call_return_origin, &updated_regs, &updated_stack, var_values)) {
+					error_code = merge_state_in_mcblock_origin(return_block, call_return_origin, &updated_regs, &updated_stack, var_values);
 				}
 			}
 		}
+
+		clear_stack(&updated_stack);
+		return error_code;
 	}
 
 	return 0;
@@ -163,11 +102,43 @@ static int ensure_call_return_origin(
 
 #define CHECKED_BLOCK_BLOCKS_PER_PAGE 16
 
-struct CheckedBlocks {
-	struct MutableCodeBlock **blocks;
-	unsigned int count;
-	unsigned int allocated_pages;
-};
+void initialize_checked_blocks_in_arena(struct CheckedBlocks *checked_blocks, struct Arena *arena) {
+	checked_blocks->blocks = NULL;
+	checked_blocks->count = 0;
+	checked_blocks->allocated_pages = 0;
+	checked_blocks->arena = arena;
+}
+
+void clear_checked_blocks(struct CheckedBlocks *checked_blocks) {
+	release_in_arena(checked_blocks->arena, checked_blocks->blocks);
+	initialize_checked_blocks_in_arena(checked_blocks, checked_blocks->arena);
+}
+
+/**
+ * Add the given block to the checked ones, unless it is already there.
+ * This will return 0 if the block is added, -1 if it was already checked, or any other value if memory cannot be allocated.
+ */
+static int add_checked_block(struct CheckedBlocks *checked_blocks, struct MutableCodeBlock *block) {
+	unsigned int index;
+	for (index = 0; index < checked_blocks->count; index++) {
+		if (checked_blocks->blocks[index] == block) {
+			return -1;
+		}
+	}
+
+	if (checked_blocks->count == checked_blocks->allocated_pages * CHECKED_BLOCK_BLOCKS_PER_PAGE) {
+		struct MutableCodeBlock **new_blocks = reallocate_in_arena(checked_blocks->arena, checked_blocks->blocks, (checked_blocks->allocated_pages + 1) * CHECKED_BLOCK_BLOCKS_PER_PAGE * sizeof(struct MutableCodeBlock *));
+		if (!new_blocks) {
+			return 1;
+		}
+
+		checked_blocks->blocks = new_blocks;
+		checked_blocks->allocated_pages++;
+	}
+
+	checked_blocks->blocks[checked_blocks->count++] = block;
+	return 0;
+}
 
 static int update_call_origins(
 		struct MutableCodeBlock *block,
@@ -182,20 +153,14 @@ static int update_call_origins(
 	int index;
 	int error_code;
 
-	for (index = 0; index < checked_blocks->count; index++) {
-		if (checked_blocks->blocks[index] == block) {
+	if ((error_code = add_checked_block(checked_blocks, block))) {
+		if (error_code < 0) {
 			DEBUG_INDENTED_PRINT2(depth, "Block at +%x:%x already checked, or not found.\n", get_mcblock_relative_cs(block), get_mcblock_ip(block));
 			return 0;
 		}
-	}
 
-	if (checked_blocks->count == checked_blocks->allocated_pages * CHECKED_BLOCK_BLOCKS_PER_PAGE) {
-		checked_blocks->blocks = realloc(checked_blocks->blocks, (++checked_blocks->allocated_pages) * CHECKED_BLOCK_BLOCKS_PER_PAGE * sizeof(struct MutableCodeBlock *));
-		if (!checked_blocks->blocks) {
-			return 1;
-		}
+		return error_code;
 	}
-	checked_blocks->blocks[checked_blocks->count++] = block;
 
 	DEBUG_INDENTED_PRINT3(depth, "Checking origins of block at +%x:%x. %d origin(s)\n", get_mcblock_relative_cs(block), get_mcblock_ip(block), origin_list->origin_count);
 	for (index = 0; index < origin_list->origin_count; index++) {
@@ -203,11 +168,10 @@ static int update_call_origins(
 		int origin_type = get_cborigin_type(origin);
 		DEBUG_INDENTED_PRINT2(depth + 1, "Index %d -> origin type is %s", index, DEBUG_CBORIGIN_TYPE_NAME(origin_type));
 		if (origin_type == CBORIGIN_TYPE_CONTINUE || origin_type == CBORIGIN_TYPE_CALL_RETURN) {
-			struct MutableCodeBlock *previous_block;
-			int cblock_index = index_of_cblock_in_list(cblock_list, block);
+			struct MutableCodeBlock *previous_block = get_previous_cblock(cblock_list, block);
 			DEBUG_PRINT0(".\n");
 
-			if (cblock_index > 0 && get_mcblock_end(previous_block = cblock_list->sorted_blocks[cblock_index - 1]) == get_mcblock_start(block)) {
+			if (previous_block && get_mcblock_end(previous_block) == get_mcblock_start(block)) {
 				unsigned int current_count = checked_blocks->count;
 				if ((error_code = update_call_origins(previous_block, cblock_list, checked_blocks, regs, stack, var_values, is_returning_far, depth + 1))) {
 					return error_code;
@@ -217,11 +181,10 @@ static int update_call_origins(
 		}
 		else if (origin_type == CBORIGIN_TYPE_JUMP) {
 			const int jmp_opcode0 = ((int) *get_cborigin_instruction(origin)) & 0xFF;
-			int jumping_block_index = index_of_cblock_containing_origin_instruction(cblock_list, origin);
+			struct MutableCodeBlock *jumping_block = get_cblock_containing_position(cblock_list, get_cborigin_instruction(origin));
 #ifdef DEBUG
-			if (jumping_block_index >= 0) {
-				struct MutableCodeBlock *origin_block = cblock_list->sorted_blocks[jumping_block_index];
-				DEBUG_PRINT2(" from +%x:%x.\n", origin_block->relative_cs, origin_block->ip + (int) (origin->instruction - origin_block->start));
+			if (jumping_block) {
+				DEBUG_PRINT2(" from +%x:%x.\n", jumping_block->relative_cs, jumping_block->ip + (int) (origin->instruction - jumping_block->start));
 			}
 			else {
 				DEBUG_PRINT0(".\n");
@@ -234,9 +197,9 @@ static int update_call_origins(
 				}
 			}
 			else if (jmp_opcode0 == 0xE9 || (jmp_opcode0 & 0xF0) == 0x70 || (jmp_opcode0 & 0xFC) == 0xE0 || jmp_opcode0 == 0xEB) { /* JMP and its conditionals */
-				if (jumping_block_index >= 0) {
+				if (jumping_block) {
 					unsigned int current_count = checked_blocks->count;
-					if ((error_code = update_call_origins(cblock_list->sorted_blocks[jumping_block_index], cblock_list, checked_blocks, regs, stack, var_values, is_returning_far, depth + 1))) {
+					if ((error_code = update_call_origins(jumping_block, cblock_list, checked_blocks, regs, stack, var_values, is_returning_far, depth + 1))) {
 						return error_code;
 					}
 
@@ -263,10 +226,9 @@ static int update_call_origins(
 					}
 				}
 				else if ((jmp_opcode1 & 0x38) == 0x20) {
-					int jumping_block_index = index_of_cblock_containing_origin_instruction(cblock_list, origin);
-					if (jumping_block_index >= 0) {
+					if (jumping_block) {
 						unsigned int current_count = checked_blocks->count;
-						if ((error_code = update_call_origins(cblock_list->sorted_blocks[jumping_block_index], cblock_list, checked_blocks, regs, stack, var_values, is_returning_far, depth + 1))) {
+						if ((error_code = update_call_origins(jumping_block, cblock_list, checked_blocks, regs, stack, var_values, is_returning_far, depth + 1))) {
 							return error_code;
 						}
 
@@ -289,9 +251,8 @@ static int add_call_return_origin_after_interruption(struct Reader *reader, stru
 	int error_code;
 	set_mcblock_size(block, reader->buffer_index);
 
-	index = index_of_cblock_with_start(code_block_list, get_mcblock_end(block));
-	if (index >= 0) {
-		return_block = code_block_list->sorted_blocks[index];
+	return_block = get_cblock_with_start(code_block_list, get_mcblock_end(block));
+	if (return_block) {
 		if ((error_code = add_call_return_type_cborigin_in_mcblock(return_block, 2, regs, stack, var_values))) {
 			return error_code;
 		}
@@ -302,7 +263,10 @@ static int add_call_return_origin_after_interruption(struct Reader *reader, stru
 			return 1;
 		}
 
-		initialize_mcblock(return_block, get_mcblock_relative_cs(block), get_mcblock_ip(block) + reader->buffer_index, get_mcblock_end(block));
+		if ((error_code = initialize_mcblock(return_block, code_block_list->arena, code_block_list->snapshots, get_mcblock_relative_cs(block), get_mcblock_ip(block) + reader->buffer_index, get_mcblock_end(block)))) {
+			return error_code;
+		}
+
 		if ((error_code = add_call_return_type_cborigin_in_mcblock(return_block, 2, regs, stack, var_values))) {
 			return error_code;
 		}
@@ -319,6 +283,80 @@ static int add_call_return_origin_after_interruption(struct Reader *reader, stru
 	return 0;
 }
 
+/**
+ * Register the given state in the given block, as reached by continuing the execution from the instruction right before it.
+ * If the block already has a continue origin, the state is merged into it instead.
+ */
+static int register_continue_state_in_mcblock(
+		struct MutableCodeBlock *next_block,
+		const struct Registers *regs,
+		const struct Stack *stack,
+		const struct GlobalVariableWordValueMap *var_values,
+		int next_instruction_potentially_reached) {
+	struct CodeBlockOriginList *next_origin_list = get_mcblock_origin_list(next_block);
+	int next_origin_index;
+	int error_code;
+
+	if ((error_code = update_mcblock_joined_state(next_block))) {
+		return error_code;
+	}
+
+	next_origin_index = index_of_cborigin_of_type_continue(next_origin_list);
+	if (next_origin_index >= 0) {
+		struct CodeBlockOrigin *next_origin = next_origin_list->sorted_origins[next_origin_index];
+		if (changes_on_merging_state_in_mcblock_origin(next_block, next_origin, regs, NULL, var_values) &&
+				(error_code = merge_state_in_mcblock_origin(next_block, next_origin, regs, NULL, var_values))) {
+			return error_code;
+		}
+	}
+	else if (next_instruction_potentially_reached) {
+		struct CodeBlockOrigin *next_origin = prepare_new_cborigin(next_origin_list);
+		if ((error_code = initialize_cborigin_as_continue(next_origin, next_origin_list->snapshots, regs, stack, var_values))) {
+			return error_code;
+		}
+
+		if ((error_code = insert_cborigin(next_origin_list, next_origin))) {
+			return error_code;
+		}
+
+		if (next_origin_list->origin_count > 1 && changes_on_joining_state_in_mcblock(next_block, regs, stack, var_values)) {
+			invalidate_mcblock_check(next_block);
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Shrink the given container, so that it ends where the given new block starts.
+ *
+ * If the container is the block being evaluated, its evaluation is still valid, and one of its instructions
+ * finished right at the split point, the state recorded there is given to the new block as a continue origin.
+ * Otherwise, the container is invalidated, so that its next evaluation reaches the new block.
+ */
+static int split_mcblock(
+		struct MutableCodeBlockList *code_block_list,
+		struct MutableCodeBlock *container,
+		struct MutableCodeBlock *new_block) {
+	struct StateCheckpointTrail *trail = code_block_list->checkpoint_trail;
+	const char *split_position = get_mcblock_start(new_block);
+	const struct StateCheckpoint *checkpoint = trail? get_checkpoint_at(trail, container, split_position) : NULL;
+
+	set_mcblock_end(container, split_position);
+	if (checkpoint && !mcblock_requires_evaluation(container)) {
+		STATS_INCREMENT(code_block_list->snapshots->stats, avoided_reevaluations);
+		trail->hit_count++;
+		return register_continue_state_in_mcblock(new_block, &checkpoint->regs, get_checkpoint_stack(trail, checkpoint), get_checkpoint_var_values(trail, checkpoint), checkpoint->next_instruction_potentially_reached);
+	}
+
+	if (trail) {
+		trail->miss_count++;
+	}
+
+	invalidate_mcblock_check(container);
+	return 0;
+}
+
 static int add_jump_type_cborigin_in_block(
 		const char *segment_start,
 		unsigned int segment_size,
@@ -333,53 +371,34 @@ static int add_jump_type_cborigin_in_block(
 	struct CodeBlockOrigin *origin = get_cborigin_with_instruction(origin_list, origin_instruction);
 
 	if (origin) {
-		struct Registers *origin_regs = get_cborigin_registers(origin);
-		struct Stack *origin_stack = get_cborigin_stack(origin);
-		struct GlobalVariableWordValueMap *origin_var_values = get_cborigin_var_values(origin);
-		if (changes_on_merging_registers(origin_regs, regs)) {
-			merge_registers(origin_regs, regs);
-			invalidate_mcblock_check(block);
+		if (changes_on_merging_state_in_mcblock_origin(block, origin, regs, NULL, NULL) &&
+				(error_code = merge_state_in_mcblock_origin(block, origin, regs, NULL, NULL))) {
+			return error_code;
 		}
 
-		if (changes_on_merging_stacks(origin_stack, stack)) {
-			merge_stacks(origin_stack, stack);
-			invalidate_mcblock_check(block);
+		if (changes_on_merging_state_in_mcblock_origin(block, origin, NULL, stack, NULL) &&
+				(error_code = merge_state_in_mcblock_origin(block, origin, NULL, stack, NULL))) {
+			return error_code;
 		}
 
-		if (changes_on_merging_gvwvmap(origin_var_values, var_values)) {
-			if ((error_code = merge_gvwvmap(origin_var_values, var_values))) {
-				return error_code;
-			}
-
-			invalidate_mcblock_check(block);
+		if (changes_on_merging_state_in_mcblock_origin(block, origin, NULL, NULL, var_values) &&
+				(error_code = merge_state_in_mcblock_origin(block, origin, NULL, NULL, var_values))) {
+			return error_code;
 		}
 	}
 	else {
 		struct CodeBlockOrigin *new_origin = prepare_new_cborigin(origin_list);
-		struct Registers accumulated_regs;
-		struct Stack accumulated_stack;
-		struct GlobalVariableWordValueMap accumulated_var_values;
-
-		if ((error_code = initialize_cborigin_as_jump(new_origin, origin_instruction, regs, stack, var_values))) {
+		if ((error_code = initialize_cborigin_as_jump(new_origin, origin_list->snapshots, origin_instruction, regs, stack, var_values)) ||
+				(error_code = update_mcblock_joined_state(block))) {
 			return error_code;
 		}
 
-		if (origin_list->origin_count) {
-			accumulate_registers_from_cbolist(&accumulated_regs, origin_list);
-			if ((error_code = accumulate_stack_from_cbolist(&accumulated_stack, origin_list)) ||
-					(error_code = accumulate_gvwvmap_from_cbolist(&accumulated_var_values, origin_list))) {
-				return error_code;
-			}
-		}
-
 		if ((error_code = insert_cborigin(origin_list, new_origin))) {
 			return error_code;
 		}
 
 		if (origin_list->origin_count > 1) {
-			if (changes_on_merging_registers(&accumulated_regs, regs) ||
-					changes_on_merging_stacks(&accumulated_stack, stack) ||
-					changes_on_merging_gvwvmap(&accumulated_var_values, var_values)) {
+			if (changes_on_joining_state_in_mcblock(block, regs, stack, var_values)) {
 				invalidate_mcblock_check(block);
 			}
 			else if ((*get_mcblock_start(block) & 0xFF) == 0xC3 && top_is_defined_absolute_in_stack(stack) && (*origin_instruction & 0xFF) == 0xFF && (origin_instruction[1] & 0x38) == 0x10) {
@@ -395,13 +414,18 @@ static int add_jump_type_cborigin_in_block(
 					}
 					else {
 						struct Registers return_regs;
+						struct RegisterProvenance return_provenance;
 						struct Stack return_stack;
 						struct MutableCodeBlock *return_block = prepare_new_cblock(code_block_list);
 						if (!return_block) {
 							return 1;
 						}
 
-						initialize_mcblock(return_block, get_mcblock_relative_cs(block), return_ip, return_destination);
+						if ((error_code = initialize_mcblock(return_block, code_block_list->arena, code_block_list->snapshots, get_mcblock_relative_cs(block), return_ip, return_destination))) {
+							return error_code;
+						}
+
+						initialize_registers(&return_regs, is_provenance_tracked_in_registers(regs)? &return_provenance : NULL);
 						copy_registers(&return_regs, regs);
 						if (is_register_sp_defined_relative(regs)) {
 							set_register_sp_relative(&return_regs, NULL, NULL, get_register_sp(regs) + 2);
@@ -413,7 +437,7 @@ static int add_jump_type_cborigin_in_block(
 							set_register_sp_relative_from_bp(&return_regs, NULL, get_register_sp(regs) + 2);
 						}
 
-						initialize_stack(&return_stack);
+						initialize_stack_in_arena(&return_stack, code_block_list->arena);
 						if ((error_code = copy_stack(&return_stack, stack))) {
 							return error_code;
 						}
@@ -423,9 +447,10 @@ static int add_jump_type_cborigin_in_block(
 							return error_code;
 						}
 
-						if (potential_block) {
-							set_mcblock_end(potential_block, return_destination);
-							invalidate_mcblock_check(potential_block);
+						clear_stack(&return_stack);
+
+						if (potential_block && (error_code = split_mcblock(code_block_list, potential_block, return_block))) {
+							return error_code;
 						}
 
 						return insert_cblock(code_block_list, return_block);
@@ -462,14 +487,16 @@ static int register_jump_target_block(
 			return 1;
 		}
 
-		initialize_mcblock(new_block, get_mcblock_relative_cs(block), get_mcblock_ip(block) + reader->buffer_index + diff, jump_destination);
+		if ((result = initialize_mcblock(new_block, code_block_list->arena, code_block_list->snapshots, get_mcblock_relative_cs(block), get_mcblock_ip(block) + reader->buffer_index + diff, jump_destination))) {
+			return result;
+		}
+
 		if ((result = add_jump_type_cborigin_in_block(segment_start, segment_size, new_block, code_block_list, opcode_reference, regs, stack, var_values))) {
 			return result;
 		}
 
-		if (potential_container) {
-			set_mcblock_end(potential_container, jump_destination);
-			invalidate_mcblock_check(potential_container);
+		if (potential_container && (result = split_mcblock(code_block_list, potential_container, new_block))) {
+			return result;
 		}
 
 		return insert_cblock(code_block_list, new_block);
@@ -483,19 +510,23 @@ static int register_next_block(
 		struct GlobalVariableWordValueMap *var_values,
 		struct MutableCodeBlock *block,
 		struct MutableCodeBlockList *code_block_list) {
-	int result = index_of_cblock_with_start(code_block_list, get_mcblock_end(block));
-	if (result >= 0) {
-		return add_continue_type_cborigin_in_mcblock(code_block_list->sorted_blocks[result], regs, stack, var_values);
+	struct MutableCodeBlock *next_block = get_cblock_with_start(code_block_list, get_mcblock_end(block));
+	if (next_block) {
+		return add_continue_type_cborigin_in_mcblock(next_block, regs, stack, var_values);
 	}
 	else {
 		struct MutableCodeBlock *new_block = prepare_new_cblock(code_block_list);
+		int error_code;
 		if (!new_block) {
 			return 1;
 		}
 
-		initialize_mcblock(new_block, get_mcblock_relative_cs(block), get_mcblock_ip(block) + reader->buffer_index, get_mcblock_end(block));
-		if ((result = add_continue_type_cborigin_in_mcblock(new_block, regs, stack, var_values))) {
-			return result;
+		if ((error_code = initialize_mcblock(new_block, code_block_list->arena, code_block_list->snapshots, get_mcblock_relative_cs(block), get_mcblock_ip(block) + reader->buffer_index, get_mcblock_end(block)))) {
+			return error_code;
+		}
+
+		if ((error_code = add_continue_type_cborigin_in_mcblock(new_block, regs, stack, var_values))) {
+			return error_code;
 		}
 
 		return insert_cblock(code_block_list, new_block);
@@ -525,27 +556,21 @@ int update_int2140_message_references(
 		unsigned int depth) {
 	uint16_t length;
 	int index;
+	int error_code;
 
 	DEBUG_INDENTED_PRINT2(depth, "Backtracing for message references at block +%x:%x.\n", get_mcblock_relative_cs(block), get_mcblock_ip(block));
-	for (index = 0; index < checked_blocks->count; index++) {
-		if (checked_blocks->blocks[index] == block) {
+	if ((error_code = add_checked_block(checked_blocks, block))) {
+		if (error_code < 0) {
 			DEBUG_INDENTED_PRINT2(depth, "Block at +%x:%x already checked, or not found.\n", get_mcblock_relative_cs(block), get_mcblock_ip(block));
 			return 0;
 		}
-	}
 
-	if (checked_blocks->count == checked_blocks->allocated_pages * CHECKED_BLOCK_BLOCKS_PER_PAGE) {
-		checked_blocks->blocks = realloc(checked_blocks->blocks, (++checked_blocks->allocated_pages) * CHECKED_BLOCK_BLOCKS_PER_PAGE * sizeof(struct MutableCodeBlock *));
-		if (!checked_blocks->blocks) {
-			return 1;
-		}
+		return error_code;
 	}
-	checked_blocks->blocks[checked_blocks->count++] = block;
 
 	if (ds_defined && dx_defined && cx_defined) {
 		DEBUG_INDENTED_PRINT0(depth, "CX, DX and DS defined");
 		if (ds_relative && !dx_relative && !cx_relative && (length = cx_value) > 0) {
-			int error_code;
 			unsigned int segment_value = ds_value;
 			unsigned int relative_address = (segment_value * 16 + dx_value) & 0xFFFF;
 			DEBUG_PRINT3(" with values 0x%x, 0x%x and +0x%x respectively.\n", cx_value, dx_value, ds_value);
@@ -611,10 +636,9 @@ int update_int2140_message_references(
 
 			origin_type = get_cborigin_type(origin);
 			if (origin_type == CBORIGIN_TYPE_CONTINUE) {
-				const int block_index = index_of_cblock_in_list(code_block_list, block);
-				if (block_index > 0) {
-					struct MutableCodeBlock *previous_block = code_block_list->sorted_blocks[block_index - 1];
-					struct Registers *origin_regs = get_cborigin_registers(origin);
+				struct MutableCodeBlock *previous_block = get_previous_cblock(code_block_list, block);
+				if (previous_block) {
+					const struct Registers *origin_regs = get_cborigin_registers(origin);
 					const int new_ds_defined = ds_defined || is_register_ds_defined(origin_regs);
 					const int new_ds_relative = ds_defined? ds_relative : is_register_ds_defined_relative(origin_regs);
 					const uint16_t new_ds_value = ds_defined? ds_value : get_register_ds(origin_regs);
@@ -628,7 +652,6 @@ int update_int2140_message_references(
 					const int new_cx_relative = cx_defined? ds_relative : is_register_cx_defined_relative(origin_regs);
 					const uint16_t new_cx_value = cx_defined? ds_value : get_register_cx(origin_regs);
 
-					int error_code;
 					DEBUG_PRINT2(" from block starting at +%x:%x\n", get_mcblock_relative_cs(previous_block), get_mcblock_ip(previous_block));
 
 					if ((error_code = update_int2140_message_references(origin_regs, segment_start, segment_size, previous_block, code_block_list,
@@ -642,10 +665,9 @@ int update_int2140_message_references(
 				}
 			}
 			else if (origin_type == CBORIGIN_TYPE_JUMP) {
-				const int origin_block_index = index_of_cblock_containing_origin_instruction(code_block_list, origin);
-				if (origin_block_index >= 0) {
-					struct MutableCodeBlock *origin_block = code_block_list->sorted_blocks[origin_block_index];
-					struct Registers *origin_regs = get_cborigin_registers(origin);
+				struct MutableCodeBlock *origin_block = get_cblock_containing_position(code_block_list, get_cborigin_instruction(origin));
+				if (origin_block) {
+					const struct Registers *origin_regs = get_cborigin_registers(origin);
 					const int new_ds_defined = ds_defined || is_register_ds_defined(origin_regs);
 					const int new_ds_relative = ds_defined? ds_relative : is_register_ds_defined_relative(origin_regs);
 					const uint16_t new_ds_value = ds_defined? ds_value : get_register_ds(origin_regs);
@@ -659,7 +681,6 @@ int update_int2140_message_references(
 					const int new_cx_relative = cx_defined? ds_relative : is_register_cx_defined_relative(origin_regs);
 					const uint16_t new_cx_value = cx_defined? ds_value : get_register_cx(origin_regs);
 
-					int error_code;
 					DEBUG_PRINT2(" from +%x:%x", get_mcblock_relative_cs(origin_block), get_mcblock_ip(origin_block) + (int) (get_cborigin_instruction(origin) - get_mcblock_start(origin_block)));
 					DEBUG_PRINT2(" contained in block starting at +%x:%x\n", get_mcblock_relative_cs(origin_block), get_mcblock_ip(origin_block));
 
@@ -687,23 +708,6 @@ int update_int2140_message_references(
 	return 0;
 }
 
-static uint16_t read_address_offset(struct Reader *reader, int value1) {
-	if ((value1 & 0xC7) == 0x06 || (value1 & 0xC0) == 0x80) {
-		return read_next_word(reader);
-	}
-	else if ((value1 & 0xC0) == 0x40) {
-		uint16_t addr = read_next_byte(reader);
-		if (addr >= 0x80) {
-			addr -= 0x100;
-		}
-
-		return addr;
-	}
-	else {
-		return 0;
-	}
-}
-
 #define ADDRESS_FLAG_DEFINED 1
 #define ADDRESS_FLAG_RELATIVE 2
 #define ADDRESS_FLAG_STACK_RELATED 4
@@ -858,50 +862,37 @@ static int read_block_instruction_internal(
 		struct InterruptionTable *int_table,
 		const char *segment_start,
 		unsigned int segment_size,
-		const char **sorted_relocations,
-		unsigned int relocation_count,
+		const struct SortedRelocations *sorted_relocations,
 		struct FilePrinter *printer_err,
 		struct MutableCodeBlock *block,
 		struct MutableCodeBlockList *code_block_list,
 		struct GlobalVariableList *gvar_list,
 		struct SegmentStartList *segment_start_list,
 		struct MutableReferenceList *ref_list,
-		int segment_index,
+		const struct DecodedInstruction *decoded,
 		const char *opcode_reference,
 		int *next_instruction_potentially_reached) {
+	const int value0 = decoded->opcode;
+	int segment_index = decoded->segment_index;
 	int error_code;
-	const int value0 = read_next_byte(reader);
 	if (value0 >= 0 && value0 < 0x40 && (value0 & 0x06) != 0x06) {
 		if ((value0 & 0x04) == 0x00) {
-			const int value1 = read_next_byte(reader);
-			if ((value1 & 0xC0) == 0) {
-				if ((value1 & 0x07) == 6) {
-					int result_address = read_next_word(reader);
-					DEBUG_PRINT0("\n");
-
-					if (segment_index == SEGMENT_INDEX_UNDEFINED) {
-						segment_index = SEGMENT_INDEX_DS;
-					}
+			const int value1 = decoded->modrm;
+			if ((value1 & 0xC7) == 6) {
+				int result_address = decoded->displacement;
+				DEBUG_PRINT0("\n");
 
-					if ((error_code = add_gvar_mref(gvar_list, segment_start_list, ref_list, regs, var_values, segment_index, result_address, segment_start, value0, opcode_reference, 0, 0, 0, 0, 0))) {
-						return error_code;
-					}
+				if (segment_index == SEGMENT_INDEX_UNDEFINED) {
+					segment_index = SEGMENT_INDEX_DS;
 				}
-				else {
-					DEBUG_PRINT0("\n");
+
+				if ((error_code = add_gvar_mref(gvar_list, segment_start_list, ref_list, regs, var_values, segment_index, result_address, segment_start, value0, opcode_reference, 0, 0, 0, 0, 0))) {
+					return error_code;
 				}
 			}
-			else if ((value1 & 0xC0) == 0x40) {
-				read_next_byte(reader);
-				DEBUG_PRINT0("\n");
-			}
-			else if ((value1 & 0xC0) == 0x80) {
-				read_next_word(reader);
-				DEBUG_PRINT0("\n");
-			}
-			else { /* value1 >= 0xC0 */
+			else {
 				DEBUG_PRINT0("\n");
-				if ((value0 & 0x38) == 0x30 && (((value1 >> 3) & 0x07) == (value1 & 0x07))) { /* XOR */
+				if (value1 >= 0xC0 && (value0 & 0x38) == 0x30 && (((value1 >> 3) & 0x07) == (value1 & 0x07))) { /* XOR */
 					if (value0 & 1) {
 						set_word_register(regs, value1 & 0x07, opcode_reference, opcode_reference, 0);
 					}
@@ -914,15 +905,8 @@ static int read_block_instruction_internal(
 			*next_instruction_potentially_reached = 1;
 			return 0;
 		}
-		else if ((value0 & 0x07) == 0x04) {
-			read_next_byte(reader);
-			DEBUG_PRINT0("\n");
-			*next_instruction_potentially_reached = 1;
-			return 0;
-		}
 		else {
-			/* Assuming (value0 & 0x07) == 0x05 */
-			read_next_word(reader);
+			/* Immediate values to al or ax */
 			DEBUG_PRINT0("\n");
 			*next_instruction_potentially_reached = 1;
 			return 0;
@@ -981,9 +965,6 @@ static int read_block_instruction_internal(
 		*next_instruction_potentially_reached = 1;
 		return 0;
 	}
-	else if ((value0 & 0xE7) == 0x26) {
-		return read_block_instruction_internal(reader, regs, stack, var_values, int_table, segment_start, segment_size, sorted_relocations, relocation_count, printer_err, block, code_block_list, gvar_list, segment_start_list, ref_list, (value0 >> 3) & 0x03, opcode_reference, next_instruction_potentially_reached);
-	}
 	else if ((value0 & 0xF0) == 0x40) {
 		DEBUG_PRINT0("\n");
 		*next_instruction_potentially_reached = 1;
@@ -1042,7 +1023,7 @@ static int read_block_instruction_internal(
 		return 0;
 	}
 	else if ((value0 & 0xF0) == 0x70 || (value0 & 0xFC) == 0xE0) {
-		const int value1 = read_next_byte(reader);
+		const int value1 = decoded->immediate;
 		const int diff = (value1 >= 0x80)? value1 - 0x100 : value1;
 		const char *next_destination = get_mcblock_start(block) + reader->buffer_index;
 		const char *jump_destination = next_destination + diff;
@@ -1062,14 +1043,8 @@ static int read_block_instruction_internal(
 			}
 		}
 		else {
-			if (jump_destination <= get_mcblock_start(block)) {
-				set_mcblock_end(block, next_destination);
-			}
-			else {
-				set_mcblock_end(block, jump_destination);
-				invalidate_mcblock_check(block);
-			}
-
+			/* Jumps to the middle of this block will split it when registering the jump target */
+			set_mcblock_end(block, next_destination);
 			if ((result = register_jump_target_block(segment_start, segment_size, reader, regs, stack, var_values, block, code_block_list, jump_destination, opcode_reference, diff))) {
 					return result;
 			}
@@ -1083,11 +1058,11 @@ static int read_block_instruction_internal(
 		return 0;
 	}
 	else if ((value0 & 0xFE) == 0x80) {
-		const int value1 = read_next_byte(reader);
+		const int value1 = decoded->modrm;
 		int imm_value;
 
 		if ((value1 & 0xC7) == 6) {
-			int result_address = read_next_word(reader);
+			int result_address = decoded->displacement;
 			if (segment_index == SEGMENT_INDEX_UNDEFINED) {
 				segment_index = SEGMENT_INDEX_DS;
 			}
@@ -1096,18 +1071,9 @@ static int read_block_instruction_internal(
 				return error_code;
 			}
 		}
-		else if ((value1 & 0xC0) == 0x40) {
-			read_next_byte(reader);
-		}
-		else if ((value1 & 0xC0) == 0x80) {
-			read_next_word(reader);
-		}
 
 		if (value0 & 1) {
-			imm_value = read_next_word(reader);
-		}
-		else {
-			read_next_byte(reader);
+			imm_value = decoded->immediate;
 		}
 
 		DEBUG_PRINT0("\n");
@@ -1142,9 +1108,9 @@ static int read_block_instruction_internal(
 		return 0;
 	}
 	else if (value0 == 0x83) {
-		const int value1 = read_next_byte(reader);
+		const int value1 = decoded->modrm;
 		if ((value1 & 0xC7) == 0x06) {
-			int result_address = read_next_word(reader);
+			int result_address = decoded->displacement;
 			if (segment_index == SEGMENT_INDEX_UNDEFINED) {
 				segment_index = SEGMENT_INDEX_DS;
 			}
@@ -1153,21 +1119,15 @@ static int read_block_instruction_internal(
 				return error_code;
 			}
 		}
-		else if ((value1 & 0xC0) == 0x80) {
-			read_next_word(reader);
-		}
-		else if ((value1 & 0xC0) == 0x40) {
-			read_next_byte(reader);
-		}
-		read_next_byte(reader);
+
 		DEBUG_PRINT0("\n");
 
 		*next_instruction_potentially_reached = 1;
 		return 0;
 	}
 	else if ((value0 & 0xFE) == 0x86 || (value0 & 0xFC) == 0x88) {
-		const int value1 = read_next_byte(reader);
-		uint16_t addr = read_address_offset(reader, value1);
+		const int value1 = decoded->modrm;
+		uint16_t addr = decoded->displacement;
 		int addr_flags;
 		int addr_stack_offset;
 		DEBUG_PRINT0("\n");
@@ -1320,14 +1280,14 @@ static int read_block_instruction_internal(
 		return 0;
 	}
 	else if ((value0 & 0xFD) == 0x8C) {
-		const int value1 = read_next_byte(reader);
+		const int value1 = decoded->modrm;
 		if (value1 & 0x20) {
 			DEBUG_PRINT0(" Unknown opcode\n");
 			return 1;
 		}
 		else {
 			if ((value1 & 0xC7) == 6) {
-				int result_address = read_next_word(reader);
+				int result_address = decoded->displacement;
 				const int read_access = value0 == 0x8E;
 				const int write_access = value0 == 0x8C;
 				const int write_value_defined = is_segment_register_defined(regs, (value1 >> 3) & 3);
@@ -1381,15 +1341,10 @@ static int read_block_instruction_internal(
 					}
 				}
 			}
-			else if ((value1 & 0xC0) == 0x40) {
-				read_next_byte(reader);
+			else if (value1 < 0xC0) {
 				DEBUG_PRINT0("\n");
 			}
-			else if ((value1 & 0xC0) == 0x80) {
-				read_next_word(reader);
-				DEBUG_PRINT0("\n");
-			}
-			else if (value1 >= 0xC0) {
+			else {
 				const int rm = value1 & 0x07;
 				const int index = (value1 >> 3) & 0x03;
 				DEBUG_PRINT0("\n");
@@ -1431,14 +1386,14 @@ static int read_block_instruction_internal(
 		}
 	}
 	else if (value0 == 0x8D) {
-		const int value1 = read_next_byte(reader);
+		const int value1 = decoded->modrm;
 		if (value1 >= 0xC0) {
 			DEBUG_PRINT0(" Unknown opcode\n");
 			return 1;
 		}
 		else {
 			const int target_reg_index = (value1 >> 3) & 7;
-			uint16_t addr = read_address_offset(reader, value1);
+			uint16_t addr = decoded->displacement;
 			int addr_flags;
 			int addr_stack_offset;
 
@@ -1462,7 +1417,7 @@ static int read_block_instruction_internal(
 		}
 	}
 	else if (value0 == 0x8F) {
-		const int value1 = read_next_byte(reader);
+		const int value1 = decoded->modrm;
 		if (value1 & 0x38 || value1 >= 0xC0) {
 			DEBUG_PRINT0(" Unknown opcode\n");
 			return 1;
@@ -1473,7 +1428,7 @@ static int read_block_instruction_internal(
 			uint16_t stack_top = pop_from_stack(stack);
 
 			if ((value1 & 0xC7) == 0x06) {
-				int result_address = read_next_word(reader);
+				int result_address = decoded->displacement;
 				DEBUG_PRINT0("\n");
 
 				if (segment_index == SEGMENT_INDEX_UNDEFINED) {
@@ -1484,14 +1439,6 @@ static int read_block_instruction_internal(
 					return error_code;
 				}
 			}
-			else if ((value1 & 0xC0) == 0x80) {
-				read_next_word(reader);
-				DEBUG_PRINT0("\n");
-			}
-			else if ((value1 & 0xC0) == 0x40) {
-				read_next_byte(reader);
-				DEBUG_PRINT0("\n");
-			}
 			else {
 				DEBUG_PRINT0("\n");
 			}
@@ -1537,7 +1484,7 @@ static int read_block_instruction_internal(
 			set_register_ax_undefined(regs, opcode_reference);
 		}
 
-		offset = read_next_word(reader);
+		offset = decoded->immediate;
 		DEBUG_PRINT0("\n");
 
 		current_segment_index = (segment_index >= 0)? segment_index : SEGMENT_INDEX_DS;
@@ -1622,19 +1569,7 @@ static int read_block_instruction_internal(
 		*next_instruction_potentially_reached = 1;
 		return 0;
 	}
-	else if (value0 == 0xA8) {
-		read_next_byte(reader);
-		DEBUG_PRINT0("\n");
-		*next_instruction_potentially_reached = 1;
-		return 0;
-	}
-	else if (value0 == 0xA9) {
-		read_next_word(reader);
-		DEBUG_PRINT0("\n");
-		*next_instruction_potentially_reached = 1;
-		return 0;
-	}
-	else if ((value0 & 0xFE) == 0xAA) {
+	else if ((value0 & 0xFC) == 0xA8) { /* test and stos */
 		DEBUG_PRINT0("\n");
 		*next_instruction_potentially_reached = 1;
 		return 0;
@@ -1678,11 +1613,11 @@ static int read_block_instruction_internal(
 	else if ((value0 & 0xF0) == 0xB0) {
 		const int target_register = value0 & 7;
 		if (value0 & 0x08) {
-			const char *relocation_query = reader->buffer + reader->buffer_index;
-			int word_value = read_next_word(reader);
+			const char *relocation_query = opcode_reference + decoded->length - decoded->immediate_length;
+			int word_value = decoded->immediate;
 			DEBUG_PRINT0("\n");
 
-			if (is_relocation_present_in_sorted_relocations(sorted_relocations, relocation_count, relocation_query)) {
+			if (is_relocation_present_in_sorted_relocations(sorted_relocations, relocation_query)) {
 				set_word_register_relative(regs, target_register, opcode_reference, opcode_reference, word_value);
 			}
 			else {
@@ -1690,7 +1625,7 @@ static int read_block_instruction_internal(
 			}
 		}
 		else {
-			int byte_value = read_next_byte(reader);
+			int byte_value = decoded->immediate;
 			DEBUG_PRINT0("\n");
 			set_byte_register(regs, target_register, opcode_reference, opcode_reference, byte_value);
 		}
@@ -1699,28 +1634,17 @@ static int read_block_instruction_internal(
 		return 0;
 	}
 	else if ((value0 & 0xFE) == 0xC2) {
-		struct CheckedBlocks checked_blocks;
-
-		if (value0 == 0xC2) {
-			read_next_word(reader);
-		}
 		DEBUG_PRINT0("\n  Finding origins of this function.\n");
 		set_mcblock_size(block, reader->buffer_index);
 
-		checked_blocks.blocks = NULL;
-		checked_blocks.count = 0;
-		checked_blocks.allocated_pages = 0;
-
-		update_call_origins(block, code_block_list, &checked_blocks, regs, stack, var_values, 0, 3);
-		if (checked_blocks.blocks != NULL) {
-			free(checked_blocks.blocks);
-		}
+		code_block_list->checked_blocks->count = 0;
+		update_call_origins(block, code_block_list, code_block_list->checked_blocks, regs, stack, var_values, 0, 3);
 
 		*next_instruction_potentially_reached = 0;
 		return 0;
 	}
 	else if ((value0 & 0xFE) == 0xC4) {
-		const int value1 = read_next_byte(reader);
+		const int value1 = decoded->modrm;
 		if ((value1 & 0xC0) == 0xC0) {
 			DEBUG_PRINT0(" Unknown opcode\n");
 			return 1;
@@ -1730,7 +1654,7 @@ static int read_block_instruction_internal(
 			const int target_segment_index = (value0 == 0xC4)? SEGMENT_INDEX_ES : SEGMENT_INDEX_DS;
 			int result_address;
 			if ((value1 & 0xC7) == 0x06) {
-				result_address = read_next_word(reader);
+				result_address = decoded->displacement;
 				DEBUG_PRINT0("\n");
 
 				if (segment_index == SEGMENT_INDEX_UNDEFINED) {
@@ -1741,14 +1665,6 @@ static int read_block_instruction_internal(
 					return error_code;
 				}
 			}
-			else if ((value1 & 0xC0) == 0x80) {
-				read_next_word(reader);
-				DEBUG_PRINT0("\n");
-			}
-			else if ((value1 & 0xC0) == 0x40) {
-				read_next_byte(reader);
-				DEBUG_PRINT0("\n");
-			}
 			else {
 				DEBUG_PRINT0("\n");
 			}
@@ -1803,25 +1719,14 @@ static int read_block_instruction_internal(
 		}
 	}
 	else if ((value0 & 0xFE) == 0xC6) {
-		const int value1 = read_next_byte(reader);
+		const int value1 = decoded->modrm;
 		if (value1 & 0x38) {
 			DEBUG_PRINT0(" Unknown opcode\n");
 			return 1;
 		}
 		else {
-			int diff_address;
-			int immediate_value;
-			if ((value1 & 0xC0) == 0x40) {
-				diff_address = read_next_byte(reader);
-				if (diff_address >= 0x80) {
-					diff_address -= 0x100;
-				}
-			}
-			else if (value1 == 0x06 || (value1 & 0xC0) == 0x80) {
-				diff_address = read_next_word(reader);
-			}
-
-			immediate_value = (value0 & 1)? read_next_word(reader) : read_next_byte(reader);
+			const int diff_address = decoded->displacement;
+			const int immediate_value = decoded->immediate;
 			DEBUG_PRINT0("\n");
 
 			if (value1 == 0x06) {
@@ -1877,25 +1782,18 @@ static int read_block_instruction_internal(
 		}
 	}
 	else if (value0 == 0xCB) {
-		struct CheckedBlocks checked_blocks;
 		DEBUG_PRINT0("\n");
 
 		set_mcblock_size(block, reader->buffer_index);
 
-		checked_blocks.blocks = NULL;
-		checked_blocks.count = 0;
-		checked_blocks.allocated_pages = 0;
-
-		error_code = update_call_origins(block, code_block_list, &checked_blocks, regs, stack, var_values, 0, 0);
-		if (checked_blocks.blocks != NULL) {
-			free(checked_blocks.blocks);
-		}
+		code_block_list->checked_blocks->count = 0;
+		error_code = update_call_origins(block, code_block_list, code_block_list->checked_blocks, regs, stack, var_values, 0, 0);
 
 		*next_instruction_potentially_reached = 0;
 		return error_code;
 	}
 	else if (value0 == 0xCD) {
-		const int interruption_number = read_next_byte(reader);
+		const int interruption_number = decoded->immediate;
 		DEBUG_PRINT0("\n");
 
 		*next_instruction_potentially_reached = 0;
@@ -1975,8 +1873,11 @@ static int read_block_instruction_internal(
 							return 1;
 						}
 
-						initialize_mcblock(target_block, target_relative_cs, target_ip, jump_destination);
-						if ((result = add_interruption_type_cborigin_in_mcblock(target_block, regs, var_values))) {
+						if ((result = initialize_mcblock(target_block, code_block_list->arena, code_block_list->snapshots, target_relative_cs, target_ip, jump_destination))) {
+							return result;
+						}
+
+						if ((result = add_interruption_type_cborigin_in_mcblock(target_block, opcode_reference, regs, var_values))) {
 							return result;
 						}
 
@@ -1984,9 +1885,8 @@ static int read_block_instruction_internal(
 							return result;
 						}
 
-						if (potential_container) {
-							set_mcblock_end(potential_container, jump_destination);
-							invalidate_mcblock_check(potential_container);
+						if (potential_container && (result = split_mcblock(code_block_list, potential_container, target_block))) {
+							return result;
 						}
 					}
 
@@ -2033,16 +1933,8 @@ static int read_block_instruction_internal(
 				const int ds_relative = is_register_ds_defined_relative(regs);
 				const uint16_t ds_value = get_register_ds(regs);
 
-				struct CheckedBlocks checked_blocks;
-				checked_blocks.blocks = NULL;
-				checked_blocks.count = 0;
-				checked_blocks.allocated_pages = 0;
-
-				error_code = update_int2140_message_references(regs, segment_start, segment_size, block, code_block_list, gvar_list, segment_start_list, ref_list, &checked_blocks, cx_defined, cx_relative, cx_value, dx_defined, dx_relative, dx_value, dx_value_origin, ds_defined, ds_relative, ds_value, 2);
-				if (checked_blocks.blocks != NULL) {
-					free(checked_blocks.blocks);
-				}
-
+				code_block_list->checked_blocks->count = 0;
+				error_code = update_int2140_message_references(regs, segment_start, segment_size, block, code_block_list, gvar_list, segment_start_list, ref_list, code_block_list->checked_blocks, cx_defined, cx_relative, cx_value, dx_defined, dx_relative, dx_value, dx_value_origin, ds_defined, ds_relative, ds_value, 2);
 				if (error_code) {
 					return error_code;
 				}
@@ -2075,13 +1967,11 @@ static int read_block_instruction_internal(
 		return 0;
 	}
 	else if ((value0 & 0xFC) == 0xD0) {
-		const int value1 = read_next_byte(reader);
-		if ((value1 & 0x38) == 0x30) {
+		if ((decoded->modrm & 0x38) == 0x30) {
 			DEBUG_PRINT0(" Unknown opcode\n");
 			return 1;
 		}
 		else {
-			read_block_instruction_address(reader, value1);
 			DEBUG_PRINT0("\n");
 			*next_instruction_potentially_reached = 1;
 			return 0;
@@ -2091,7 +1981,7 @@ static int read_block_instruction_internal(
 		const char *jump_destination;
 		struct MutableCodeBlock *potential_container;
 		int potential_container_evaluated_at_least_once;
-		int diff = read_next_word(reader);
+		int diff = decoded->immediate;
 		DEBUG_PRINT0("\n");
 
 		if (get_mcblock_ip(block) + reader->buffer_index + diff >= 0x10000) {
@@ -2127,7 +2017,10 @@ static int read_block_instruction_internal(
 				return 1;
 			}
 
-			initialize_mcblock(new_block, get_mcblock_relative_cs(block), get_mcblock_ip(block) + reader->buffer_index + diff, jump_destination);
+			if ((result = initialize_mcblock(new_block, code_block_list->arena, code_block_list->snapshots, get_mcblock_relative_cs(block), get_mcblock_ip(block) + reader->buffer_index + diff, jump_destination))) {
+				return result;
+			}
+
 			if ((result = add_jump_type_cborigin_in_block(segment_start, segment_size, new_block, code_block_list, opcode_reference, regs, stack, var_values))) {
 				return result;
 			}
@@ -2136,9 +2029,9 @@ static int read_block_instruction_internal(
 				return result;
 			}
 
-			if (potential_container_evaluated_at_least_once && get_mcblock_end(potential_container) > jump_destination) {
-				set_mcblock_end(potential_container, jump_destination);
-				invalidate_mcblock_check(potential_container);
+			if (potential_container_evaluated_at_least_once && get_mcblock_end(potential_container) > jump_destination &&
+					(result = split_mcblock(code_block_list, potential_container, new_block))) {
+				return result;
 			}
 		}
 
@@ -2147,15 +2040,13 @@ static int read_block_instruction_internal(
 		return 0;
 	}
 	else if (value0 == 0xEA) {
-		read_next_word(reader);
-		read_next_word(reader);
 		DEBUG_PRINT0("\n");
 		set_mcblock_size(block, reader->buffer_index);
 		*next_instruction_potentially_reached = 0;
 		return 0;
 	}
 	else if (value0 == 0xEB) {
-		const int value1 = read_next_byte(reader);
+		const int value1 = decoded->immediate;
 		const int diff = (value1 >= 0x80)? value1 - 0x100 : value1;
 		const char *jump_destination = get_mcblock_start(block) + reader->buffer_index + diff;
 		DEBUG_PRINT0("\n");
@@ -2175,22 +2066,11 @@ static int read_block_instruction_internal(
 		return 0;
 	}
 	else if ((value0 & 0xFE) == 0xF6) {
-		const int value1 = read_next_byte(reader);
-		if ((value1 & 0x38) == 0x08) {
+		if ((decoded->modrm & 0x38) == 0x08) {
 			DEBUG_PRINT0(" Unknown opcode\n");
 			return 1;
 		}
 		else {
-			read_block_instruction_address(reader, value1);
-			if ((value1 & 0x38) == 0) {
-				if (value0 & 1) {
-					read_next_word(reader);
-				}
-				else {
-					read_next_byte(reader);
-				}
-			}
-
 			DEBUG_PRINT0("\n");
 			*next_instruction_potentially_reached = 1;
 			return 0;
@@ -2219,6 +2099,7 @@ static int read_block_instruction_internal(
 				else {
 					int result;
 					struct Registers int_regs;
+					struct RegisterProvenance int_provenance;
 					if (potential_container) {
 						set_mcblock_end(potential_container, jump_destination);
 					}
@@ -2228,10 +2109,13 @@ static int read_block_instruction_internal(
 						return 1;
 					}
 
-					initialize_mcblock(target_block, target_relative_cs, target_ip, jump_destination);
-					set_all_registers_undefined(&int_regs);
+					if ((result = initialize_mcblock(target_block, code_block_list->arena, code_block_list->snapshots, target_relative_cs, target_ip, jump_destination))) {
+						return result;
+					}
+
+					initialize_registers(&int_regs, is_provenance_tracked_in_registers(regs)? &int_provenance : NULL);
 					set_register_cs_relative(&int_regs, NULL, where_interruption_segment_defined_in_table(int_table, i), target_relative_cs);
-					if ((result = add_interruption_type_cborigin_in_mcblock(target_block, &int_regs, var_values))) {
+					if ((result = add_interruption_type_cborigin_in_mcblock(target_block, opcode_reference, &int_regs, var_values))) {
 						return result;
 					}
 
@@ -2260,26 +2144,24 @@ static int read_block_instruction_internal(
 		return 0;
 	}
 	else if (value0 == 0xFE) {
-		const int value1 = read_next_byte(reader);
-		if (value1 & 0x30) {
+		if (decoded->modrm & 0x30) {
 			DEBUG_PRINT0(" Unknown opcode\n");
 			return 1;
 		}
 		else {
-			read_block_instruction_address(reader, value1);
 			DEBUG_PRINT0("\n");
 			*next_instruction_potentially_reached = 1;
 			return 0;
 		}
 	}
 	else if (value0 == 0xFF) {
-		const int value1 = read_next_byte(reader);
+		const int value1 = decoded->modrm;
 		if ((value1 & 0x38) == 0x38 || (value1 & 0xF8) == 0xD8 || (value1 & 0xF8) == 0xE8) {
 			DEBUG_PRINT0(" Unknown opcode\n");
 			return 1;
 		}
 		else {
-			uint16_t addr = read_address_offset(reader, value1);
+			uint16_t addr = decoded->displacement;
 			int addr_flags;
 			int addr_stack_offset;
 			int value_defined = 0;
@@ -2376,7 +2258,10 @@ static int read_block_instruction_internal(
 							return 1;
 						}
 
-						initialize_mcblock(new_block, get_mcblock_relative_cs(block), code_relative_target, jump_destination);
+						if ((result = initialize_mcblock(new_block, code_block_list->arena, code_block_list->snapshots, get_mcblock_relative_cs(block), code_relative_target, jump_destination))) {
+							return result;
+						}
+
 						if ((result = add_jump_type_cborigin_in_block(segment_start, segment_size, new_block, code_block_list, opcode_reference, regs, stack, var_values))) {
 							return result;
 						}
@@ -2393,9 +2278,8 @@ static int read_block_instruction_internal(
 							}
 						}
 
-						if (potential_container) {
-							set_mcblock_end(potential_container, jump_destination);
-							invalidate_mcblock_check(potential_container);
+						if (potential_container && (error_code = split_mcblock(code_block_list, potential_container, new_block))) {
+							return error_code;
 						}
 					}
 				}
@@ -2445,12 +2329,12 @@ static int read_block_instruction_internal(
 		}
 	}
 	else {
-		const int this_block_index = index_of_cblock_in_list(code_block_list, block);
+		const struct MutableCodeBlock *next_block = get_next_cblock(code_block_list, block);
 		const char *new_end = reader->buffer + reader->buffer_size;
 		DEBUG_PRINT0("\n");
 
-		if (this_block_index + 1 < code_block_list->block_count) {
-			const char *next_start = get_mcblock_start(code_block_list->sorted_blocks[this_block_index + 1]);
+		if (next_block) {
+			const char *next_start = get_mcblock_start(next_block);
 			if (next_start < new_end) {
 				new_end = next_start;
 			}
@@ -2461,6 +2345,43 @@ static int read_block_instruction_internal(
 	}
 }
 
+/**
+ * Finish the given block at the instruction where the reader is, which is cut off by the end of the image.
+ *
+ * The block ends at its last complete instruction, and the remaining bytes are registered as a variable,
+ * so that they are dumped as data. If the incomplete instruction is the first one, the block cannot be empty,
+ * so it keeps those bytes, which are dumped as data anyway as they cannot be decoded.
+ */
+static int end_mcblock_at_incomplete_instruction(
+		struct Reader *reader,
+		const char *segment_start,
+		struct MutableCodeBlock *block,
+		struct GlobalVariableList *gvar_list,
+		int *next_instruction_potentially_reached) {
+	const char *tail = reader->buffer + reader->buffer_index;
+	*next_instruction_potentially_reached = 0;
+	if (reader->buffer_index == 0) {
+		reader->buffer_index = reader->buffer_size;
+		set_mcblock_size(block, reader->buffer_size);
+		return 0;
+	}
+
+	set_mcblock_size(block, reader->buffer_index);
+	if (index_of_gvar_with_start(gvar_list, tail) < 0) {
+		const unsigned int relative_address = (get_mcblock_relative_cs(block) * 16 + get_mcblock_ip(block) + reader->buffer_index) & 0xFFFF;
+		struct GlobalVariable *var = prepare_new_gvar(gvar_list);
+		if (!var) {
+			return 1;
+		}
+
+		initialize_gvar(var, tail, relative_address, GVAR_TYPE_BYTE_STRING);
+		set_gvar_length(var, reader->buffer_size - reader->buffer_index);
+		return insert_gvar(gvar_list, var);
+	}
+
+	return 0;
+}
+
 static int read_block_instruction(
 		struct Reader *reader,
 		struct Registers *regs,
@@ -2469,8 +2390,8 @@ static int read_block_instruction(
 		struct InterruptionTable *int_table,
 		const char *segment_start,
 		unsigned int segment_size,
-		const char **sorted_relocations,
-		unsigned int relocation_count,
+		const struct SortedRelocations *sorted_relocations,
+		struct DecodedInstructionCache *instruction_cache,
 		struct FilePrinter *printer_err,
 		struct MutableCodeBlock *block,
 		struct MutableCodeBlockList *code_block_list,
@@ -2479,16 +2400,39 @@ static int read_block_instruction(
 		struct MutableReferenceList *reference_list,
 		int *next_instruction_potentially_reached) {
 	const char *instruction = reader->buffer + reader->buffer_index;
+	const unsigned int instruction_index = reader->buffer_index;
+	struct DecodedInstruction decoded;
+	unsigned int evaluated_length;
+	int invalid_modrm;
 	int result;
 #ifdef DEBUG
-	reader_debug_print_enabled = 1;
-#endif
+	unsigned int i;
+#endif /* DEBUG */
+
+	const int decode_error = decode_next_cached_instruction(instruction_cache, reader, &decoded);
+	if (decode_error == READ_ERROR_MAX_EXCEEDED) {
+		DEBUG_PRINT1("Incomplete instruction at +%x\n", instruction_index);
+		return end_mcblock_at_incomplete_instruction(reader, segment_start, block, global_variable_list, next_instruction_potentially_reached);
+	}
+
+	/* Unknown opcodes are still evaluated, as some of them just finish the block */
+	invalid_modrm = decode_error && (opcode_descriptors[decoded.opcode].flags & OPCODE_FLAG_VALID);
+	evaluated_length = decode_error? decoded.prefix_count + 1 + invalid_modrm : decoded.length;
 
-	result = read_block_instruction_internal(reader, regs, stack, var_values, int_table, segment_start, segment_size, sorted_relocations, relocation_count, printer_err, block, code_block_list, global_variable_list, segment_start_list, reference_list, SEGMENT_INDEX_UNDEFINED, instruction, next_instruction_potentially_reached);
 #ifdef DEBUG
-	reader_debug_print_enabled = 0;
-#endif
+	for (i = 0; i < evaluated_length; i++) {
+		DEBUG_PRINT1(" %02X", instruction[i] & 0xFF);
+	}
+#endif /* DEBUG */
+
+	if (invalid_modrm) {
+		DEBUG_PRINT0(" Unknown opcode\n");
+		return 1;
+	}
 
+	reader->buffer_index = instruction_index + evaluated_length;
+	result = read_block_instruction_internal(reader, regs, stack, var_values, int_table, segment_start, segment_size, sorted_relocations, printer_err, block, code_block_list, global_variable_list, segment_start_list, reference_list, &decoded, instruction, next_instruction_potentially_reached);
+	assert(result || reader->buffer_index == instruction_index + evaluated_length);
 	return result;
 }
 
@@ -2500,8 +2444,8 @@ static int read_block(
 		struct GlobalVariableWordValueMap *var_values,
 		const char *segment_start,
 		unsigned int segment_size,
-		const char **sorted_relocations,
-		unsigned int relocation_count,
+		const struct SortedRelocations *sorted_relocations,
+		struct DecodedInstructionCache *instruction_cache,
 		struct FilePrinter *printer_err,
 		struct MutableCodeBlock *block,
 		unsigned int block_max_size,
@@ -2518,119 +2462,130 @@ static int read_block(
 	reader.buffer_size = block_max_size;
 
 	set_all_interruption_table_undefined(&int_table);
+	if (code_block_list->checkpoint_trail) {
+		start_checkpoint_trail(code_block_list->checkpoint_trail, block);
+	}
 
 	DEBUG_PRINT2("Evaluation #%d. Iteration %d. ", evaluation_number, evaluation_loop);
 	DEBUG_PRINT2("Reading block at +%x:%x\n", get_mcblock_relative_cs(block), get_mcblock_ip(block));
 	do {
 		int next_instruction_potentially_reached = 0;
-		int index;
-		if ((error_code = read_block_instruction(&reader, regs, stack, var_values, &int_table, segment_start, segment_size, sorted_relocations, relocation_count, printer_err, block, code_block_list, global_variable_list, segment_start_list, reference_list, &next_instruction_potentially_reached))) {
+		struct MutableCodeBlock *next_block;
+		if ((error_code = read_block_instruction(&reader, regs, stack, var_values, &int_table, segment_start, segment_size, sorted_relocations, instruction_cache, printer_err, block, code_block_list, global_variable_list, segment_start_list, reference_list, &next_instruction_potentially_reached))) {
 			return error_code;
 		}
 
 		DEBUG_PRINT_STATE(get_mcblock_ip(block) + reader.buffer_index, regs, stack, var_values, segment_start, &int_table);
-		index = index_of_cblock_in_list(code_block_list, block);
-		if (index + 1 < code_block_list->block_count) {
-			struct MutableCodeBlock *next_block = code_block_list->sorted_blocks[index + 1];
+		if (code_block_list->checkpoint_trail &&
+				(error_code = record_checkpoint(code_block_list->checkpoint_trail, reader.buffer_index, next_instruction_potentially_reached, regs, stack, var_values))) {
+			return error_code;
+		}
+
+		if ((next_block = get_next_cblock(code_block_list, block))) {
 			const char *next_start = get_mcblock_start(next_block);
 			if (get_mcblock_start(block) + reader.buffer_index == next_start) {
-				struct Registers accumulated_regs;
-				struct Stack accumulated_stack;
-				struct GlobalVariableWordValueMap accumulated_map;
-
-				struct CodeBlockOriginList *next_origin_list = get_mcblock_origin_list(next_block);
-				int next_origin_index;
-
 				set_mcblock_end(block, next_start);
-				if (next_origin_list->origin_count > 0) {
-					struct CodeBlockOrigin *origin = next_origin_list->sorted_origins[0];
-					struct Registers *origin_regs = get_cborigin_registers(origin);
-					struct Stack *origin_stack = get_cborigin_stack(origin);
-					struct GlobalVariableWordValueMap *origin_var_values = get_cborigin_var_values(origin);
-
-					copy_registers(&accumulated_regs, origin_regs);
-					initialize_stack(&accumulated_stack);
-					if ((error_code = copy_stack(&accumulated_stack, origin_stack))) {
-						return error_code;
-					}
-
-					initialize_gvwvmap(&accumulated_map);
-					if ((error_code = copy_gvwvmap(&accumulated_map, origin_var_values))) {
-						return error_code;
-					}
+				if ((error_code = register_continue_state_in_mcblock(next_block, regs, stack, var_values, next_instruction_potentially_reached))) {
+					return error_code;
+				}
+			}
+			else if (get_mcblock_start(block) + reader.buffer_index >= next_start) {
+				set_mcblock_end(block, next_start);
+			}
+		}
+	} while (!is_mcblock_end_known(block) || reader.buffer_index < get_mcblock_size(block));
 
-					for (index = 1; index < next_origin_list->origin_count; index++) {
-						origin = next_origin_list->sorted_origins[index];
-						merge_registers(&accumulated_regs, origin_regs);
-						if ((error_code = merge_stacks(&accumulated_stack, origin_stack))) {
-							return error_code;
-						}
+	return 0;
+}
 
-						if ((error_code = merge_gvwvmap(&accumulated_map, origin_var_values))) {
-							return error_code;
-						}
-					}
-				}
+/**
+ * Evaluate blocks picked from the work list until no block is pending, or the iteration limit is reached.
+ *
+ * Blocks picked within the same iteration are evaluated one after another, as they are not independent.
+ * Evaluating a block may split any other block, or register a new one, and where each block ends depends on
+ * the start of the next one at the time it is evaluated. The state a block passes to its successors is also
+ * joined with the ones already registered there, in the order they arrive.
+ *
+ * The given stack and map are scratch buffers owned by the caller. They are overwritten on each block evaluation,
+ * reusing the memory they already hold, so that evaluating a block does not require any allocation
+ * once the buffers are large enough for the states involved.
+ */
+static int evaluate_pending_mcblocks(
+		struct SegmentReadResult *read_result,
+		struct DecodedInstructionCache *instruction_cache,
+		struct FilePrinter *printer_err,
+		struct MutableCodeBlockList *cblock_list,
+		struct MutableCodeBlockWorkList *work_list,
+		struct GlobalVariableList *global_variable_list,
+		struct SegmentStartList *segment_start_list,
+		struct MutableReferenceList *reference_list,
+		struct Stack *stack,
+		struct GlobalVariableWordValueMap *var_values,
+		int *evaluation_loop,
+		int *evaluation_number) {
+	while (!is_mcbwlist_iteration_limit_reached(work_list) && has_pending_mcblocks_in_mcbwlist(work_list)) {
+		struct MutableCodeBlock *block;
+		int error_code;
+		if ((error_code = start_mcbwlist_iteration(work_list))) {
+			return error_code;
+		}
 
-				next_origin_index = index_of_cborigin_of_type_continue(next_origin_list);
-				if (next_origin_index >= 0) {
-					struct CodeBlockOrigin *next_origin = next_origin_list->sorted_origins[next_origin_index];
-					struct Registers *next_origin_regs = get_cborigin_registers(next_origin);
-					struct GlobalVariableWordValueMap *next_origin_var_values = get_cborigin_var_values(next_origin);
+		while ((block = pick_mcblock_from_mcbwlist(work_list))) {
+			struct Registers regs;
+			struct RegisterProvenance provenance;
+			unsigned int block_max_size;
+			unsigned int block_index;
 
-					if (changes_on_merging_registers(next_origin_regs, regs) || changes_on_merging_gvwvmap(next_origin_var_values, var_values)) {
-						merge_registers(next_origin_regs, regs);
-						if ((error_code = merge_gvwvmap(next_origin_var_values, var_values))) {
-							return error_code;
-						}
+			mark_mcblock_as_being_evaluated(block);
+			STATS_INCREMENT(work_list->stats, block_evaluations);
 
-						invalidate_mcblock_check(next_block);
-					}
-				}
-				else if (next_instruction_potentially_reached) {
-					struct CodeBlockOrigin *next_origin = prepare_new_cborigin(next_origin_list);
-					if ((error_code = initialize_cborigin_as_continue(next_origin, regs, stack, var_values))) {
-						return error_code;
-					}
+			block_max_size = read_result->size - (get_mcblock_start(block) - read_result->buffer);
+			if ((error_code = update_mcblock_joined_state(block))) {
+				return error_code;
+			}
 
-					if ((error_code = insert_cborigin(next_origin_list, next_origin))) {
-						return error_code;
-					}
+			initialize_registers(&regs, is_provenance_tracked_in_registers(get_mcblock_joined_registers(block))? &provenance : NULL);
+			copy_registers(&regs, get_mcblock_joined_registers(block));
+			if ((error_code = copy_stack(stack, get_mcblock_joined_stack(block))) ||
+					(error_code = copy_gvwvmap(var_values, get_mcblock_joined_var_values(block))) ||
+					(error_code = read_block(++*evaluation_number, *evaluation_loop, &regs, stack, var_values, read_result->buffer, read_result->size, &read_result->sorted_relocations, instruction_cache, printer_err, block, block_max_size, cblock_list, global_variable_list, segment_start_list, reference_list))) {
+				return error_code;
+			}
 
-					if (next_origin_list->origin_count > 1 && (
-							changes_on_merging_registers(&accumulated_regs, regs) ||
-							changes_on_merging_stacks(&accumulated_stack, stack) ||
-							changes_on_merging_gvwvmap(&accumulated_map, var_values))) {
+			mark_mcblock_as_evaluated(block);
 
-						invalidate_mcblock_check(next_block);
-					}
+			for (block_index = work_list->attached_count; block_index < cblock_list->block_count; block_index++) {
+				if ((error_code = attach_mcblock_to_mcbwlist(work_list, get_unsorted_cblock(cblock_list, block_index)))) {
+					return error_code;
 				}
 			}
-			else if (get_mcblock_start(block) + reader.buffer_index >= next_start) {
-				set_mcblock_end(block, next_start);
-			}
+
+			DEBUG_CBLIST(cblock_list);
 		}
-	} while (!is_mcblock_end_known(block) || reader.buffer_index < get_mcblock_size(block));
+
+		DEBUG_PRINT2("Evaluation iteration %d evaluated %d blocks.\n", *evaluation_loop, get_mcbwlist_picked_count(work_list, *evaluation_loop - 1));
+		++*evaluation_loop;
+	}
 
 	return 0;
 }
 
-#define CBLOCK_EVALUATION_LOOP_LIMIT 20
-
 struct ProgramContent *compose_pcontent(
 		struct SegmentReadResult *read_result,
+		struct DecodedInstructionCache *instruction_cache,
 		struct FilePrinter *printer_err,
 		struct MutableCodeBlockList *cblock_list,
+		struct MutableCodeBlockWorkList *work_list,
 		struct GlobalVariableList *global_variable_list,
 		struct SegmentStartList *segment_start_list,
 		struct MutableReferenceList *reference_list) {
 	struct CodeBlockOriginList *origin_list;
 	struct CodeBlockOrigin *origin;
 	struct Registers *origin_regs;
-	struct MutableCodeBlock *first_block = prepare_new_cblock(cblock_list);
+	struct Stack stack;
+	struct GlobalVariableWordValueMap var_values;
+	unsigned int pass;
 	int error_code;
-	int any_evaluated;
-	int evaluate_all;
 	int variable_index;
 	int evaluation_loop = 1;
 	int evaluation_number = 0;
@@ -2641,64 +2596,71 @@ struct ProgramContent *compose_pcontent(
 	struct Reference *result_refs;
 	int index;
 
-	if (!first_block) {
-		return NULL;
+	if (cblock_list->block_count) {
+		/* Blocks kept from a previous analysis are attached in their insertion order, and only the ones requiring evaluation are pushed */
+		for (index = 0; index < cblock_list->block_count; index++) {
+			if (attach_mcblock_to_mcbwlist(work_list, get_unsorted_cblock(cblock_list, index))) {
+				return NULL;
+			}
+		}
 	}
+	else {
+		struct MutableCodeBlock *first_block = prepare_new_cblock(cblock_list);
+		if (!first_block) {
+			return NULL;
+		}
 
-	initialize_mcblock(first_block, read_result->relative_cs, read_result->ip, read_result->buffer + (read_result->relative_cs * 16 + read_result->ip));
-	origin_list = get_mcblock_origin_list(first_block);
-	origin = prepare_new_cborigin(origin_list);
-	initialize_cborigin_as_os(origin, read_result->relative_cs, ds_should_match_cs_at_segment_start(read_result));
-	if (insert_cborigin(origin_list, origin)) {
-		return NULL;
-	}
+		if (initialize_mcblock(first_block, cblock_list->arena, cblock_list->snapshots, read_result->relative_cs, read_result->ip, read_result->buffer + (read_result->relative_cs * 16 + read_result->ip))) {
+			return NULL;
+		}
 
-	if (insert_cblock(cblock_list, first_block)) {
-		return NULL;
-	}
+		origin_list = get_mcblock_origin_list(first_block);
+		origin = prepare_new_cborigin(origin_list);
+		if (initialize_cborigin_as_os(origin, origin_list->snapshots, read_result->relative_cs, ds_should_match_cs_at_segment_start(read_result)) ||
+				insert_cborigin(origin_list, origin)) {
+			return NULL;
+		}
 
-	evaluate_all = 0;
-	do {
-		int block_index;
-		any_evaluated = 0;
+		if (insert_cblock(cblock_list, first_block) || attach_mcblock_to_mcbwlist(work_list, first_block)) {
+			return NULL;
+		}
+	}
 
-		for (block_index = 0; block_index < cblock_list->block_count; block_index++) {
-			struct MutableCodeBlock *block = get_unsorted_cblock(cblock_list, block_index);
-			if (mcblock_requires_evaluation(block)) {
-				struct CodeBlockOriginList *block_origin_list = get_mcblock_origin_list(block);
-				struct Registers regs;
-				struct Stack stack;
-				unsigned int block_max_size;
-				struct GlobalVariableWordValueMap var_values;
+	initialize_stack_in_arena(&stack, cblock_list->arena);
+	initialize_gvwvmap_in_arena(&var_values, cblock_list->arena);
+	error_code = evaluate_pending_mcblocks(read_result, instruction_cache, printer_err, cblock_list, work_list, global_variable_list, segment_start_list, reference_list, &stack, &var_values, &evaluation_loop, &evaluation_number);
 
-				any_evaluated = 1;
-				mark_mcblock_as_being_evaluated(block);
+	/* Once the fixpoint is reached, evaluating all blocks again must not change anything, nor allocate anything.
+	 * A stable pass takes a single iteration, so those are reserved in advance */
+	if (!error_code && work_list->extra_pass_count) {
+		error_code = reserve_mcbwlist_iterations(work_list, work_list->extra_pass_count);
+	}
 
-				block_max_size = read_result->size - (get_mcblock_start(block) - read_result->buffer);
+	for (pass = 1; !error_code && pass <= work_list->extra_pass_count; pass++) {
+		const unsigned long allocations_before = get_arena_heap_allocation_count(cblock_list->arena);
+		for (index = 0; index < cblock_list->block_count; index++) {
+			invalidate_mcblock_check(get_unsorted_cblock(cblock_list, index));
+		}
 
-				accumulate_registers_from_cbolist(&regs, block_origin_list);
-				if (accumulate_stack_from_cbolist(&stack, block_origin_list) ||
-						accumulate_gvwvmap_from_cbolist(&var_values, block_origin_list) ||
-						read_block(++evaluation_number, evaluation_loop, &regs, &stack, &var_values, read_result->buffer, read_result->size, read_result->sorted_relocations, read_result->relocation_count, printer_err, block, block_max_size, cblock_list, global_variable_list, segment_start_list, reference_list)) {
-					return NULL;
-				}
+		error_code = evaluate_pending_mcblocks(read_result, instruction_cache, printer_err, cblock_list, work_list, global_variable_list, segment_start_list, reference_list, &stack, &var_values, &evaluation_loop, &evaluation_number);
+		fprintf(stderr, "Extra fixpoint pass %u: %lu heap allocations\n", pass, get_arena_heap_allocation_count(cblock_list->arena) - allocations_before);
+	}
 
-				clear_stack(&stack);
-				clear_gvwvmap(&var_values);
-				mark_mcblock_as_evaluated(block);
-				DEBUG_CBLIST(cblock_list);
-			}
-		}
+	clear_stack(&stack);
+	clear_gvwvmap(&var_values);
+	if (error_code) {
+		return NULL;
 	}
-	while (++evaluation_loop <= CBLOCK_EVALUATION_LOOP_LIMIT && any_evaluated);
 
-	if (evaluation_loop > CBLOCK_EVALUATION_LOOP_LIMIT) {
+	if (has_pending_mcblocks_in_mcbwlist(work_list)) {
 		DEBUG_PRINT0("Warning: Evalutation loop limit reached! Skipping to avoid infinite loops.\n");
 	}
 	else {
 		DEBUG_PRINT1("Evalutation required %d loop iterations.\n", evaluation_loop - 1);
 	}
 
+	DEBUG_PRINT1("Origins of %d blocks required widening.\n", work_list->widened_count);
+
 	for (variable_index = 0; variable_index < global_variable_list->variable_count; variable_index++) {
 		struct GlobalVariable *variable = global_variable_list->sorted_variables[variable_index];
 		if (!is_gvar_length_known(variable)) {
@@ -2756,11 +2718,11 @@ struct ProgramContent *compose_pcontent(
 			cblock_list->block_count * sizeof(struct CodeBlock));
 
 	for (index = 0; index < cblock_list->block_count; index++) {
-		copy_mcblock_to_cblock(result_blocks + index, cblock_list->sorted_blocks[index]);
+		copy_mcblock_to_cblock(result_blocks + index, get_sorted_cblock(cblock_list, index));
 	}
 
 	for (index = 0; index < reference_list->reference_count; index++) {
-		if (copy_mref_to_ref(result_refs + index, reference_list->sorted_references[index], result_blocks, cblock_list->block_count)) {
+		if (copy_mref_to_ref(result_refs + index, get_sorted_ref(reference_list, index), result_blocks, cblock_list->block_count)) {
 			free(result_raw);
 			return NULL;
 		}
@@ -2,17 +2,43 @@
 #define _FINDER_H_
 
 #include "srresult.h"
+#include "dicache.h"
 #include "mcblist.h"
+#include "mcbwlist.h"
 #include "gvlist.h"
 #include "sslist.h"
 #include "mreflist.h"
 #include "printu.h"
 #include "pcontent.h"
 
+/**
+ * Blocks already visited while walking backwards through the origins of a block.
+ * A single instance is reused by all walks, so that evaluating a block does not allocate once it is large enough.
+ */
+struct CheckedBlocks {
+	struct MutableCodeBlock **blocks;
+	unsigned int count;
+	unsigned int allocated_pages;
+	struct Arena *arena;
+};
+
+void initialize_checked_blocks_in_arena(struct CheckedBlocks *checked_blocks, struct Arena *arena);
+void clear_checked_blocks(struct CheckedBlocks *checked_blocks);
+
+/**
+ * Evaluate all code blocks reachable from the entry point of the image, finding all variables and references on the way,
+ * until a fixpoint is reached, and return the result. This will return NULL on failure.
+ *
+ * If the given list already holds blocks, kept from a previous analysis of an image with the same layout,
+ * the entry point is not added again, and the evaluation restarts from the blocks that require it,
+ * assuming that all the others are still valid.
+ */
 struct ProgramContent *compose_pcontent(
 	struct SegmentReadResult *read_result,
+	struct DecodedInstructionCache *instruction_cache,
 	struct FilePrinter *printer_err,
 	struct MutableCodeBlockList *code_block_list,
+	struct MutableCodeBlockWorkList *work_list,
 	struct GlobalVariableList *global_variable_list,
 	struct SegmentStartList *segment_start_list,
 	struct MutableReferenceList *reference_list);
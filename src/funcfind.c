@@ -1,5 +1,5 @@
 #include "funcfind.h"
-#include "counter.h"
+#include "dicache.h"
 #include "packed.h"
 #include "printd.h"
 
@@ -132,7 +132,7 @@ static int read_addr_diff(struct Reader *reader, int modRm) {
 	}
 }
 
-static int evaluate_block(const struct CodeBlock *blocks, unsigned int block_count, unsigned int block_index, packed_data_t *available_blocks, struct FuncState *state, const struct FunctionList *func_list) {
+static int evaluate_block(const struct CodeBlock *blocks, unsigned int block_count, unsigned int block_index, packed_data_t *available_blocks, struct FuncState *state, const struct FunctionList *func_list, struct DecodedInstructionCache *instruction_cache) {
 	const int is_first_block = count_set_bits_in_bitset(state->included_blocks, block_count) == 1;
 	const struct CodeBlock *block = blocks + block_index;
 	struct Reader reader;
@@ -199,9 +199,14 @@ static int evaluate_block(const struct CodeBlock *blocks, unsigned int block_cou
 	while (reader.buffer_index < reader.buffer_size) {
 		unsigned int buffer_index = reader.buffer_index;
 		unsigned int next_instruction_index;
+		struct DecodedInstruction decoded;
 		int value0;
 
-		if ((error_code = read_for_instruction_length(&reader))) {
+		/* Blocks only end with an incomplete instruction when it is cut off by the end of the image */
+		if ((error_code = decode_next_cached_instruction(instruction_cache, &reader, &decoded)) == READ_ERROR_MAX_EXCEEDED) {
+			break;
+		}
+		else if (error_code) {
 			return error_code;
 		}
 
@@ -441,7 +446,7 @@ static int evaluate_block(const struct CodeBlock *blocks, unsigned int block_cou
 	return 0;
 }
 
-static int find_all_blocks_in_function(const struct CodeBlock *blocks, unsigned int block_count, packed_data_t *available_blocks, struct FuncState *state, const struct FunctionList *func_list) {
+static int find_all_blocks_in_function(const struct CodeBlock *blocks, unsigned int block_count, packed_data_t *available_blocks, struct FuncState *state, const struct FunctionList *func_list, struct DecodedInstructionCache *instruction_cache) {
 	packed_data_t *evaluated_blocks = allocate_bitset(block_count);
 	int block_index;
 
@@ -453,7 +458,7 @@ static int find_all_blocks_in_function(const struct CodeBlock *blocks, unsigned
 		for (block_index = 0; block_index < block_count; block_index++) {
 			if (get_bitset_value(state->included_blocks, block_index) && !get_bitset_value(evaluated_blocks, block_index)) {
 				int error_code;
-				if ((error_code = evaluate_block(blocks, block_count, block_index, available_blocks, state, func_list))) {
+				if ((error_code = evaluate_block(blocks, block_count, block_index, available_blocks, state, func_list, instruction_cache))) {
 					free(evaluated_blocks);
 					return error_code;
 				}
@@ -467,7 +472,7 @@ static int find_all_blocks_in_function(const struct CodeBlock *blocks, unsigned
 	return 0;
 }
 
-static int check_block_stack(const struct CodeBlock *blocks, unsigned int block_count, unsigned int block_index, unsigned int included_block_index, unsigned int included_blocks_count, const struct FuncState *state, struct FuncStackState *stack_state, const int *block_map, const struct FunctionList *func_list) {
+static int check_block_stack(const struct CodeBlock *blocks, unsigned int block_count, unsigned int block_index, unsigned int included_block_index, unsigned int included_blocks_count, const struct FuncState *state, struct FuncStackState *stack_state, const int *block_map, const struct FunctionList *func_list, struct DecodedInstructionCache *instruction_cache) {
 	const struct CodeBlock *block = blocks + block_index;
 	struct Reader reader;
 	int error_code;
@@ -481,9 +486,14 @@ static int check_block_stack(const struct CodeBlock *blocks, unsigned int block_
 	while (reader.buffer_index < reader.buffer_size) {
 		unsigned int buffer_index = reader.buffer_index;
 		unsigned int next_instruction_index;
+		struct DecodedInstruction decoded;
 		int value0;
 
-		if ((error_code = read_for_instruction_length(&reader))) {
+		/* Blocks only end with an incomplete instruction when it is cut off by the end of the image */
+		if ((error_code = decode_next_cached_instruction(instruction_cache, &reader, &decoded)) == READ_ERROR_MAX_EXCEEDED) {
+			break;
+		}
+		else if (error_code) {
 			return error_code;
 		}
 
@@ -639,7 +649,7 @@ static int check_block_stack(const struct CodeBlock *blocks, unsigned int block_
 	return 0;
 }
 
-static int check_stack_in_all_blocks(const struct CodeBlock *blocks, unsigned int block_count, const struct FuncState *state, struct FuncStackState *stack_state, const int *block_map, const struct FunctionList *func_list) {
+static int check_stack_in_all_blocks(const struct CodeBlock *blocks, unsigned int block_count, const struct FuncState *state, struct FuncStackState *stack_state, const int *block_map, const struct FunctionList *func_list, struct DecodedInstructionCache *instruction_cache) {
 	const packed_data_t *included_blocks = state->included_blocks;
 	const unsigned int included_blocks_count = count_set_bits_in_bitset(included_blocks, block_count);
 	packed_data_t *evaluated_included_blocks = allocate_bitset(included_blocks_count);
@@ -650,7 +660,7 @@ static int check_stack_in_all_blocks(const struct CodeBlock *blocks, unsigned in
 		if (get_bitset_value(included_blocks, block_index)) {
 			if (!get_bitset_value(evaluated_included_blocks, included_block_index) && stack_state->stack_size[included_block_index] >= 0) {
 				int error_code;
-				if ((error_code = check_block_stack(blocks, block_count, block_index, included_block_index, included_blocks_count, state, stack_state, block_map, func_list))) {
+				if ((error_code = check_block_stack(blocks, block_count, block_index, included_block_index, included_blocks_count, state, stack_state, block_map, func_list, instruction_cache))) {
 					free(evaluated_included_blocks);
 					return error_code;
 				}
@@ -664,7 +674,7 @@ static int check_stack_in_all_blocks(const struct CodeBlock *blocks, unsigned in
 	return 0;
 }
 
-int find_functions(const struct CodeBlock *blocks, unsigned int block_count, struct FunctionList *func_list) {
+int find_functions(const struct CodeBlock *blocks, unsigned int block_count, struct FunctionList *func_list, struct DecodedInstructionCache *instruction_cache) {
 	packed_data_t *available_blocks = allocate_bitset(block_count);
 	int block_index;
 	int new_function_added;
@@ -724,7 +734,7 @@ int find_functions(const struct CodeBlock *blocks, unsigned int block_count, str
 					set_bitset_value(state.starting_blocks, block_index, 1);
 
 					DEBUG_PRINT2(" Finding all blocks in function starting at +%x:%x\n", get_cblock_relative_cs(block), get_cblock_ip(block));
-					if (!find_all_blocks_in_function(blocks, block_count, available_blocks, &state, func_list) && (state.flags & STATE_FLAG_RET_TYPE_MASK) != STATE_FLAG_RET_TYPE_UNKNOWN) {
+					if (!find_all_blocks_in_function(blocks, block_count, available_blocks, &state, func_list, instruction_cache) && (state.flags & STATE_FLAG_RET_TYPE_MASK) != STATE_FLAG_RET_TYPE_UNKNOWN) {
 						struct FuncStackState stack_state;
 						const unsigned int included_blocks_count = count_set_bits_in_bitset(state.included_blocks, block_count);
 						int included_block_index;
@@ -770,7 +780,7 @@ int find_functions(const struct CodeBlock *blocks, unsigned int block_count, str
 						}
 
 						DEBUG_PRINT0("  Checking if stack is properly balanced.\n");
-						if (!check_stack_in_all_blocks(blocks, block_count, &state, &stack_state, block_map, func_list)) {
+						if (!check_stack_in_all_blocks(blocks, block_count, &state, &stack_state, block_map, func_list, instruction_cache)) {
 							struct Function *new_func = prepare_new_func(func_list);
 							int all_block_index;
 							int new_blocks_index = 0;
@@ -1,11 +1,13 @@
 #ifndef _FUNCTION_FINDER_H_
 #define _FUNCTION_FINDER_H_
 
+#include "dicache.h"
 #include "funclist.h"
 
 int find_functions(
 		const struct CodeBlock *blocks,
 		unsigned int block_count,
-		struct FunctionList *func_list);
+		struct FunctionList *func_list,
+		struct DecodedInstructionCache *instruction_cache);
 
 #endif /* _FUNCTION_FINDER_H_ */
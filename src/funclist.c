@@ -40,11 +40,11 @@ void clear_func_list(struct FunctionList *list) {
 				free_func_content(page + j);
 			}
 
-			free(page);
+			release_in_arena(list->arena, page);
 		}
 
-		free(list->page_array);
-		free(list->sorted_funcs);
+		release_in_arena(list->arena, list->page_array);
+		release_in_arena(list->arena, list->sorted_funcs);
 		list->page_array = NULL;
 		list->sorted_funcs = NULL;
 		list->func_count = 0;
@@ -28,6 +28,7 @@ int initialize_func(struct Function *func, unsigned int block_count) {
 	assert(block_count > 0);
 	func->flags = 0;
 	func->block_count = block_count;
+	func->blocks = NULL;
 
 	if (block_count <= sizeof(packed_data_t *) * 8) {
 		func->included_block_start = NULL;
@@ -46,6 +47,8 @@ void free_func_content(struct Function *func) {
 	if (func->block_count > sizeof(packed_data_t *) * 8) {
 		free(func->included_block_start);
 	}
+
+	free(func->blocks);
 }
 
 int get_function_return_type(const struct Function *func) {
@@ -2,6 +2,7 @@
 #define _FUNCTION_H_
 
 #include "cblock.h"
+#include "packed.h"
 
 #define FUNC_RET_TYPE_NEAR 1
 #define FUNC_RET_TYPE_FAR 2
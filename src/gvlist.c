@@ -87,7 +87,7 @@ int add_gvar_mref(
 			}
 		}
 		else {
-			var_ref = reference_list->sorted_references[index];
+			var_ref = get_sorted_ref(reference_list, index);
 		}
 
 		if (read_access) {
@@ -143,7 +143,7 @@ int add_far_pointer_gvar_mref(
 			}
 		}
 		else {
-			var_ref = ref_list->sorted_references[index];
+			var_ref = get_sorted_ref(ref_list, index);
 		}
 
 		if (read_access) {
@@ -5,11 +5,20 @@
 #define GVWVMAP_DEFINED_RELATIVE_GRANULARITY 4
 #define GVWVMAP_ARRAY_WORD_GRANULARITY (GVWVMAP_DEFINED_RELATIVE_GRANULARITY * GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD)
 
-void initialize_gvwvmap(struct GlobalVariableWordValueMap *map) {
+/* Number of keys skipped at once while looking for a key in the other map when merging */
+#define GVWVMAP_JOIN_BLOCK_SIZE 8
+
+void initialize_gvwvmap_in_arena(struct GlobalVariableWordValueMap *map, struct Arena *arena) {
 	map->entry_count = 0;
+	map->capacity = 0;
 	map->keys = NULL;
 	map->values = NULL;
 	map->defined_and_relative = NULL;
+	map->arena = arena;
+}
+
+void initialize_gvwvmap(struct GlobalVariableWordValueMap *map) {
+	initialize_gvwvmap_in_arena(map, NULL);
 }
 
 int is_gvwvalue_defined_at_index(const struct GlobalVariableWordValueMap *map, int index) {
@@ -47,21 +56,34 @@ int index_of_gvar_in_gvwvmap_with_start(const struct GlobalVariableWordValueMap
 	return -1;
 }
 
-static int enlarge_one_page_if_required(struct GlobalVariableWordValueMap *map) {
-	if ((map->entry_count % GVWVMAP_ARRAY_WORD_GRANULARITY) == 0) {
-		const unsigned int new_allocated_word_count = map->entry_count + GVWVMAP_ARRAY_WORD_GRANULARITY;
-		size_t new_size = map->entry_count + GVWVMAP_ARRAY_WORD_GRANULARITY * sizeof(uint16_t);
-		map->keys = realloc(map->keys, new_allocated_word_count * sizeof(const char *));
-		map->values = realloc(map->values, new_allocated_word_count * sizeof(uint16_t));
-		map->defined_and_relative = realloc(map->defined_and_relative, (new_allocated_word_count / GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD) * sizeof(uint16_t));
+/**
+ * Reserve space for at least the given number of entries, keeping the current ones.
+ * The capacity is doubled each time, so inserting entries one by one takes amortised constant time.
+ */
+static int reserve_gvwvmap_capacity(struct GlobalVariableWordValueMap *map, unsigned int required_count) {
+	if (required_count > map->capacity) {
+		unsigned int new_capacity = map->capacity? map->capacity : GVWVMAP_ARRAY_WORD_GRANULARITY;
+		while (new_capacity < required_count) {
+			new_capacity *= 2;
+		}
+
+		map->keys = reallocate_in_arena(map->arena, map->keys, new_capacity * sizeof(const char *));
+		map->values = reallocate_in_arena(map->arena, map->values, new_capacity * sizeof(uint16_t));
+		map->defined_and_relative = reallocate_in_arena(map->arena, map->defined_and_relative, (new_capacity / GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD) * sizeof(uint16_t));
 		if (!map->keys || !map->values || !map->defined_and_relative) {
 			return 1;
 		}
+
+		map->capacity = new_capacity;
 	}
 
 	return 0;
 }
 
+static int enlarge_one_page_if_required(struct GlobalVariableWordValueMap *map) {
+	return reserve_gvwvmap_capacity(map, map->entry_count + 1);
+}
+
 static void ensure_gap(struct GlobalVariableWordValueMap *map, int gap_index) {
 	int i;
 
@@ -239,15 +261,8 @@ int remove_gvwvalue_with_start(struct GlobalVariableWordValueMap *map, const cha
 				}
 			}
 
-			if ((--map->entry_count % GVWVMAP_ARRAY_WORD_GRANULARITY) == 0) {
-				map->keys = realloc(map->keys, map->entry_count * sizeof(const char *));
-				map->values = realloc(map->values, map->entry_count * sizeof(uint16_t));
-				map->defined_and_relative = realloc(map->defined_and_relative, (map->entry_count / GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD) * sizeof(uint16_t));
-				if (!map->keys || !map->values || !map->defined_and_relative) {
-					return 1;
-				}
-			}
-
+			/* The capacity is kept, as the map is likely to grow again */
+			map->entry_count--;
 			return 0;
 		}
 	}
@@ -257,74 +272,89 @@ int remove_gvwvalue_with_start(struct GlobalVariableWordValueMap *map, const cha
 
 void clear_gvwvmap(struct GlobalVariableWordValueMap *map) {
 	if (map->keys) {
-		free(map->keys);
+		release_in_arena(map->arena, map->keys);
 	}
 
 	if (map->values) {
-		free(map->values);
+		release_in_arena(map->arena, map->values);
 	}
 
 	if (map->defined_and_relative) {
-		free(map->defined_and_relative);
+		release_in_arena(map->arena, map->defined_and_relative);
 	}
 
-	initialize_gvwvmap(map);
+	initialize_gvwvmap_in_arena(map, map->arena);
 }
 
 int copy_gvwvmap(struct GlobalVariableWordValueMap *target_map, const struct GlobalVariableWordValueMap *source_map) {
-	const unsigned int old_count = target_map->entry_count;
-	const unsigned int old_allocated_pages = (old_count + GVWVMAP_ARRAY_WORD_GRANULARITY - 1) / GVWVMAP_ARRAY_WORD_GRANULARITY;
-	const unsigned int new_count = source_map->entry_count;
-	const unsigned int new_allocated_pages = (new_count + GVWVMAP_ARRAY_WORD_GRANULARITY - 1) / GVWVMAP_ARRAY_WORD_GRANULARITY;
-	const unsigned int new_allocated_count = new_allocated_pages * GVWVMAP_ARRAY_WORD_GRANULARITY;
-
-	if (old_allocated_pages && old_allocated_pages != new_allocated_pages) {
-		free(target_map->keys);
-		free(target_map->values);
-		free(target_map->defined_and_relative);
-	}
-
-	if (new_allocated_pages && old_allocated_pages != new_allocated_pages) {
-		target_map->keys = malloc(new_allocated_count * sizeof(const char *));
-		target_map->values = malloc(new_allocated_count * sizeof(uint16_t));
-		target_map->defined_and_relative = malloc(new_allocated_count / GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD * sizeof(uint16_t));
-		if (!target_map->keys || !target_map->values || !target_map->defined_and_relative) {
+	const unsigned int count = source_map->entry_count;
+	const unsigned int relative_word_count = (count + GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD - 1) / GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD;
+	unsigned int i;
+
+	if (count > target_map->capacity) {
+		/* Current entries are not required, so there is no point in reallocating them */
+		clear_gvwvmap(target_map);
+		if (reserve_gvwvmap_capacity(target_map, count)) {
 			return 1;
 		}
 	}
 
-	if (new_allocated_count) {
-		const int relative_allocated_count = new_allocated_count / GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD;
-		int i;
+	for (i = 0; i < count; i++) {
+		target_map->keys[i] = source_map->keys[i];
+		target_map->values[i] = source_map->values[i];
+	}
 
-		for (i = 0; i < new_count; i++) {
-			target_map->keys[i] = source_map->keys[i];
-			target_map->values[i] = source_map->values[i];
-		}
+	for (i = 0; i < relative_word_count; i++) {
+		target_map->defined_and_relative[i] = source_map->defined_and_relative[i];
+	}
 
-		for (i = 0; i < relative_allocated_count; i++) {
-			target_map->defined_and_relative[i] = source_map->defined_and_relative[i];
-		}
+	target_map->entry_count = count;
+	return 0;
+}
+
+/**
+ * Returns the index of the first key in the given map that is not lower than the given key, starting the search at the given index.
+ *
+ * This is used to join 2 maps in a single pass, as keys are sorted in both maps.
+ * Keys are skipped in blocks first, comparing only the last key of each block,
+ * so that large ranges of keys not present in the other map are traversed quickly.
+ */
+static unsigned int skip_gvwvmap_keys_lower_than(const struct GlobalVariableWordValueMap *map, unsigned int index, const char *key) {
+	while (index + GVWVMAP_JOIN_BLOCK_SIZE <= map->entry_count && map->keys[index + GVWVMAP_JOIN_BLOCK_SIZE - 1] < key) {
+		index += GVWVMAP_JOIN_BLOCK_SIZE;
 	}
-	else {
-		target_map->keys = NULL;
-		target_map->values = NULL;
-		target_map->defined_and_relative = NULL;
+
+	while (index < map->entry_count && map->keys[index] < key) {
+		index++;
 	}
-	target_map->entry_count = new_count;
 
-	return 0;
+	return index;
+}
+
+static uint16_t get_gvwvalue_definition_at_index(const struct GlobalVariableWordValueMap *map, unsigned int index) {
+	return (map->defined_and_relative[index / GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD] >> ((index % GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD) * 2)) & 3;
+}
+
+/**
+ * Returns something different from 0 if the entry at the given index of the given map would be undefined after merging it with the other map.
+ * The given other_index is updated to the position of the entry key in the other map, and it must be
+ * lower or equal than that position when calling this method.
+ */
+static int is_gvwvalue_lost_on_merging(const struct GlobalVariableWordValueMap *map, unsigned int index, const struct GlobalVariableWordValueMap *other_map, unsigned int *other_index) {
+	const char *key = map->keys[index];
+	*other_index = skip_gvwvmap_keys_lower_than(other_map, *other_index, key);
+	return *other_index == other_map->entry_count ||
+			other_map->keys[*other_index] != key ||
+			get_gvwvalue_definition_at_index(map, index) != get_gvwvalue_definition_at_index(other_map, *other_index) ||
+			map->values[index] != other_map->values[*other_index];
 }
 
 int merge_gvwvmap(struct GlobalVariableWordValueMap *map, const struct GlobalVariableWordValueMap *other_map) {
-	int i;
+	unsigned int other_index = 0;
+	unsigned int i;
 	for (i = 0; i < map->entry_count; i++) {
-		if (is_gvwvalue_defined_at_index(map, i)) {
-			const char *key = map->keys[i];
-			int other_index = index_of_gvar_in_gvwvmap_with_start(other_map, key);
-			if (other_index < 0 || !is_gvwvalue_defined_at_index(other_map, other_index) || map->values[i] != other_map->values[i] || is_gvwvalue_defined_relative_at_index(map, i) != is_gvwvalue_defined_relative_at_index(other_map, other_index)) {
-				map->defined_and_relative[i / GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD] &= ~(3 << ((i % GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD) * 2));
-			}
+		if (is_gvwvalue_defined_at_index(map, i) && is_gvwvalue_lost_on_merging(map, i, other_map, &other_index)) {
+			map->defined_and_relative[i / GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD] &= ~(3 << ((i % GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD) * 2));
 		}
 	}
 
@@ -332,20 +362,67 @@ int merge_gvwvmap(struct GlobalVariableWordValueMap *map, const struct GlobalVar
 }
 
 int changes_on_merging_gvwvmap(const struct GlobalVariableWordValueMap *map, const struct GlobalVariableWordValueMap *other_map) {
-	int i;
+	unsigned int other_index = 0;
+	unsigned int i;
 	for (i = 0; i < map->entry_count; i++) {
-		if (is_gvwvalue_defined_at_index(map, i)) {
-			const char *key = map->keys[i];
-			int other_index = index_of_gvar_in_gvwvmap_with_start(other_map, key);
-			if (other_index < 0 || !is_gvwvalue_defined_at_index(other_map, other_index) || map->values[i] != other_map->values[i] || is_gvwvalue_defined_relative_at_index(map, i) != is_gvwvalue_defined_relative_at_index(other_map, other_index)) {
-				return 1;
-			}
+		if (is_gvwvalue_defined_at_index(map, i) && is_gvwvalue_lost_on_merging(map, i, other_map, &other_index)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int widen_gvwvmap(struct GlobalVariableWordValueMap *map, const struct GlobalVariableWordValueMap *other_map) {
+	unsigned int other_index = 0;
+	unsigned int i;
+	for (i = 0; i < map->entry_count; i++) {
+		if ((get_gvwvalue_definition_at_index(map, i) & 1) && is_gvwvalue_lost_on_merging(map, i, other_map, &other_index)) {
+			map->defined_and_relative[i / GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD] &= ~(3 << ((i % GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD) * 2));
 		}
 	}
 
 	return 0;
 }
 
+unsigned int count_defined_in_gvwvmap(const struct GlobalVariableWordValueMap *map) {
+	unsigned int count = 0;
+	int i;
+	for (i = 0; i < map->entry_count; i++) {
+		if (map->defined_and_relative[i / GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD] & 1 << ((i % GVWVMAP_DEFINED_RELATIVE_ENTRIES_PER_WORD) * 2)) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+int are_gvwvmaps_equal(const struct GlobalVariableWordValueMap *map, const struct GlobalVariableWordValueMap *other_map) {
+	unsigned int i;
+	if (map->entry_count != other_map->entry_count) {
+		return 0;
+	}
+
+	for (i = 0; i < map->entry_count; i++) {
+		if (map->keys[i] != other_map->keys[i] || map->values[i] != other_map->values[i] ||
+				get_gvwvalue_definition_at_index(map, i) != get_gvwvalue_definition_at_index(other_map, i)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+unsigned long hash_gvwvmap(const struct GlobalVariableWordValueMap *map) {
+	unsigned long hash = map->entry_count;
+	unsigned int i;
+	for (i = 0; i < map->entry_count; i++) {
+		hash = hash * 31 + ((unsigned long) get_gvwvalue_definition_at_index(map, i) << 16 | map->values[i]);
+	}
+
+	return hash;
+}
+
 #ifdef DEBUG
 
 #include <stdio.h>
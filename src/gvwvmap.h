@@ -2,15 +2,27 @@
 #define _GLOBAL_VARIABLE_WORD_VALUE_MAP_H_
 
 #include <stdint.h>
+#include "arena.h"
 
 struct GlobalVariableWordValueMap {
 		const char **keys;
 		uint16_t *values;
 		uint16_t *defined_and_relative;
 		unsigned int entry_count;
+
+		/**
+		 * Number of entries that the arrays can hold without reallocating them.
+		 */
+		unsigned int capacity;
+
+		/**
+		 * Arena where all the arrays of this map are allocated, or NULL to allocate them directly with malloc.
+		 */
+		struct Arena *arena;
 };
 
 void initialize_gvwvmap(struct GlobalVariableWordValueMap *map);
+void initialize_gvwvmap_in_arena(struct GlobalVariableWordValueMap *map, struct Arena *arena);
 int is_gvwvalue_defined_at_index(const struct GlobalVariableWordValueMap *map, int index);
 int is_gvwvalue_defined_relative_at_index(const struct GlobalVariableWordValueMap *map, int index);
 uint16_t get_gvwvalue_at_index(const struct GlobalVariableWordValueMap *map, int index);
@@ -25,6 +37,34 @@ int copy_gvwvmap(struct GlobalVariableWordValueMap *target_map, const struct Glo
 int merge_gvwvmap(struct GlobalVariableWordValueMap *map, const struct GlobalVariableWordValueMap *other_map);
 int changes_on_merging_gvwvmap(const struct GlobalVariableWordValueMap *map, const struct GlobalVariableWordValueMap *other_map);
 
+/**
+ * Merge the given map as merge_gvwvmap does, but undefining as well any relative
+ * value that is not present with the same value in the other map.
+ *
+ * This is used instead of merge_gvwvmap for blocks that have been evaluated
+ * too many times, in order to reach the fixed point faster.
+ */
+int widen_gvwvmap(struct GlobalVariableWordValueMap *map, const struct GlobalVariableWordValueMap *other_map);
+
+/**
+ * Returns the number of defined entries in the given map, either relative or not.
+ *
+ * Merging or widening never increases this number, so it can be used to check
+ * whether widening has actually changed anything.
+ */
+unsigned int count_defined_in_gvwvmap(const struct GlobalVariableWordValueMap *map);
+
+/**
+ * Returns something different from 0 if both maps have the same keys, with the same values and definitions.
+ */
+int are_gvwvmaps_equal(const struct GlobalVariableWordValueMap *map, const struct GlobalVariableWordValueMap *other_map);
+
+/**
+ * Returns a hash of the entries in the given map.
+ * Maps that are equal according to are_gvwvmaps_equal will always have the same hash.
+ */
+unsigned long hash_gvwvmap(const struct GlobalVariableWordValueMap *map);
+
 #ifdef DEBUG
 void print_gvwvmap(const struct GlobalVariableWordValueMap *map, const char *buffer);
 #endif /* DEBUG */
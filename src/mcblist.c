@@ -1,114 +1,357 @@
 #include "mcblist.h"
 #include "printd.h"
+#include <assert.h>
+#include <string.h>
+
+#define BITS_PER_WORD (sizeof(packed_data_t) * 8)
 
 static void log_cblock_insertion(struct MutableCodeBlock *block) {
 	DEBUG_PRINT2("  Registering new code block at +%x:%x\n", get_mcblock_relative_cs(block), get_mcblock_ip(block));
 }
 
-DEFINE_STRUCT_LIST_INITIALIZE_METHOD(MutableCodeBlock, cblock, block)
+void initialize_cblock_list_in_arena(struct MutableCodeBlockList *list, struct Arena *arena) {
+	list->block_count = 0;
+	list->page_array = NULL;
+	list->chunks = NULL;
+	list->chunk_count_tree = NULL;
+	list->chunk_count = 0;
+	list->chunk_capacity = 0;
+	list->arena = arena;
+	list->indexed_start = NULL;
+	list->indexed_size = 0;
+	list->ids_by_position = NULL;
+	list->start_bitset = NULL;
+	list->start_summary = NULL;
+	list->checkpoint_trail = NULL;
+	list->checked_blocks = NULL;
+	list->snapshots = NULL;
+}
+
+void initialize_cblock_list(struct MutableCodeBlockList *list) {
+	initialize_cblock_list_in_arena(list, NULL);
+}
+
+DEFINE_STRUCT_CHUNKED_LIST_COUNT_TREE_METHODS(MutableCodeBlock, cblock)
 DEFINE_STRUCT_LIST_GET_UNSORTED_METHOD(MutableCodeBlock, cblock, 64)
-DEFINE_STRUCT_LIST_PREPARE_NEW_METHOD(MutableCodeBlock, cblock, block, 8, 64)
-DEFINE_STRUCT_LIST_CLEAR_METHOD(MutableCodeBlock, cblock, block, 64)
-DEFINE_STRUCT_LIST_INDEX_OF_WITH_METHOD(MutableCodeBlock, cblock, block, start)
+DEFINE_STRUCT_CHUNKED_LIST_GET_SORTED_METHOD(MutableCodeBlock, cblock)
+DEFINE_STRUCT_CHUNKED_LIST_PREPARE_NEW_METHOD(MutableCodeBlock, cblock, block, 8, 64)
+DEFINE_STRUCT_CHUNKED_LIST_RELEASE_CHUNKS_METHOD(MutableCodeBlock, cblock)
+DEFINE_STRUCT_CHUNKED_LIST_LOCATE_METHOD(MutableCodeBlock, cblock, start)
+DEFINE_STRUCT_CHUNKED_LIST_INSERT_AT_METHOD(MutableCodeBlock, cblock, block)
 
-int insert_cblock(struct MutableCodeBlockList *list, struct MutableCodeBlock *new_block) {
-	const char *new_block_start = get_mcblock_start(new_block);
-	int first = 0;
-	int last = list->block_count;
-	int i;
-	log_cblock_insertion(new_block);
-	while (last > first) {
-		int index = (first + last) / 2;
-		const char *this_start = get_mcblock_start(list->sorted_blocks[index]);
-		if (this_start < new_block_start) {
-			first = index + 1;
+static void release_cblock_list_position_index(struct MutableCodeBlockList *list) {
+	release_in_arena(list->arena, list->ids_by_position);
+	release_in_arena(list->arena, list->start_bitset);
+	release_in_arena(list->arena, list->start_summary);
+	list->indexed_start = NULL;
+	list->indexed_size = 0;
+	list->ids_by_position = NULL;
+	list->start_bitset = NULL;
+	list->start_summary = NULL;
+}
+
+void clear_cblock_list(struct MutableCodeBlockList *list) {
+	release_cblock_list_position_index(list);
+	if (list->block_count > 0) {
+		const int allocated_pages = (list->block_count + 63) / 64;
+		int i;
+		for (i = allocated_pages - 1; i >= 0; i--) {
+			release_in_arena(list->arena, list->page_array[i]);
 		}
-		else if (this_start > new_block_start) {
-			last = index;
+
+		release_in_arena(list->arena, list->page_array);
+		list->page_array = NULL;
+		list->block_count = 0;
+	}
+
+	release_cblock_chunks(list);
+}
+
+int index_cblock_list_positions(struct MutableCodeBlockList *list, const char *image_start, unsigned int image_size) {
+	const unsigned int bitset_words = (image_size + BITS_PER_WORD - 1) / BITS_PER_WORD;
+	const unsigned int summary_words = (bitset_words + BITS_PER_WORD - 1) / BITS_PER_WORD;
+	assert(list->block_count == 0 && !list->indexed_start);
+
+	if (!image_size) {
+		return 0;
+	}
+
+	list->ids_by_position = allocate_in_arena(list->arena, image_size * sizeof(unsigned int));
+	list->start_bitset = allocate_in_arena(list->arena, bitset_words * sizeof(packed_data_t));
+	list->start_summary = allocate_in_arena(list->arena, summary_words * sizeof(packed_data_t));
+	if (!list->ids_by_position || !list->start_bitset || !list->start_summary) {
+		release_cblock_list_position_index(list);
+		return 1;
+	}
+
+	memset(list->ids_by_position, 0, image_size * sizeof(unsigned int));
+	memset(list->start_bitset, 0, bitset_words * sizeof(packed_data_t));
+	memset(list->start_summary, 0, summary_words * sizeof(packed_data_t));
+	list->indexed_start = image_start;
+	list->indexed_size = image_size;
+	return 0;
+}
+
+static int is_position_indexed(const struct MutableCodeBlockList *list, const char *position) {
+	return list->indexed_start && position >= list->indexed_start && position < list->indexed_start + list->indexed_size;
+}
+
+/**
+ * Register the start of the given block in the position index.
+ * If the block is outside the indexed image, the index is discarded, as it could not answer all lookups anymore.
+ */
+static void index_cblock_position(struct MutableCodeBlockList *list, const struct MutableCodeBlock *block) {
+	if (list->indexed_start) {
+		const char *start = get_mcblock_start(block);
+		if (is_position_indexed(list, start)) {
+			const unsigned int offset = start - list->indexed_start;
+			list->ids_by_position[offset] = get_mcblock_id(block) + 1;
+			set_bitset_value(list->start_bitset, offset, 1);
+			set_bitset_value(list->start_summary, offset / BITS_PER_WORD, 1);
 		}
 		else {
-			return -1;
+			release_cblock_list_position_index(list);
 		}
 	}
+}
 
-	if (last < list->block_count && get_mcblock_start(list->sorted_blocks[last]) < get_mcblock_end(new_block)) {
-		return -1;
+/**
+ * Returns the index of the highest bit set in the given word, that must not be 0.
+ */
+static unsigned int highest_set_bit(packed_data_t word) {
+	unsigned int index = 0;
+	while (word >>= 1) {
+		index++;
 	}
 
-	for (i = list->block_count; i > last; i--) {
-		list->sorted_blocks[i] = list->sorted_blocks[i - 1];
+	return index;
+}
+
+/**
+ * Returns the index of the lowest bit set in the given word, that must not be 0.
+ */
+static unsigned int lowest_set_bit(packed_data_t word) {
+	unsigned int index = 0;
+	while (!(word & 1)) {
+		word >>= 1;
+		index++;
 	}
 
-	list->sorted_blocks[last] = new_block;
-	list->block_count++;
+	return index;
+}
 
-	return 0;
+/**
+ * Returns the word in the given bitset keeping only the bits up to the given index, included.
+ */
+static packed_data_t word_bits_up_to(const packed_data_t *bitset, unsigned int index) {
+	const unsigned int bit = index % BITS_PER_WORD;
+	const packed_data_t mask = (bit + 1 < BITS_PER_WORD)? (((packed_data_t) 1) << (bit + 1)) - 1 : ~((packed_data_t) 0);
+	return bitset[index / BITS_PER_WORD] & mask;
 }
 
-static int index_of_cblock_containing_position(const struct MutableCodeBlockList *list, const char *position) {
-	int first = 0;
-	int last = list->block_count;
-	while (last > first) {
-		int index = (first + last) / 2;
-		struct MutableCodeBlock *this_block = list->sorted_blocks[index];
-		const char *this_start = get_mcblock_start(this_block);
-		if (this_start > position) {
-			last = index;
-		}
-		else if (this_start == position) {
-			return index;
+/**
+ * Returns the offset of the nearest block start at or before the given offset in the indexed image, or -1 if there is none.
+ */
+static long indexed_start_at_or_before(const struct MutableCodeBlockList *list, unsigned int offset) {
+	packed_data_t word = word_bits_up_to(list->start_bitset, offset);
+	unsigned int word_index = offset / BITS_PER_WORD;
+
+	if (!word) {
+		packed_data_t summary_word;
+		unsigned int summary_index;
+		if (!word_index) {
+			return -1;
 		}
-		else {
-			if (is_mcblock_end_known(this_block) && position < get_mcblock_end(this_block)) {
-				return index;
-			}
-			else {
-				first = index + 1;
+
+		summary_index = word_index - 1;
+		summary_word = word_bits_up_to(list->start_summary, summary_index);
+		summary_index /= BITS_PER_WORD;
+		while (!summary_word) {
+			if (!summary_index) {
+				return -1;
 			}
+
+			summary_word = list->start_summary[--summary_index];
 		}
+
+		word_index = summary_index * BITS_PER_WORD + highest_set_bit(summary_word);
+		word = list->start_bitset[word_index];
 	}
 
-	return first - 1;
+	return ((long) word_index) * BITS_PER_WORD + highest_set_bit(word);
 }
 
-struct MutableCodeBlock *get_cblock_containing_position(struct MutableCodeBlockList *list, const char *position) {
-	int index = index_of_cblock_containing_position(list, position);
-	return (index < 0)? NULL : list->sorted_blocks[index];
+/**
+ * Returns the word in the given bitset keeping only the bits from the given index, included.
+ */
+static packed_data_t word_bits_from(const packed_data_t *bitset, unsigned int index) {
+	return bitset[index / BITS_PER_WORD] & (~((packed_data_t) 0) << (index % BITS_PER_WORD));
 }
 
-static int index_of_cblock_with_start_equals_or_after(const struct MutableCodeBlockList *list, const char *position) {
-	int first = 0;
-	int last = list->block_count;
+/**
+ * Returns the offset of the nearest block start at or after the given offset in the indexed image, or -1 if there is none.
+ */
+static long indexed_start_at_or_after(const struct MutableCodeBlockList *list, unsigned int offset) {
+	const unsigned int word_count = (list->indexed_size + BITS_PER_WORD - 1) / BITS_PER_WORD;
+	const unsigned int summary_word_count = (word_count + BITS_PER_WORD - 1) / BITS_PER_WORD;
+	unsigned int word_index = offset / BITS_PER_WORD;
+	packed_data_t word;
 
-	while (last > first) {
-		int index = (first + last) / 2;
-		struct MutableCodeBlock *this_block = list->sorted_blocks[index];
-		const char *this_start = get_mcblock_start(this_block);
-		if (this_start > position) {
-			last = index;
-		}
-		else if (this_start == position) {
-			return index;
+	if (offset >= list->indexed_size) {
+		return -1;
+	}
+
+	word = word_bits_from(list->start_bitset, offset);
+	if (!word) {
+		packed_data_t summary_word;
+		unsigned int summary_index = word_index + 1;
+		if (summary_index >= word_count) {
+			return -1;
 		}
-		else {
-			first = index + 1;
+
+		summary_word = word_bits_from(list->start_summary, summary_index);
+		summary_index /= BITS_PER_WORD;
+		while (!summary_word) {
+			if (++summary_index >= summary_word_count) {
+				return -1;
+			}
+
+			summary_word = list->start_summary[summary_index];
 		}
+
+		word_index = summary_index * BITS_PER_WORD + lowest_set_bit(summary_word);
+		word = list->start_bitset[word_index];
 	}
 
-	return (last < list->block_count)? last : -1;
+	return ((long) word_index) * BITS_PER_WORD + lowest_set_bit(word);
+}
+
+/**
+ * Returns the block starting at the given offset of the indexed image, or NULL if the offset is negative.
+ */
+static struct MutableCodeBlock *get_indexed_cblock(const struct MutableCodeBlockList *list, long offset) {
+	return (offset < 0)? NULL : get_unsorted_cblock(list, list->ids_by_position[offset] - 1);
+}
+
+struct MutableCodeBlock *get_cblock_with_id(const struct MutableCodeBlockList *list, unsigned int id) {
+	assert(id < list->block_count);
+	return get_unsorted_cblock(list, id);
+}
+
+/**
+ * Returns the block at the position returned by locate_cblock_in_chunks, or the first one in the following chunk
+ * if the position is at the end of its chunk. This returns NULL if there is no block at or after that position.
+ */
+static struct MutableCodeBlock *get_located_cblock(const struct MutableCodeBlockList *list, unsigned int chunk_index, unsigned int item_index) {
+	if (chunk_index < list->chunk_count && item_index < list->chunks[chunk_index]->count) {
+		return list->chunks[chunk_index]->items[item_index];
+	}
+
+	return (chunk_index + 1 < list->chunk_count)? list->chunks[chunk_index + 1]->items[0] : NULL;
+}
+
+int index_of_cblock_with_start(const struct MutableCodeBlockList *list, const char *start) {
+	unsigned int chunk_index;
+	unsigned int item_index;
+
+	/* The position index answers negative lookups without searching */
+	if (is_position_indexed(list, start) && !list->ids_by_position[start - list->indexed_start]) {
+		return -1;
+	}
+
+	if (locate_cblock_in_chunks(list, start, &chunk_index, &item_index)) {
+		return get_cblock_chunk_offset(list, chunk_index) + item_index;
+	}
+
+	return -1;
+}
+
+int insert_cblock(struct MutableCodeBlockList *list, struct MutableCodeBlock *new_block) {
+	const struct MutableCodeBlock *next_block;
+	unsigned int chunk_index;
+	unsigned int item_index;
+	int error_code;
+	log_cblock_insertion(new_block);
+	if (locate_cblock_in_chunks(list, get_mcblock_start(new_block), &chunk_index, &item_index)) {
+		return -1;
+	}
+
+	next_block = get_located_cblock(list, chunk_index, item_index);
+	if (next_block && get_mcblock_start(next_block) < get_mcblock_end(new_block)) {
+		return -1;
+	}
+
+	/* This is always the position where prepare_new_cblock placed the block, so it matches the allocation order */
+	assert(new_block == get_unsorted_cblock(list, list->block_count));
+	new_block->id = list->block_count;
+	if ((error_code = insert_cblock_at(list, new_block, chunk_index, item_index))) {
+		return error_code;
+	}
+
+	index_cblock_position(list, new_block);
+	return 0;
+}
+
+static int index_of_cblock_containing_position(const struct MutableCodeBlockList *list, const char *position) {
+	unsigned int chunk_index;
+	unsigned int item_index;
+	int index;
+	const int found = locate_cblock_in_chunks(list, position, &chunk_index, &item_index);
+	if (!list->chunk_count) {
+		return -1;
+	}
+
+	/* Blocks never overlap, so the only candidate is the nearest one starting at or before the position */
+	index = get_cblock_chunk_offset(list, chunk_index) + item_index;
+	return found? index : index - 1;
+}
+
+struct MutableCodeBlock *get_cblock_containing_position(const struct MutableCodeBlockList *list, const char *position) {
+	int index;
+	if (is_position_indexed(list, position)) {
+		return get_indexed_cblock(list, indexed_start_at_or_before(list, position - list->indexed_start));
+	}
+
+	index = index_of_cblock_containing_position(list, position);
+	return (index < 0)? NULL : get_sorted_cblock(list, index);
 }
 
 struct MutableCodeBlock *get_cblock_with_start_equals_or_after(const struct MutableCodeBlockList *list, const char *position) {
-	int index = index_of_cblock_with_start_equals_or_after(list, position);
-	return (index < 0)? NULL : list->sorted_blocks[index];
+	unsigned int chunk_index;
+	unsigned int item_index;
+	if (is_position_indexed(list, position)) {
+		return get_indexed_cblock(list, indexed_start_at_or_after(list, position - list->indexed_start));
+	}
+
+	locate_cblock_in_chunks(list, position, &chunk_index, &item_index);
+	return get_located_cblock(list, chunk_index, item_index);
 }
 
-int index_of_cblock_in_list(const struct MutableCodeBlockList *list, const struct MutableCodeBlock *block) {
-	return index_of_cblock_with_start(list, get_mcblock_start(block));
+struct MutableCodeBlock *get_cblock_with_start(const struct MutableCodeBlockList *list, const char *start) {
+	int index;
+	if (is_position_indexed(list, start)) {
+		const unsigned int id_plus_one = list->ids_by_position[start - list->indexed_start];
+		return id_plus_one? get_unsorted_cblock(list, id_plus_one - 1) : NULL;
+	}
+
+	index = index_of_cblock_with_start(list, start);
+	return (index < 0)? NULL : get_sorted_cblock(list, index);
+}
+
+struct MutableCodeBlock *get_next_cblock(const struct MutableCodeBlockList *list, const struct MutableCodeBlock *block) {
+	return get_cblock_with_start_equals_or_after(list, get_mcblock_start(block) + 1);
 }
 
-int index_of_cblock_containing_origin_instruction(const struct MutableCodeBlockList *list, const struct CodeBlockOrigin *origin) {
-	return index_of_cblock_containing_position(list, get_cborigin_instruction(origin));
+struct MutableCodeBlock *get_previous_cblock(const struct MutableCodeBlockList *list, const struct MutableCodeBlock *block) {
+	const char *start = get_mcblock_start(block);
+	int index;
+	if (is_position_indexed(list, start)) {
+		return (start == list->indexed_start)? NULL : get_indexed_cblock(list, indexed_start_at_or_before(list, start - list->indexed_start - 1));
+	}
+
+	index = index_of_cblock_with_start(list, start);
+	assert(index >= 0 && get_sorted_cblock(list, index) == block);
+	return (index > 0)? get_sorted_cblock(list, index - 1) : NULL;
 }
 
 #ifdef DEBUG
@@ -119,7 +362,7 @@ void print_cblist(const struct MutableCodeBlockList *list) {
 	int i;
 	fprintf(stderr, "CodeBlockList(");
 	for (i = 0; i < list->block_count; i++) {
-		const struct MutableCodeBlock *block = list->sorted_blocks[i];
+		const struct MutableCodeBlock *block = get_sorted_cblock(list, i);
 		const struct CodeBlockOriginList *origin_list = &block->origin_list;
 		int origin_index;
 		if (i > 0) {
@@ -4,9 +4,115 @@
 #include "mcblock.h"
 #include "slmacros.h"
 
-DEFINE_STRUCT_LIST(MutableCodeBlock, block);
+#include "packed.h"
+
+struct StateCheckpointTrail;
+struct CheckedBlocks;
+
+DEFINE_STRUCT_CHUNKED_LIST_CHUNK(MutableCodeBlock);
+
+/**
+ * Complex structure containing pages of MutableCodeBlock.
+ * It is designed to grow as more blocks are added to it, keeping them sorted in chunks like chunked struct lists do.
+ *
+ * Optionally, it can index the position of all blocks within the image, making lookups by position O(1),
+ * and lookups of the nearest block before or after a position a scan of a few words of its bitsets.
+ * Lookups for positions outside the indexed image, or when the index is not built, fall back to a binary search.
+ */
+struct MutableCodeBlockList {
+	/**
+	 * Array holding all allocated pages in the order they have been allocated.
+	 * This will be NULL when block_count is 0.
+	 */
+	struct MutableCodeBlock **page_array;
+
+	/**
+	 * Chunks of blocks, sorted by its start. Blocks in a chunk are always sorted before the ones in the following chunks.
+	 * No chunk is empty, except the first one when the list is empty.
+	 */
+	struct MutableCodeBlockListChunk **chunks;
+
+	/**
+	 * Fenwick tree with the number of blocks in each chunk.
+	 * Entry i holds the number of blocks in the chunks from i + 1 - (lowest set bit of i + 1) to i, both included.
+	 */
+	unsigned int *chunk_count_tree;
+
+	unsigned int chunk_count;
+
+	/**
+	 * Number of chunks that chunks and chunk_count_tree can hold without reallocating them.
+	 */
+	unsigned int chunk_capacity;
+
+	/**
+	 * Number of blocks already inserted.
+	 * Note that this value is most of the times lower than the actual capacity allocated in memory
+	 * to hold all of them.
+	 */
+	unsigned int block_count;
+
+	/**
+	 * Arena where all pages and arrays are allocated, or NULL to allocate them directly with malloc.
+	 */
+	struct Arena *arena;
+
+	/**
+	 * First position of the indexed image, or NULL if there is no position index.
+	 */
+	const char *indexed_start;
+	unsigned int indexed_size;
+
+	/**
+	 * Id plus one of the block starting at each position of the indexed image, or 0 if no block starts there.
+	 */
+	unsigned int *ids_by_position;
+
+	/**
+	 * Bitset with set bits for each position of the indexed image where a block starts.
+	 */
+	packed_data_t *start_bitset;
+
+	/**
+	 * Bitset with a set bit for each word in start_bitset that is not 0.
+	 */
+	packed_data_t *start_summary;
+
+	/**
+	 * Checkpoints of the block currently being evaluated, or NULL if they are not recorded.
+	 * When a block is split, this allows giving the state at the split point directly to the new block.
+	 */
+	struct StateCheckpointTrail *checkpoint_trail;
+
+	/**
+	 * Scratch buffer for walking backwards through block origins while evaluating a block.
+	 * This must be set before evaluating any block that returns or prints a message.
+	 */
+	struct CheckedBlocks *checked_blocks;
+
+	/**
+	 * Store where the states of all block origins are interned, so that origins reached with the same state share it.
+	 * This must be set before adding any block.
+	 */
+	struct StateSnapshotStore *snapshots;
+};
+
 DECLARE_STRUCT_LIST_METHODS(MutableCodeBlock, cblock, block, start);
 
+/**
+ * Build an index for all blocks starting within the given image.
+ * This must be called before inserting any block.
+ *
+ * This method may require allocating memory. It will return 0 on success, or any other value on failure.
+ * On failure, the list is still usable, but lookups by position will not be indexed.
+ */
+int index_cblock_list_positions(struct MutableCodeBlockList *list, const char *image_start, unsigned int image_size);
+
+/**
+ * Returns the block with the given id, which matches its index in allocation order.
+ */
+struct MutableCodeBlock *get_cblock_with_id(const struct MutableCodeBlockList *list, unsigned int id);
+
 /**
  * Returns a pointer to the code block containing the given position, or NULL if none matches.
  *
@@ -18,7 +124,7 @@ DECLARE_STRUCT_LIST_METHODS(MutableCodeBlock, cblock, block, start);
  *
  * This method will return NULL if there are not blocks in the list, or none of them include the given position.
  */
-struct MutableCodeBlock *get_cblock_containing_position(struct MutableCodeBlockList *list, const char *position);
+struct MutableCodeBlock *get_cblock_containing_position(const struct MutableCodeBlockList *list, const char *position);
 
 /**
  * Returns a pointer to the code block whose start is equal or just after the given position.
@@ -48,25 +154,27 @@ struct MutableCodeBlock *get_cblock_with_start_equals_or_after(const struct Muta
  *
  * If the given block is valid and not overlapping any of the existing blocks in the list,
  * this method will insert the block in the list in its suitable position. As result,
- * the block_count property will be increased by 1, and the sorted_blocks will be updated
+ * the block_count property will be increased by 1, and the sorted chunks will be updated
  * accordingly.
  */
 int insert_cblock(struct MutableCodeBlockList *list, struct MutableCodeBlock *new_block);
 
 /**
- * Return the sorted index of the given block within this list, or -1 if the block is not present.
- *
- * This method will not compare the given block with any potential block found in the list.
- * It will just pick the start of the block in order to check for it in the list, ignoring the rest of values.
+ * Returns a pointer to the code block starting at the given position, or NULL if none of the blocks in the list starts there.
  */
-int index_of_cblock_in_list(const struct MutableCodeBlockList *list, const struct MutableCodeBlock *block);
+struct MutableCodeBlock *get_cblock_with_start(const struct MutableCodeBlockList *list, const char *start);
 
 /**
- * Return the sorted index of the block containing the origin JMP or CALL instruction, or -1 if none of the blocks in the list contains it.
- *
- * This method assumes that the given origin has type JUMP, and so, its instruction can be retrieved.
+ * Returns a pointer to the code block sorted just after the given one, or NULL if it is the last one.
+ * The given block must have been inserted in this list.
+ */
+struct MutableCodeBlock *get_next_cblock(const struct MutableCodeBlockList *list, const struct MutableCodeBlock *block);
+
+/**
+ * Returns a pointer to the code block sorted just before the given one, or NULL if it is the first one.
+ * The given block must have been inserted in this list.
  */
-int index_of_cblock_containing_origin_instruction(const struct MutableCodeBlockList *list, const struct CodeBlockOrigin *origin);
+struct MutableCodeBlock *get_previous_cblock(const struct MutableCodeBlockList *list, const struct MutableCodeBlock *block);
 
 #ifdef DEBUG
 void print_cblist(const struct MutableCodeBlockList *list);
@@ -3,14 +3,31 @@
 
 #define CODE_BLOCK_FLAG_VALID_EVALUATION 1
 #define CODE_BLOCK_FLAG_UNDER_EVALUATION 2
+#define CODE_BLOCK_FLAG_WIDENED 4
 
-void initialize_mcblock(struct MutableCodeBlock *block, unsigned int relative_cs, unsigned int ip, const char *start) {
+int initialize_mcblock(struct MutableCodeBlock *block, struct Arena *arena, struct StateSnapshotStore *snapshots, unsigned int relative_cs, unsigned int ip, const char *start) {
 	block->relative_cs = relative_cs;
 	block->ip = ip;
 	block->start = start;
 	block->end = start;
 	block->flags = 0;
-	initialize_cborigin_list(&block->origin_list);
+	block->evaluation_count = 0;
+	initialize_cborigin_list_in_arena(&block->origin_list, arena);
+	block->origin_list.snapshots = snapshots;
+	block->joined_provenance = NULL;
+	initialize_stack_in_arena(&block->joined_stack, arena);
+	initialize_gvwvmap_in_arena(&block->joined_var_values, arena);
+	block->joined_origin_count = 0;
+	block->id = 0;
+	block->work_list = NULL;
+
+	if (snapshots->track_provenance && !(block->joined_provenance = allocate_in_arena(arena, sizeof(struct RegisterProvenance)))) {
+		initialize_registers(&block->joined_regs, NULL);
+		return 1;
+	}
+
+	initialize_registers(&block->joined_regs, block->joined_provenance);
+	return 0;
 }
 
 unsigned int get_mcblock_relative_cs(const struct MutableCodeBlock *block) {
@@ -25,6 +42,50 @@ const char *get_mcblock_start(const struct MutableCodeBlock *block) {
 	return block->start;
 }
 
+unsigned int get_mcblock_id(const struct MutableCodeBlock *block) {
+	return block->id;
+}
+
+int update_mcblock_joined_state(struct MutableCodeBlock *block) {
+	const struct CodeBlockOriginList *origin_list = &block->origin_list;
+	int error_code;
+	for (; block->joined_origin_count < origin_list->origin_count; block->joined_origin_count++) {
+		struct CodeBlockOrigin *origin = get_unsorted_cborigin(origin_list, block->joined_origin_count);
+		if (block->joined_origin_count == 0) {
+			copy_registers(&block->joined_regs, get_cborigin_registers(origin));
+			if ((error_code = copy_stack(&block->joined_stack, get_cborigin_stack(origin))) ||
+					(error_code = copy_gvwvmap(&block->joined_var_values, get_cborigin_var_values(origin)))) {
+				return error_code;
+			}
+		}
+		else {
+			merge_registers(&block->joined_regs, get_cborigin_registers(origin));
+			if ((error_code = merge_stacks(&block->joined_stack, get_cborigin_stack(origin))) ||
+					(error_code = merge_gvwvmap(&block->joined_var_values, get_cborigin_var_values(origin)))) {
+				return error_code;
+			}
+		}
+	}
+
+	return 0;
+}
+
+const struct Registers *get_mcblock_joined_registers(const struct MutableCodeBlock *block) {
+	return &block->joined_regs;
+}
+
+const struct Stack *get_mcblock_joined_stack(const struct MutableCodeBlock *block) {
+	return &block->joined_stack;
+}
+
+const struct GlobalVariableWordValueMap *get_mcblock_joined_var_values(const struct MutableCodeBlock *block) {
+	return &block->joined_var_values;
+}
+
+void set_mcblock_work_list(struct MutableCodeBlock *block, struct MutableCodeBlockWorkList *work_list) {
+	block->work_list = work_list;
+}
+
 int is_mcblock_end_known(const struct MutableCodeBlock *block) {
 	return block->end > block->start;
 }
@@ -73,6 +134,7 @@ int mcblock_requires_evaluation(struct MutableCodeBlock *block) {
 
 void mark_mcblock_as_being_evaluated(struct MutableCodeBlock *block) {
 	block->flags |= CODE_BLOCK_FLAG_UNDER_EVALUATION | CODE_BLOCK_FLAG_VALID_EVALUATION;
+	block->evaluation_count++;
 }
 
 void mark_mcblock_as_evaluated(struct MutableCodeBlock *block) {
@@ -81,46 +143,180 @@ void mark_mcblock_as_evaluated(struct MutableCodeBlock *block) {
 
 void invalidate_mcblock_check(struct MutableCodeBlock *block) {
 	block->flags &= ~CODE_BLOCK_FLAG_VALID_EVALUATION;
+	if (block->work_list) {
+		push_mcblock_in_mcbwlist(block->work_list, block);
+	}
+}
+
+int is_mcblock_widened(const struct MutableCodeBlock *block) {
+	return block->flags & CODE_BLOCK_FLAG_WIDENED;
+}
+
+/**
+ * Return the stats where merges and checks on this block are counted, or NULL if they are not counted.
+ */
+static struct AnalysisStats *get_mcblock_stats(const struct MutableCodeBlock *block) {
+	return block->origin_list.snapshots->stats;
+}
+
+static int changes_on_merging_state(
+		const struct MutableCodeBlock *block,
+		const struct Registers *target_regs,
+		const struct Stack *target_stack,
+		const struct GlobalVariableWordValueMap *target_var_values,
+		const struct Registers *regs,
+		const struct Stack *stack,
+		const struct GlobalVariableWordValueMap *var_values) {
+	struct AnalysisStats *stats = get_mcblock_stats(block);
+	if (regs) {
+		STATS_INCREMENT(stats, register_change_checks);
+		if (changes_on_merging_registers(target_regs, regs)) {
+			return 1;
+		}
+	}
+
+	if (stack) {
+		STATS_INCREMENT(stats, stack_change_checks);
+		if (changes_on_merging_stacks(target_stack, stack)) {
+			return 1;
+		}
+	}
+
+	if (var_values) {
+		STATS_INCREMENT(stats, gvwvmap_change_checks);
+		if (changes_on_merging_gvwvmap(target_var_values, var_values)) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+int changes_on_merging_state_in_mcblock_origin(const struct MutableCodeBlock *block, const struct CodeBlockOrigin *origin, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
+	return changes_on_merging_state(block, get_cborigin_registers(origin), get_cborigin_stack(origin), get_cborigin_var_values(origin), regs, stack, var_values);
+}
+
+int changes_on_joining_state_in_mcblock(const struct MutableCodeBlock *block, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
+	return changes_on_merging_state(block, &block->joined_regs, &block->joined_stack, &block->joined_var_values, regs, stack, var_values);
+}
+
+static int should_widen_mcblock(const struct MutableCodeBlock *block) {
+	return block->work_list && block->work_list->widening_threshold &&
+			block->evaluation_count >= block->work_list->widening_threshold;
 }
 
-int add_interruption_type_cborigin_in_mcblock(struct MutableCodeBlock *block, const struct Registers *regs, const struct GlobalVariableWordValueMap *var_values) {
+int merge_state_in_mcblock_origin(struct MutableCodeBlock *block, struct CodeBlockOrigin *origin, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
+	struct Registers *origin_regs;
+	struct Stack *origin_stack;
+	struct GlobalVariableWordValueMap *origin_var_values;
+	struct AnalysisStats *stats = get_mcblock_stats(block);
+	int error_code;
+
+	if ((error_code = prepare_cborigin_for_update(origin, block->origin_list.snapshots))) {
+		return error_code;
+	}
+
+	origin_regs = get_cborigin_writable_registers(origin);
+	origin_stack = get_cborigin_writable_stack(origin);
+	origin_var_values = get_cborigin_writable_var_values(origin);
+
+	if (should_widen_mcblock(block)) {
+		const unsigned int defined_count =
+				(regs? count_defined_in_registers(origin_regs) : 0) +
+				(stack? count_defined_in_stack(origin_stack) : 0) +
+				(var_values? count_defined_in_gvwvmap(origin_var_values) : 0);
+
+		if (regs) {
+			STATS_INCREMENT(stats, register_widenings);
+			widen_registers(origin_regs, regs);
+		}
+
+		if (stack) {
+			STATS_INCREMENT(stats, stack_widenings);
+		}
+
+		if (var_values) {
+			STATS_INCREMENT(stats, gvwvmap_widenings);
+		}
+
+		if ((stack && (error_code = widen_stacks(origin_stack, stack))) ||
+				(var_values && (error_code = widen_gvwvmap(origin_var_values, var_values)))) {
+			return error_code;
+		}
+
+		/* Widened origins are joined again from scratch on the next update */
+		block->joined_origin_count = 0;
+		if ((regs? count_defined_in_registers(origin_regs) : 0) +
+				(stack? count_defined_in_stack(origin_stack) : 0) +
+				(var_values? count_defined_in_gvwvmap(origin_var_values) : 0) < defined_count) {
+			if (!(block->flags & CODE_BLOCK_FLAG_WIDENED)) {
+				block->flags |= CODE_BLOCK_FLAG_WIDENED;
+				register_widened_mcblock_in_mcbwlist(block->work_list);
+			}
+
+			invalidate_mcblock_check(block);
+		}
+	}
+	else {
+		if (regs) {
+			STATS_INCREMENT(stats, register_merges);
+			merge_registers(origin_regs, regs);
+		}
+
+		if (stack) {
+			STATS_INCREMENT(stats, stack_merges);
+		}
+
+		if (var_values) {
+			STATS_INCREMENT(stats, gvwvmap_merges);
+		}
+
+		if ((stack && (error_code = merge_stacks(origin_stack, stack))) ||
+				(var_values && (error_code = merge_gvwvmap(origin_var_values, var_values)))) {
+			return error_code;
+		}
+
+		if (block->joined_origin_count) {
+			if (regs) {
+				merge_registers(&block->joined_regs, regs);
+			}
+
+			if ((stack && (error_code = merge_stacks(&block->joined_stack, stack))) ||
+					(var_values && (error_code = merge_gvwvmap(&block->joined_var_values, var_values)))) {
+				return error_code;
+			}
+		}
+
+		invalidate_mcblock_check(block);
+	}
+
+	return 0;
+}
+
+int add_interruption_type_cborigin_in_mcblock(struct MutableCodeBlock *block, const char *instruction, const struct Registers *regs, const struct GlobalVariableWordValueMap *var_values) {
 	struct CodeBlockOriginList *origin_list = &block->origin_list;
 	int error_code;
 	int index = index_of_cborigin_with_type_interruption(origin_list);
 	if (index < 0) {
-		struct Registers accumulated_regs;
-		struct Stack accumulated_stack;
 		struct CodeBlockOrigin *new_origin;
-		struct GlobalVariableWordValueMap accumulated_var_values;
-		if (origin_list->origin_count) {
-			accumulate_registers_from_cbolist(&accumulated_regs, origin_list);
-			if ((error_code = accumulate_stack_from_cbolist(&accumulated_stack, origin_list)) ||
-					(error_code = accumulate_gvwvmap_from_cbolist(&accumulated_var_values, origin_list))) {
-				return error_code;
-			}
+		if ((error_code = update_mcblock_joined_state(block))) {
+			return error_code;
 		}
 
 		new_origin = prepare_new_cborigin(origin_list);
-		if ((error_code = initialize_cborigin_as_interruption(new_origin, regs, var_values)) ||
+		if ((error_code = initialize_cborigin_as_interruption(new_origin, origin_list->snapshots, instruction, regs, var_values)) ||
 				(error_code = insert_cborigin(origin_list, new_origin))) {
 			return error_code;
 		}
 
-		if (origin_list->origin_count > 1 && (changes_on_merging_registers(&accumulated_regs, regs) || changes_on_merging_gvwvmap(&accumulated_var_values, var_values))) {
+		if (origin_list->origin_count > 1 && changes_on_joining_state_in_mcblock(block, regs, NULL, var_values)) {
 			invalidate_mcblock_check(block);
 		}
 	}
 	else {
 		struct CodeBlockOrigin *origin = origin_list->sorted_origins[index];
-		struct Registers *origin_regs = get_cborigin_registers(origin);
-		struct GlobalVariableWordValueMap *origin_var_values = get_cborigin_var_values(origin);
-		if (changes_on_merging_registers(origin_regs, regs) || changes_on_merging_gvwvmap(origin_var_values, var_values)) {
-			merge_registers(origin_regs, regs);
-			if ((error_code = merge_gvwvmap(origin_var_values, var_values))) {
-				return error_code;
-			}
-
-			invalidate_mcblock_check(block);
+		if (changes_on_merging_state_in_mcblock_origin(block, origin, regs, NULL, var_values)) {
+			return merge_state_in_mcblock_origin(block, origin, regs, NULL, var_values);
 		}
 	}
 
@@ -136,42 +332,23 @@ int add_continue_type_cborigin_in_mcblock(struct MutableCodeBlock *block, const
 	index = index_of_cborigin_of_type_continue(origin_list);
 	if (index < 0) {
 		struct CodeBlockOrigin *new_origin = prepare_new_cborigin(origin_list);
-		struct Registers accumulated_regs;
-		struct Stack accumulated_stack;
-		struct GlobalVariableWordValueMap accumulated_var_values;
-
-		if ((error_code = initialize_cborigin_as_continue(new_origin, regs, stack, var_values))) {
+		if ((error_code = initialize_cborigin_as_continue(new_origin, origin_list->snapshots, regs, stack, var_values)) ||
+				(error_code = update_mcblock_joined_state(block))) {
 			return error_code;
 		}
 
-		if (origin_list->origin_count) {
-			accumulate_registers_from_cbolist(&accumulated_regs, origin_list);
-			if ((error_code = accumulate_stack_from_cbolist(&accumulated_stack, origin_list)) ||
-					(error_code = accumulate_gvwvmap_from_cbolist(&accumulated_var_values, origin_list))) {
-				return error_code;
-			}
-		}
-
 		if ((error_code = insert_cborigin(origin_list, new_origin))) {
 			return error_code;
 		}
 
-		if (origin_list->origin_count > 1 && (changes_on_merging_registers(&accumulated_regs, regs) || changes_on_merging_stacks(&accumulated_stack, stack) || changes_on_merging_gvwvmap(&accumulated_var_values, var_values))) {
+		if (origin_list->origin_count > 1 && changes_on_joining_state_in_mcblock(block, regs, stack, var_values)) {
 			invalidate_mcblock_check(block);
 		}
 	}
 	else {
 		struct CodeBlockOrigin *origin = origin_list->sorted_origins[index];
-		struct Registers *origin_regs = get_cborigin_registers(origin);
-		struct Stack *origin_stack = get_cborigin_stack(origin);
-		struct GlobalVariableWordValueMap *origin_var_values = get_cborigin_var_values(origin);
-		if (changes_on_merging_registers(origin_regs, regs) || changes_on_merging_stacks(origin_stack, stack) || changes_on_merging_gvwvmap(origin_var_values, var_values)) {
-			merge_registers(origin_regs, regs);
-			merge_stacks(origin_stack, stack);
-			if ((error_code = merge_gvwvmap(origin_var_values, var_values))) {
-				return error_code;
-			}
-			invalidate_mcblock_check(block);
+		if (changes_on_merging_state_in_mcblock_origin(block, origin, regs, stack, var_values)) {
+			return merge_state_in_mcblock_origin(block, origin, regs, stack, var_values);
 		}
 	}
 
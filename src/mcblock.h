@@ -3,6 +3,7 @@
 
 #include "cbolist.h"
 #include "cblock.h"
+#include "mcbwlist.h"
 
 /**
  * Structure reflecting a piece of code whose instructions are always executed one after the other, except due to interruptions not explicitly called.
@@ -22,21 +23,85 @@ struct MutableCodeBlock {
 
 	unsigned int flags;
 
+	/**
+	 * Number of times this block has started being evaluated.
+	 */
+	unsigned int evaluation_count;
+
 	/**
 	 * List of origins found for this code block.
 	 */
 	struct CodeBlockOriginList origin_list;
+
+	/**
+	 * Dense identifier assigned by the list when this block is inserted, matching its allocation order.
+	 * It never changes once assigned, and it is also used by the work list this block is attached to.
+	 */
+	unsigned int id;
+
+	/**
+	 * State resulting of merging the first joined_origin_count origins of this block, in the order they were inserted.
+	 * Origins inserted after that are merged into it the next time the joined state is requested,
+	 * and states merged into already joined origins are merged into it as well, so it never requires merging all origins again.
+	 */
+	struct Registers joined_regs;
+	struct Stack joined_stack;
+	struct GlobalVariableWordValueMap joined_var_values;
+	unsigned int joined_origin_count;
+
+	/**
+	 * Provenance of the joined registers, or NULL if the store of origin states does not track it.
+	 */
+	struct RegisterProvenance *joined_provenance;
+
+	/**
+	 * Work list where this block will be pushed each time its evaluation gets invalidated,
+	 * or NULL if this block is not attached to any work list yet.
+	 */
+	struct MutableCodeBlockWorkList *work_list;
 };
 
 /**
  * Initialize the CodeBlock structure with the given start.
  * This will intialize the block with unknown end. End must be adjusted once we know where it is.
+ * Its origin list will take memory from the given arena, that can be NULL, and the states of its origins from the given store.
+ * This method may require allocating memory if the store tracks provenance. It will return 0 on success, or any other value on failure.
  */
-void initialize_mcblock(struct MutableCodeBlock *block, unsigned int relative_cs, unsigned int ip, const char *start);
+int initialize_mcblock(struct MutableCodeBlock *block, struct Arena *arena, struct StateSnapshotStore *snapshots, unsigned int relative_cs, unsigned int ip, const char *start);
 
 unsigned int get_mcblock_relative_cs(const struct MutableCodeBlock *block);
 unsigned int get_mcblock_ip(const struct MutableCodeBlock *block);
 const char *get_mcblock_start(const struct MutableCodeBlock *block);
+unsigned int get_mcblock_id(const struct MutableCodeBlock *block);
+
+/**
+ * Merge into the joined state of this block all origins inserted since the last time it was updated.
+ * This must be called before any of the get_mcblock_joined methods, and after any origin is inserted.
+ * Returns 0 on success, or any other value if memory cannot be allocated.
+ */
+int update_mcblock_joined_state(struct MutableCodeBlock *block);
+
+/**
+ * Returns the registers resulting of merging all origins of this block, as they were on the last call to update_mcblock_joined_state.
+ * These are the registers that should be assumed at the start of the block when evaluating it.
+ */
+const struct Registers *get_mcblock_joined_registers(const struct MutableCodeBlock *block);
+
+/**
+ * Returns the stack resulting of merging all origins of this block, as they were on the last call to update_mcblock_joined_state.
+ */
+const struct Stack *get_mcblock_joined_stack(const struct MutableCodeBlock *block);
+
+/**
+ * Returns the global variable values resulting of merging all origins of this block, as they were on the last call to update_mcblock_joined_state.
+ */
+const struct GlobalVariableWordValueMap *get_mcblock_joined_var_values(const struct MutableCodeBlock *block);
+
+/**
+ * Set the work list where this block will be pushed on invalidation.
+ * This should be only called by the work list itself when attaching the block.
+ */
+void set_mcblock_work_list(struct MutableCodeBlock *block, struct MutableCodeBlockWorkList *work_list);
 
 /**
  * Whether the end of the block is known.
@@ -107,9 +172,45 @@ int mcblock_requires_evaluation(struct MutableCodeBlock *block);
 
 void mark_mcblock_as_being_evaluated(struct MutableCodeBlock *block);
 void mark_mcblock_as_evaluated(struct MutableCodeBlock *block);
+
+/**
+ * Mark this block as requiring a new evaluation.
+ * If the block is attached to a work list, it will be pushed into it.
+ */
 void invalidate_mcblock_check(struct MutableCodeBlock *block);
 
-int add_interruption_type_cborigin_in_mcblock(struct MutableCodeBlock *block, const struct Registers *regs, const struct GlobalVariableWordValueMap *var_values);
+/**
+ * Whether the origins of this block have been widened at least once.
+ */
+int is_mcblock_widened(const struct MutableCodeBlock *block);
+
+/**
+ * Merge the given state into the given origin of this block, and invalidate the block accordingly.
+ *
+ * Callers should only call this method after checking that merging will result in changes.
+ * Any of regs, stack or var_values can be NULL if that part of the state should not be merged.
+ *
+ * Once this block has been evaluated as many times as the widening threshold of its work list,
+ * the state will be widened instead of merged, and the block will only be invalidated if widening
+ * actually undefines anything. As widening can only undefine values, this ensures that the block
+ * will be evaluated a bounded number of times.
+ */
+int merge_state_in_mcblock_origin(struct MutableCodeBlock *block, struct CodeBlockOrigin *origin, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values);
+
+/**
+ * Whether merging the given state into the given origin of this block would change the origin.
+ * Any of regs, stack or var_values can be NULL if that part of the state should not be checked.
+ * Parts are checked in that order, and checking stops at the first one that would change.
+ */
+int changes_on_merging_state_in_mcblock_origin(const struct MutableCodeBlock *block, const struct CodeBlockOrigin *origin, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values);
+
+/**
+ * Whether merging the given state into the joined state of this block would change it.
+ * Any of regs, stack or var_values can be NULL if that part of the state should not be checked.
+ */
+int changes_on_joining_state_in_mcblock(const struct MutableCodeBlock *block, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values);
+
+int add_interruption_type_cborigin_in_mcblock(struct MutableCodeBlock *block, const char *instruction, const struct Registers *regs, const struct GlobalVariableWordValueMap *var_values);
 int add_continue_type_cborigin_in_mcblock(struct MutableCodeBlock *block, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values);
 int add_call_return_type_cborigin_in_mcblock(struct MutableCodeBlock *block, unsigned int behind_count, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values);
 
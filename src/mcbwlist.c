@@ -0,0 +1,260 @@
+#include "mcbwlist.h"
+#include "mcblock.h"
+#include "arena.h"
+#include <assert.h>
+#include <stdlib.h>
+
+#define MCBWLIST_CAPACITY_GRANULARITY 64
+#define MCBWLIST_ITERATION_GRANULARITY 8
+
+void initialize_mcbwlist_in_arena(struct MutableCodeBlockWorkList *list, struct Arena *arena) {
+	list->current = NULL;
+	list->next = NULL;
+	list->current_count = 0;
+	list->next_count = 0;
+	list->attached_count = 0;
+	list->capacity = 0;
+	list->queued = NULL;
+	list->last_picked = NULL;
+	list->picked_counts = NULL;
+	list->iteration_count = 0;
+	list->iteration_capacity = 0;
+	list->order = MCBWLIST_ORDER_ALLOCATION;
+	list->iterating = 0;
+	list->widening_threshold = MCBWLIST_DEFAULT_WIDENING_THRESHOLD;
+	list->iteration_limit = MCBWLIST_DEFAULT_ITERATION_LIMIT;
+	list->extra_pass_count = 0;
+	list->widened_count = 0;
+	list->stats = NULL;
+	list->arena = arena;
+}
+
+void initialize_mcbwlist(struct MutableCodeBlockWorkList *list) {
+	initialize_mcbwlist_in_arena(list, NULL);
+}
+
+void set_mcbwlist_order(struct MutableCodeBlockWorkList *list, unsigned int order) {
+	assert(list->attached_count == 0);
+	list->order = order;
+}
+
+void set_mcbwlist_widening_threshold(struct MutableCodeBlockWorkList *list, unsigned int threshold) {
+	list->widening_threshold = threshold;
+}
+
+void set_mcbwlist_iteration_limit(struct MutableCodeBlockWorkList *list, unsigned int limit) {
+	list->iteration_limit = limit;
+}
+
+void set_mcbwlist_extra_pass_count(struct MutableCodeBlockWorkList *list, unsigned int count) {
+	list->extra_pass_count = count;
+}
+
+static int is_mcblock_picked_before(const struct MutableCodeBlockWorkList *list, const struct MutableCodeBlock *a, const struct MutableCodeBlock *b) {
+	if (list->order == MCBWLIST_ORDER_START) {
+		return get_mcblock_start(a) < get_mcblock_start(b);
+	}
+	else {
+		return get_mcblock_id(a) < get_mcblock_id(b);
+	}
+}
+
+static void push_in_heap(const struct MutableCodeBlockWorkList *list, struct MutableCodeBlock **heap, unsigned int *count, struct MutableCodeBlock *block) {
+	unsigned int index = (*count)++;
+	while (index > 0) {
+		const unsigned int parent = (index - 1) / 2;
+		if (!is_mcblock_picked_before(list, block, heap[parent])) {
+			break;
+		}
+
+		heap[index] = heap[parent];
+		index = parent;
+	}
+
+	heap[index] = block;
+}
+
+static struct MutableCodeBlock *pop_from_heap(const struct MutableCodeBlockWorkList *list, struct MutableCodeBlock **heap, unsigned int *count) {
+	struct MutableCodeBlock *result = heap[0];
+	struct MutableCodeBlock *last = heap[--(*count)];
+	unsigned int index = 0;
+	unsigned int child;
+
+	while ((child = index * 2 + 1) < *count) {
+		if (child + 1 < *count && is_mcblock_picked_before(list, heap[child + 1], heap[child])) {
+			child++;
+		}
+
+		if (!is_mcblock_picked_before(list, heap[child], last)) {
+			break;
+		}
+
+		heap[index] = heap[child];
+		index = child;
+	}
+
+	heap[index] = last;
+	return result;
+}
+
+int attach_mcblock_to_mcbwlist(struct MutableCodeBlockWorkList *list, struct MutableCodeBlock *block) {
+	if (list->attached_count == list->capacity) {
+		const unsigned int new_capacity = list->capacity + MCBWLIST_CAPACITY_GRANULARITY;
+		const unsigned int bits_per_word = sizeof(packed_data_t) * 8;
+		struct MutableCodeBlock **new_current;
+		struct MutableCodeBlock **new_next;
+		packed_data_t *new_queued;
+		unsigned int i;
+
+		new_current = reallocate_in_arena(list->arena, list->current, new_capacity * sizeof(struct MutableCodeBlock *));
+		if (!new_current) {
+			return 1;
+		}
+		list->current = new_current;
+
+		new_next = reallocate_in_arena(list->arena, list->next, new_capacity * sizeof(struct MutableCodeBlock *));
+		if (!new_next) {
+			return 1;
+		}
+		list->next = new_next;
+
+		new_queued = reallocate_in_arena(list->arena, list->queued, (new_capacity / bits_per_word) * sizeof(packed_data_t));
+		if (!new_queued) {
+			return 1;
+		}
+
+		for (i = list->capacity / bits_per_word; i < new_capacity / bits_per_word; i++) {
+			new_queued[i] = 0;
+		}
+
+		list->queued = new_queued;
+		list->capacity = new_capacity;
+	}
+
+	/* Blocks must be attached in the same order they were inserted in their list, so their ids can index the bitset */
+	assert(get_mcblock_id(block) == list->attached_count);
+	set_mcblock_work_list(block, list);
+	list->attached_count++;
+	if (mcblock_requires_evaluation(block)) {
+		push_mcblock_in_mcbwlist(list, block);
+	}
+
+	return 0;
+}
+
+void push_mcblock_in_mcbwlist(struct MutableCodeBlockWorkList *list, struct MutableCodeBlock *block) {
+	const unsigned int id = get_mcblock_id(block);
+	assert(id < list->attached_count);
+
+	if (!get_bitset_value(list->queued, id)) {
+		set_bitset_value(list->queued, id, 1);
+		if (list->iterating && (!list->last_picked || is_mcblock_picked_before(list, list->last_picked, block))) {
+			push_in_heap(list, list->current, &list->current_count, block);
+		}
+		else {
+			push_in_heap(list, list->next, &list->next_count, block);
+		}
+	}
+}
+
+int has_pending_mcblocks_in_mcbwlist(const struct MutableCodeBlockWorkList *list) {
+	return list->current_count || list->next_count;
+}
+
+int is_mcbwlist_iteration_limit_reached(const struct MutableCodeBlockWorkList *list) {
+	return list->iteration_limit && list->iteration_count >= list->iteration_limit;
+}
+
+int start_mcbwlist_iteration(struct MutableCodeBlockWorkList *list) {
+	struct MutableCodeBlock **heap;
+	unsigned int count;
+
+	assert(!list->iterating && list->current_count == 0);
+	if (list->iteration_count == list->iteration_capacity && reserve_mcbwlist_iterations(list, MCBWLIST_ITERATION_GRANULARITY)) {
+		return 1;
+	}
+
+	list->picked_counts[list->iteration_count++] = 0;
+
+	heap = list->current;
+	list->current = list->next;
+	list->next = heap;
+
+	count = list->current_count;
+	list->current_count = list->next_count;
+	list->next_count = count;
+
+	list->last_picked = NULL;
+	list->iterating = 1;
+	return 0;
+}
+
+int reserve_mcbwlist_iterations(struct MutableCodeBlockWorkList *list, unsigned int count) {
+	if (list->iteration_count + count > list->iteration_capacity) {
+		const unsigned int new_capacity = (list->iteration_count + count + MCBWLIST_ITERATION_GRANULARITY - 1) / MCBWLIST_ITERATION_GRANULARITY * MCBWLIST_ITERATION_GRANULARITY;
+		unsigned int *new_picked_counts = reallocate_in_arena(list->arena, list->picked_counts, new_capacity * sizeof(unsigned int));
+		if (!new_picked_counts) {
+			return 1;
+		}
+
+		list->picked_counts = new_picked_counts;
+		list->iteration_capacity = new_capacity;
+	}
+
+	return 0;
+}
+
+struct MutableCodeBlock *pick_mcblock_from_mcbwlist(struct MutableCodeBlockWorkList *list) {
+	struct MutableCodeBlock *block;
+	if (!list->current_count) {
+		list->iterating = 0;
+		return NULL;
+	}
+
+	block = pop_from_heap(list, list->current, &list->current_count);
+	set_bitset_value(list->queued, get_mcblock_id(block), 0);
+	list->last_picked = block;
+	list->picked_counts[list->iteration_count - 1]++;
+	return block;
+}
+
+unsigned int get_mcbwlist_picked_count(const struct MutableCodeBlockWorkList *list, unsigned int iteration) {
+	assert(iteration < list->iteration_count);
+	return list->picked_counts[iteration];
+}
+
+void register_widened_mcblock_in_mcbwlist(struct MutableCodeBlockWorkList *list) {
+	list->widened_count++;
+}
+
+void reset_mcbwlist(struct MutableCodeBlockWorkList *list) {
+	const unsigned int bits_per_word = sizeof(packed_data_t) * 8;
+	unsigned int i;
+	for (i = 0; i < list->capacity / bits_per_word; i++) {
+		list->queued[i] = 0;
+	}
+
+	list->current_count = 0;
+	list->next_count = 0;
+	list->attached_count = 0;
+	list->last_picked = NULL;
+	list->iteration_count = 0;
+	list->iterating = 0;
+	list->widened_count = 0;
+}
+
+void clear_mcbwlist(struct MutableCodeBlockWorkList *list) {
+	const unsigned int order = list->order;
+	const unsigned int widening_threshold = list->widening_threshold;
+	const unsigned int iteration_limit = list->iteration_limit;
+	const unsigned int extra_pass_count = list->extra_pass_count;
+	release_in_arena(list->arena, list->current);
+	release_in_arena(list->arena, list->next);
+	release_in_arena(list->arena, list->queued);
+	release_in_arena(list->arena, list->picked_counts);
+	initialize_mcbwlist_in_arena(list, list->arena);
+	list->order = order;
+	list->widening_threshold = widening_threshold;
+	list->iteration_limit = iteration_limit;
+	list->extra_pass_count = extra_pass_count;
+}
@@ -0,0 +1,236 @@
+#ifndef _MUTABLE_CODE_BLOCK_WORK_LIST_H_
+#define _MUTABLE_CODE_BLOCK_WORK_LIST_H_
+
+#include "arena.h"
+#include "packed.h"
+#include "stats.h"
+
+struct MutableCodeBlock;
+
+/**
+ * Blocks are picked in the same order they were allocated in their MutableCodeBlockList.
+ * This matches the order in which a full sweep of the unsorted blocks would evaluate them.
+ */
+#define MCBWLIST_ORDER_ALLOCATION 0
+
+/**
+ * Blocks are picked sorted by their start position.
+ * For code flowing forward, this approximates a reverse postorder traversal,
+ * where most of the block origins are already evaluated when the block is picked.
+ */
+#define MCBWLIST_ORDER_START 1
+
+/**
+ * Default number of evaluations of a block after which its origins start being widened instead of merged.
+ */
+#define MCBWLIST_DEFAULT_WIDENING_THRESHOLD 8
+
+/**
+ * Default maximum number of iterations.
+ * Widening should make the evaluation converge much earlier, so this is just a safety net.
+ */
+#define MCBWLIST_DEFAULT_ITERATION_LIMIT 1000
+
+/**
+ * Set of blocks pending to be evaluated.
+ *
+ * Evaluation is performed in iterations. Within an iteration, blocks are
+ * picked following the configured order. Any block that gets invalidated
+ * while the iteration is in progress will be picked in the same iteration
+ * if it comes after the last picked block, or will be postponed to the next
+ * iteration otherwise.
+ *
+ * Blocks must be attached to this list before they can be pushed. Attached
+ * blocks will be pushed automatically each time their evaluation is invalidated.
+ */
+struct MutableCodeBlockWorkList {
+	/**
+	 * Binary heap with the blocks that will be picked in the current iteration.
+	 */
+	struct MutableCodeBlock **current;
+
+	/**
+	 * Binary heap with the blocks that will be picked in the next iteration.
+	 */
+	struct MutableCodeBlock **next;
+
+	unsigned int current_count;
+	unsigned int next_count;
+
+	/**
+	 * Number of blocks attached to this list.
+	 * As blocks are attached in insertion order, this is also the id of the next block to be attached.
+	 */
+	unsigned int attached_count;
+
+	/**
+	 * Number of blocks that current, next and queued can hold without reallocating them.
+	 */
+	unsigned int capacity;
+
+	/**
+	 * Bitset indexed by block id, with set bits for those blocks present in any of the heaps.
+	 */
+	packed_data_t *queued;
+
+	/**
+	 * Last block picked in the current iteration, or NULL if no block has been picked yet.
+	 */
+	const struct MutableCodeBlock *last_picked;
+
+	/**
+	 * Number of blocks picked on each iteration.
+	 * Its length matches iteration_count.
+	 */
+	unsigned int *picked_counts;
+	unsigned int iteration_count;
+
+	/**
+	 * Number of iterations that picked_counts can hold without reallocating it.
+	 */
+	unsigned int iteration_capacity;
+
+	/**
+	 * One of the MCBWLIST_ORDER constants.
+	 */
+	unsigned int order;
+
+	/**
+	 * Whether an iteration has been started and not all its blocks have been picked yet.
+	 */
+	int iterating;
+
+	/**
+	 * Number of evaluations of a block after which its origins will be widened instead of merged.
+	 * 0 means that widening is disabled.
+	 */
+	unsigned int widening_threshold;
+
+	/**
+	 * Maximum number of iterations to be started. 0 means no limit.
+	 */
+	unsigned int iteration_limit;
+
+	/**
+	 * Number of times that all blocks will be evaluated again once the fixpoint is reached.
+	 * This has no effect on the result, and it is only useful to check that the evaluation is stable.
+	 */
+	unsigned int extra_pass_count;
+
+	/**
+	 * Number of attached blocks whose origins have been widened at least once.
+	 */
+	unsigned int widened_count;
+
+	/**
+	 * Stats where the evaluations of the picked blocks are counted, or NULL if they are not counted.
+	 */
+	struct AnalysisStats *stats;
+
+	/**
+	 * Arena where the heaps, the bitset and the picked counts are allocated. It can be NULL.
+	 */
+	struct Arena *arena;
+};
+
+/**
+ * Set all its values. After this, this list will be empty, but ready.
+ * Blocks will be picked in MCBWLIST_ORDER_ALLOCATION order, and its memory will be allocated in the given arena, that can be NULL.
+ */
+void initialize_mcbwlist_in_arena(struct MutableCodeBlockWorkList *list, struct Arena *arena);
+
+/**
+ * Set all its values. After this, this list will be empty, but ready.
+ * Blocks will be picked in MCBWLIST_ORDER_ALLOCATION order.
+ */
+void initialize_mcbwlist(struct MutableCodeBlockWorkList *list);
+
+/**
+ * Set the order in which blocks are picked.
+ * This must be called before attaching any block.
+ */
+void set_mcbwlist_order(struct MutableCodeBlockWorkList *list, unsigned int order);
+
+/**
+ * Set the number of evaluations of a block after which its origins will be widened instead of merged.
+ * 0 disables widening.
+ */
+void set_mcbwlist_widening_threshold(struct MutableCodeBlockWorkList *list, unsigned int threshold);
+
+/**
+ * Set the maximum number of iterations that can be started. 0 means no limit.
+ */
+void set_mcbwlist_iteration_limit(struct MutableCodeBlockWorkList *list, unsigned int limit);
+
+/**
+ * Set the number of times that all blocks will be evaluated again once the fixpoint is reached.
+ */
+void set_mcbwlist_extra_pass_count(struct MutableCodeBlockWorkList *list, unsigned int count);
+
+/**
+ * Attach the given block to this list.
+ * Blocks must be attached in the same order they were inserted in their MutableCodeBlockList.
+ *
+ * If the given block requires evaluation, it will be pushed as well.
+ * This method may require allocating memory. It will return 0 on success, or any other value on failure.
+ */
+int attach_mcblock_to_mcbwlist(struct MutableCodeBlockWorkList *list, struct MutableCodeBlock *block);
+
+/**
+ * Push the given block in the list, if it is not already present.
+ * The given block must have been attached to this list previously.
+ */
+void push_mcblock_in_mcbwlist(struct MutableCodeBlockWorkList *list, struct MutableCodeBlock *block);
+
+/**
+ * Whether there is any block pending to be picked, either in this iteration or the following one.
+ */
+int has_pending_mcblocks_in_mcbwlist(const struct MutableCodeBlockWorkList *list);
+
+/**
+ * Whether the iteration limit has been reached, and then no more iterations should be started.
+ */
+int is_mcbwlist_iteration_limit_reached(const struct MutableCodeBlockWorkList *list);
+
+/**
+ * Start a new iteration, making all blocks postponed in the previous iteration available to be picked.
+ * This method may require allocating memory. It will return 0 on success, or any other value on failure.
+ */
+int start_mcbwlist_iteration(struct MutableCodeBlockWorkList *list);
+
+/**
+ * Make sure that the given number of iterations can be started without allocating memory.
+ * This method may require allocating memory. It will return 0 on success, or any other value on failure.
+ */
+int reserve_mcbwlist_iterations(struct MutableCodeBlockWorkList *list, unsigned int count);
+
+/**
+ * Remove and return the next block to be evaluated in the current iteration,
+ * or NULL if all of them have been already picked.
+ */
+struct MutableCodeBlock *pick_mcblock_from_mcbwlist(struct MutableCodeBlockWorkList *list);
+
+/**
+ * Return the number of blocks picked in the given iteration.
+ * The given iteration must be lower than iteration_count.
+ */
+unsigned int get_mcbwlist_picked_count(const struct MutableCodeBlockWorkList *list, unsigned int iteration);
+
+/**
+ * Register that the origins of an attached block have been widened for first time.
+ */
+void register_widened_mcblock_in_mcbwlist(struct MutableCodeBlockWorkList *list);
+
+/**
+ * Detach all blocks and discard all iterations, keeping the allocated memory to be reused by following blocks.
+ * The configured order, widening threshold, iteration limit and extra pass count are kept.
+ */
+void reset_mcbwlist(struct MutableCodeBlockWorkList *list);
+
+/**
+ * Free all the allocated memory and restores this list to its initial state.
+ * The configured order, widening threshold, iteration limit, extra pass count and arena are kept.
+ */
+void clear_mcbwlist(struct MutableCodeBlockWorkList *list);
+
+#endif /* _MUTABLE_CODE_BLOCK_WORK_LIST_H_ */
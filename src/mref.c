@@ -24,6 +24,13 @@ void initialize_mref_as_cblock_instruction_immediate_value(struct MutableReferen
 	ref->instruction = instruction;
 }
 
+void initialize_mref_with_flags(struct MutableReference *ref, void *target, unsigned int flags, const char *instruction) {
+	assert(target && instruction);
+	ref->flags = flags;
+	ref->target = target;
+	ref->instruction = instruction;
+}
+
 const char *get_mref_instruction(struct MutableReference *ref) {
 	return ref->instruction;
 }
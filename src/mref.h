@@ -47,6 +47,14 @@ void initialize_mref_as_gvar_instruction_address(struct MutableReference *ref, s
  */
 void initialize_mref_as_cblock_instruction_immediate_value(struct MutableReference *ref, struct MutableCodeBlock *block, const char *instruction);
 
+/**
+ * Initialize the given reference with the flags of a reference found by a previous analysis of the same image.
+ * The given target must be a GlobalVariable or a MutableCodeBlock, as the flags state.
+ *
+ * This method will override any previous value in the given struct.
+ */
+void initialize_mref_with_flags(struct MutableReference *ref, void *target, unsigned int flags, const char *instruction);
+
 /**
  * Returns the instruction where this reference is located.
  */
@@ -3,7 +3,7 @@
 
 #include "mref.h"
 
-DEFINE_STRUCT_LIST(MutableReference, reference);
+DEFINE_STRUCT_CHUNKED_LIST(MutableReference, reference);
 DECLARE_STRUCT_LIST_METHODS(MutableReference, ref, reference, instruction);
 DECLARE_STRUCT_LIST_INSERT_METHOD(MutableReference, ref, reference);
 
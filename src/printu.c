@@ -1,4 +1,18 @@
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L
+#define PRINTER_DIRECT_SINK_SUPPORTED
+#endif
+
 #include "printu.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef PRINTER_DIRECT_SINK_SUPPORTED
+#include <errno.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif /* PRINTER_DIRECT_SINK_SUPPORTED */
 
 const char HEX_CHAR[16] = {
 	'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
@@ -8,8 +22,181 @@ const char HEX_CHAR[16] = {
 #define PRINTER_FLAG_FORMAT_BIN 0
 #define PRINTER_FLAG_FORMAT_DOS 1
 
+/**
+ * Set when the buffer is written with system calls on the file descriptor instead of through stdio.
+ */
+#define PRINTER_FLAG_DIRECT_SINK 2
+
+/**
+ * Set when any write on the file has failed. Following writes are then skipped.
+ */
+#define PRINTER_FLAG_WRITE_ERROR 4
+
+void initialize_printer(struct FilePrinter *printer, FILE *file) {
+	printer->flags = 0;
+	printer->buffer_start = NULL;
+	printer->file = file;
+	printer->func_list = NULL;
+	printer->renames = NULL;
+	printer->output = NULL;
+	printer->output_length = 0;
+	printer->output_capacity = 0;
+	printer->write_callback = NULL;
+	printer->write_context = NULL;
+}
+
+void initialize_printer_with_callback(struct FilePrinter *printer, int (*write_callback)(void *context, const char *text, unsigned int length), void *write_context) {
+	initialize_printer(printer, NULL);
+	printer->write_callback = write_callback;
+	printer->write_context = write_context;
+}
+
+int set_printer_buffered(struct FilePrinter *printer, unsigned int capacity) {
+	char *output;
+	assert(!printer->output && capacity > 0);
+
+	output = malloc(capacity);
+	if (!output) {
+		return 1;
+	}
+
+	printer->output = output;
+	printer->output_length = 0;
+	printer->output_capacity = capacity;
+
+#ifdef PRINTER_DIRECT_SINK_SUPPORTED
+	/* Anything already in the stdio buffer must reach the file before the first direct write */
+	if (printer->file && !fflush(printer->file) && fileno(printer->file) >= 0) {
+		printer->flags |= PRINTER_FLAG_DIRECT_SINK;
+	}
+#endif /* PRINTER_DIRECT_SINK_SUPPORTED */
+
+	return 0;
+}
+
+#ifdef PRINTER_DIRECT_SINK_SUPPORTED
+/**
+ * Write all the given chunks in order, retrying when the system writes them only partially.
+ */
+static int write_chunks(int fd, struct iovec *chunks, int chunk_count) {
+	while (chunk_count > 0) {
+		ssize_t written = writev(fd, chunks, chunk_count);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			return 1;
+		}
+
+		while (chunk_count > 0 && (size_t) written >= chunks->iov_len) {
+			written -= chunks->iov_len;
+			chunks++;
+			chunk_count--;
+		}
+
+		if (chunk_count > 0) {
+			chunks->iov_base = ((char *) chunks->iov_base) + written;
+			chunks->iov_len -= written;
+		}
+	}
+
+	return 0;
+}
+#endif /* PRINTER_DIRECT_SINK_SUPPORTED */
+
+/**
+ * Write the buffer content followed by the given text, which may be NULL.
+ * Both are sent in a single system call when possible.
+ */
+static int write_output(struct FilePrinter *printer, const char *str, size_t length) {
+	int error = 0;
+
+	if (printer->flags & PRINTER_FLAG_WRITE_ERROR) {
+		error = 1;
+	}
+#ifdef PRINTER_DIRECT_SINK_SUPPORTED
+	else if (printer->flags & PRINTER_FLAG_DIRECT_SINK) {
+		struct iovec chunks[2];
+		int chunk_count = 0;
+		if (printer->output_length) {
+			chunks[chunk_count].iov_base = printer->output;
+			chunks[chunk_count++].iov_len = printer->output_length;
+		}
+
+		if (length) {
+			chunks[chunk_count].iov_base = (char *) str;
+			chunks[chunk_count++].iov_len = length;
+		}
+
+		error = write_chunks(fileno(printer->file), chunks, chunk_count);
+	}
+#endif /* PRINTER_DIRECT_SINK_SUPPORTED */
+	else if (printer->write_callback) {
+		error = (printer->output_length && printer->write_callback(printer->write_context, printer->output, printer->output_length)) ||
+				(length && printer->write_callback(printer->write_context, str, length));
+	}
+	else {
+		error = fwrite(printer->output, 1, printer->output_length, printer->file) != printer->output_length ||
+				(length && fwrite(str, 1, length, printer->file) != length);
+	}
+
+	if (error) {
+		printer->flags |= PRINTER_FLAG_WRITE_ERROR;
+	}
+
+	printer->output_length = 0;
+	return error;
+}
+
+int flush_printer(struct FilePrinter *printer) {
+	if (!printer->output) {
+		return printer->file && fflush(printer->file) != 0;
+	}
+
+	if (printer->output_length || (printer->flags & PRINTER_FLAG_WRITE_ERROR)) {
+		return write_output(printer, NULL, 0);
+	}
+
+	return 0;
+}
+
+int clear_printer(struct FilePrinter *printer) {
+	const int error = flush_printer(printer);
+	free(printer->output);
+	printer->output = NULL;
+	printer->output_length = 0;
+	printer->output_capacity = 0;
+	printer->flags &= ~PRINTER_FLAG_DIRECT_SINK;
+	return error;
+}
+
 void print(struct FilePrinter *printer, const char *str) {
-	fprintf(printer->file, "%s", str);
+	size_t length;
+	if (!printer->output) {
+		if (printer->write_callback) {
+			write_output(printer, str, strlen(str));
+		}
+		else {
+			fputs(str, printer->file);
+		}
+
+		return;
+	}
+
+	length = strlen(str);
+	if (length <= printer->output_capacity - printer->output_length) {
+		memcpy(printer->output + printer->output_length, str, length);
+		printer->output_length += length;
+	}
+	else if (length < printer->output_capacity) {
+		write_output(printer, NULL, 0);
+		memcpy(printer->output, str, length);
+		printer->output_length = length;
+	}
+	else {
+		write_output(printer, str, length);
+	}
 }
 
 void print_literal_hex_byte(struct FilePrinter *printer, int value) {
@@ -87,6 +274,12 @@ void print_variable_label(struct FilePrinter *printer, unsigned int address) {
 
 	if ((printer->flags & PRINTER_FLAG_FORMAT_MASK) == PRINTER_FLAG_FORMAT_BIN) {
 		const int value = (address + 0x100) & 0xFFFF;
+		index = index_of_label_in_rename_map(printer->renames, RENAME_LABEL_KIND_BIN_VARIABLE, 0, value);
+		if (index >= 0) {
+			print(printer, printer->renames->entries[index].value);
+			return;
+		}
+
 		buffer[6] = HEX_CHAR[value & 0x000F];
 		buffer[5] = HEX_CHAR[(value >> 4) & 0x000F];
 		buffer[4] = HEX_CHAR[(value >> 8) & 0x000F];
@@ -94,6 +287,12 @@ void print_variable_label(struct FilePrinter *printer, unsigned int address) {
 		buffer[7] = '\0';
 	}
 	else {
+		index = index_of_label_in_rename_map(printer->renames, RENAME_LABEL_KIND_DOS_VARIABLE, 0, address & 0xFFFFF);
+		if (index >= 0) {
+			print(printer, printer->renames->entries[index].value);
+			return;
+		}
+
 		buffer[7] = HEX_CHAR[address & 0x0000F];
 		buffer[6] = HEX_CHAR[(address >> 4) & 0x0000F];
 		buffer[5] = HEX_CHAR[(address >> 8) & 0x0000F];
@@ -101,17 +300,10 @@ void print_variable_label(struct FilePrinter *printer, unsigned int address) {
 		buffer[3] = HEX_CHAR[(address >> 16) & 0x0000F];
 	}
 
-	index = index_of_key_in_rename_map(printer->renames, buffer);
-	if (index >= 0) {
-		print(printer, printer->renames->entries[index].value);
-	}
-	else {
-		print(printer, buffer);
-	}
+	print(printer, buffer);
 }
 
 #define PRINT_CODE_LABEL_BUFFER_MAX_SIZE 24
-#include <assert.h>
 
 void print_code_label(struct FilePrinter *printer, int ip, int cs) {
 	char buffer[PRINT_CODE_LABEL_BUFFER_MAX_SIZE];
@@ -120,6 +312,18 @@ void print_code_label(struct FilePrinter *printer, int ip, int cs) {
 	int func_index = index_of_func_containing_block_start(printer->func_list, block_start);
 	int index;
 
+	if ((printer->flags & PRINTER_FLAG_FORMAT_MASK) == PRINTER_FLAG_FORMAT_DOS) {
+		index = index_of_label_in_rename_map(printer->renames, RENAME_LABEL_KIND_DOS_CODE, func_index + 1, ((cs & 0xFFFFUL) << 16) | (ip & 0xFFFF));
+	}
+	else {
+		index = index_of_label_in_rename_map(printer->renames, RENAME_LABEL_KIND_BIN_CODE, func_index + 1, ip & 0xFFFF);
+	}
+
+	if (index >= 0) {
+		print(printer, printer->renames->entries[index].value);
+		return;
+	}
+
 	if (func_index >= 0) {
 		buffer[buffer_index++] = 'f';
 		buffer[buffer_index++] = 'u';
@@ -148,14 +352,7 @@ void print_code_label(struct FilePrinter *printer, int ip, int cs) {
 	buffer[buffer_index] = HEX_CHAR[(ip >> 12) & 0x000F];
 	buffer[buffer_index + 4] = '\0';
 	assert(buffer_index + 5 <= PRINT_CODE_LABEL_BUFFER_MAX_SIZE);
-
-	index = index_of_key_in_rename_map(printer->renames, buffer);
-	if (index >= 0) {
-		print(printer, printer->renames->entries[index].value);
-	}
-	else {
-		print(printer, buffer);
-	}
+	print(printer, buffer);
 }
 
 void print_segment_label(struct FilePrinter *printer, const char *start) {
@@ -5,14 +5,71 @@
 #include "funclist.h"
 #include "renames.h"
 
+/**
+ * Default capacity for buffered printers.
+ */
+#define PRINTER_DEFAULT_BUFFER_SIZE 0x10000
+
 struct FilePrinter {
 	unsigned int flags;
 	const char *buffer_start;
 	FILE *file;
 	struct FunctionList *func_list;
 	struct RenameMap *renames;
+
+	/**
+	 * Text printed and not yet written to the file, or NULL if this printer is not buffered.
+	 */
+	char *output;
+	unsigned int output_length;
+	unsigned int output_capacity;
+
+	/**
+	 * Function receiving the printed text instead of the file, or NULL if the text is written to the file.
+	 * It must return 0 on success, or any other value if the text cannot be written.
+	 */
+	int (*write_callback)(void *context, const char *text, unsigned int length);
+
+	/**
+	 * Value given to write_callback on each call.
+	 */
+	void *write_context;
 };
 
+/**
+ * Set all its values. After this, the printer will write directly to the given file on each print.
+ */
+void initialize_printer(struct FilePrinter *printer, FILE *file);
+
+/**
+ * Set all its values. After this, the printer will give the text to the given callback on each print, instead of writing it to a file.
+ */
+void initialize_printer_with_callback(struct FilePrinter *printer, int (*write_callback)(void *context, const char *text, unsigned int length), void *write_context);
+
+/**
+ * Make this printer accumulate the printed text in a buffer of the given capacity,
+ * writing it to the file only when the buffer gets full or the printer is flushed.
+ *
+ * When supported, the buffer is written directly to the file descriptor, bypassing stdio.
+ * Then, nothing else should be written to the same file until the printer is cleared.
+ *
+ * This method may require allocating memory. It will return 0 on success, or any other value on failure.
+ * On failure, the printer remains unbuffered, but usable.
+ */
+int set_printer_buffered(struct FilePrinter *printer, unsigned int capacity);
+
+/**
+ * Write to the file all the text accumulated in the buffer, if any.
+ * This will return 0 on success, or any other value if the file cannot be written.
+ */
+int flush_printer(struct FilePrinter *printer);
+
+/**
+ * Flush the printer and free its buffer. The file is not closed.
+ * This will return 0 on success, or any other value if the file cannot be written.
+ */
+int clear_printer(struct FilePrinter *printer);
+
 void print(struct FilePrinter *printer, const char *str);
 void print_literal_hex_byte(struct FilePrinter *printer, int value);
 void print_literal_hex_word(struct FilePrinter *printer, int value);
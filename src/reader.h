@@ -7,8 +7,6 @@ struct Reader {
 	unsigned int buffer_index;
 };
 
-extern int reader_debug_print_enabled;
-
 int read_next_byte(struct Reader *reader);
 int read_next_word(struct Reader *reader);
 
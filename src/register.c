@@ -2,6 +2,35 @@
 #include <assert.h>
 #include <stdlib.h>
 
+static const char *get_value_origin(const struct Registers *regs, unsigned int index) {
+	return regs->provenance? regs->provenance->value_origin[index] : NULL;
+}
+
+static const char *get_last_update(const struct Registers *regs, unsigned int index) {
+	return regs->provenance? regs->provenance->last_update[index] : NULL;
+}
+
+static void set_value_origin(struct Registers *regs, unsigned int index, const char *value_origin) {
+	if (regs->provenance) {
+		regs->provenance->value_origin[index] = value_origin;
+	}
+}
+
+static void set_last_update(struct Registers *regs, unsigned int index, const char *last_update) {
+	if (regs->provenance) {
+		regs->provenance->last_update[index] = last_update;
+	}
+}
+
+void initialize_registers(struct Registers *regs, struct RegisterProvenance *provenance) {
+	regs->provenance = provenance;
+	set_all_registers_undefined(regs);
+}
+
+int is_provenance_tracked_in_registers(const struct Registers *regs) {
+	return regs->provenance != NULL;
+}
+
 int is_register_al_defined(const struct Registers *regs) {
 	return regs->defined & 0x0001;
 }
@@ -222,41 +251,41 @@ int is_register_ds_merged(const struct Registers *regs) {
 }
 
 const char *get_register_al_value_origin(const struct Registers *regs) {
-	return regs->value_origin[0];
+	return get_value_origin(regs, 0);
 }
 
 const char *get_register_ax_value_origin(const struct Registers *regs) {
-	const char *value_origin = regs->value_origin[0];
-	return (value_origin == regs->value_origin[1])? value_origin : NULL;
+	const char *value_origin = get_value_origin(regs, 0);
+	return (value_origin == get_value_origin(regs, 1))? value_origin : NULL;
 }
 
 const char *get_register_dx_value_origin(const struct Registers *regs) {
-	const char *value_origin = regs->value_origin[4];
-	return (value_origin == regs->value_origin[5])? value_origin : NULL;
+	const char *value_origin = get_value_origin(regs, 4);
+	return (value_origin == get_value_origin(regs, 5))? value_origin : NULL;
 }
 
 const char *get_register_bp_value_origin(const struct Registers *regs) {
-	return regs->value_origin[9];
+	return get_value_origin(regs, 9);
 }
 
 const char *get_register_si_value_origin(const struct Registers *regs) {
-	return regs->value_origin[10];
+	return get_value_origin(regs, 10);
 }
 
 const char *get_word_register_value_origin(const struct Registers *regs, unsigned int index) {
 	assert(index < 8);
 	if (index < 4) {
-		const char *value_origin = regs->value_origin[index * 2];
-		return (value_origin == regs->value_origin[index * 2 + 1])? value_origin : NULL;
+		const char *value_origin = get_value_origin(regs, index * 2);
+		return (value_origin == get_value_origin(regs, index * 2 + 1))? value_origin : NULL;
 	}
 	else {
-		return regs->value_origin[index + 4];
+		return get_value_origin(regs, index + 4);
 	}
 }
 
 const char *get_segment_register_value_origin(const struct Registers *regs, unsigned int index) {
 	assert(index < 4);
-	return regs->value_origin[index + 12];
+	return get_value_origin(regs, index + 12);
 }
 
 unsigned int get_register_al(const struct Registers *regs) {
@@ -420,7 +449,7 @@ unsigned int get_segment_register(const struct Registers *regs, unsigned int ind
 void set_register_ah_undefined(struct Registers *regs, const char *last_update) {
 	regs->defined &= 0xFFFE;
 	regs->relative &= 0xFFEF;
-	regs->last_update[1] = last_update;
+	set_last_update(regs, 1, last_update);
 	regs->merged &= 0xFFFE;
 }
 
@@ -435,56 +464,56 @@ void set_byte_register(struct Registers *regs, unsigned int index, const char *l
 
 	if (index == 0) {
 		regs->al = value;
-		regs->last_update[0] = last_update;
-		regs->value_origin[0] = value_origin;
+		set_last_update(regs, 0, last_update);
+		set_value_origin(regs, 0, value_origin);
 		regs->defined |= 0x01;
 		regs->relative &= 0xFFEF;
 		regs->merged &= 0xFFFE;
 	}
 	else if (index == 1) {
 		regs->cl = value;
-		regs->last_update[2] = last_update;
-		regs->value_origin[2] = value_origin;
+		set_last_update(regs, 2, last_update);
+		set_value_origin(regs, 2, value_origin);
 		regs->defined |= 0x04;
 		regs->relative &= 0xFFDF;
 		regs->merged &= 0xFFFB;
 	}
 	else if (index == 2) {
 		regs->dl = value;
-		regs->last_update[4] = last_update;
-		regs->value_origin[4] = value_origin;
+		set_last_update(regs, 4, last_update);
+		set_value_origin(regs, 4, value_origin);
 		regs->defined |= 0x10;
 		regs->relative &= 0xFFBF;
 		regs->merged &= 0xFFEF;
 	}
 	else if (index == 3) {
 		regs->bl = value;
-		regs->last_update[6] = last_update;
-		regs->value_origin[6] = value_origin;
+		set_last_update(regs, 6, last_update);
+		set_value_origin(regs, 6, value_origin);
 		regs->defined |= 0x40;
 		regs->relative &= 0xFF7F;
 		regs->merged &= 0xFFBF;
 	}
 	else if (index == 4) {
 		regs->ah = value;
-		regs->last_update[1] = last_update;
-		regs->value_origin[1] = value_origin;
+		set_last_update(regs, 1, last_update);
+		set_value_origin(regs, 1, value_origin);
 		regs->defined |= 0x02;
 		regs->relative &= 0xFFEF;
 		regs->merged &= 0xFFFD;
 	}
 	else if (index == 5) {
 		regs->ch = value;
-		regs->last_update[3] = last_update;
-		regs->value_origin[3] = value_origin;
+		set_last_update(regs, 3, last_update);
+		set_value_origin(regs, 3, value_origin);
 		regs->defined |= 0x08;
 		regs->relative &= 0xFFDF;
 		regs->merged &= 0xFFF7;
 	}
 	else if (index == 6) {
 		regs->dh = value;
-		regs->last_update[5] = last_update;
-		regs->value_origin[5] = value_origin;
+		set_last_update(regs, 5, last_update);
+		set_value_origin(regs, 5, value_origin);
 		regs->defined |= 0x20;
 		regs->relative &= 0xFFBF;
 		regs->merged &= 0xFFDF;
@@ -492,8 +521,8 @@ void set_byte_register(struct Registers *regs, unsigned int index, const char *l
 	else {
 		/* Assuming index == 7 */
 		regs->bh = value;
-		regs->last_update[7] = last_update;
-		regs->value_origin[7] = value_origin;
+		set_last_update(regs, 7, last_update);
+		set_value_origin(regs, 7, value_origin);
 		regs->defined |= 0x80;
 		regs->relative &= 0xFF7F;
 		regs->merged &= 0xFF7F;
@@ -515,10 +544,10 @@ void set_word_register(struct Registers *regs, unsigned int index, const char *l
 	else if (index == 1) {
 		regs->cl = value & 0xFF;
 		regs->ch = (value >> 8) & 0xFF;
-		regs->last_update[2] = last_update;
-		regs->last_update[3] = last_update;
-		regs->value_origin[2] = value_origin;
-		regs->value_origin[3] = value_origin;
+		set_last_update(regs, 2, last_update);
+		set_last_update(regs, 3, last_update);
+		set_value_origin(regs, 2, value_origin);
+		set_value_origin(regs, 3, value_origin);
 		regs->defined |= 0x000C;
 		regs->relative &= ~0x20;
 		regs->merged &= 0xFFF3;
@@ -526,10 +555,10 @@ void set_word_register(struct Registers *regs, unsigned int index, const char *l
 	else if (index == 2) {
 		regs->dl = value & 0xFF;
 		regs->dh = (value >> 8) & 0xFF;
-		regs->last_update[4] = last_update;
-		regs->last_update[5] = last_update;
-		regs->value_origin[4] = value_origin;
-		regs->value_origin[5] = value_origin;
+		set_last_update(regs, 4, last_update);
+		set_last_update(regs, 5, last_update);
+		set_value_origin(regs, 4, value_origin);
+		set_value_origin(regs, 5, value_origin);
 		regs->defined |= 0x0030;
 		regs->relative &= ~0x40;
 		regs->merged &= 0xFFCF;
@@ -537,10 +566,10 @@ void set_word_register(struct Registers *regs, unsigned int index, const char *l
 	else if (index == 3) {
 		regs->bl = value & 0xFF;
 		regs->bh = (value >> 8) & 0xFF;
-		regs->last_update[6] = last_update;
-		regs->last_update[7] = last_update;
-		regs->value_origin[6] = value_origin;
-		regs->value_origin[7] = value_origin;
+		set_last_update(regs, 6, last_update);
+		set_last_update(regs, 7, last_update);
+		set_value_origin(regs, 6, value_origin);
+		set_value_origin(regs, 7, value_origin);
 		regs->defined |= 0x00C0;
 		regs->relative &= ~0x80;
 		regs->merged &= 0xFF3F;
@@ -550,16 +579,16 @@ void set_word_register(struct Registers *regs, unsigned int index, const char *l
 	}
 	else if (index == 5) {
 		regs->bp = value;
-		regs->last_update[9] = last_update;
-		regs->value_origin[9] = value_origin;
+		set_last_update(regs, 9, last_update);
+		set_value_origin(regs, 9, value_origin);
 		regs->defined |= 0x0200;
 		regs->relative &= ~0x200;
 		regs->merged &= 0xFDFF;
 	}
 	else if (index == 6) {
 		regs->si = value;
-		regs->last_update[10] = last_update;
-		regs->value_origin[10] = value_origin;
+		set_last_update(regs, 10, last_update);
+		set_value_origin(regs, 10, value_origin);
 		regs->defined |= 0x0400;
 		regs->relative &= ~0x400;
 		regs->merged &= 0xFBFF;
@@ -567,8 +596,8 @@ void set_word_register(struct Registers *regs, unsigned int index, const char *l
 	else {
 		/* Assuming index == 7 */
 		regs->di = value;
-		regs->last_update[11] = last_update;
-		regs->value_origin[11] = value_origin;
+		set_last_update(regs, 11, last_update);
+		set_value_origin(regs, 11, value_origin);
 		regs->defined |= 0x0800;
 		regs->relative &= ~0x800;
 		regs->merged &= 0xF7FF;
@@ -587,10 +616,10 @@ void set_word_register_relative(struct Registers *regs, unsigned int index, cons
 	if (index == 0) {
 		regs->al = value & 0xFF;
 		regs->ah = value >> 8 & 0xFF;
-		regs->last_update[0] = last_update;
-		regs->last_update[1] = last_update;
-		regs->value_origin[0] = value_origin;
-		regs->value_origin[1] = value_origin;
+		set_last_update(regs, 0, last_update);
+		set_last_update(regs, 1, last_update);
+		set_value_origin(regs, 0, value_origin);
+		set_value_origin(regs, 1, value_origin);
 		regs->defined |= 0x0003;
 		regs->relative |= 0x10;
 		regs->merged &= 0xFFFC;
@@ -598,10 +627,10 @@ void set_word_register_relative(struct Registers *regs, unsigned int index, cons
 	else if (index == 1) {
 		regs->cl = value & 0xFF;
 		regs->ch = value >> 8 & 0xFF;
-		regs->last_update[2] = last_update;
-		regs->last_update[3] = last_update;
-		regs->value_origin[2] = value_origin;
-		regs->value_origin[3] = value_origin;
+		set_last_update(regs, 2, last_update);
+		set_last_update(regs, 3, last_update);
+		set_value_origin(regs, 2, value_origin);
+		set_value_origin(regs, 3, value_origin);
 		regs->defined |= 0x000C;
 		regs->relative |= 0x20;
 		regs->merged &= 0xFFF3;
@@ -609,10 +638,10 @@ void set_word_register_relative(struct Registers *regs, unsigned int index, cons
 	else if (index == 2) {
 		regs->dl = value & 0xFF;
 		regs->dh = value >> 8 & 0xFF;
-		regs->last_update[4] = last_update;
-		regs->last_update[5] = last_update;
-		regs->value_origin[4] = value_origin;
-		regs->value_origin[5] = value_origin;
+		set_last_update(regs, 4, last_update);
+		set_last_update(regs, 5, last_update);
+		set_value_origin(regs, 4, value_origin);
+		set_value_origin(regs, 5, value_origin);
 		regs->defined |= 0x0030;
 		regs->relative |= 0x40;
 		regs->merged &= 0xFFCF;
@@ -620,34 +649,34 @@ void set_word_register_relative(struct Registers *regs, unsigned int index, cons
 	else if (index == 3) {
 		regs->bl = value & 0xFF;
 		regs->bh = value >> 8 & 0xFF;
-		regs->last_update[6] = last_update;
-		regs->last_update[7] = last_update;
-		regs->value_origin[6] = value_origin;
-		regs->value_origin[7] = value_origin;
+		set_last_update(regs, 6, last_update);
+		set_last_update(regs, 7, last_update);
+		set_value_origin(regs, 6, value_origin);
+		set_value_origin(regs, 7, value_origin);
 		regs->defined |= 0x00C0;
 		regs->relative |= 0x80;
 		regs->merged &= 0xFF3F;
 	}
 	else if (index == 4) {
 		regs->sp = value;
-		regs->last_update[8] = last_update;
-		regs->value_origin[8] = value_origin;
+		set_last_update(regs, 8, last_update);
+		set_value_origin(regs, 8, value_origin);
 		regs->defined |= 0x0100;
 		regs->relative |= 0x100;
 		regs->merged &= 0xFEFF;
 	}
 	else if (index == 5) {
 		regs->bp = value;
-		regs->last_update[9] = last_update;
-		regs->value_origin[9] = value_origin;
+		set_last_update(regs, 9, last_update);
+		set_value_origin(regs, 9, value_origin);
 		regs->defined |= 0x0200;
 		regs->relative |= 0x200;
 		regs->merged &= 0xFDFF;
 	}
 	else if (index == 6) {
 		regs->si = value;
-		regs->last_update[10] = last_update;
-		regs->value_origin[10] = value_origin;
+		set_last_update(regs, 10, last_update);
+		set_value_origin(regs, 10, value_origin);
 		regs->defined |= 0x0400;
 		regs->relative |= 0x400;
 		regs->merged &= 0xFBFF;
@@ -655,8 +684,8 @@ void set_word_register_relative(struct Registers *regs, unsigned int index, cons
 	else {
 		/* Assuming index == 7 */
 		regs->di = value;
-		regs->last_update[11] = last_update;
-		regs->value_origin[11] = value_origin;
+		set_last_update(regs, 11, last_update);
+		set_value_origin(regs, 11, value_origin);
 		regs->defined |= 0x0800;
 		regs->relative |= 0x800;
 		regs->merged &= 0xF7FF;
@@ -675,10 +704,10 @@ void set_word_register_local(struct Registers *regs, unsigned int index, const c
 	if (index == 0) {
 		regs->al = diff & 0xFF;
 		regs->ah = diff >> 8 & 0xFF;
-		regs->last_update[0] = last_update;
-		regs->last_update[1] = last_update;
-		regs->value_origin[0] = value_origin;
-		regs->value_origin[1] = value_origin;
+		set_last_update(regs, 0, last_update);
+		set_last_update(regs, 1, last_update);
+		set_value_origin(regs, 0, value_origin);
+		set_value_origin(regs, 1, value_origin);
 		regs->defined &= 0xFFFC;
 		regs->relative |= 0x10;
 		regs->merged &= 0xFFFC;
@@ -686,10 +715,10 @@ void set_word_register_local(struct Registers *regs, unsigned int index, const c
 	else if (index == 1) {
 		regs->cl = diff & 0xFF;
 		regs->ch = diff >> 8 & 0xFF;
-		regs->last_update[2] = last_update;
-		regs->last_update[3] = last_update;
-		regs->value_origin[2] = value_origin;
-		regs->value_origin[3] = value_origin;
+		set_last_update(regs, 2, last_update);
+		set_last_update(regs, 3, last_update);
+		set_value_origin(regs, 2, value_origin);
+		set_value_origin(regs, 3, value_origin);
 		regs->defined &= 0xFFF3;
 		regs->relative |= 0x20;
 		regs->merged &= 0xFFF3;
@@ -697,10 +726,10 @@ void set_word_register_local(struct Registers *regs, unsigned int index, const c
 	else if (index == 2) {
 		regs->dl = diff & 0xFF;
 		regs->dh = diff >> 8 & 0xFF;
-		regs->last_update[4] = last_update;
-		regs->last_update[5] = last_update;
-		regs->value_origin[4] = value_origin;
-		regs->value_origin[5] = value_origin;
+		set_last_update(regs, 4, last_update);
+		set_last_update(regs, 5, last_update);
+		set_value_origin(regs, 4, value_origin);
+		set_value_origin(regs, 5, value_origin);
 		regs->defined &= 0xFFCF;
 		regs->relative |= 0x40;
 		regs->merged &= 0xFFCF;
@@ -708,34 +737,34 @@ void set_word_register_local(struct Registers *regs, unsigned int index, const c
 	else if (index == 3) {
 		regs->bl = diff & 0xFF;
 		regs->bh = diff >> 8 & 0xFF;
-		regs->last_update[6] = last_update;
-		regs->last_update[7] = last_update;
-		regs->value_origin[6] = value_origin;
-		regs->value_origin[7] = value_origin;
+		set_last_update(regs, 6, last_update);
+		set_last_update(regs, 7, last_update);
+		set_value_origin(regs, 6, value_origin);
+		set_value_origin(regs, 7, value_origin);
 		regs->defined &= 0xFF3F;
 		regs->relative |= 0x80;
 		regs->merged &= 0xFF3F;
 	}
 	else if (index == 4) {
 		regs->sp = diff;
-		regs->last_update[8] = last_update;
-		regs->value_origin[8] = value_origin;
+		set_last_update(regs, 8, last_update);
+		set_value_origin(regs, 8, value_origin);
 		regs->defined &= 0xFEFF;
 		regs->relative |= 0x100;
 		regs->merged &= 0xFEFF;
 	}
 	else if (index == 5) {
 		regs->bp = diff;
-		regs->last_update[9] = last_update;
-		regs->value_origin[9] = value_origin;
+		set_last_update(regs, 9, last_update);
+		set_value_origin(regs, 9, value_origin);
 		regs->defined &= 0xFDFF;
 		regs->relative |= 0x200;
 		regs->merged &= 0xFDFF;
 	}
 	else if (index == 6) {
 		regs->si = diff;
-		regs->last_update[10] = last_update;
-		regs->value_origin[10] = value_origin;
+		set_last_update(regs, 10, last_update);
+		set_value_origin(regs, 10, value_origin);
 		regs->defined &= 0xFBFF;
 		regs->relative |= 0x400;
 		regs->merged &= 0xFBFF;
@@ -743,8 +772,8 @@ void set_word_register_local(struct Registers *regs, unsigned int index, const c
 	else {
 		/* Assuming index == 7 */
 		regs->di = diff;
-		regs->last_update[11] = last_update;
-		regs->value_origin[11] = value_origin;
+		set_last_update(regs, 11, last_update);
+		set_value_origin(regs, 11, value_origin);
 		regs->defined &= 0xF7FF;
 		regs->relative |= 0x800;
 		regs->merged &= 0xF7FF;
@@ -754,46 +783,46 @@ void set_word_register_local(struct Registers *regs, unsigned int index, const c
 void set_register_ax_undefined(struct Registers *regs, const char *last_update) {
 	regs->defined &= 0xFFFC;
 	regs->relative &= 0xFFEF;
-	regs->last_update[0] = last_update;
-	regs->last_update[1] = last_update;
+	set_last_update(regs, 0, last_update);
+	set_last_update(regs, 1, last_update);
 	regs->merged &= 0xFFFC;
 }
 
 void set_register_cx_undefined(struct Registers *regs, const char *last_update) {
 	regs->defined &= 0xFFF3;
 	regs->relative &= 0xFFDF;
-	regs->last_update[2] = last_update;
-	regs->last_update[3] = last_update;
+	set_last_update(regs, 2, last_update);
+	set_last_update(regs, 3, last_update);
 	regs->merged &= 0xFFF3;
 }
 
 void set_register_dx_undefined(struct Registers *regs, const char *last_update) {
 	regs->defined &= 0xFFCF;
 	regs->relative &= 0xFFBF;
-	regs->last_update[4] = last_update;
-	regs->last_update[5] = last_update;
+	set_last_update(regs, 4, last_update);
+	set_last_update(regs, 5, last_update);
 	regs->merged &= 0xFFCF;
 }
 
 void set_register_bx_undefined(struct Registers *regs, const char *last_update) {
 	regs->defined &= 0xFF3F;
 	regs->relative &= 0xFF7F;
-	regs->last_update[6] = last_update;
-	regs->last_update[7] = last_update;
+	set_last_update(regs, 6, last_update);
+	set_last_update(regs, 7, last_update);
 	regs->merged &= 0xFF3F;
 }
 
 void set_register_es_undefined(struct Registers *regs, const char *last_update) {
 	regs->defined &= 0xEFFF;
 	regs->relative &= 0xEFFF;
-	regs->last_update[12] = last_update;
+	set_last_update(regs, 12, last_update);
 	regs->merged &= 0xEFFF;
 }
 
 void set_register_ds_undefined(struct Registers *regs, const char *last_update) {
 	regs->defined &= 0x7FFF;
 	regs->relative &= 0x7FFF;
-	regs->last_update[15] = last_update;
+	set_last_update(regs, 15, last_update);
 	regs->merged &= 0x7FFF;
 }
 
@@ -821,17 +850,17 @@ void set_word_register_undefined(struct Registers *regs, unsigned int index, con
 void set_register_al_undefined(struct Registers *regs, const char *last_update) {
 	regs->defined &= 0xFFFE;
 	regs->relative &= 0xFFEF;
-	regs->last_update[0] = last_update;
+	set_last_update(regs, 0, last_update);
 	regs->merged &= 0xFFFE;
 }
 
 void set_register_ax(struct Registers *regs, const char *last_update, const char *value_origin, uint16_t value) {
 	regs->al = value & 0xFF;
 	regs->ah = value >> 8 & 0xFF;
-	regs->last_update[0] = last_update;
-	regs->last_update[1] = last_update;
-	regs->value_origin[0] = value_origin;
-	regs->value_origin[1] = value_origin;
+	set_last_update(regs, 0, last_update);
+	set_last_update(regs, 1, last_update);
+	set_value_origin(regs, 0, value_origin);
+	set_value_origin(regs, 1, value_origin);
 	regs->defined |= 0x0003;
 	regs->relative &= ~0x10;
 	regs->merged &= 0xFFFC;
@@ -839,8 +868,8 @@ void set_register_ax(struct Registers *regs, const char *last_update, const char
 
 void set_register_sp(struct Registers *regs, const char *last_update, const char *value_origin, uint16_t value) {
 	regs->sp = value;
-	regs->last_update[8] = last_update;
-	regs->value_origin[8] = value_origin;
+	set_last_update(regs, 8, last_update);
+	set_value_origin(regs, 8, value_origin);
 	regs->defined |= 0x0100;
 	regs->relative &= ~0x100;
 	regs->merged &= 0xFEFE;
@@ -848,8 +877,8 @@ void set_register_sp(struct Registers *regs, const char *last_update, const char
 
 void set_register_es(struct Registers *regs, const char *last_update, const char *value_origin, uint16_t value) {
 	regs->es = value;
-	regs->last_update[12] = last_update;
-	regs->value_origin[12] = value_origin;
+	set_last_update(regs, 12, last_update);
+	set_value_origin(regs, 12, value_origin);
 	regs->defined |= 0x1000;
 	regs->relative &= ~0x1000;
 	regs->merged &= 0xEFFF;
@@ -857,8 +886,8 @@ void set_register_es(struct Registers *regs, const char *last_update, const char
 
 void set_register_cs(struct Registers *regs, const char *last_update, const char *value_origin, uint16_t value) {
 	regs->cs = value;
-	regs->last_update[13] = last_update;
-	regs->value_origin[13] = value_origin;
+	set_last_update(regs, 13, last_update);
+	set_value_origin(regs, 13, value_origin);
 	regs->defined |= 0x2000;
 	regs->relative &= ~0x2000;
 	regs->merged &= 0xDFFF;
@@ -866,8 +895,8 @@ void set_register_cs(struct Registers *regs, const char *last_update, const char
 
 void set_register_ss(struct Registers *regs, const char *last_update, const char *value_origin, uint16_t value) {
 	regs->ss = value;
-	regs->last_update[14] = last_update;
-	regs->value_origin[14] = value_origin;
+	set_last_update(regs, 14, last_update);
+	set_value_origin(regs, 14, value_origin);
 	regs->defined |= 0x4000;
 	regs->relative &= ~0x4000;
 	regs->merged &= 0xBFFF;
@@ -875,8 +904,8 @@ void set_register_ss(struct Registers *regs, const char *last_update, const char
 
 void set_register_ds(struct Registers *regs, const char *last_update, const char *value_origin, uint16_t value) {
 	regs->ds = value;
-	regs->last_update[15] = last_update;
-	regs->value_origin[15] = value_origin;
+	set_last_update(regs, 15, last_update);
+	set_value_origin(regs, 15, value_origin);
 	regs->defined |= 0x8000;
 	regs->relative &= ~0x8000;
 	regs->merged &= 0x7FFF;
@@ -904,7 +933,7 @@ void set_segment_register_undefined(struct Registers *regs, unsigned int index,
 	const int mask = ~(0x1000 << index);
 	assert(index < 4);
 
-	regs->last_update[index + 12] = last_update;
+	set_last_update(regs, index + 12, last_update);
 	regs->defined &= mask;
 	regs->relative &= mask;
 	regs->merged &= mask;
@@ -912,8 +941,8 @@ void set_segment_register_undefined(struct Registers *regs, unsigned int index,
 
 void set_register_sp_relative(struct Registers *regs, const char *last_update, const char *value_origin, uint16_t value) {
 	regs->sp = value;
-	regs->last_update[8] = last_update;
-	regs->value_origin[8] = value_origin;
+	set_last_update(regs, 8, last_update);
+	set_value_origin(regs, 8, value_origin);
 	regs->defined |= 0x0100;
 	regs->relative |= 0x0100;
 	regs->merged &= ~0xFEFF;
@@ -921,8 +950,8 @@ void set_register_sp_relative(struct Registers *regs, const char *last_update, c
 
 void set_register_es_relative(struct Registers *regs, const char *last_update, const char *value_origin, uint16_t value) {
 	regs->es = value;
-	regs->last_update[12] = last_update;
-	regs->value_origin[12] = value_origin;
+	set_last_update(regs, 12, last_update);
+	set_value_origin(regs, 12, value_origin);
 	regs->defined |= 0x1000;
 	regs->relative |= 0x1000;
 	regs->merged &= ~0xEFFF;
@@ -930,8 +959,8 @@ void set_register_es_relative(struct Registers *regs, const char *last_update, c
 
 void set_register_cs_relative(struct Registers *regs, const char *last_update, const char *value_origin, uint16_t value) {
 	regs->cs = value;
-	regs->last_update[13] = last_update;
-	regs->value_origin[13] = value_origin;
+	set_last_update(regs, 13, last_update);
+	set_value_origin(regs, 13, value_origin);
 	regs->defined |= 0x2000;
 	regs->relative |= 0x2000;
 	regs->merged &= ~0xDFFF;
@@ -939,8 +968,8 @@ void set_register_cs_relative(struct Registers *regs, const char *last_update, c
 
 void set_register_ss_relative(struct Registers *regs, const char *last_update, const char *value_origin, uint16_t value) {
 	regs->ss = value;
-	regs->last_update[14] = last_update;
-	regs->value_origin[14] = value_origin;
+	set_last_update(regs, 14, last_update);
+	set_value_origin(regs, 14, value_origin);
 	regs->defined |= 0x4000;
 	regs->relative |= 0x4000;
 	regs->merged &= ~0xBFFF;
@@ -948,8 +977,8 @@ void set_register_ss_relative(struct Registers *regs, const char *last_update, c
 
 void set_register_ds_relative(struct Registers *regs, const char *last_update, const char *value_origin, uint16_t value) {
 	regs->ds = value;
-	regs->last_update[15] = last_update;
-	regs->value_origin[15] = value_origin;
+	set_last_update(regs, 15, last_update);
+	set_value_origin(regs, 15, value_origin);
 	regs->defined |= 0x8000;
 	regs->relative |= 0x8000;
 	regs->merged &= ~0x7FFF;
@@ -988,38 +1017,27 @@ void set_register_sp_relative_from_bp(struct Registers *regs, const char *last_u
 		regs->defined &= 0xFEFF;
 		regs->relative = regs->relative & 0xFEFF | 1;
 		regs->sp = value;
-		regs->last_update[8] = last_update;
+		set_last_update(regs, 8, last_update);
 		regs->merged &= 0xFEFF;
 	}
 }
 
 void copy_registers(struct Registers *target_regs, const struct Registers *source_regs) {
-	int i;
-
-	/* TODO: Optimise this copy */
-	target_regs->al = source_regs->al;
-	target_regs->ah = source_regs->ah;
-	target_regs->cl = source_regs->cl;
-	target_regs->ch = source_regs->ch;
-	target_regs->dl = source_regs->dl;
-	target_regs->dh = source_regs->dh;
-	target_regs->bl = source_regs->bl;
-	target_regs->bh = source_regs->bh;
-	target_regs->sp = source_regs->sp;
-	target_regs->bp = source_regs->bp;
-	target_regs->si = source_regs->si;
-	target_regs->di = source_regs->di;
-	target_regs->es = source_regs->es;
-	target_regs->cs = source_regs->cs;
-	target_regs->ss = source_regs->ss;
-	target_regs->ds = source_regs->ds;
-	target_regs->defined = source_regs->defined;
-	target_regs->relative = source_regs->relative;
-	target_regs->merged = source_regs->merged;
+	struct RegisterProvenance *provenance = target_regs->provenance;
+	*target_regs = *source_regs;
+	target_regs->provenance = provenance;
 
-	for (i = 0; i < 16; i++) {
-		target_regs->last_update[i] = source_regs->last_update[i];
-		target_regs->value_origin[i] = source_regs->value_origin[i];
+	if (provenance) {
+		if (source_regs->provenance) {
+			*provenance = *source_regs->provenance;
+		}
+		else {
+			int i;
+			for (i = 0; i < 16; i++) {
+				provenance->value_origin[i] = NULL;
+				provenance->last_update[i] = NULL;
+			}
+		}
 	}
 }
 
@@ -1202,13 +1220,15 @@ void merge_registers(struct Registers *regs, const struct Registers *other_regs)
 	/* This must be after checking BP, is it needs it in case SP is relative to BP */
 	merge_sp_register(regs, other_regs, regs->sp == other_regs->sp);
 
-	for (i = 0; i < 16; i++) {
-		if (regs->last_update[i] != other_regs->last_update[i]) {
-			regs->last_update[i] = NULL;
-		}
+	if (regs->provenance) {
+		for (i = 0; i < 16; i++) {
+			if (get_last_update(regs, i) != get_last_update(other_regs, i)) {
+				set_last_update(regs, i, NULL);
+			}
 
-		if (regs->value_origin[i] != other_regs->value_origin[i]) {
-			regs->value_origin[i] = NULL;
+			if (get_value_origin(regs, i) != get_value_origin(other_regs, i)) {
+				set_value_origin(regs, i, NULL);
+			}
 		}
 	}
 
@@ -1304,6 +1324,83 @@ int changes_on_merging_registers(const struct Registers *regs, const struct Regi
 	return 0;
 }
 
+void widen_registers(struct Registers *regs, const struct Registers *other_regs) {
+	int i;
+	merge_registers(regs, other_regs);
+
+	for (i = 0; i < 4; i++) {
+		const int def_mask = 3 << i * 2;
+		if ((regs->defined & def_mask) != def_mask) {
+			regs->relative &= ~(0x10 << i);
+		}
+	}
+
+	for (i = 4; i < 12; i++) {
+		const int mask = 0x10 << i;
+		if (!(regs->defined & mask)) {
+			regs->relative &= ~mask;
+		}
+	}
+}
+
+unsigned int count_defined_in_registers(const struct Registers *regs) {
+	unsigned int count = 0;
+	int i;
+	for (i = 0; i < 16; i++) {
+		if (regs->defined & 1 << i) {
+			count++;
+		}
+
+		if (regs->relative & 1 << i) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+int are_registers_equal(const struct Registers *regs, const struct Registers *other_regs) {
+	int i;
+	if (regs->defined != other_regs->defined || regs->relative != other_regs->relative || regs->merged != other_regs->merged ||
+			regs->al != other_regs->al || regs->ah != other_regs->ah ||
+			regs->cl != other_regs->cl || regs->ch != other_regs->ch ||
+			regs->dl != other_regs->dl || regs->dh != other_regs->dh ||
+			regs->bl != other_regs->bl || regs->bh != other_regs->bh ||
+			regs->sp != other_regs->sp || regs->bp != other_regs->bp ||
+			regs->si != other_regs->si || regs->di != other_regs->di ||
+			regs->es != other_regs->es || regs->cs != other_regs->cs ||
+			regs->ss != other_regs->ss || regs->ds != other_regs->ds) {
+		return 0;
+	}
+
+	for (i = 0; regs->provenance != other_regs->provenance && i < 16; i++) {
+		if (get_value_origin(regs, i) != get_value_origin(other_regs, i) || get_last_update(regs, i) != get_last_update(other_regs, i)) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+unsigned long hash_registers(const struct Registers *regs) {
+	unsigned long hash = regs->defined;
+	hash = hash * 31 + regs->relative;
+	hash = hash * 31 + regs->merged;
+	hash = hash * 31 + (regs->ah << 8 | regs->al);
+	hash = hash * 31 + (regs->ch << 8 | regs->cl);
+	hash = hash * 31 + (regs->dh << 8 | regs->dl);
+	hash = hash * 31 + (regs->bh << 8 | regs->bl);
+	hash = hash * 31 + regs->sp;
+	hash = hash * 31 + regs->bp;
+	hash = hash * 31 + regs->si;
+	hash = hash * 31 + regs->di;
+	hash = hash * 31 + regs->es;
+	hash = hash * 31 + regs->cs;
+	hash = hash * 31 + regs->ss;
+	hash = hash * 31 + regs->ds;
+	return hash;
+}
+
 void set_all_registers_undefined(struct Registers *regs) {
 	int i;
 	regs->defined = 0;
@@ -1311,8 +1408,8 @@ void set_all_registers_undefined(struct Registers *regs) {
 	regs->merged = 0;
 
 	for (i = 0; i < 16; i++) {
-		regs->last_update[i] = NULL;
-		regs->value_origin[i] = NULL;
+		set_last_update(regs, i, NULL);
+		set_value_origin(regs, i, NULL);
 	}
 }
 
@@ -1324,8 +1421,8 @@ void set_all_registers_undefined_except_cs(struct Registers *regs) {
 
 	for (i = 0; i < 16; i++) {
 		if (i != 13) {
-			regs->last_update[i] = NULL;
-			regs->value_origin[i] = NULL;
+			set_last_update(regs, i, NULL);
+			set_value_origin(regs, i, NULL);
 		}
 	}
 }
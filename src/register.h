@@ -2,6 +2,28 @@
 #define _REGISTER_H_
 #include <stdint.h>
 
+/**
+ * Instructions where the values of the registers come from.
+ *
+ * This is only required to find references to immediate values that are later
+ * used as addresses, like DOS messages printed through DX. It is kept apart
+ * from the values, so that registers can be copied and merged faster when it
+ * is not required.
+ */
+struct RegisterProvenance {
+	/**
+	 * Points to the opcode where the value in this register was set.
+	 * NULL if it is unknown.
+	 */
+	const char *value_origin[16];
+
+	/**
+	 * Points to the last opcode that modified the register value.
+	 * NULL if it is unknown.
+	 */
+	const char *last_update[16];
+};
+
 struct Registers {
 	unsigned char al;
 	unsigned char ah;
@@ -20,18 +42,6 @@ struct Registers {
 	uint16_t ss;
 	uint16_t ds;
 
-	/**
-	 * Points to the opcode where the value in this register was set.
-	 * NULL if it is unknown.
-	 */
-	const char *value_origin[16];
-
-	/**
-	 * Points to the last opcode that modified the register value.
-	 * NULL if it is unknown.
-	 */
-	const char *last_update[16];
-
 	/**
 	 * Whether the corresponding register definition and value comes from the
 	 * merging performed before the start of the current block.
@@ -68,8 +78,28 @@ struct Registers {
 	 * cannot be worked out.
 	 */
 	uint16_t relative;
+
+	/**
+	 * Provenance of the values in these registers, or NULL if it is not tracked.
+	 *
+	 * This table is not owned by the registers, and it is never replaced when copying or merging.
+	 * When it is NULL, all value origins and last updates are handled as unknown.
+	 */
+	struct RegisterProvenance *provenance;
 };
 
+/**
+ * Set all registers undefined, keeping track of their provenance in the given table.
+ * The table can be NULL if provenance is not required.
+ * This must be called before any other method, as the table is not replaced later.
+ */
+void initialize_registers(struct Registers *regs, struct RegisterProvenance *provenance);
+
+/**
+ * Returns something different from 0 if the given registers keep track of the provenance of their values.
+ */
+int is_provenance_tracked_in_registers(const struct Registers *regs);
+
 int is_register_al_defined(const struct Registers *regs);
 int is_register_ah_defined(const struct Registers *regs);
 int is_register_cl_defined(const struct Registers *regs);
@@ -197,9 +227,42 @@ void set_segment_register_undefined(struct Registers *regs, unsigned int index,
 
 void set_register_sp_relative_from_bp(struct Registers *regs, const char *last_update, int value);
 
+/**
+ * Copy the values of the source registers into the target ones.
+ * Provenance is only copied if the target registers track it. If the source registers do not, it is copied as unknown.
+ */
 void copy_registers(struct Registers *target_regs, const struct Registers *source_regs);
 void merge_registers(struct Registers *regs, const struct Registers *other_regs);
 int changes_on_merging_registers(const struct Registers *regs, const struct Registers *other_regs);
+
+/**
+ * Merge the given registers as merge_registers does, but also discarding any
+ * relative or local information for the registers that are undefined after the merge.
+ *
+ * This is used instead of merge_registers for blocks that have been evaluated
+ * too many times, in order to reach the fixed point faster.
+ */
+void widen_registers(struct Registers *regs, const struct Registers *other_regs);
+
+/**
+ * Returns the number of definition and relative flags set in the given registers.
+ *
+ * Merging or widening never increases this number, so it can be used to check
+ * whether widening has actually changed anything.
+ */
+unsigned int count_defined_in_registers(const struct Registers *regs);
+
+/**
+ * Returns something different from 0 if both registers hold exactly the same values,
+ * flags, value origins and last updates, so that any of them can be used in place of the other.
+ */
+int are_registers_equal(const struct Registers *regs, const struct Registers *other_regs);
+
+/**
+ * Returns a hash of the values and flags in the given registers.
+ * Registers that are equal according to are_registers_equal will always have the same hash.
+ */
+unsigned long hash_registers(const struct Registers *regs);
 void set_all_registers_undefined(struct Registers *regs);
 void set_all_registers_undefined_except_cs(struct Registers *regs);
 
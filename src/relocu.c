@@ -1,11 +1,136 @@
 #include "relocu.h"
+#include <stdlib.h>
 
-int is_relocation_present_in_sorted_relocations(const char **sorted_relocations, unsigned int relocation_count, const char *relocation_query) {
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+/**
+ * Linear addresses are below 0x10FFF0, so 3 passes of 8 bits are enough.
+ */
+#define RADIX_PASSES 3
+
+static unsigned long linear_address_of(const struct FarPointer *pointer) {
+	return ((unsigned long) pointer->segment) * 16 + pointer->offset;
+}
+
+static int sort_linear_addresses(unsigned long *addresses, unsigned int count) {
+	unsigned long *temp = malloc(sizeof(unsigned long) * count);
+	unsigned long *source = addresses;
+	unsigned long *target = temp;
+	unsigned int bucket_starts[RADIX_BUCKETS];
+	unsigned int pass;
+	unsigned int i;
+
+	if (!temp) {
+		return 1;
+	}
+
+	for (pass = 0; pass < RADIX_PASSES; pass++) {
+		const unsigned int shift = pass * RADIX_BITS;
+		unsigned long *swap;
+		unsigned int position = 0;
+
+		for (i = 0; i < RADIX_BUCKETS; i++) {
+			bucket_starts[i] = 0;
+		}
+
+		for (i = 0; i < count; i++) {
+			bucket_starts[(source[i] >> shift) & (RADIX_BUCKETS - 1)]++;
+		}
+
+		for (i = 0; i < RADIX_BUCKETS; i++) {
+			const unsigned int bucket_count = bucket_starts[i];
+			bucket_starts[i] = position;
+			position += bucket_count;
+		}
+
+		for (i = 0; i < count; i++) {
+			target[bucket_starts[(source[i] >> shift) & (RADIX_BUCKETS - 1)]++] = source[i];
+		}
+
+		swap = source;
+		source = target;
+		target = swap;
+	}
+
+	/* After an odd number of passes, the result is in temp */
+	if (source != addresses) {
+		for (i = 0; i < count; i++) {
+			addresses[i] = source[i];
+		}
+	}
+
+	free(temp);
+	return 0;
+}
+
+int initialize_sorted_relocations(struct SortedRelocations *relocations, const struct FarPointer *relocation_table, unsigned int relocation_count, const char *buffer, unsigned int buffer_size) {
+	unsigned long *addresses;
+	unsigned int i;
+
+	relocations->pointers = NULL;
+	relocations->count = 0;
+	relocations->buffer = buffer;
+	relocations->buffer_size = buffer_size;
+	relocations->bitmap = NULL;
+
+	if (!relocation_count) {
+		return 0;
+	}
+
+	addresses = malloc(sizeof(unsigned long) * relocation_count);
+	if (!addresses) {
+		return 1;
+	}
+
+	for (i = 0; i < relocation_count; i++) {
+		addresses[i] = linear_address_of(relocation_table + i);
+	}
+
+	if (sort_linear_addresses(addresses, relocation_count)) {
+		free(addresses);
+		return 1;
+	}
+
+	relocations->pointers = malloc(sizeof(const char *) * relocation_count);
+	relocations->bitmap = allocate_bitset(buffer_size);
+	if (!relocations->pointers || !relocations->bitmap) {
+		free(relocations->pointers);
+		free(relocations->bitmap);
+		relocations->pointers = NULL;
+		relocations->bitmap = NULL;
+		free(addresses);
+		return 1;
+	}
+
+	for (i = 0; i < relocation_count; i++) {
+		relocations->pointers[i] = buffer + addresses[i];
+		if (addresses[i] < buffer_size) {
+			set_bitset_value(relocations->bitmap, addresses[i], 1);
+		}
+	}
+
+	relocations->count = relocation_count;
+	free(addresses);
+	return 0;
+}
+
+int is_relocation_present_in_sorted_relocations(const struct SortedRelocations *relocations, const char *relocation_query) {
 	int first = 0;
-	int last = relocation_count;
+	int last = relocations->count;
+
+	if (!relocations->count) {
+		return 0;
+	}
+
+	if (relocation_query >= relocations->buffer && relocation_query < relocations->buffer + relocations->buffer_size) {
+		return get_bitset_value(relocations->bitmap, relocation_query - relocations->buffer);
+	}
+
+	/* Relocations outside the image are not present in the bitmap */
 	while (last > first) {
 		int index = (first + last) / 2;
-		const char *this_relocation = sorted_relocations[index];
+		const char *this_relocation = relocations->pointers[index];
 		if (this_relocation < relocation_query) {
 			first = index + 1;
 		}
@@ -19,3 +144,11 @@ int is_relocation_present_in_sorted_relocations(const char **sorted_relocations,
 
 	return 0;
 }
+
+void clear_sorted_relocations(struct SortedRelocations *relocations) {
+	free(relocations->pointers);
+	free(relocations->bitmap);
+	relocations->pointers = NULL;
+	relocations->count = 0;
+	relocations->bitmap = NULL;
+}
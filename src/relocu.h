@@ -1,6 +1,59 @@
 #ifndef _RELOCATIONS_H_
 #define _RELOCATIONS_H_
 
-int is_relocation_present_in_sorted_relocations(const char **sorted_relocations, unsigned int relocation_count, const char *relocation_query);
+#include "fpointer.h"
+#include "packed.h"
+
+/**
+ * Positions within the loaded image that the DOS loader patches with the segment where the program is loaded.
+ */
+struct SortedRelocations {
+	/**
+	 * Position of each relocation, sorted from lower to higher address.
+	 */
+	const char **pointers;
+
+	/**
+	 * Number of relocations in the pointers array.
+	 */
+	unsigned int count;
+
+	/**
+	 * Start of the loaded image.
+	 */
+	const char *buffer;
+
+	/**
+	 * Size in bytes of the loaded image.
+	 */
+	unsigned int buffer_size;
+
+	/**
+	 * Bitset with one bit per byte in the loaded image, set for each position where a relocation is present.
+	 * This is NULL if there are no relocations.
+	 */
+	packed_data_t *bitmap;
+};
+
+/**
+ * Sort the given relocation table and build the bitmap for the given image.
+ *
+ * Relocations are sorted with a radix sort on their linear address, that is
+ * bounded because segment and offset are both 16 bits.
+ *
+ * This method may require allocating memory. It will return 0 on success, or any other value on failure.
+ */
+int initialize_sorted_relocations(struct SortedRelocations *relocations, const struct FarPointer *relocation_table, unsigned int relocation_count, const char *buffer, unsigned int buffer_size);
+
+/**
+ * Check if there is a relocation at the given position.
+ * This takes constant time for any position within the loaded image.
+ */
+int is_relocation_present_in_sorted_relocations(const struct SortedRelocations *relocations, const char *relocation_query);
+
+/**
+ * Free all the allocated memory and leave it empty.
+ */
+void clear_sorted_relocations(struct SortedRelocations *relocations);
 
 #endif /* _RELOCATIONS_H_ */
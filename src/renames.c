@@ -22,6 +22,11 @@ struct EntryLimits {
 #define ENTRIES_PER_PAGE 32
 #define BYTES_PER_BUFFER_PAGE 1024
 
+/**
+ * Decimal digits accepted for function numbers in label keys.
+ */
+#define FUNC_NUMBER_MAX_DIGITS 9
+
 struct MutableRenameMap {
 	struct KeyValuePair *entries;
 	char *buffer;
@@ -114,6 +119,152 @@ static int insert_entry(struct MutableRenameMap *map, const struct EntryLimits *
 	return 0;
 }
 
+void initialize_rename_map(struct RenameMap *map) {
+	map->entries = NULL;
+	map->entry_count = 0;
+	map->labels = NULL;
+	map->label_capacity = 0;
+}
+
+/**
+ * Parse the given number of uppercase hexadecimal digits, as generated by the printers.
+ * Returns the pointer to the first character after them, or NULL if any of them is not valid.
+ */
+static const char *parse_hex_digits(const char *str, unsigned int digit_count, unsigned long *value) {
+	*value = 0;
+	while (digit_count-- > 0) {
+		const char ch = *(str++);
+		if (ch >= '0' && ch <= '9') {
+			*value = (*value << 4) + (ch - '0');
+		}
+		else if (ch >= 'A' && ch <= 'F') {
+			*value = (*value << 4) + (ch - 'A' + 10);
+		}
+		else {
+			return NULL;
+		}
+	}
+
+	return str;
+}
+
+/**
+ * Check if the given key is a label that can be generated by the printers, and extract its components.
+ * Returns 0 if it is a label, or any other value if it is not.
+ */
+static int parse_label_key(const char *key, struct RenameLabel *label) {
+	unsigned long ip;
+	unsigned long cs;
+	const char *str;
+
+	label->func_number = 0;
+	if (!strncmp(key, "var", 3)) {
+		str = parse_hex_digits(key + 3, 4, &label->value);
+		if (str && *str == '\0') {
+			label->kind = RENAME_LABEL_KIND_BIN_VARIABLE;
+			return 0;
+		}
+
+		str = parse_hex_digits(key + 3, 5, &label->value);
+		if (str && *str == '\0') {
+			label->kind = RENAME_LABEL_KIND_DOS_VARIABLE;
+			return 0;
+		}
+
+		return 1;
+	}
+
+	if (!strncmp(key, "func", 4)) {
+		unsigned int digit_count = 0;
+		key += 4;
+
+		/* Function numbers start at 1 and are printed without leading zeros */
+		if (*key < '1' || *key > '9') {
+			return 1;
+		}
+
+		while (*key >= '0' && *key <= '9') {
+			if (++digit_count > FUNC_NUMBER_MAX_DIGITS) {
+				return 1;
+			}
+
+			label->func_number = label->func_number * 10 + (*(key++) - '0');
+		}
+
+		if (*(key++) != '_') {
+			return 1;
+		}
+	}
+
+	if (strncmp(key, "addr", 4) || !(str = parse_hex_digits(key + 4, 4, &ip))) {
+		return 1;
+	}
+
+	if (*str == '\0') {
+		label->kind = RENAME_LABEL_KIND_BIN_CODE;
+		label->value = ip;
+		return 0;
+	}
+
+	cs = ip;
+	if (*str != '_' || !(str = parse_hex_digits(str + 1, 4, &ip)) || *str != '\0') {
+		return 1;
+	}
+
+	label->kind = RENAME_LABEL_KIND_DOS_CODE;
+	label->value = (cs << 16) | ip;
+	return 0;
+}
+
+static unsigned int hash_label(unsigned int kind, unsigned int func_number, unsigned long value) {
+	unsigned long hash = value;
+	hash = hash * 31 + func_number;
+	hash = hash * 31 + kind;
+	hash ^= hash >> 15;
+	hash *= 0x2C1B3C6DUL;
+	hash ^= hash >> 12;
+	return (unsigned int) hash;
+}
+
+/**
+ * Build the label index for all the entries in the map.
+ * This method may require allocating memory. It will return 0 on success, or any other value on failure.
+ */
+static int index_labels(struct RenameMap *map) {
+	unsigned int capacity = 1;
+	unsigned int index;
+
+	while (capacity < map->entry_count * 2) {
+		capacity <<= 1;
+	}
+
+	map->labels = malloc(capacity * sizeof(struct RenameLabel));
+	if (!map->labels) {
+		fprintf(stderr, "Unable to allocate %lu bytes.\n", (unsigned long) (capacity * sizeof(struct RenameLabel)));
+		return 1;
+	}
+
+	map->label_capacity = capacity;
+	for (index = 0; index < capacity; index++) {
+		map->labels[index].entry_index = -1;
+	}
+
+	for (index = 0; index < map->entry_count; index++) {
+		struct RenameLabel label;
+		if (!parse_label_key(map->entries[index].key, &label)) {
+			unsigned int slot = hash_label(label.kind, label.func_number, label.value) & (capacity - 1);
+			while (map->labels[slot].entry_index >= 0) {
+				slot = (slot + 1) & (capacity - 1);
+			}
+
+			label.entry_index = index;
+			map->labels[slot] = label;
+		}
+	}
+
+	return 0;
+}
+
 int read_renames_file(struct RenameMap *map, const char *filename) {
 	FILE *file;
 	char file_buffer[BUFFER_SIZE];
@@ -125,6 +276,7 @@ int read_renames_file(struct RenameMap *map, const char *filename) {
 	struct MutableRenameMap mutable_map;
 	unsigned int index;
 
+	initialize_rename_map(map);
 	mutable_map.buffer = NULL;
 	mutable_map.buffer_in_use = 0;
 	mutable_map.entries = NULL;
@@ -215,7 +367,13 @@ int read_renames_file(struct RenameMap *map, const char *filename) {
 
 	free(mutable_map.entries);
 	free(mutable_map.buffer);
-	return 0;
+	return index_labels(map);
+}
+
+void free_rename_map(struct RenameMap *map) {
+	free(map->entries);
+	free(map->labels);
+	initialize_rename_map(map);
 }
 
 int index_of_key_in_rename_map(const struct RenameMap *map, const char *key) {
@@ -244,6 +402,24 @@ int index_of_key_in_rename_map(const struct RenameMap *map, const char *key) {
 	return -1;
 }
 
+int index_of_label_in_rename_map(const struct RenameMap *map, unsigned int kind, unsigned int func_number, unsigned long value) {
+	const unsigned int mask = map->label_capacity - 1;
+	unsigned int slot;
+
+	if (!map->label_capacity) {
+		return -1;
+	}
+
+	for (slot = hash_label(kind, func_number, value) & mask; map->labels[slot].entry_index >= 0; slot = (slot + 1) & mask) {
+		const struct RenameLabel *label = map->labels + slot;
+		if (label->value == value && label->func_number == func_number && label->kind == kind) {
+			return label->entry_index;
+		}
+	}
+
+	return -1;
+}
+
 #ifdef DEBUG
 void print_rename_map(const struct RenameMap *map) {
 	unsigned int index;
@@ -11,15 +11,69 @@ struct KeyValuePairConst {
 	const char *value;
 };
 
+/**
+ * Kinds of labels generated by the printers, each one with its own key format.
+ */
+#define RENAME_LABEL_KIND_BIN_VARIABLE 0
+#define RENAME_LABEL_KIND_DOS_VARIABLE 1
+#define RENAME_LABEL_KIND_BIN_CODE 2
+#define RENAME_LABEL_KIND_DOS_CODE 3
+
+/**
+ * Entry in the label index, identifying a label by its numeric components instead of its formatted key.
+ */
+struct RenameLabel {
+	/**
+	 * Address of the variable, or ip of the code label. For DOS code labels, cs is also included in the upper 16 bits.
+	 */
+	unsigned long value;
+
+	/**
+	 * Number of the function containing the code label, as it appears in the key, or 0 if there is no function prefix.
+	 */
+	unsigned int func_number;
+
+	/**
+	 * One of the RENAME_LABEL_KIND constants.
+	 */
+	unsigned int kind;
+
+	/**
+	 * Index of the corresponding entry in the map, or -1 if this slot in the index is empty.
+	 */
+	int entry_index;
+};
+
 struct RenameMap {
+	/**
+	 * Sorted by key.
+	 */
 	struct KeyValuePairConst *entries;
 	unsigned int entry_count;
+
+	/**
+	 * Open addressing hash table for all the entries whose key matches a label generated by the printers.
+	 * Its capacity is always a power of 2, or 0 if there is no index.
+	 */
+	struct RenameLabel *labels;
+	unsigned int label_capacity;
 };
 
+/**
+ * Set all its values. After this, the map will be empty.
+ */
+void initialize_rename_map(struct RenameMap *map);
+
 int read_renames_file(struct RenameMap *map, const char *filename);
 void free_rename_map(struct RenameMap *map);
 
 int index_of_key_in_rename_map(const struct RenameMap *map, const char *key);
+
+/**
+ * Returns the index of the entry whose key is the label with the given components, or -1 if there is none.
+ * This is equivalent to formatting the label and calling index_of_key_in_rename_map, but without formatting it.
+ */
+int index_of_label_in_rename_map(const struct RenameMap *map, unsigned int kind, unsigned int func_number, unsigned long value);
 #ifdef DEBUG
 void print_rename_map(const struct RenameMap *map);
 #endif /* DEBUG */
@@ -0,0 +1,458 @@
+#include "session.h"
+#include "dumpers.h"
+#include "finder.h"
+#include "funcfind.h"
+#include "printd.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+struct dos_header {
+	uint16_t magic; /* Must be "MZ" */
+	uint16_t bytes_in_last_page;
+	uint16_t pages_count;
+	uint16_t relocations_count;
+	uint16_t header_paragraphs;
+	uint16_t required_paragraphs;
+	uint16_t desired_paragraphs;
+	uint16_t initial_stack_segment;
+	uint16_t initial_stack_pointer;
+	uint16_t checksum;
+	uint16_t initial_ip;
+	uint16_t initial_cs;
+	uint16_t relocation_table_offset;
+};
+
+static int sort_relocations(struct SegmentReadResult *result) {
+	if (initialize_sorted_relocations(&result->sorted_relocations, result->relocation_table, result->relocation_count, result->buffer, result->size)) {
+		fprintf(stderr, "Unable to allocate memory for the sorted relocations\n");
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Make buffer point directly to the given whole image in memory, without copying its contents,
+ * and copy its relocation table into a new array, as it may not be aligned within the image.
+ * This will return 0 on success, or any other value if the image is invalid, reporting the reason.
+ */
+static int parse_image(struct SegmentReadResult *result, char *data, unsigned long size, const char *format) {
+	result->relocation_table = NULL;
+	result->relocation_count = 0;
+	if (!strcmp(format, "dos")) {
+		struct dos_header header;
+		unsigned long header_size;
+		unsigned long file_size;
+
+		if (size < sizeof(header)) {
+			fprintf(stderr, "Unexpected end of file\n");
+			return 1;
+		}
+
+		/* This is assuming that the processor running this is also little endian */
+		memcpy(&header, data, sizeof(header));
+		if (header.magic != 0x5A4D ||
+				header.bytes_in_last_page >= 0x200 ||
+				header.required_paragraphs > header.desired_paragraphs) {
+			fprintf(stderr, "Invalid dos file\n");
+			return 1;
+		}
+
+		if (header.relocation_table_offset + sizeof(struct FarPointer) * header.relocations_count > size) {
+			fprintf(stderr, "Unable to read relocation table from file\n");
+			return 1;
+		}
+
+		header_size = header.header_paragraphs * 16;
+		if (header.bytes_in_last_page) {
+			file_size = (header.pages_count - 1) * 512UL + header.bytes_in_last_page;
+		}
+		else {
+			file_size = header.pages_count * 512UL;
+		}
+
+		if (header_size > file_size || file_size > size) {
+			fprintf(stderr, "Unable to read code and data from file\n");
+			return 1;
+		}
+
+		if (header.relocations_count > 0) {
+			result->relocation_table = malloc(sizeof(struct FarPointer) * header.relocations_count);
+			if (!result->relocation_table) {
+				fprintf(stderr, "Unable to allocate memory for relocation table\n");
+				return 1;
+			}
+
+			memcpy(result->relocation_table, data + header.relocation_table_offset, sizeof(struct FarPointer) * header.relocations_count);
+		}
+
+		result->relocation_count = header.relocations_count;
+		result->buffer = data + header_size;
+		result->size = file_size - header_size;
+		result->relative_cs = header.initial_cs;
+		result->ip = header.initial_ip;
+		result->flags = 0;
+
+		if (sort_relocations(result)) {
+			free(result->relocation_table);
+			result->relocation_table = NULL;
+			result->relocation_count = 0;
+			return 1;
+		}
+	}
+	else {
+		result->buffer = data;
+		result->size = size;
+		result->ip = 0x100;
+		result->relative_cs = -0x10;
+		mark_ds_matches_cs_at_start(result);
+		initialize_sorted_relocations(&result->sorted_relocations, NULL, 0, result->buffer, result->size);
+	}
+
+	return 0;
+}
+
+/**
+ * Read the given stream until its end into file_data, growing the buffer as required.
+ * This is used for streams that cannot be repositioned, like pipes, whose size is not known in advance.
+ * This will return 0 on success, or any other value on failure, reporting the reason.
+ */
+static int read_stream_data(struct SegmentReadResult *result, FILE *file, unsigned long *size) {
+	unsigned long capacity = 4096;
+	unsigned long read_count;
+	char *data;
+
+	*size = 0;
+	result->file_data = malloc(capacity);
+	if (!result->file_data) {
+		fprintf(stderr, "Unable to allocate memory\n");
+		return 1;
+	}
+
+	while ((read_count = fread(result->file_data + *size, 1, capacity - *size, file)) > 0) {
+		*size += read_count;
+		if (*size == capacity) {
+			data = realloc(result->file_data, capacity * 2);
+			if (!data) {
+				fprintf(stderr, "Unable to allocate memory\n");
+				free(result->file_data);
+				result->file_data = NULL;
+				return 1;
+			}
+
+			result->file_data = data;
+			capacity *= 2;
+		}
+	}
+
+	if (ferror(file)) {
+		fprintf(stderr, "Unable to read code and data from file\n");
+		free(result->file_data);
+		result->file_data = NULL;
+		return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Read the whole content of the given file into file_data, for files that cannot be mapped in memory.
+ * This will return 0 on success, or any other value on failure, reporting the reason.
+ */
+static int read_file_data(struct SegmentReadResult *result, FILE *file, unsigned long *size) {
+	long end;
+	if (fseek(file, 0, SEEK_END) || (end = ftell(file)) < 0 || fseek(file, 0, SEEK_SET)) {
+		clearerr(file);
+		return read_stream_data(result, file, size);
+	}
+
+	*size = end;
+	result->file_data = malloc(*size);
+	if (!result->file_data) {
+		fprintf(stderr, "Unable to allocate memory\n");
+		return 1;
+	}
+
+	if (fread(result->file_data, 1, *size, file) != *size) {
+		fprintf(stderr, "Unable to read code and data from file\n");
+		free(result->file_data);
+		result->file_data = NULL;
+		return 1;
+	}
+
+	return 0;
+}
+
+static int read_file(struct SegmentReadResult *result, const char *filename, const char *format) {
+	FILE *file;
+	char *data;
+	unsigned long size;
+
+	if (strcmp(format, "bin") && strcmp(format, "dos")) {
+		fprintf(stderr, "Undefined format '%s'. It must be 'bin' or 'dos'\n", format);
+		return 1;
+	}
+
+	file = fopen(filename, "r");
+	if (!file) {
+		fprintf(stderr, "Unable to open file\n");
+		return 1;
+	}
+
+	/* Files that cannot be mapped are read into memory instead, so that both are parsed the same way */
+	result->file_data = NULL;
+	if (!map_file(&result->file_map, file)) {
+		data = result->file_map.data;
+		size = result->file_map.size;
+	}
+	else if (read_file_data(result, file, &size)) {
+		fclose(file);
+		return 1;
+	}
+	else {
+		data = result->file_data;
+	}
+
+	fclose(file);
+	if (parse_image(result, data, size, format)) {
+		unmap_file(&result->file_map);
+		free(result->file_data);
+		result->file_data = NULL;
+		return 1;
+	}
+
+	return 0;
+}
+
+void initialize_disasm_session(struct DisasmSession *session) {
+	session->state = DISASM_SESSION_STATE_EMPTY;
+	session->image = NULL;
+	session->image_capacity = 0;
+	session->pcontent = NULL;
+	session->heap_allocation_count = 0;
+	initialize_arena(&session->arena);
+	session->arena.heap_allocation_count = &session->heap_allocation_count;
+	initialize_mcbwlist_in_arena(&session->work_list, &session->arena);
+	initialize_rename_map(&session->empty_renames);
+	session->renames = &session->empty_renames;
+	session->track_provenance = 1;
+	session->stats = NULL;
+}
+
+/**
+ * Prepare all the lists required to analyse the image just read.
+ */
+static void prepare_disasm_session_lists(struct DisasmSession *session) {
+	struct SegmentReadResult *read_result = &session->read_result;
+	initialize_dicache_in_arena(&session->instruction_cache, &session->arena, read_result->buffer, read_result->size);
+	initialize_cblock_list_in_arena(&session->cblock_list, &session->arena);
+	if (index_cblock_list_positions(&session->cblock_list, read_result->buffer, read_result->size)) {
+		DEBUG_PRINT0("Unable to allocate the block position index. Blocks will be looked up by binary search.\n");
+	}
+
+	initialize_checkpoint_trail_in_arena(&session->checkpoint_trail, &session->arena);
+	session->cblock_list.checkpoint_trail = &session->checkpoint_trail;
+
+	initialize_checked_blocks_in_arena(&session->checked_blocks, &session->arena);
+	session->cblock_list.checked_blocks = &session->checked_blocks;
+
+	initialize_snapshot_store_in_arena(&session->snapshots, &session->arena);
+	session->snapshots.track_provenance = session->track_provenance;
+	session->snapshots.stats = session->stats;
+	session->cblock_list.snapshots = &session->snapshots;
+
+	session->work_list.stats = session->stats;
+
+	initialize_gvar_list_in_arena(&session->gvar_list, &session->arena);
+	initialize_segment_start_list_in_arena(&session->segment_start_list, &session->arena);
+	initialize_ref_list_in_arena(&session->ref_list, &session->arena);
+
+	initialize_printer(&session->printer_err, stderr);
+	if (ds_should_match_cs_at_segment_start(read_result)) {
+		set_printer_bin_format(&session->printer_err);
+	}
+	else {
+		set_printer_dos_format(&session->printer_err);
+	}
+
+	session->printer_err.buffer_start = read_result->buffer;
+	session->printer_err.renames = session->renames;
+	session->state = DISASM_SESSION_STATE_OPENED;
+}
+
+int open_disasm_session_from_file(struct DisasmSession *session, const char *filename, const char *format) {
+	int error_code;
+	assert(session->state == DISASM_SESSION_STATE_EMPTY);
+	if ((error_code = read_file(&session->read_result, filename, format))) {
+		return error_code;
+	}
+
+	prepare_disasm_session_lists(session);
+	return 0;
+}
+
+int open_disasm_session_from_memory(struct DisasmSession *session, const char *data, unsigned long size, const char *format) {
+	assert(session->state == DISASM_SESSION_STATE_EMPTY);
+	if (strcmp(format, "bin") && strcmp(format, "dos")) {
+		fprintf(stderr, "Undefined format '%s'. It must be 'bin' or 'dos'\n", format);
+		return 1;
+	}
+
+	if (!size) {
+		fprintf(stderr, "Empty image\n");
+		return 1;
+	}
+
+	if (size > session->image_capacity) {
+		char *new_image = malloc(size);
+		if (!new_image) {
+			fprintf(stderr, "Unable to allocate memory\n");
+			return 1;
+		}
+
+		free(session->image);
+		session->image = new_image;
+		session->image_capacity = size;
+	}
+
+	memcpy(session->image, data, size);
+	initialize_file_map(&session->read_result.file_map);
+	session->read_result.file_data = NULL;
+	if (parse_image(&session->read_result, session->image, size, format)) {
+		return 1;
+	}
+
+	prepare_disasm_session_lists(session);
+	return 0;
+}
+
+int analyse_disasm_session(struct DisasmSession *session) {
+	assert(session->state == DISASM_SESSION_STATE_OPENED);
+	session->pcontent = compose_pcontent(&session->read_result, &session->instruction_cache, &session->printer_err, &session->cblock_list, &session->work_list, &session->gvar_list, &session->segment_start_list, &session->ref_list);
+
+	/* Blocks are not split after this point, so checkpoints are no longer required */
+	session->cblock_list.checkpoint_trail = NULL;
+	clear_checkpoint_trail(&session->checkpoint_trail);
+	session->cblock_list.checked_blocks = NULL;
+	clear_checked_blocks(&session->checked_blocks);
+	if (!session->pcontent) {
+		return 1;
+	}
+
+	DEBUG_PRINT1("Found %d blocks.\n", get_pcontent_block_count(session->pcontent));
+	session->state = DISASM_SESSION_STATE_ANALYSED;
+	return 0;
+}
+
+int find_disasm_session_functions(struct DisasmSession *session) {
+	int error_code;
+	assert(session->state == DISASM_SESSION_STATE_ANALYSED);
+	initialize_func_list(&session->func_list);
+	if ((error_code = find_functions(get_pcontent_blocks(session->pcontent), get_pcontent_block_count(session->pcontent), &session->func_list, &session->instruction_cache))) {
+		clear_func_list(&session->func_list);
+		return error_code;
+	}
+
+#ifdef DEBUG
+	print_funclist(&session->func_list);
+#endif /* DEBUG */
+
+	session->printer_err.func_list = &session->func_list;
+	session->state = DISASM_SESSION_STATE_FUNCTIONS_FOUND;
+	return 0;
+}
+
+int dump_disasm_session_to_printer(struct DisasmSession *session, struct FilePrinter *printer) {
+	struct SegmentReadResult *read_result = &session->read_result;
+	assert(session->state == DISASM_SESSION_STATE_FUNCTIONS_FOUND);
+	if (ds_should_match_cs_at_segment_start(read_result)) {
+		set_printer_bin_format(printer);
+	}
+	else {
+		set_printer_dos_format(printer);
+	}
+
+	printer->buffer_start = read_result->buffer;
+	printer->func_list = &session->func_list;
+	printer->renames = session->renames;
+
+	/* Only the 'bin' format matches DS and CS at the segment start */
+	if (ds_should_match_cs_at_segment_start(read_result)) {
+		print(printer, "org 0x100\n");
+	}
+
+	return dump(
+			read_result->buffer,
+			read_result->relative_cs? 0x100 : 0,
+			session->pcontent,
+			session->segment_start_list.start,
+			session->segment_start_list.count,
+			&read_result->sorted_relocations,
+			&session->instruction_cache,
+			&session->func_list,
+			printer,
+			&session->printer_err);
+}
+
+int dump_disasm_session(struct DisasmSession *session, int (*write_callback)(void *context, const char *text, unsigned int length), void *write_context) {
+	struct FilePrinter printer;
+	int error_code;
+
+	initialize_printer_with_callback(&printer, write_callback, write_context);
+
+	/* Not being able to allocate the buffer is not critical, the printer will just give each token directly */
+	set_printer_buffered(&printer, PRINTER_DEFAULT_BUFFER_SIZE);
+
+	error_code = dump_disasm_session_to_printer(session, &printer);
+	if (clear_printer(&printer) && !error_code) {
+		error_code = 1;
+	}
+
+	return error_code;
+}
+
+void discard_disasm_session_analysis(struct DisasmSession *session) {
+	assert(session->state != DISASM_SESSION_STATE_EMPTY);
+	if (session->state == DISASM_SESSION_STATE_FUNCTIONS_FOUND) {
+		clear_func_list(&session->func_list);
+	}
+
+	free(session->pcontent);
+	session->pcontent = NULL;
+	reset_mcbwlist(&session->work_list);
+	clear_checkpoint_trail(&session->checkpoint_trail);
+	clear_checked_blocks(&session->checked_blocks);
+	prepare_disasm_session_lists(session);
+}
+
+void reset_disasm_session(struct DisasmSession *session) {
+	if (session->state == DISASM_SESSION_STATE_EMPTY) {
+		return;
+	}
+
+	if (session->state == DISASM_SESSION_STATE_FUNCTIONS_FOUND) {
+		clear_func_list(&session->func_list);
+	}
+
+	free(session->pcontent);
+	session->pcontent = NULL;
+
+	/* Blocks, origins, their state snapshots, variables and references are all allocated in the arena, so they are released at once.
+	 * The work list options are kept for the following images */
+	clear_mcbwlist(&session->work_list);
+	reset_arena(&session->arena);
+	clear_srresult(&session->read_result);
+
+	session->state = DISASM_SESSION_STATE_EMPTY;
+}
+
+void clear_disasm_session(struct DisasmSession *session) {
+	reset_disasm_session(session);
+	clear_arena(&session->arena);
+	free(session->image);
+	session->image = NULL;
+	session->image_capacity = 0;
+}
@@ -0,0 +1,175 @@
+#ifndef _DISASM_SESSION_H_
+#define _DISASM_SESSION_H_
+
+#include "arena.h"
+#include "checkpt.h"
+#include "dicache.h"
+#include "finder.h"
+#include "funclist.h"
+#include "gvlist.h"
+#include "mcblist.h"
+#include "mcbwlist.h"
+#include "mreflist.h"
+#include "pcontent.h"
+#include "printu.h"
+#include "renames.h"
+#include "snapshot.h"
+#include "srresult.h"
+#include "sslist.h"
+
+/**
+ * No image is opened. The session can open a new one.
+ */
+#define DISASM_SESSION_STATE_EMPTY 0
+
+/**
+ * An image is opened, but not analysed yet.
+ */
+#define DISASM_SESSION_STATE_OPENED 1
+
+/**
+ * All code blocks, variables and references of the opened image have been found.
+ */
+#define DISASM_SESSION_STATE_ANALYSED 2
+
+/**
+ * Functions have been found as well, and the image can be dumped.
+ */
+#define DISASM_SESSION_STATE_FUNCTIONS_FOUND 3
+
+/**
+ * Everything required to disassemble an image, from reading it to dumping its assembly code.
+ *
+ * Images are disassembled one at a time. Once an image is dumped, the session can be reset to disassemble
+ * another one. All blocks, origins, variables and references are allocated in the session arena, which keeps
+ * the memory reserved for the previous images, so that following images do not need to request it again.
+ *
+ * Work list options, like the block order or the widening threshold, can be set directly in work_list,
+ * and they are kept across images.
+ */
+struct DisasmSession {
+	/**
+	 * One of the DISASM_SESSION_STATE constants.
+	 */
+	unsigned int state;
+
+	/**
+	 * Copy of the last image given to open_disasm_session_from_memory, or NULL if none.
+	 * It is reused for following images when it is large enough.
+	 */
+	char *image;
+	unsigned long image_capacity;
+
+	struct SegmentReadResult read_result;
+	struct Arena arena;
+
+	/**
+	 * Number of times that the session arena has requested memory to the system since the session was initialized.
+	 */
+	unsigned long heap_allocation_count;
+
+	struct DecodedInstructionCache instruction_cache;
+	struct MutableCodeBlockList cblock_list;
+	struct StateCheckpointTrail checkpoint_trail;
+	struct CheckedBlocks checked_blocks;
+	struct StateSnapshotStore snapshots;
+	struct MutableCodeBlockWorkList work_list;
+	struct GlobalVariableList gvar_list;
+	struct SegmentStartList segment_start_list;
+	struct MutableReferenceList ref_list;
+	struct FunctionList func_list;
+
+	/**
+	 * Result of the analysis, or NULL if the opened image has not been analysed yet.
+	 */
+	struct ProgramContent *pcontent;
+
+	/**
+	 * Printer where warnings found along the analysis and the dump are reported. It writes to the standard error.
+	 */
+	struct FilePrinter printer_err;
+
+	/**
+	 * Map of naming replacements applied when printing labels.
+	 * It points to empty_renames by default. Any other map set here must remain valid while the session uses it.
+	 */
+	struct RenameMap *renames;
+	struct RenameMap empty_renames;
+
+	/**
+	 * Whether the instructions where register values are set are tracked along the analysis.
+	 * This is set by default. Changes only take effect on the next opened image.
+	 */
+	int track_provenance;
+
+	/**
+	 * Stats where the counters of the analysis are incremented, or NULL if they are not collected.
+	 * Changes only take effect on the next opened image.
+	 */
+	struct AnalysisStats *stats;
+};
+
+/**
+ * Set all its values. After this, the session will be empty, but ready to open an image.
+ */
+void initialize_disasm_session(struct DisasmSession *session);
+
+/**
+ * Open the given file, that must be in the given format: 'bin' or 'dos'.
+ * The session must be empty. This will return 0 on success, or any other value on failure.
+ */
+int open_disasm_session_from_file(struct DisasmSession *session, const char *filename, const char *format);
+
+/**
+ * Open the given image, that must be in the given format: 'bin' or 'dos'.
+ * The session keeps its own copy of the image, so the given data is not required after this call.
+ *
+ * The session must be empty. This will return 0 on success, or any other value on failure.
+ */
+int open_disasm_session_from_memory(struct DisasmSession *session, const char *data, unsigned long size, const char *format);
+
+/**
+ * Find all code blocks, variables and references in the opened image.
+ * This will return 0 on success, or any other value on failure.
+ */
+int analyse_disasm_session(struct DisasmSession *session);
+
+/**
+ * Group the code blocks found by the analysis into functions.
+ * This will return 0 on success, or any other value on failure.
+ */
+int find_disasm_session_functions(struct DisasmSession *session);
+
+/**
+ * Print the assembly code of the image with the given printer, once its functions are found.
+ * The printer is not flushed. This will return 0 on success, or any other value on failure.
+ */
+int dump_disasm_session_to_printer(struct DisasmSession *session, struct FilePrinter *printer);
+
+/**
+ * Give the assembly code of the image to the given callback, once its functions are found.
+ * The text is given in chunks, that are not null-terminated.
+ * This will return 0 on success, or any other value on failure, including any failure reported by the callback.
+ */
+int dump_disasm_session(struct DisasmSession *session, int (*write_callback)(void *context, const char *text, unsigned int length), void *write_context);
+
+/**
+ * Discard everything found in the opened image, so that it can be analysed again from scratch.
+ * Memory used by the discarded analysis in the arena is only released when the session is reset.
+ * After this, the session will be opened.
+ */
+void discard_disasm_session_analysis(struct DisasmSession *session);
+
+/**
+ * Discard the opened image and everything found on it, keeping the memory reserved to be reused by the next image.
+ * After this, the session will be empty.
+ */
+void reset_disasm_session(struct DisasmSession *session);
+
+/**
+ * Discard the opened image, if any, and return all the memory reserved by the session to the system.
+ * After this, the session will be empty, but it can still be used to open new images.
+ */
+void clear_disasm_session(struct DisasmSession *session);
+
+#endif /* _DISASM_SESSION_H_ */
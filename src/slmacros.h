@@ -2,6 +2,7 @@
 #define _STRUCT_LIST_MACROS_H_
 
 #include <stdlib.h>
+#include "arena.h"
 
 #define DEFINE_STRUCT_LIST(struct_name, short_item_name) \
 /** \
@@ -31,13 +32,23 @@ struct struct_name ## List { \
 	 * to hold all of them. \
 	 */ \
 	unsigned int short_item_name##_count; \
+	\
+	/** \
+	 * Arena where all pages and arrays are allocated, or NULL to allocate them directly with malloc. \
+	 */ \
+	struct Arena *arena; \
 }
 
 #define DECLARE_STRUCT_LIST_INITIALIZE_METHOD(struct_name, struct_name_snake) \
 /** \
  * Set all its values. After this, this list will be empty, but ready. \
  */ \
-void initialize_##struct_name_snake##_list(struct struct_name##List *list)
+void initialize_##struct_name_snake##_list(struct struct_name##List *list); \
+\
+/** \
+ * Set all its values as initialize_##struct_name_snake##_list does, but taking all the memory from the given arena. \
+ */ \
+void initialize_##struct_name_snake##_list_in_arena(struct struct_name##List *list, struct Arena *arena)
 
 #define DECLARE_STRUCT_LIST_GET_UNSORTED_METHOD(struct_name, struct_name_snake) \
 struct struct_name *get_unsorted_##struct_name_snake(const struct struct_name##List *list, int index)
@@ -65,9 +76,17 @@ void clear_##struct_name_snake##_list(struct struct_name##List *list)
  */ \
 int insert_##struct_name_snake(struct struct_name##List *list, struct struct_name *new_##short_item_name)
 
+#define DECLARE_STRUCT_LIST_GET_SORTED_METHOD(struct_name, struct_name_snake) \
+/** \
+ * Returns the item at the given index, when sorted. \
+ * This works for any list backend, so callers should use it instead of accessing the sorted array directly. \
+ */ \
+struct struct_name *get_sorted_##struct_name_snake(const struct struct_name##List *list, int index)
+
 #define DECLARE_STRUCT_LIST_METHODS(struct_name, struct_name_snake, short_item_name, sorted_property) \
 DECLARE_STRUCT_LIST_INITIALIZE_METHOD(struct_name, struct_name_snake); \
 DECLARE_STRUCT_LIST_GET_UNSORTED_METHOD(struct_name, struct_name_snake); \
+DECLARE_STRUCT_LIST_GET_SORTED_METHOD(struct_name, struct_name_snake); \
 DECLARE_STRUCT_LIST_PREPARE_NEW_METHOD(struct_name, struct_name_snake); \
 DECLARE_STRUCT_LIST_CLEAR_METHOD(struct_name, struct_name_snake); \
 \
@@ -80,10 +99,15 @@ struct struct_name *get_unsorted_##struct_name_snake(const struct struct_name##L
 int index_of_##struct_name_snake##_with_##sorted_property(const struct struct_name##List *list, const char *sorted_property)
 
 #define DEFINE_STRUCT_LIST_INITIALIZE_METHOD(struct_name, struct_name_snake, short_item_name) \
-void initialize_##struct_name_snake##_list(struct struct_name##List *list) { \
+void initialize_##struct_name_snake##_list_in_arena(struct struct_name##List *list, struct Arena *arena) { \
 	list->short_item_name##_count = 0; \
 	list->page_array = NULL; \
 	list->sorted_##short_item_name##s = NULL; \
+	list->arena = arena; \
+} \
+\
+void initialize_##struct_name_snake##_list(struct struct_name##List *list) { \
+	initialize_##struct_name_snake##_list_in_arena(list, NULL); \
 }
 
 #define DEFINE_STRUCT_LIST_GET_UNSORTED_METHOD(struct_name, struct_name_snake, initial_items_per_page) \
@@ -91,24 +115,29 @@ struct struct_name *get_unsorted_##struct_name_snake(const struct struct_name##L
 	return list->page_array[index / initial_items_per_page] + (index % initial_items_per_page); \
 }
 
+#define DEFINE_STRUCT_LIST_GET_SORTED_METHOD(struct_name, struct_name_snake, short_item_name) \
+struct struct_name *get_sorted_##struct_name_snake(const struct struct_name##List *list, int index) { \
+	return list->sorted_##short_item_name##s[index]; \
+}
+
 #define DEFINE_STRUCT_LIST_PREPARE_NEW_METHOD(struct_name, struct_name_snake, short_item_name, initial_page_array_granularity, initial_items_per_page) \
 struct struct_name *prepare_new_##struct_name_snake(struct struct_name##List *list) { \
 	if ((list->short_item_name##_count % initial_items_per_page) == 0) { \
 		struct struct_name *new_page; \
 		if ((list->short_item_name##_count % (initial_items_per_page * initial_page_array_granularity)) == 0) { \
-			const int new_page_array_length = (list->short_item_name##_count / (initial_items_per_page * initial_page_array_granularity)) + initial_page_array_granularity; \
-			list->page_array = realloc(list->page_array, new_page_array_length * sizeof(struct struct_name *)); \
+			const int new_page_array_length = (list->short_item_name##_count / initial_items_per_page) + initial_page_array_granularity; \
+			list->page_array = reallocate_in_arena(list->arena, list->page_array, new_page_array_length * sizeof(struct struct_name *)); \
 			if (!(list->page_array)) { \
 				return NULL; \
 			} \
 \
-			list->sorted_##short_item_name##s = realloc(list->sorted_##short_item_name##s, new_page_array_length * initial_items_per_page * sizeof(struct struct_name *)); \
+			list->sorted_##short_item_name##s = reallocate_in_arena(list->arena, list->sorted_##short_item_name##s, new_page_array_length * initial_items_per_page * sizeof(struct struct_name *)); \
 			if (!(list->sorted_##short_item_name##s)) { \
 				return NULL; \
 			} \
 		} \
 \
-		new_page = malloc(initial_items_per_page * sizeof(struct struct_name)); \
+		new_page = allocate_in_arena(list->arena, initial_items_per_page * sizeof(struct struct_name)); \
 		if (!new_page) { \
 			return NULL; \
 		} \
@@ -125,11 +154,11 @@ void clear_##struct_name_snake##_list(struct struct_name##List *list) { \
 		const int allocated_pages = (list->short_item_name##_count + initial_items_per_page - 1) / initial_items_per_page; \
 		int i; \
 		for (i = allocated_pages - 1; i >= 0; i--) { \
-			free(list->page_array[i]); \
+			release_in_arena(list->arena, list->page_array[i]); \
 		} \
 \
-		free(list->page_array); \
-		free(list->sorted_##short_item_name##s); \
+		release_in_arena(list->arena, list->page_array); \
+		release_in_arena(list->arena, list->sorted_##short_item_name##s); \
 		list->page_array = NULL; \
 		list->sorted_##short_item_name##s = NULL; \
 		list->short_item_name##_count = 0; \
@@ -211,10 +240,418 @@ int insert_##struct_name_snake(struct struct_name##List *list, struct struct_nam
 #define DEFINE_STRUCT_LIST_METHODS(struct_name, struct_name_snake, short_item_name, sorted_property, initial_page_array_granularity, initial_items_per_page) \
 DEFINE_STRUCT_LIST_INITIALIZE_METHOD(struct_name, struct_name_snake, short_item_name) \
 DEFINE_STRUCT_LIST_GET_UNSORTED_METHOD(struct_name, struct_name_snake, initial_items_per_page) \
+DEFINE_STRUCT_LIST_GET_SORTED_METHOD(struct_name, struct_name_snake, short_item_name) \
 DEFINE_STRUCT_LIST_PREPARE_NEW_METHOD(struct_name, struct_name_snake, short_item_name, initial_page_array_granularity, initial_items_per_page) \
 DEFINE_STRUCT_LIST_CLEAR_METHOD(struct_name, struct_name_snake, short_item_name, initial_items_per_page) \
 DEFINE_STRUCT_LIST_INDEX_OF_WITH_METHOD(struct_name, struct_name_snake, short_item_name, sorted_property) \
 DEFINE_STRUCT_LIST_INDEX_OF_CONTAINING_METHOD(struct_name, struct_name_snake, short_item_name, sorted_property) \
 DEFINE_STRUCT_LIST_INSERT_METHOD(struct_name, struct_name_snake, short_item_name, sorted_property)
 
+/*
+ * Chunked backend.
+ *
+ * Lists defined with DEFINE_STRUCT_CHUNKED_LIST and DEFINE_STRUCT_CHUNKED_LIST_METHODS expose the same methods
+ * as the ones above, so a list type can switch from one backend to the other without changing its callers,
+ * as long as they access the sorted items through get_sorted_<struct_name_snake>.
+ *
+ * Instead of keeping all pointers in a single sorted array, where each insertion has to shift all the items
+ * after it, pointers are kept in sorted chunks of limited capacity. Each insertion only shifts the items within
+ * its chunk, splitting it when full. The number of items in each chunk is kept in a Fenwick tree, so that the
+ * sorted index of the first item in a chunk, and the chunk holding a given sorted index, are found in logarithmic
+ * time, and an insertion only updates a logarithmic number of its entries. The tree is only rebuilt when a chunk
+ * is split, which happens at most once every STRUCT_CHUNKED_LIST_CHUNK_CAPACITY / 2 insertions.
+ */
+
+/**
+ * Maximum number of item pointers that each chunk can hold.
+ */
+#define STRUCT_CHUNKED_LIST_CHUNK_CAPACITY 64
+
+/**
+ * Minimum number of chunks that the chunk array can hold once allocated.
+ */
+#define STRUCT_CHUNKED_LIST_CHUNK_ARRAY_GRANULARITY 8
+
+#define DEFINE_STRUCT_CHUNKED_LIST_CHUNK(struct_name) \
+/** \
+ * Piece of the sorted sequence of items in a chunked list. \
+ */ \
+struct struct_name##ListChunk { \
+	unsigned int count; \
+	struct struct_name *items[STRUCT_CHUNKED_LIST_CHUNK_CAPACITY]; \
+}
+
+#define DEFINE_STRUCT_CHUNKED_LIST(struct_name, short_item_name) \
+DEFINE_STRUCT_CHUNKED_LIST_CHUNK(struct_name); \
+\
+/** \
+ * Complex structure containing pages of the given struct in struct_name. \
+ * It is designed to grow as more items are added to it, keeping them sorted in chunks. \
+ */ \
+struct struct_name##List { \
+	/** \
+	 * Array holding all allocated pages in the order they have been allocated. \
+	 * This will be NULL when short_item_name##_count is 0. \
+	 */ \
+	struct struct_name **page_array; \
+	\
+	/** \
+	 * Sorted chunks. Items in a chunk are always sorted before the items in the following ones. \
+	 * No chunk is empty, except the first one when the list is empty. \
+	 */ \
+	struct struct_name##ListChunk **chunks; \
+	\
+	/** \
+	 * Fenwick tree with the number of items in each chunk. \
+	 * Entry i holds the number of items in the chunks from i + 1 - (lowest set bit of i + 1) to i, both included. \
+	 */ \
+	unsigned int *chunk_count_tree; \
+	\
+	unsigned int chunk_count; \
+	\
+	/** \
+	 * Number of chunks that chunks and chunk_count_tree can hold without reallocating them. \
+	 */ \
+	unsigned int chunk_capacity; \
+	\
+	/** \
+	 * Number of structs already inserted. \
+	 */ \
+	unsigned int short_item_name##_count; \
+	\
+	/** \
+	 * Arena where all pages, chunks and arrays are allocated, or NULL to allocate them directly with malloc. \
+	 */ \
+	struct Arena *arena; \
+}
+
+#define DEFINE_STRUCT_CHUNKED_LIST_INITIALIZE_METHOD(struct_name, struct_name_snake, short_item_name) \
+void initialize_##struct_name_snake##_list_in_arena(struct struct_name##List *list, struct Arena *arena) { \
+	list->short_item_name##_count = 0; \
+	list->page_array = NULL; \
+	list->chunks = NULL; \
+	list->chunk_count_tree = NULL; \
+	list->chunk_count = 0; \
+	list->chunk_capacity = 0; \
+	list->arena = arena; \
+} \
+\
+void initialize_##struct_name_snake##_list(struct struct_name##List *list) { \
+	initialize_##struct_name_snake##_list_in_arena(list, NULL); \
+}
+
+#define DEFINE_STRUCT_CHUNKED_LIST_PREPARE_NEW_METHOD(struct_name, struct_name_snake, short_item_name, initial_page_array_granularity, initial_items_per_page) \
+struct struct_name *prepare_new_##struct_name_snake(struct struct_name##List *list) { \
+	if ((list->short_item_name##_count % initial_items_per_page) == 0) { \
+		struct struct_name *new_page; \
+		if ((list->short_item_name##_count % (initial_items_per_page * initial_page_array_granularity)) == 0) { \
+			const int new_page_array_length = (list->short_item_name##_count / initial_items_per_page) + initial_page_array_granularity; \
+			list->page_array = reallocate_in_arena(list->arena, list->page_array, new_page_array_length * sizeof(struct struct_name *)); \
+			if (!(list->page_array)) { \
+				return NULL; \
+			} \
+		} \
+\
+		new_page = allocate_in_arena(list->arena, initial_items_per_page * sizeof(struct struct_name)); \
+		if (!new_page) { \
+			return NULL; \
+		} \
+\
+		list->page_array[list->short_item_name##_count / initial_items_per_page] = new_page; \
+	} \
+\
+	return list->page_array[list->short_item_name##_count / initial_items_per_page] + (list->short_item_name##_count % initial_items_per_page); \
+}
+
+#define DEFINE_STRUCT_CHUNKED_LIST_RELEASE_CHUNKS_METHOD(struct_name, struct_name_snake) \
+/** \
+ * Release all chunks and the arrays pointing to them, leaving the list without chunks. \
+ */ \
+static void release_##struct_name_snake##_chunks(struct struct_name##List *list) { \
+	unsigned int chunk_index; \
+	for (chunk_index = 0; chunk_index < list->chunk_count; chunk_index++) { \
+		release_in_arena(list->arena, list->chunks[chunk_index]); \
+	} \
+\
+	release_in_arena(list->arena, list->chunks); \
+	release_in_arena(list->arena, list->chunk_count_tree); \
+	list->chunks = NULL; \
+	list->chunk_count_tree = NULL; \
+	list->chunk_count = 0; \
+	list->chunk_capacity = 0; \
+}
+
+#define DEFINE_STRUCT_CHUNKED_LIST_CLEAR_METHOD(struct_name, struct_name_snake, short_item_name, initial_items_per_page) \
+void clear_##struct_name_snake##_list(struct struct_name##List *list) { \
+	if (list->short_item_name##_count > 0) { \
+		const int allocated_pages = (list->short_item_name##_count + initial_items_per_page - 1) / initial_items_per_page; \
+		int i; \
+		for (i = allocated_pages - 1; i >= 0; i--) { \
+			release_in_arena(list->arena, list->page_array[i]); \
+		} \
+\
+		release_in_arena(list->arena, list->page_array); \
+	} \
+\
+	release_##struct_name_snake##_chunks(list); \
+	initialize_##struct_name_snake##_list_in_arena(list, list->arena); \
+}
+
+#define DEFINE_STRUCT_CHUNKED_LIST_COUNT_TREE_METHODS(struct_name, struct_name_snake) \
+/** \
+ * Returns the sorted index of the first item in the given chunk, which is the number of items in all chunks before it. \
+ */ \
+static unsigned int get_##struct_name_snake##_chunk_offset(const struct struct_name##List *list, unsigned int chunk_index) { \
+	unsigned int offset = 0; \
+	unsigned int position; \
+	for (position = chunk_index; position; position &= position - 1) { \
+		offset += list->chunk_count_tree[position - 1]; \
+	} \
+\
+	return offset; \
+} \
+\
+/** \
+ * Returns the chunk holding the item with the given sorted index, and sets in item_index its position within the chunk. \
+ * The given index must be lower than the number of items in the list. \
+ */ \
+static unsigned int find_##struct_name_snake##_chunk_with_index(const struct struct_name##List *list, unsigned int index, unsigned int *item_index) { \
+	unsigned int chunk_index = 0; \
+	unsigned int step = 1; \
+	while (step * 2 <= list->chunk_count) { \
+		step *= 2; \
+	} \
+\
+	for (; step; step /= 2) { \
+		if (chunk_index + step <= list->chunk_count && list->chunk_count_tree[chunk_index + step - 1] <= index) { \
+			chunk_index += step; \
+			index -= list->chunk_count_tree[chunk_index - 1]; \
+		} \
+	} \
+\
+	*item_index = index; \
+	return chunk_index; \
+} \
+\
+/** \
+ * Count one more item in the given chunk. \
+ */ \
+static void increment_##struct_name_snake##_chunk_count(struct struct_name##List *list, unsigned int chunk_index) { \
+	unsigned int position; \
+	for (position = chunk_index + 1; position <= list->chunk_count; position += position & (~position + 1)) { \
+		list->chunk_count_tree[position - 1]++; \
+	} \
+} \
+\
+/** \
+ * Build the tree again from the number of items in each chunk. \
+ */ \
+static void rebuild_##struct_name_snake##_chunk_count_tree(struct struct_name##List *list) { \
+	unsigned int position; \
+	for (position = 1; position <= list->chunk_count; position++) { \
+		list->chunk_count_tree[position - 1] = list->chunks[position - 1]->count; \
+	} \
+\
+	for (position = 1; position <= list->chunk_count; position++) { \
+		const unsigned int parent = position + (position & (~position + 1)); \
+		if (parent <= list->chunk_count) { \
+			list->chunk_count_tree[parent - 1] += list->chunk_count_tree[position - 1]; \
+		} \
+	} \
+}
+
+#define DEFINE_STRUCT_CHUNKED_LIST_LOCATE_METHOD(struct_name, struct_name_snake, sorted_property) \
+/** \
+ * Find the chunk where the given value is, or where it should be inserted, and its position within the chunk. \
+ * Returns 0 if the value is not present, or any other value if an item with that value is found at the returned position. \
+ */ \
+static int locate_##struct_name_snake##_in_chunks(const struct struct_name##List *list, const char *sorted_property, unsigned int *chunk_index, unsigned int *item_index) { \
+	const struct struct_name##ListChunk *chunk; \
+	unsigned int first = 0; \
+	unsigned int last = list->chunk_count; \
+	while (last - first > 1) { \
+		const unsigned int index = (first + last) / 2; \
+		if (list->chunks[index]->items[0]->sorted_property <= sorted_property) { \
+			first = index; \
+		} \
+		else { \
+			last = index; \
+		} \
+	} \
+\
+	*chunk_index = first; \
+	*item_index = 0; \
+	if (!list->chunk_count) { \
+		return 0; \
+	} \
+\
+	chunk = list->chunks[first]; \
+	first = 0; \
+	last = chunk->count; \
+	while (last > first) { \
+		const unsigned int index = (first + last) / 2; \
+		const char *this_##sorted_property = chunk->items[index]->sorted_property; \
+		if (this_##sorted_property < sorted_property) { \
+			first = index + 1; \
+		} \
+		else if (this_##sorted_property > sorted_property) { \
+			last = index; \
+		} \
+		else { \
+			*item_index = index; \
+			return 1; \
+		} \
+	} \
+\
+	*item_index = first; \
+	return 0; \
+}
+
+#define DEFINE_STRUCT_CHUNKED_LIST_GET_SORTED_METHOD(struct_name, struct_name_snake) \
+struct struct_name *get_sorted_##struct_name_snake(const struct struct_name##List *list, int index) { \
+	unsigned int item_index; \
+	const unsigned int chunk_index = find_##struct_name_snake##_chunk_with_index(list, index, &item_index); \
+	return list->chunks[chunk_index]->items[item_index]; \
+}
+
+#define DEFINE_STRUCT_CHUNKED_LIST_INDEX_OF_WITH_METHOD(struct_name, struct_name_snake, sorted_property) \
+int index_of_##struct_name_snake##_with_##sorted_property(const struct struct_name##List *list, const char *sorted_property) { \
+	unsigned int chunk_index; \
+	unsigned int item_index; \
+	if (locate_##struct_name_snake##_in_chunks(list, sorted_property, &chunk_index, &item_index)) { \
+		return get_##struct_name_snake##_chunk_offset(list, chunk_index) + item_index; \
+	} \
+\
+	return -1; \
+}
+
+#define DEFINE_STRUCT_CHUNKED_LIST_INDEX_OF_CONTAINING_METHOD(struct_name, struct_name_snake, sorted_property) \
+int index_of_##struct_name_snake##_containing_position(const struct struct_name##List *list, const char *position) { \
+	unsigned int chunk_index; \
+	unsigned int item_index; \
+	int index; \
+	const int found = locate_##struct_name_snake##_in_chunks(list, position, &chunk_index, &item_index); \
+	if (!list->chunk_count) { \
+		return -1; \
+	} \
+\
+	index = get_##struct_name_snake##_chunk_offset(list, chunk_index) + item_index; \
+	return found? index : index - 1; \
+}
+
+#define DEFINE_STRUCT_CHUNKED_LIST_INSERT_AT_METHOD(struct_name, struct_name_snake, short_item_name) \
+/** \
+ * Insert a new empty chunk in the given position, moving there the upper half of the previous chunk if any. \
+ * Returns 0 on success, or any other value if memory cannot be allocated. \
+ */ \
+static int split_##struct_name_snake##_chunk(struct struct_name##List *list, unsigned int chunk_index) { \
+	struct struct_name##ListChunk *new_chunk; \
+	unsigned int i; \
+	if (list->chunk_count == list->chunk_capacity) { \
+		const unsigned int new_capacity = list->chunk_capacity? list->chunk_capacity * 2 : STRUCT_CHUNKED_LIST_CHUNK_ARRAY_GRANULARITY; \
+		struct struct_name##ListChunk **new_chunks = reallocate_in_arena(list->arena, list->chunks, new_capacity * sizeof(struct struct_name##ListChunk *)); \
+		unsigned int *new_tree; \
+		if (!new_chunks) { \
+			return 1; \
+		} \
+\
+		list->chunks = new_chunks; \
+		new_tree = reallocate_in_arena(list->arena, list->chunk_count_tree, new_capacity * sizeof(unsigned int)); \
+		if (!new_tree) { \
+			return 1; \
+		} \
+\
+		list->chunk_count_tree = new_tree; \
+		list->chunk_capacity = new_capacity; \
+	} \
+\
+	new_chunk = allocate_in_arena(list->arena, sizeof(struct struct_name##ListChunk)); \
+	if (!new_chunk) { \
+		return 1; \
+	} \
+\
+	for (i = list->chunk_count; i > chunk_index; i--) { \
+		list->chunks[i] = list->chunks[i - 1]; \
+	} \
+\
+	new_chunk->count = 0; \
+	list->chunks[chunk_index] = new_chunk; \
+	list->chunk_count++; \
+\
+	if (chunk_index > 0) { \
+		struct struct_name##ListChunk *previous_chunk = list->chunks[chunk_index - 1]; \
+		const unsigned int kept = previous_chunk->count / 2; \
+		for (i = kept; i < previous_chunk->count; i++) { \
+			new_chunk->items[i - kept] = previous_chunk->items[i]; \
+		} \
+\
+		new_chunk->count = previous_chunk->count - kept; \
+		previous_chunk->count = kept; \
+	} \
+\
+	rebuild_##struct_name_snake##_chunk_count_tree(list); \
+	return 0; \
+} \
+\
+/** \
+ * Insert the given item at the position returned by locate_##struct_name_snake##_in_chunks. \
+ * Returns 0 on success, or any other value if memory cannot be allocated. \
+ */ \
+static int insert_##struct_name_snake##_at(struct struct_name##List *list, struct struct_name *new_##short_item_name, unsigned int chunk_index, unsigned int item_index) { \
+	struct struct_name##ListChunk *chunk; \
+	unsigned int i; \
+	if (!list->chunk_count) { \
+		if (split_##struct_name_snake##_chunk(list, 0)) { \
+			return 1; \
+		} \
+	} \
+	else if (list->chunks[chunk_index]->count == STRUCT_CHUNKED_LIST_CHUNK_CAPACITY) { \
+		if (split_##struct_name_snake##_chunk(list, chunk_index + 1)) { \
+			return 1; \
+		} \
+\
+		if (item_index > list->chunks[chunk_index]->count) { \
+			item_index -= list->chunks[chunk_index]->count; \
+			chunk_index++; \
+		} \
+	} \
+\
+	chunk = list->chunks[chunk_index]; \
+	for (i = chunk->count; i > item_index; i--) { \
+		chunk->items[i] = chunk->items[i - 1]; \
+	} \
+\
+	chunk->items[item_index] = new_##short_item_name; \
+	chunk->count++; \
+	increment_##struct_name_snake##_chunk_count(list, chunk_index); \
+	list->short_item_name##_count++; \
+	return 0; \
+}
+
+#define DEFINE_STRUCT_CHUNKED_LIST_INSERT_METHOD(struct_name, struct_name_snake, short_item_name, sorted_property) \
+int insert_##struct_name_snake(struct struct_name##List *list, struct struct_name *new_##short_item_name) { \
+	unsigned int chunk_index; \
+	unsigned int item_index; \
+	log_##struct_name_snake##_insertion(new_##short_item_name); \
+	if (locate_##struct_name_snake##_in_chunks(list, new_##short_item_name->sorted_property, &chunk_index, &item_index)) { \
+		return -1; \
+	} \
+\
+	return insert_##struct_name_snake##_at(list, new_##short_item_name, chunk_index, item_index); \
+}
+
+#define DEFINE_STRUCT_CHUNKED_LIST_METHODS(struct_name, struct_name_snake, short_item_name, sorted_property, initial_page_array_granularity, initial_items_per_page) \
+DEFINE_STRUCT_CHUNKED_LIST_INITIALIZE_METHOD(struct_name, struct_name_snake, short_item_name) \
+DEFINE_STRUCT_CHUNKED_LIST_COUNT_TREE_METHODS(struct_name, struct_name_snake) \
+DEFINE_STRUCT_LIST_GET_UNSORTED_METHOD(struct_name, struct_name_snake, initial_items_per_page) \
+DEFINE_STRUCT_CHUNKED_LIST_GET_SORTED_METHOD(struct_name, struct_name_snake) \
+DEFINE_STRUCT_CHUNKED_LIST_PREPARE_NEW_METHOD(struct_name, struct_name_snake, short_item_name, initial_page_array_granularity, initial_items_per_page) \
+DEFINE_STRUCT_CHUNKED_LIST_RELEASE_CHUNKS_METHOD(struct_name, struct_name_snake) \
+DEFINE_STRUCT_CHUNKED_LIST_CLEAR_METHOD(struct_name, struct_name_snake, short_item_name, initial_items_per_page) \
+DEFINE_STRUCT_CHUNKED_LIST_LOCATE_METHOD(struct_name, struct_name_snake, sorted_property) \
+DEFINE_STRUCT_CHUNKED_LIST_INDEX_OF_WITH_METHOD(struct_name, struct_name_snake, sorted_property) \
+DEFINE_STRUCT_CHUNKED_LIST_INDEX_OF_CONTAINING_METHOD(struct_name, struct_name_snake, sorted_property) \
+DEFINE_STRUCT_CHUNKED_LIST_INSERT_AT_METHOD(struct_name, struct_name_snake, short_item_name) \
+DEFINE_STRUCT_CHUNKED_LIST_INSERT_METHOD(struct_name, struct_name_snake, short_item_name, sorted_property)
+
 #endif
@@ -0,0 +1,209 @@
+#include "snapshot.h"
+#include "stats.h"
+#include <assert.h>
+
+#define SNAPSHOT_STORE_INITIAL_BUCKET_COUNT 64
+
+void initialize_snapshot_store_in_arena(struct StateSnapshotStore *store, struct Arena *arena) {
+	store->buckets = NULL;
+	store->bucket_count = 0;
+	store->interned_count = 0;
+	store->last_allocated = NULL;
+	store->released = NULL;
+	store->arena = arena;
+	store->track_provenance = 1;
+	store->stats = NULL;
+}
+
+static unsigned long hash_state(const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
+	unsigned long hash = hash_registers(regs);
+	hash = hash * 31 + hash_stack(stack);
+	return hash * 31 + hash_gvwvmap(var_values);
+}
+
+static int is_state_in_snapshot(const struct StateSnapshot *snapshot, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
+	return are_registers_equal(&snapshot->regs, regs) &&
+			are_stacks_equal(&snapshot->stack, stack) &&
+			are_gvwvmaps_equal(&snapshot->var_values, var_values);
+}
+
+/**
+ * Doubles the number of buckets, moving all interned snapshots to their new bucket.
+ */
+static int grow_snapshot_buckets(struct StateSnapshotStore *store) {
+	const unsigned int new_bucket_count = store->bucket_count? store->bucket_count * 2 : SNAPSHOT_STORE_INITIAL_BUCKET_COUNT;
+	struct StateSnapshot **new_buckets = allocate_in_arena(store->arena, new_bucket_count * sizeof(struct StateSnapshot *));
+	unsigned int index;
+	if (!new_buckets) {
+		return 1;
+	}
+
+	for (index = 0; index < new_bucket_count; index++) {
+		new_buckets[index] = NULL;
+	}
+
+	for (index = 0; index < store->bucket_count; index++) {
+		struct StateSnapshot *snapshot = store->buckets[index];
+		while (snapshot) {
+			struct StateSnapshot *next = snapshot->next;
+			struct StateSnapshot **bucket = new_buckets + snapshot->hash % new_bucket_count;
+			snapshot->next = *bucket;
+			*bucket = snapshot;
+			snapshot = next;
+		}
+	}
+
+	release_in_arena(store->arena, store->buckets);
+	store->buckets = new_buckets;
+	store->bucket_count = new_bucket_count;
+	return 0;
+}
+
+static void unintern_state_snapshot(struct StateSnapshotStore *store, struct StateSnapshot *snapshot) {
+	struct StateSnapshot **link = store->buckets + snapshot->hash % store->bucket_count;
+	while (*link != snapshot) {
+		link = &(*link)->next;
+	}
+
+	*link = snapshot->next;
+	snapshot->next = NULL;
+	snapshot->interned = 0;
+	store->interned_count--;
+}
+
+/**
+ * Returns a snapshot not referenced by any origin, reusing a released one if possible.
+ */
+static struct StateSnapshot *prepare_new_state_snapshot(struct StateSnapshotStore *store) {
+	struct StateSnapshot *snapshot = store->released;
+	if (snapshot) {
+		store->released = snapshot->next;
+	}
+	else {
+		struct RegisterProvenance *provenance = NULL;
+		if (store->track_provenance && !(provenance = allocate_in_arena(store->arena, sizeof(struct RegisterProvenance)))) {
+			return NULL;
+		}
+
+		snapshot = allocate_in_arena(store->arena, sizeof(struct StateSnapshot));
+		if (!snapshot) {
+			release_in_arena(store->arena, provenance);
+			return NULL;
+		}
+
+		initialize_registers(&snapshot->regs, provenance);
+		initialize_stack_in_arena(&snapshot->stack, store->arena);
+		initialize_gvwvmap_in_arena(&snapshot->var_values, store->arena);
+		snapshot->previous_allocated = store->last_allocated;
+		store->last_allocated = snapshot;
+	}
+
+	snapshot->reference_count = 1;
+	snapshot->interned = 0;
+	snapshot->hash = 0;
+	snapshot->next = NULL;
+	return snapshot;
+}
+
+static int copy_state_in_snapshot(struct StateSnapshot *snapshot, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
+	int error_code;
+	copy_registers(&snapshot->regs, regs);
+	if ((error_code = copy_stack(&snapshot->stack, stack))) {
+		return error_code;
+	}
+
+	return copy_gvwvmap(&snapshot->var_values, var_values);
+}
+
+struct StateSnapshot *intern_state_snapshot(struct StateSnapshotStore *store, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values) {
+	const unsigned long hash = hash_state(regs, stack, var_values);
+	struct StateSnapshot *snapshot;
+	struct StateSnapshot **bucket;
+
+	if (store->bucket_count) {
+		for (snapshot = store->buckets[hash % store->bucket_count]; snapshot; snapshot = snapshot->next) {
+			if (snapshot->hash == hash && is_state_in_snapshot(snapshot, regs, stack, var_values)) {
+				STATS_INCREMENT(store->stats, snapshots_shared);
+				snapshot->reference_count++;
+				return snapshot;
+			}
+		}
+	}
+
+	if (store->interned_count >= store->bucket_count && grow_snapshot_buckets(store)) {
+		return NULL;
+	}
+
+	if (!(snapshot = prepare_new_state_snapshot(store))) {
+		return NULL;
+	}
+
+	if (copy_state_in_snapshot(snapshot, regs, stack, var_values)) {
+		release_state_snapshot(store, snapshot);
+		return NULL;
+	}
+
+	STATS_INCREMENT(store->stats, snapshots_created);
+	bucket = store->buckets + hash % store->bucket_count;
+	snapshot->hash = hash;
+	snapshot->interned = 1;
+	snapshot->next = *bucket;
+	*bucket = snapshot;
+	store->interned_count++;
+	return snapshot;
+}
+
+void release_state_snapshot(struct StateSnapshotStore *store, struct StateSnapshot *snapshot) {
+	assert(snapshot->reference_count > 0);
+	if (--snapshot->reference_count == 0) {
+		if (snapshot->interned) {
+			unintern_state_snapshot(store, snapshot);
+		}
+
+		snapshot->next = store->released;
+		store->released = snapshot;
+	}
+}
+
+struct StateSnapshot *make_state_snapshot_writable(struct StateSnapshotStore *store, struct StateSnapshot *snapshot) {
+	struct StateSnapshot *copy;
+	if (snapshot->reference_count == 1) {
+		if (snapshot->interned) {
+			unintern_state_snapshot(store, snapshot);
+		}
+
+		return snapshot;
+	}
+
+	if (!(copy = prepare_new_state_snapshot(store))) {
+		return NULL;
+	}
+
+	if (copy_state_in_snapshot(copy, &snapshot->regs, &snapshot->stack, &snapshot->var_values)) {
+		release_state_snapshot(store, copy);
+		return NULL;
+	}
+
+	STATS_INCREMENT(store->stats, snapshots_copied_on_write);
+	snapshot->reference_count--;
+	return copy;
+}
+
+void clear_snapshot_store(struct StateSnapshotStore *store) {
+	struct StateSnapshot *snapshot = store->last_allocated;
+	while (snapshot) {
+		struct StateSnapshot *previous = snapshot->previous_allocated;
+		clear_stack(&snapshot->stack);
+		clear_gvwvmap(&snapshot->var_values);
+		release_in_arena(store->arena, snapshot->regs.provenance);
+		release_in_arena(store->arena, snapshot);
+		snapshot = previous;
+	}
+
+	release_in_arena(store->arena, store->buckets);
+	store->buckets = NULL;
+	store->bucket_count = 0;
+	store->interned_count = 0;
+	store->last_allocated = NULL;
+	store->released = NULL;
+}
@@ -0,0 +1,127 @@
+#ifndef _STATE_SNAPSHOT_H_
+#define _STATE_SNAPSHOT_H_
+
+#include "register.h"
+#include "stack.h"
+#include "gvwvmap.h"
+#include "arena.h"
+#include "stats.h"
+
+/**
+ * Abstract state of registers, stack and global variables, as found when a block is reached from an origin.
+ *
+ * Snapshots are shared by all origins reaching their blocks with the same state, and they must not
+ * be modified while they are shared. Any origin that needs to merge a new state into its snapshot
+ * must call make_state_snapshot_writable first, that will give it a private copy if required.
+ */
+struct StateSnapshot {
+	/**
+	 * Number of origins pointing to this snapshot.
+	 */
+	unsigned int reference_count;
+
+	/**
+	 * Whether this snapshot is registered in the store, and then it can be shared with any new origin having the same state.
+	 */
+	int interned;
+
+	/**
+	 * Hash of the state, only valid if the snapshot is interned.
+	 */
+	unsigned long hash;
+
+	/**
+	 * Next snapshot in the same bucket of the store, or in the list of released snapshots.
+	 */
+	struct StateSnapshot *next;
+
+	/**
+	 * Previous snapshot allocated by the same store, or NULL if this is the first one.
+	 */
+	struct StateSnapshot *previous_allocated;
+
+	struct Registers regs;
+	struct Stack stack;
+	struct GlobalVariableWordValueMap var_values;
+};
+
+/**
+ * Set of interned snapshots, indexed by the hash of their state.
+ *
+ * Snapshots whose reference count reaches 0 are kept in a list of released ones,
+ * so that their stacks and maps can be reused by new snapshots without allocating memory again.
+ */
+struct StateSnapshotStore {
+	/**
+	 * Array of bucket_count lists of interned snapshots. This will be NULL if no snapshot has been interned yet.
+	 */
+	struct StateSnapshot **buckets;
+	unsigned int bucket_count;
+
+	/**
+	 * Number of snapshots currently interned.
+	 */
+	unsigned int interned_count;
+
+	/**
+	 * Last allocated snapshot, that allows iterating all of them when clearing the store.
+	 */
+	struct StateSnapshot *last_allocated;
+
+	/**
+	 * Snapshots that are not pointed by any origin, and can be reused.
+	 */
+	struct StateSnapshot *released;
+
+	/**
+	 * Arena where all snapshots and their states are allocated, or NULL to allocate them directly with malloc.
+	 */
+	struct Arena *arena;
+
+	/**
+	 * Whether the registers in the snapshots keep track of the provenance of their values.
+	 * This is set by default, and it can only be changed before any snapshot is interned.
+	 */
+	int track_provenance;
+
+	/**
+	 * Stats where the states kept in this store, and the merges and checks made on them, are counted.
+	 * This is NULL if they are not counted.
+	 */
+	struct AnalysisStats *stats;
+};
+
+/**
+ * Set all its values. After this, the store will be empty.
+ */
+void initialize_snapshot_store_in_arena(struct StateSnapshotStore *store, struct Arena *arena);
+
+/**
+ * Returns a snapshot holding the given state, adding one reference to it.
+ * If there is already an interned snapshot with the same state, that one is returned, and no memory is allocated.
+ * This will return NULL if memory cannot be allocated.
+ */
+struct StateSnapshot *intern_state_snapshot(struct StateSnapshotStore *store, const struct Registers *regs, const struct Stack *stack, const struct GlobalVariableWordValueMap *var_values);
+
+/**
+ * Removes one reference to the given snapshot. When no references are left, the snapshot becomes available for reuse.
+ */
+void release_state_snapshot(struct StateSnapshotStore *store, struct StateSnapshot *snapshot);
+
+/**
+ * Returns a snapshot with the same state as the given one, that can be modified without affecting any other origin.
+ *
+ * If the given snapshot is only referenced once, it is removed from the store and returned as it is.
+ * Otherwise, one reference is removed from it, and a private copy with a single reference is returned.
+ * Snapshots returned by this method are never shared again.
+ * This will return NULL if memory cannot be allocated.
+ */
+struct StateSnapshot *make_state_snapshot_writable(struct StateSnapshotStore *store, struct StateSnapshot *snapshot);
+
+/**
+ * Free all snapshots and memory allocated by the store.
+ * Any origin pointing to any of its snapshots must not be used after this.
+ */
+void clear_snapshot_store(struct StateSnapshotStore *store);
+
+#endif /* _STATE_SNAPSHOT_H_ */
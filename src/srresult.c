@@ -1,4 +1,5 @@
 #include "srresult.h"
+#include <stdlib.h>
 
 #define SRRESULT_FLAG_DS_MATCHES_CS_AT_START 1
 
@@ -9,3 +10,18 @@ int ds_should_match_cs_at_segment_start(const struct SegmentReadResult *result)
 void mark_ds_matches_cs_at_start(struct SegmentReadResult *result) {
 	result->flags = SRRESULT_FLAG_DS_MATCHES_CS_AT_START;
 }
+
+void clear_srresult(struct SegmentReadResult *result) {
+	clear_sorted_relocations(&result->sorted_relocations);
+	if (is_file_mapped(&result->file_map)) {
+		unmap_file(&result->file_map);
+	}
+
+	free(result->file_data);
+	free(result->relocation_table);
+	result->file_data = NULL;
+	result->relocation_table = NULL;
+	result->relocation_count = 0;
+	result->buffer = NULL;
+	result->size = 0;
+}
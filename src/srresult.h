@@ -1,20 +1,39 @@
 #ifndef _SEGMENT_READ_RESULT_H_
 #define _SEGMENT_READ_RESULT_H_
 
+#include "filemap.h"
 #include "fpointer.h"
+#include "relocu.h"
 
 struct SegmentReadResult {
 	struct FarPointer *relocation_table;
 	unsigned int relocation_count;
-	const char **sorted_relocations;
+	struct SortedRelocations sorted_relocations;
 	char *buffer;
 	unsigned int size;
 	int relative_cs;
 	unsigned int ip;
 	unsigned int flags;
+
+	/**
+	 * File where buffer points to, if it could be mapped in memory.
+	 */
+	struct FileMap file_map;
+
+	/**
+	 * Whole content of the file where buffer points to, allocated with malloc, if it could not be mapped.
+	 * This is NULL if the file is mapped, or if buffer points to an image owned by someone else.
+	 */
+	char *file_data;
 };
 
 int ds_should_match_cs_at_segment_start(const struct SegmentReadResult *result);
 void mark_ds_matches_cs_at_start(struct SegmentReadResult *result);
 
+/**
+ * Free or unmap the file where buffer points to, if owned, and free all relocation arrays.
+ * The relocation table is always allocated with malloc, as it may not be aligned within the file.
+ */
+void clear_srresult(struct SegmentReadResult *result);
+
 #endif /* _SEGMENT_READ_RESULT_H_ */
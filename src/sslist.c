@@ -1,11 +1,15 @@
 #include "sslist.h"
-#include <stdlib.h>
 
 #define SEGMENT_START_LIST_GRANULARITY 8
 
-void initialize_segment_start_list(struct SegmentStartList *list) {
+void initialize_segment_start_list_in_arena(struct SegmentStartList *list, struct Arena *arena) {
 	list->count = 0;
 	list->start = NULL;
+	list->arena = arena;
+}
+
+void initialize_segment_start_list(struct SegmentStartList *list) {
+	initialize_segment_start_list_in_arena(list, NULL);
 }
 
 int contains_segment_start(struct SegmentStartList *list, const char *start) {
@@ -33,13 +37,6 @@ int insert_segment_start(struct SegmentStartList *list, const char *new_start) {
 	int last = list->count;
 	int i;
 
-	if ((list->count % SEGMENT_START_LIST_GRANULARITY) == 0) {
-		list->start = realloc(list->start, list->count + SEGMENT_START_LIST_GRANULARITY);
-		if (!list->start) {
-			return 1;
-		}
-	}
-
 	while (last > first) {
 		int index = (first + last) / 2;
 		const char *this_start = list->start[index];
@@ -54,6 +51,16 @@ int insert_segment_start(struct SegmentStartList *list, const char *new_start) {
 		}
 	}
 
+	/* Growing after the search, so that inserting an already known start never allocates */
+	if ((list->count % SEGMENT_START_LIST_GRANULARITY) == 0) {
+		const char **new_start = reallocate_in_arena(list->arena, list->start, (list->count + SEGMENT_START_LIST_GRANULARITY) * sizeof(const char *));
+		if (!new_start) {
+			return 1;
+		}
+
+		list->start = new_start;
+	}
+
 	for (i = list->count; i > last; i--) {
 		list->start[i] = list->start[i - 1];
 	}
@@ -66,8 +73,8 @@ int insert_segment_start(struct SegmentStartList *list, const char *new_start) {
 
 void clear_segment_start_list(struct SegmentStartList *list) {
 	if (list->start) {
-		free(list->start);
+		release_in_arena(list->arena, list->start);
 	}
 
-	initialize_segment_start_list(list);
+	initialize_segment_start_list_in_arena(list, list->arena);
 }
@@ -1,11 +1,15 @@
 #ifndef _SEGMENT_START_LIST_H_
 #define _SEGMENT_START_LIST_H_
 
+#include "arena.h"
+
 struct SegmentStartList {
 	const char **start;
 	unsigned int count;
+	struct Arena *arena;
 };
 
+void initialize_segment_start_list_in_arena(struct SegmentStartList *list, struct Arena *arena);
 void initialize_segment_start_list(struct SegmentStartList *list);
 int contains_segment_start(struct SegmentStartList *list, const char *start);
 int insert_segment_start(struct SegmentStartList *list, const char *new_start);
@@ -1,34 +1,45 @@
 #include "stack.h"
 #include <stdlib.h>
+#include <string.h>
 
-#define STACK_BYTES_IN_REL_PER_PAGE 4
-#define STACK_BYTES_PER_PAGE (STACK_BYTES_IN_REL_PER_PAGE * 16)
-#define STACK_BYTES_IN_DNM_PER_PAGE (STACK_BYTES_IN_REL_PER_PAGE * 4)
-#define STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE (STACK_BYTES_IN_REL_PER_PAGE * 8 * sizeof(const char *))
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif /* __SSE2__ */
 
-/* This must be at least STACK_BYTES_PER_PAGE / 2 */
-#define STACK_SHRINK_TOP_THRESHOLD STACK_BYTES_PER_PAGE
+#define STACK_BYTES_PER_PAGE 64
+#define STACK_BYTES_IN_FLAGS_PER_PAGE STACK_BYTES_PER_PAGE
+#define STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE (STACK_BYTES_PER_PAGE / 2 * sizeof(const char *))
+
+#define STACK_FLAG_DEFINED 1
+#define STACK_FLAG_MERGED 2
+#define STACK_FLAG_RELATIVE 4
+
+/* Word with the lowest bit of each of its bytes set. Multiplying it by a flag sets that flag in all bytes */
+#define STACK_LOW_BITS (~0UL / 0xFF)
 
 #include <assert.h>
 
-void initialize_stack(struct Stack *stack) {
+void initialize_stack_in_arena(struct Stack *stack, struct Arena *arena) {
 	stack->allocated_pages = 0;
 	stack->top = 0;
 	stack->data = NULL;
-	stack->defined_and_merged = NULL;
-	stack->relative = NULL;
+	stack->flags = NULL;
 	stack->value_origin = NULL;
+	stack->arena = arena;
+}
+
+void initialize_stack(struct Stack *stack) {
+	initialize_stack_in_arena(stack, NULL);
 }
 
 void clear_stack(struct Stack *stack) {
 	if (stack->allocated_pages > 0) {
-		free(stack->data);
-		free(stack->defined_and_merged);
-		free(stack->relative);
-		free(stack->value_origin);
+		release_in_arena(stack->arena, stack->data);
+		release_in_arena(stack->arena, stack->flags);
+		release_in_arena(stack->arena, stack->value_origin);
 	}
 
-	initialize_stack(stack);
+	initialize_stack_in_arena(stack, stack->arena);
 }
 
 int is_defined_in_stack_from_top(const struct Stack *stack, unsigned int count) {
@@ -38,17 +49,16 @@ int is_defined_in_stack_from_top(const struct Stack *stack, unsigned int count)
 		return 0;
 	}
 	else {
-		const unsigned int mask = 5 << (data_index % (4 * sizeof(packed_data_t)) * 2);
-		return (stack->defined_and_merged[data_index / (4 * sizeof(packed_data_t))] & mask) == mask;
+		return stack->flags[data_index] & stack->flags[data_index + 1] & STACK_FLAG_DEFINED;
 	}
 }
 
 int is_defined_absolute_in_stack_from_top(const struct Stack *stack, unsigned int count) {
-	return is_defined_in_stack_from_top(stack, count) && (stack->relative[(stack->top + count) / (8 * sizeof(packed_data_t))] & 1 << (stack->top + count) % (8 * sizeof(packed_data_t))) == 0;
+	return is_defined_in_stack_from_top(stack, count) && (stack->flags[(stack->top + count) * 2] & STACK_FLAG_RELATIVE) == 0;
 }
 
 int is_defined_relative_in_stack_from_top(const struct Stack *stack, unsigned int count) {
-	return is_defined_in_stack_from_top(stack, count) && stack->relative[(stack->top + count) / (8 * sizeof(packed_data_t))] & 1 << (stack->top + count) % (8 * sizeof(packed_data_t));
+	return is_defined_in_stack_from_top(stack, count) && (stack->flags[(stack->top + count) * 2] & STACK_FLAG_RELATIVE);
 }
 
 int top_is_defined_in_stack(const struct Stack *stack) {
@@ -64,7 +74,6 @@ int top_is_defined_relative_in_stack(const struct Stack *stack) {
 }
 
 uint16_t get_from_top(const struct Stack *stack, unsigned int count) {
-	const unsigned int allocated_bytes = stack->allocated_pages * STACK_BYTES_PER_PAGE;
 	const unsigned int data_index = (stack->top + count) * 2;
 	uint16_t result = stack->data[data_index + 1] & 0xFF;
 	result = (result << 8) + (stack->data[data_index] & 0xFF);
@@ -72,45 +81,54 @@ uint16_t get_from_top(const struct Stack *stack, unsigned int count) {
 }
 
 const char *get_value_origin_from_top(const struct Stack *stack, unsigned int count) {
-	const unsigned int allocated_bytes = stack->allocated_pages * STACK_BYTES_PER_PAGE;
 	const unsigned int origin_index = stack->top + count;
-	return (origin_index * 2 < stack->allocated_pages * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE)? stack->value_origin[origin_index] : NULL;
+	return (origin_index * 2 < stack->allocated_pages * STACK_BYTES_PER_PAGE)? stack->value_origin[origin_index] : NULL;
 }
 
-static int add_new_pages_at_start(struct Stack *stack, unsigned int count) {
-	unsigned int offset;
-	int i;
-
-	stack->allocated_pages += count;
-	stack->data = realloc(stack->data, stack->allocated_pages * STACK_BYTES_PER_PAGE);
-	stack->defined_and_merged = realloc(stack->defined_and_merged, stack->allocated_pages * STACK_BYTES_IN_DNM_PER_PAGE);
-	stack->relative = realloc(stack->relative, stack->allocated_pages * STACK_BYTES_IN_REL_PER_PAGE);
-	stack->value_origin = realloc(stack->value_origin, stack->allocated_pages * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE);
-	if (!stack->data || !stack->defined_and_merged || !stack->relative || !stack->value_origin) {
-		return 1;
-	}
+unsigned int get_word_count_in_stack(const struct Stack *stack) {
+	return (stack->allocated_pages * STACK_BYTES_PER_PAGE) / 2 - stack->top;
+}
 
-	offset = count * STACK_BYTES_PER_PAGE;
-	for (i = stack->allocated_pages * STACK_BYTES_PER_PAGE - 1; i >= offset; i--) {
-		stack->data[i] = stack->data[i - offset];
-	}
+unsigned int get_word_flags_from_top(const struct Stack *stack, unsigned int count) {
+	const unsigned int data_index = (stack->top + count) * 2;
+	return (stack->flags[data_index + 1] << 8) | stack->flags[data_index];
+}
 
-	offset = count * STACK_BYTES_IN_DNM_PER_PAGE / sizeof(packed_data_t);
-	for (i = stack->allocated_pages * STACK_BYTES_IN_DNM_PER_PAGE / sizeof(packed_data_t) - 1; i >= offset; i--) {
-		stack->defined_and_merged[i] = stack->defined_and_merged[i - offset];
+/**
+ * Make room for more words on top of the stack, at least one.
+ *
+ * The allocated space is doubled, and the current words are moved to the end of it, keeping the rest as headroom.
+ * As the space is doubled each time, this happens only a logarithmic number of times while the stack grows,
+ * which makes pushing amortised constant time.
+ */
+static int grow_stack_at_start(struct Stack *stack) {
+	const unsigned int new_allocated_pages = (stack->allocated_pages > 0)? stack->allocated_pages * 2 : 1;
+	const unsigned int offset = (new_allocated_pages - stack->allocated_pages) * STACK_BYTES_PER_PAGE;
+	const unsigned int used_bytes = stack->allocated_pages * STACK_BYTES_PER_PAGE - stack->top * 2;
+	unsigned char *new_data = allocate_in_arena(stack->arena, new_allocated_pages * STACK_BYTES_PER_PAGE);
+	unsigned char *new_flags = allocate_in_arena(stack->arena, new_allocated_pages * STACK_BYTES_IN_FLAGS_PER_PAGE);
+	const char **new_value_origin = allocate_in_arena(stack->arena, new_allocated_pages * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE);
+	if (!new_data || !new_flags || !new_value_origin) {
+		return 1;
 	}
 
-	offset = count * STACK_BYTES_IN_REL_PER_PAGE / sizeof(packed_data_t);
-	for (i = stack->allocated_pages * STACK_BYTES_IN_REL_PER_PAGE / sizeof(packed_data_t) - 1; i >= offset; i--) {
-		stack->relative[i] = stack->relative[i - offset];
+	if (used_bytes) {
+		memcpy(new_data + offset + stack->top * 2, stack->data + stack->top * 2, used_bytes);
+		memcpy(new_flags + offset + stack->top * 2, stack->flags + stack->top * 2, used_bytes);
+		memcpy(new_value_origin + (offset / 2) + stack->top, stack->value_origin + stack->top, (used_bytes / 2) * sizeof(const char *));
 	}
 
-	offset = count * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE / sizeof(const char *);
-	for (i = stack->allocated_pages * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE / sizeof(const char *) - 1; i >= offset; i--) {
-		stack->value_origin[i] = stack->value_origin[i - offset];
+	if (stack->allocated_pages > 0) {
+		release_in_arena(stack->arena, stack->data);
+		release_in_arena(stack->arena, stack->flags);
+		release_in_arena(stack->arena, stack->value_origin);
 	}
 
-	stack->top += (count * STACK_BYTES_PER_PAGE) / 2;
+	stack->data = new_data;
+	stack->flags = new_flags;
+	stack->value_origin = new_value_origin;
+	stack->allocated_pages = new_allocated_pages;
+	stack->top += offset / 2;
 	return 0;
 }
 
@@ -119,67 +137,21 @@ static int add_new_pages_at_end(struct Stack *stack, unsigned int count) {
 	int i;
 
 	stack->allocated_pages += count;
-	stack->data = realloc(stack->data, stack->allocated_pages * STACK_BYTES_PER_PAGE);
-	stack->defined_and_merged = realloc(stack->defined_and_merged, stack->allocated_pages * STACK_BYTES_IN_DNM_PER_PAGE);
-	stack->relative = realloc(stack->relative, stack->allocated_pages * STACK_BYTES_IN_REL_PER_PAGE);
-	stack->value_origin = realloc(stack->value_origin, stack->allocated_pages * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE);
-	if (!stack->data || !stack->defined_and_merged || !stack->relative || !stack->value_origin) {
+	stack->data = reallocate_in_arena(stack->arena, stack->data, stack->allocated_pages * STACK_BYTES_PER_PAGE);
+	stack->flags = reallocate_in_arena(stack->arena, stack->flags, stack->allocated_pages * STACK_BYTES_IN_FLAGS_PER_PAGE);
+	stack->value_origin = reallocate_in_arena(stack->arena, stack->value_origin, stack->allocated_pages * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE);
+	if (!stack->data || !stack->flags || !stack->value_origin) {
 		return 1;
 	}
 
-	end = stack->allocated_pages * STACK_BYTES_IN_DNM_PER_PAGE / sizeof(packed_data_t);
-	for (i = (stack->allocated_pages - count) * STACK_BYTES_IN_DNM_PER_PAGE / sizeof(packed_data_t); i < end; i++) {
-		stack->defined_and_merged[i] = 0;
-	}
-
-	return 0;
-}
-
-static int remove_pages_at_start(struct Stack *stack, unsigned int count) {
-	if (count >= stack->allocated_pages) {
-		clear_stack(stack);
+	end = stack->allocated_pages * STACK_BYTES_IN_FLAGS_PER_PAGE;
+	for (i = (stack->allocated_pages - count) * STACK_BYTES_IN_FLAGS_PER_PAGE; i < end; i++) {
+		stack->flags[i] = 0;
 	}
-	else {
-		unsigned int end;
-		unsigned int offset;
-		int i;
-
-		assert(stack->top >= (count * STACK_BYTES_PER_PAGE) / 2);
-
-		end = stack->allocated_pages * STACK_BYTES_PER_PAGE;
-		offset = count * STACK_BYTES_PER_PAGE;
-		for (i = offset; i < end; i++) {
-			stack->data[i - offset] = stack->data[i];
-		}
-
-		end = (stack->allocated_pages * STACK_BYTES_IN_DNM_PER_PAGE) / sizeof(packed_data_t);
-		offset = (count * STACK_BYTES_IN_DNM_PER_PAGE) / sizeof(packed_data_t);
-		for (i = offset; i < end; i++) {
-			stack->defined_and_merged[i - offset] = stack->defined_and_merged[i];
-		}
-
-		end = (stack->allocated_pages * STACK_BYTES_IN_REL_PER_PAGE) / sizeof(packed_data_t);
-		offset = (count * STACK_BYTES_IN_REL_PER_PAGE) / sizeof(packed_data_t);
-		for (i = offset; i < end; i++) {
-			stack->relative[i - offset] = stack->relative[i];
-		}
 
-		end = (stack->allocated_pages * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE) / sizeof(const char *);
-		offset = (count * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE) / sizeof(const char *);
-		for (i = offset; i < end; i++) {
-			stack->value_origin[i - offset] = stack->value_origin[i];
-		}
-
-		stack->allocated_pages -= count;
-		stack->data = realloc(stack->data, stack->allocated_pages * STACK_BYTES_PER_PAGE);
-		stack->defined_and_merged = realloc(stack->defined_and_merged, stack->allocated_pages * STACK_BYTES_IN_DNM_PER_PAGE);
-		stack->relative = realloc(stack->relative, stack->allocated_pages * STACK_BYTES_IN_REL_PER_PAGE);
-		stack->value_origin = realloc(stack->value_origin, stack->allocated_pages * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE);
-		if (!stack->data || !stack->defined_and_merged || !stack->relative || !stack->value_origin) {
-			return 1;
-		}
-
-		stack->top -= (count * STACK_BYTES_PER_PAGE) / 2;
+	end = stack->allocated_pages * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE / sizeof(const char *);
+	for (i = (stack->allocated_pages - count) * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE / sizeof(const char *); i < end; i++) {
+		stack->value_origin[i] = NULL;
 	}
 
 	return 0;
@@ -187,45 +159,42 @@ static int remove_pages_at_start(struct Stack *stack, unsigned int count) {
 
 int push_undefined_in_stack(struct Stack *stack) {
 	int error_code;
-	if (stack->top == 0 && (error_code = add_new_pages_at_start(stack, 1))) {
+	if (stack->top == 0 && (error_code = grow_stack_at_start(stack))) {
 		return error_code;
 	}
 
 	stack->top--;
-	stack->defined_and_merged[(stack->top >> 1) / sizeof(packed_data_t)] &= ~(15 << ((stack->top << 1) % (sizeof(packed_data_t) * 4)) * 2);
+	stack->flags[stack->top * 2] = 0;
+	stack->flags[stack->top * 2 + 1] = 0;
+	stack->value_origin[stack->top] = NULL;
 	return 0;
 }
 
-int push_in_stack(struct Stack *stack, const char *value_origin, uint16_t value) {
+int push_word_with_flags_in_stack(struct Stack *stack, const char *value_origin, uint16_t value, unsigned int flags) {
 	int error_code;
-	if (stack->top == 0 && (error_code = add_new_pages_at_start(stack, 1))) {
+	if (stack->top == 0 && (error_code = grow_stack_at_start(stack))) {
 		return error_code;
 	}
 
 	stack->top--;
-	stack->defined_and_merged[(stack->top >> 1) / sizeof(packed_data_t)] &= ~(10 << ((stack->top << 1) % (sizeof(packed_data_t) * 4)) * 2);
-	stack->defined_and_merged[(stack->top >> 1) / sizeof(packed_data_t)] |= 5 << ((stack->top << 1) % (sizeof(packed_data_t) * 4) * 2);
-	stack->relative[(stack->top >> 3) / sizeof(packed_data_t)] &= ~(1 << (stack->top % (sizeof(packed_data_t) * 8)));
+	stack->flags[stack->top * 2] = flags & 0xFF;
+	stack->flags[stack->top * 2 + 1] = (flags >> 8) & 0xFF;
 	stack->data[stack->top * 2] = value & 0xFF;
 	stack->data[stack->top * 2 + 1] = (value >> 8) & 0xFF;
 	stack->value_origin[stack->top] = value_origin;
 	return 0;
 }
 
-int push_relative_in_stack(struct Stack *stack, const char *value_origin, uint16_t value) {
-	int error_code;
-	if (stack->top == 0 && (error_code = add_new_pages_at_start(stack, 1))) {
-		return error_code;
-	}
+static int push_word_in_stack(struct Stack *stack, const char *value_origin, uint16_t value, unsigned char flags) {
+	return push_word_with_flags_in_stack(stack, value_origin, value, (flags << 8) | flags);
+}
 
-	stack->top--;
-	stack->defined_and_merged[(stack->top >> 1) / sizeof(packed_data_t)] &= ~(10 << ((stack->top << 1) % (sizeof(packed_data_t) * 4)) * 2);
-	stack->defined_and_merged[(stack->top >> 1) / sizeof(packed_data_t)] |= 5 << ((stack->top << 1) % (sizeof(packed_data_t) * 4) * 2);
-	stack->relative[(stack->top >> 3) / sizeof(packed_data_t)] |= 1 << (stack->top % (sizeof(packed_data_t) * 8));
-	stack->data[stack->top * 2] = value & 0xFF;
-	stack->data[stack->top * 2 + 1] = (value >> 8) & 0xFF;
-	stack->value_origin[stack->top] = value_origin;
-	return 0;
+int push_in_stack(struct Stack *stack, const char *value_origin, uint16_t value) {
+	return push_word_in_stack(stack, value_origin, value, STACK_FLAG_DEFINED);
+}
+
+int push_relative_in_stack(struct Stack *stack, const char *value_origin, uint16_t value) {
+	return push_word_in_stack(stack, value_origin, value, STACK_FLAG_DEFINED | STACK_FLAG_RELATIVE);
 }
 
 uint16_t pop_from_stack(struct Stack *stack) {
@@ -240,55 +209,54 @@ uint16_t pop_from_stack(struct Stack *stack) {
 	result <<= 8;
 	result += stack->data[stack->top * 2];
 	stack->top++;
+	return result;
+}
 
-	if (stack->top >= STACK_SHRINK_TOP_THRESHOLD) {
-		remove_pages_at_start(stack, 1); /* We cannot report any error here, as the return type is in use... */
+/**
+ * Ensure that the byte at the given index and the given number of bytes after it are allocated.
+ */
+static int ensure_bytes_allocated_in_stack(struct Stack *stack, unsigned int byte_index, unsigned int length) {
+	const unsigned int allocated_bytes = stack->allocated_pages * STACK_BYTES_PER_PAGE;
+	if (byte_index + length > allocated_bytes) {
+		const unsigned int required_extra_pages = (byte_index + length - allocated_bytes + STACK_BYTES_PER_PAGE - 1) / STACK_BYTES_PER_PAGE;
+		return add_new_pages_at_end(stack, required_extra_pages);
 	}
 
-	return result;
+	return 0;
 }
 
 int set_byte_in_stack_from_top(struct Stack *stack, unsigned int offset, unsigned char value) {
-	const int byte_index = stack->top * 2 + offset;
-	if (byte_index > stack->allocated_pages * STACK_BYTES_PER_PAGE) {
-		const int required_extra_pages = (byte_index - stack->allocated_pages * STACK_BYTES_PER_PAGE + STACK_BYTES_PER_PAGE - 1) / STACK_BYTES_PER_PAGE;
-		int error_code;
-
-		if (required_extra_pages > 0 && (error_code = add_new_pages_at_end(stack, required_extra_pages))) {
-			return error_code;
-		}
+	const unsigned int byte_index = stack->top * 2 + offset;
+	int error_code;
+	if ((error_code = ensure_bytes_allocated_in_stack(stack, byte_index, 1))) {
+		return error_code;
 	}
 
 	stack->data[byte_index] = value;
-	stack->defined_and_merged[byte_index / 4 / sizeof(packed_data_t)] &= ~(2 << byte_index % (4 * sizeof(packed_data_t)) * 2);
-	stack->defined_and_merged[byte_index / 4 / sizeof(packed_data_t)] |= 1 << byte_index % (4 * sizeof(packed_data_t)) * 2;
+	stack->flags[byte_index] = (stack->flags[byte_index] & STACK_FLAG_RELATIVE) | STACK_FLAG_DEFINED;
 	stack->value_origin[byte_index / 2] = NULL;
 
 	return 0;
 }
 
 int set_word_in_stack_from_top(struct Stack *stack, unsigned int offset, const char *value_origin, uint16_t value) {
-	const int byte_index = stack->top * 2 + offset;
-	if (byte_index > stack->allocated_pages * STACK_BYTES_PER_PAGE) {
-		const int required_extra_pages = (byte_index - stack->allocated_pages * STACK_BYTES_PER_PAGE + STACK_BYTES_PER_PAGE - 1) / STACK_BYTES_PER_PAGE;
-		int error_code;
-
-		if (required_extra_pages > 0 && (error_code = add_new_pages_at_end(stack, required_extra_pages))) {
-			return error_code;
-		}
+	const unsigned int byte_index = stack->top * 2 + offset;
+	int error_code;
+	if ((error_code = ensure_bytes_allocated_in_stack(stack, byte_index, 2))) {
+		return error_code;
 	}
 
 	stack->data[byte_index] = value & 0xFF;
 	stack->data[byte_index + 1] = (value >> 8) & 0xFF;
-	stack->defined_and_merged[byte_index / 4 / sizeof(packed_data_t)] &= ~(2 << byte_index % (4 * sizeof(packed_data_t)) * 2);
-	stack->defined_and_merged[byte_index / 4 / sizeof(packed_data_t)] |= 1 << byte_index % (4 * sizeof(packed_data_t)) * 2;
-	stack->defined_and_merged[(byte_index + 1) / 4 / sizeof(packed_data_t)] &= ~(2 << (byte_index + 1) % (4 * sizeof(packed_data_t)) * 2);
-	stack->defined_and_merged[(byte_index + 1) / 4 / sizeof(packed_data_t)] |= 1 << (byte_index + 1) % (4 * sizeof(packed_data_t)) * 2;
 	if ((offset & 1) == 0) {
-		stack->relative[byte_index / 16 / sizeof(packed_data_t)] &= ~(1 << byte_index % (16 * sizeof(packed_data_t)));
+		stack->flags[byte_index] = STACK_FLAG_DEFINED;
+		stack->flags[byte_index + 1] = STACK_FLAG_DEFINED;
 		stack->value_origin[stack->top + offset / 2] = value_origin;
 	}
 	else {
+		/* Each byte belongs to a different word, so their relative flag is kept */
+		stack->flags[byte_index] = (stack->flags[byte_index] & STACK_FLAG_RELATIVE) | STACK_FLAG_DEFINED;
+		stack->flags[byte_index + 1] = (stack->flags[byte_index + 1] & STACK_FLAG_RELATIVE) | STACK_FLAG_DEFINED;
 		stack->value_origin[byte_index / 2] = NULL;
 		stack->value_origin[byte_index / 2 + 1] = NULL;
 	}
@@ -297,40 +265,27 @@ int set_word_in_stack_from_top(struct Stack *stack, unsigned int offset, const c
 }
 
 int set_relative_word_in_stack_from_top(struct Stack *stack, unsigned int offset, const char *value_origin, uint16_t value) {
-	const int byte_index = stack->top * 2 + offset;
+	const unsigned int byte_index = stack->top * 2 + offset;
+	int error_code;
 	assert((offset & 1) == 0);
 
-	if (byte_index > stack->allocated_pages * STACK_BYTES_PER_PAGE) {
-		const int required_extra_pages = (byte_index - stack->allocated_pages * STACK_BYTES_PER_PAGE + STACK_BYTES_PER_PAGE - 1) / STACK_BYTES_PER_PAGE;
-		int error_code;
-
-		if (required_extra_pages > 0 && (error_code = add_new_pages_at_end(stack, required_extra_pages))) {
-			return error_code;
-		}
+	if ((error_code = ensure_bytes_allocated_in_stack(stack, byte_index, 2))) {
+		return error_code;
 	}
 
 	stack->data[byte_index] = value & 0xFF;
 	stack->data[byte_index + 1] = (value >> 8) & 0xFF;
-	stack->defined_and_merged[byte_index / 4 / sizeof(packed_data_t)] &= ~(2 << byte_index % (4 * sizeof(packed_data_t)) * 2);
-	stack->defined_and_merged[byte_index / 4 / sizeof(packed_data_t)] |= 1 << byte_index % (4 * sizeof(packed_data_t) * 2);
-	stack->defined_and_merged[(byte_index + 1) / 4 / sizeof(packed_data_t)] &= ~(2 << (byte_index + 1) % (4 * sizeof(packed_data_t)) * 2);
-	stack->defined_and_merged[(byte_index + 1) / 4 / sizeof(packed_data_t)] |= 1 << (byte_index + 1) % (4 * sizeof(packed_data_t) * 2);
-	stack->relative[byte_index / 16 / sizeof(packed_data_t)] |= 1 << byte_index % (16 * sizeof(packed_data_t));
-	if ((offset & 1) == 0) {
-		stack->value_origin[stack->top + offset / 2] = value_origin;
-	}
-	else {
-		stack->value_origin[byte_index / 2] = NULL;
-		stack->value_origin[byte_index / 2 + 1] = NULL;
-	}
+	stack->flags[byte_index] = STACK_FLAG_DEFINED | STACK_FLAG_RELATIVE;
+	stack->flags[byte_index + 1] = STACK_FLAG_DEFINED | STACK_FLAG_RELATIVE;
+	stack->value_origin[stack->top + offset / 2] = value_origin;
 
 	return 0;
 }
 
 void set_undefined_byte_in_stack_from_top(struct Stack *stack, unsigned int offset) {
-	const int byte_index = stack->top * 2 + offset;
+	const unsigned int byte_index = stack->top * 2 + offset;
 	if (byte_index < stack->allocated_pages * STACK_BYTES_PER_PAGE) {
-		stack->defined_and_merged[byte_index / 4 / sizeof(packed_data_t)] &= ~(3 << byte_index % (4 * sizeof(packed_data_t)) * 2);
+		stack->flags[byte_index] &= STACK_FLAG_RELATIVE;
 		stack->value_origin[byte_index / 2] = NULL;
 	}
 }
@@ -341,212 +296,378 @@ void set_undefined_word_in_stack_from_top(struct Stack *stack, unsigned int offs
 }
 
 int copy_stack(struct Stack *target_stack, const struct Stack *source_stack) {
-	if (source_stack->allocated_pages == 0) {
+	const unsigned int used_bytes = source_stack->allocated_pages * STACK_BYTES_PER_PAGE - source_stack->top * 2;
+	unsigned int target_bytes;
+
+	if (used_bytes > target_stack->allocated_pages * STACK_BYTES_PER_PAGE) {
+		/* Only the words in use are copied, so the target does not inherit the headroom of the source */
+		const unsigned int required_pages = (used_bytes + STACK_BYTES_PER_PAGE - 1) / STACK_BYTES_PER_PAGE;
 		clear_stack(target_stack);
+
+		target_stack->data = allocate_in_arena(target_stack->arena, required_pages * STACK_BYTES_PER_PAGE);
+		target_stack->flags = allocate_in_arena(target_stack->arena, required_pages * STACK_BYTES_IN_FLAGS_PER_PAGE);
+		target_stack->value_origin = allocate_in_arena(target_stack->arena, required_pages * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE);
+		if (!target_stack->data || !target_stack->flags || !target_stack->value_origin) {
+			return 1;
+		}
+
+		target_stack->allocated_pages = required_pages;
+	}
+
+	/* Words are located relative to the end of the allocated space, so any remaining space is kept as headroom */
+	target_bytes = target_stack->allocated_pages * STACK_BYTES_PER_PAGE;
+	target_stack->top = (target_bytes - used_bytes) / 2;
+	if (used_bytes) {
+		memcpy(target_stack->data + target_stack->top * 2, source_stack->data + source_stack->top * 2, used_bytes);
+		memcpy(target_stack->flags + target_stack->top * 2, source_stack->flags + source_stack->top * 2, used_bytes);
+		memcpy(target_stack->value_origin + target_stack->top, source_stack->value_origin + source_stack->top, (used_bytes / 2) * sizeof(const char *));
+	}
+
+	return 0;
+}
+
+/**
+ * Returns the number of bytes from the top to the last byte that is either defined or merged, both included.
+ * Any byte after it can be discarded when merging, as it does not hold any information.
+ */
+static unsigned int used_bytes_in_stack(const struct Stack *stack) {
+	const unsigned int start = stack->top * 2;
+	unsigned int end = stack->allocated_pages * STACK_BYTES_PER_PAGE;
+
+	while (end > start && (stack->flags[end - 1] & (STACK_FLAG_DEFINED | STACK_FLAG_MERGED)) == 0) {
+		end--;
+	}
+
+	return end - start;
+}
+
+/**
+ * Merge a single byte. A byte keeps being defined if it is defined in both stacks with the same value and the same relative flag.
+ * Otherwise, it will be marked as merged if it was either defined or merged in any of the stacks.
+ */
+static unsigned char merge_stack_byte_flags(unsigned char this_flags, unsigned char this_data, unsigned char other_flags, unsigned char other_data) {
+	const unsigned char both_flags = this_flags & other_flags;
+	if ((both_flags & STACK_FLAG_DEFINED) && this_data == other_data && ((this_flags ^ other_flags) & STACK_FLAG_RELATIVE) == 0) {
+		return both_flags & (STACK_FLAG_DEFINED | STACK_FLAG_RELATIVE);
+	}
+	else if ((this_flags | other_flags) & (STACK_FLAG_DEFINED | STACK_FLAG_MERGED)) {
+		return (both_flags & STACK_FLAG_RELATIVE) | STACK_FLAG_MERGED;
 	}
 	else {
-		int index;
+		return both_flags & STACK_FLAG_RELATIVE;
+	}
+}
 
-		if (target_stack->allocated_pages != source_stack->allocated_pages) {
-			if (target_stack->allocated_pages > 0) {
-				free(target_stack->data);
-				free(target_stack->defined_and_merged);
-				free(target_stack->relative);
-			}
+/**
+ * Returns a word with the lowest bit set for each byte that is equal in both given words, and all other bits cleared.
+ */
+static unsigned long find_equal_bytes(unsigned long a, unsigned long b) {
+	const unsigned long high_bits = STACK_LOW_BITS * 0x80;
+	const unsigned long low_7_bits = STACK_LOW_BITS * 0x7F;
+	const unsigned long diff = a ^ b;
+	const unsigned long non_zero = (((diff & low_7_bits) + low_7_bits) | diff) & high_bits;
+	return (~non_zero & high_bits) >> 7;
+}
 
-			target_stack->allocated_pages = source_stack->allocated_pages;
-			target_stack->data = malloc(target_stack->allocated_pages * STACK_BYTES_PER_PAGE);
-			target_stack->defined_and_merged = malloc(target_stack->allocated_pages * STACK_BYTES_IN_DNM_PER_PAGE);
-			target_stack->relative = malloc(target_stack->allocated_pages * STACK_BYTES_IN_REL_PER_PAGE);
-			target_stack->value_origin = malloc(target_stack->allocated_pages * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE);
-			if (!target_stack->data || !target_stack->defined_and_merged || !target_stack->relative || !target_stack->value_origin) {
-				return 1;
-			}
-		}
+/**
+ * Same as merge_stack_byte_flags, but for all bytes packed within the given words.
+ * The returned word has STACK_FLAG_DEFINED set in the bytes that are kept defined.
+ */
+static unsigned long merge_stack_word_flags(unsigned long this_flags, unsigned long this_data, unsigned long other_flags, unsigned long other_data, unsigned long *defined) {
+	const unsigned long both_flags = this_flags & other_flags;
+	const unsigned long any_flags = this_flags | other_flags;
+	const unsigned long same_relative = ~(this_flags ^ other_flags) >> 2;
+
+	*defined = both_flags & same_relative & find_equal_bytes(this_data, other_data) & STACK_LOW_BITS;
+	return *defined | ((any_flags | any_flags >> 1) & ~*defined & STACK_LOW_BITS) << 1 | (both_flags & STACK_LOW_BITS * STACK_FLAG_RELATIVE);
+}
 
-		for (index = 0; index < source_stack->allocated_pages * STACK_BYTES_PER_PAGE; index++) {
-			target_stack->data[index] = source_stack->data[index];
-		}
+#ifdef __SSE2__
+
+/**
+ * Same as merge_stack_byte_flags, but for 16 bytes at once.
+ * The returned vector has STACK_FLAG_DEFINED set in the bytes that are kept defined.
+ */
+static __m128i merge_stack_vector_flags(__m128i this_flags, __m128i this_data, __m128i other_flags, __m128i other_data, __m128i *defined) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i defined_bits = _mm_set1_epi8(STACK_FLAG_DEFINED);
+	const __m128i both_flags = _mm_and_si128(this_flags, other_flags);
+	const __m128i any_flags = _mm_and_si128(_mm_or_si128(this_flags, other_flags), _mm_set1_epi8(STACK_FLAG_DEFINED | STACK_FLAG_MERGED));
+	const __m128i same_relative = _mm_cmpeq_epi8(_mm_and_si128(_mm_xor_si128(this_flags, other_flags), _mm_set1_epi8(STACK_FLAG_RELATIVE)), zero);
+	const __m128i defined_mask = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(this_data, other_data), same_relative), _mm_cmpeq_epi8(_mm_and_si128(both_flags, defined_bits), defined_bits));
+	const __m128i merged = _mm_andnot_si128(_mm_or_si128(defined_mask, _mm_cmpeq_epi8(any_flags, zero)), _mm_set1_epi8(STACK_FLAG_MERGED));
+
+	*defined = _mm_and_si128(defined_mask, defined_bits);
+	return _mm_or_si128(_mm_or_si128(*defined, merged), _mm_and_si128(both_flags, _mm_set1_epi8(STACK_FLAG_RELATIVE)));
+}
 
-		for (index = 0; index < source_stack->allocated_pages * STACK_BYTES_IN_DNM_PER_PAGE / sizeof(packed_data_t); index++) {
-			target_stack->defined_and_merged[index] = source_stack->defined_and_merged[index];
-		}
+#endif /* __SSE2__ */
+
+/**
+ * Merge the given number of bytes, present in both stacks, into the resulting arrays.
+ * Resulting arrays can be the same as the ones in this stack.
+ */
+static void merge_stack_bytes(unsigned char *new_flags, unsigned char *new_data, const unsigned char *this_flags, const unsigned char *this_data, const unsigned char *other_flags, const unsigned char *other_data, unsigned int count) {
+	unsigned int i = 0;
+
+#ifdef __SSE2__
+	for (; i + sizeof(__m128i) <= count; i += sizeof(__m128i)) {
+		const __m128i this_data_vector = _mm_loadu_si128((const __m128i *) (this_data + i));
+		__m128i defined;
+		const __m128i flags = merge_stack_vector_flags(
+				_mm_loadu_si128((const __m128i *) (this_flags + i)), this_data_vector,
+				_mm_loadu_si128((const __m128i *) (other_flags + i)), _mm_loadu_si128((const __m128i *) (other_data + i)),
+				&defined);
+		_mm_storeu_si128((__m128i *) (new_flags + i), flags);
+		_mm_storeu_si128((__m128i *) (new_data + i), this_data_vector);
+	}
+#endif /* __SSE2__ */
+
+	for (; i + sizeof(unsigned long) <= count; i += sizeof(unsigned long)) {
+		unsigned long this_flags_word;
+		unsigned long this_data_word;
+		unsigned long other_flags_word;
+		unsigned long other_data_word;
+		unsigned long defined;
+		unsigned long flags;
+
+		memcpy(&this_flags_word, this_flags + i, sizeof(unsigned long));
+		memcpy(&this_data_word, this_data + i, sizeof(unsigned long));
+		memcpy(&other_flags_word, other_flags + i, sizeof(unsigned long));
+		memcpy(&other_data_word, other_data + i, sizeof(unsigned long));
+		flags = merge_stack_word_flags(this_flags_word, this_data_word, other_flags_word, other_data_word, &defined);
+		memcpy(new_flags + i, &flags, sizeof(unsigned long));
+		memcpy(new_data + i, &this_data_word, sizeof(unsigned long));
+	}
+
+	for (; i < count; i++) {
+		new_flags[i] = merge_stack_byte_flags(this_flags[i], this_data[i], other_flags[i], other_data[i]);
+		new_data[i] = this_data[i];
+	}
+}
 
-		for (index = 0; index < source_stack->allocated_pages * STACK_BYTES_IN_REL_PER_PAGE / sizeof(packed_data_t); index++) {
-			target_stack->relative[index] = source_stack->relative[index];
+/**
+ * Returns something different from 0 if any of the given number of bytes, present in both stacks,
+ * is defined in this stack but would not be after merging.
+ */
+static int stack_bytes_lose_definition(const unsigned char *this_flags, const unsigned char *this_data, const unsigned char *other_flags, const unsigned char *other_data, unsigned int count) {
+	unsigned int i = 0;
+
+#ifdef __SSE2__
+	for (; i + sizeof(__m128i) <= count; i += sizeof(__m128i)) {
+		const __m128i this_flags_vector = _mm_loadu_si128((const __m128i *) (this_flags + i));
+		__m128i defined;
+		merge_stack_vector_flags(
+				this_flags_vector, _mm_loadu_si128((const __m128i *) (this_data + i)),
+				_mm_loadu_si128((const __m128i *) (other_flags + i)), _mm_loadu_si128((const __m128i *) (other_data + i)),
+				&defined);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(this_flags_vector, _mm_set1_epi8(STACK_FLAG_DEFINED)), defined)) != 0xFFFF) {
+			return 1;
 		}
-
-		for (index = 0; index < source_stack->allocated_pages * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE / sizeof(const char *); index++) {
-			target_stack->value_origin[index] = source_stack->value_origin[index];
+	}
+#endif /* __SSE2__ */
+
+	for (; i + sizeof(unsigned long) <= count; i += sizeof(unsigned long)) {
+		unsigned long this_flags_word;
+		unsigned long this_data_word;
+		unsigned long other_flags_word;
+		unsigned long other_data_word;
+		unsigned long defined;
+
+		memcpy(&this_flags_word, this_flags + i, sizeof(unsigned long));
+		memcpy(&this_data_word, this_data + i, sizeof(unsigned long));
+		memcpy(&other_flags_word, other_flags + i, sizeof(unsigned long));
+		memcpy(&other_data_word, other_data + i, sizeof(unsigned long));
+		merge_stack_word_flags(this_flags_word, this_data_word, other_flags_word, other_data_word, &defined);
+		if (this_flags_word & ~defined & STACK_LOW_BITS * STACK_FLAG_DEFINED) {
+			return 1;
 		}
+	}
 
-		target_stack->top = source_stack->top;
+	for (; i < count; i++) {
+		if (this_flags[i] & ~merge_stack_byte_flags(this_flags[i], this_data[i], other_flags[i], other_data[i]) & STACK_FLAG_DEFINED) {
+			return 1;
+		}
 	}
 
 	return 0;
 }
 
 int merge_stacks(struct Stack *stack, const struct Stack *other_stack) {
-	int this_bytes = stack->allocated_pages * STACK_BYTES_PER_PAGE - stack->top * 2;
-	int other_bytes = other_stack->allocated_pages * STACK_BYTES_PER_PAGE - other_stack->top * 2;
-	int required_bytes = (this_bytes < other_bytes)? other_bytes : this_bytes;
+	const unsigned int this_bytes = stack->allocated_pages * STACK_BYTES_PER_PAGE - stack->top * 2;
+	const unsigned int other_bytes = other_stack->allocated_pages * STACK_BYTES_PER_PAGE - other_stack->top * 2;
+	const unsigned int this_used_bytes = used_bytes_in_stack(stack);
+	const unsigned int other_used_bytes = used_bytes_in_stack(other_stack);
+	unsigned int required_bytes = (this_used_bytes < other_used_bytes)? other_used_bytes : this_used_bytes;
 
 	unsigned int new_allocated_pages;
 	unsigned int new_top;
+	unsigned int common_bytes;
 	unsigned char *new_data;
-	packed_data_t *new_dnm;
-	packed_data_t *new_rel;
+	unsigned char *new_flags;
 	const char **new_value_origin;
-	int this_relative;
-	int other_relative;
-	const char *this_value_origin;
-	const char *other_value_origin;
-	int i;
+	unsigned int i;
+
+	if (required_bytes & 1) {
+		required_bytes++;
+	}
 
-	while (required_bytes > 0) {
-		const int this_defined_or_merged = required_bytes + stack->top * 2 - 1 < stack->allocated_pages * STACK_BYTES_PER_PAGE && stack->defined_and_merged[(required_bytes + stack->top * 2 - 1) / 4 / sizeof(packed_data_t)] & 3 << ((required_bytes + stack->top * 2 - 1) % (4 * sizeof(packed_data_t))) * 2;
+	if (required_bytes <= this_bytes) {
+		/*
+		 * The result fits in the words this stack already has. Bytes beyond the required ones are not defined
+		 * nor merged in any of the stacks, so they can be merged as well without changing the result.
+		 * Each byte in the result is at the same position as its counterpart in this stack, and
+		 * it is only written after being read. So the result can be written in place, without allocating anything.
+		 */
+		required_bytes = this_bytes;
+		new_allocated_pages = stack->allocated_pages;
+		new_top = stack->top;
+		new_data = stack->data;
+		new_flags = stack->flags;
+		new_value_origin = stack->value_origin;
+	}
+	else {
+		new_allocated_pages = (required_bytes + STACK_BYTES_PER_PAGE - 1) / STACK_BYTES_PER_PAGE;
+		new_top = (new_allocated_pages * STACK_BYTES_PER_PAGE - required_bytes) / 2;
+		new_data = allocate_in_arena(stack->arena, new_allocated_pages * STACK_BYTES_PER_PAGE);
+		new_flags = allocate_in_arena(stack->arena, new_allocated_pages * STACK_BYTES_IN_FLAGS_PER_PAGE);
+		new_value_origin = allocate_in_arena(stack->arena, new_allocated_pages * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE);
 
-		if (this_defined_or_merged) {
-			break;
+		if (!new_data || !new_flags || !new_value_origin) {
+			return 1;
 		}
-		else {
-			const int other_defined_or_merged = required_bytes + other_stack->top * 2 - 1 < other_stack->allocated_pages * STACK_BYTES_PER_PAGE && other_stack->defined_and_merged[(required_bytes + other_stack->top * 2 - 1) / 4 / sizeof(packed_data_t)] & 3 << ((required_bytes + other_stack->top * 2 - 1) % (4 * sizeof(packed_data_t))) * 2;
-			if (other_defined_or_merged) {
-				break;
-			}
-			else {
-				required_bytes--;
-			}
+
+		memset(new_flags, 0, new_top * 2);
+		for (i = 0; i < new_top; i++) {
+			new_value_origin[i] = NULL;
 		}
 	}
 
-	if (required_bytes & 1) {
-		required_bytes++;
+	/* Bytes present in both stacks are merged in bulk */
+	common_bytes = (this_bytes < other_bytes)? this_bytes : other_bytes;
+	if (common_bytes > required_bytes) {
+		common_bytes = required_bytes;
 	}
 
-	new_allocated_pages = (required_bytes + STACK_BYTES_PER_PAGE - 1) / STACK_BYTES_PER_PAGE;
-	new_top = (new_allocated_pages * STACK_BYTES_PER_PAGE - required_bytes) / 2;
-	new_data = malloc(new_allocated_pages * STACK_BYTES_PER_PAGE);
-	new_dnm = malloc(new_allocated_pages * STACK_BYTES_IN_DNM_PER_PAGE);
-	new_rel = malloc(new_allocated_pages * STACK_BYTES_IN_REL_PER_PAGE);
-	new_value_origin = malloc(new_allocated_pages * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE);
+	merge_stack_bytes(new_flags + new_top * 2, new_data + new_top * 2,
+			stack->flags + stack->top * 2, stack->data + stack->top * 2,
+			other_stack->flags + other_stack->top * 2, other_stack->data + other_stack->top * 2,
+			common_bytes);
 
-	if (!new_data || !new_dnm || !new_rel || !new_value_origin) {
-		return 1;
+	/* Bytes present in only one of the stacks cannot be defined in the result, and they are not relative either */
+	for (i = common_bytes; i < required_bytes; i++) {
+		const unsigned char flags = (i < this_bytes)? stack->flags[stack->top * 2 + i] :
+				(i < other_bytes)? other_stack->flags[other_stack->top * 2 + i] : 0;
+		new_flags[new_top * 2 + i] = (flags & (STACK_FLAG_DEFINED | STACK_FLAG_MERGED))? STACK_FLAG_MERGED : 0;
+		if (i < this_bytes) {
+			new_data[new_top * 2 + i] = stack->data[stack->top * 2 + i];
+		}
 	}
 
-	for (i = 0; i < required_bytes; i++) {
-		const int this_index = stack->top * 2 + i;
-		const int other_index = other_stack->top * 2 + i;
-		const int new_index = new_top * 2 + i;
-		const int this_defined = this_index < stack->allocated_pages * STACK_BYTES_PER_PAGE && stack->defined_and_merged[this_index / 4 / sizeof(packed_data_t)] & 1 << (this_index % (4 * sizeof(packed_data_t))) * 2;
-		const int other_defined = other_index < other_stack->allocated_pages * STACK_BYTES_PER_PAGE && other_stack->defined_and_merged[other_index / 4 / sizeof(packed_data_t)] & 1 << (other_index % (4 * sizeof(packed_data_t))) * 2;
-		const int this_merged = this_index < stack->allocated_pages * STACK_BYTES_PER_PAGE && stack->defined_and_merged[this_index / 4 / sizeof(packed_data_t)] & 2 << (this_index % (4 * sizeof(packed_data_t))) * 2;
-		const int other_merged = other_index < other_stack->allocated_pages * STACK_BYTES_PER_PAGE && other_stack->defined_and_merged[other_index / 4 / sizeof(packed_data_t)] & 2 << (other_index % (4 * sizeof(packed_data_t))) * 2;
-		int is_defined;
-
-		if ((i & 1) == 0) {
-			this_relative = (this_index / 16 / sizeof(packed_data_t)) < stack->allocated_pages * STACK_BYTES_IN_REL_PER_PAGE && stack->relative[this_index / 16 / sizeof(packed_data_t)] & 1 << (this_index / 2) % (8 * sizeof(packed_data_t));
-			other_relative = (other_index / 16 / sizeof(packed_data_t)) < other_stack->allocated_pages * STACK_BYTES_IN_REL_PER_PAGE && other_stack->relative[other_index / 16 / sizeof(packed_data_t)] & 1 << (other_index / 2) % (8 * sizeof(packed_data_t));
-			this_value_origin = (this_index < stack->allocated_pages * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE)? stack->value_origin[this_index / 2] : NULL;
-			other_value_origin = (this_index < stack->allocated_pages * STACK_BYTES_IN_VALUE_ORIGIN_PER_PAGE)? other_stack->value_origin[other_index / 2] : NULL;
-		}
+	for (i = 0; i < required_bytes / 2; i++) {
+		const char *this_value_origin = (i * 2 < this_bytes)? stack->value_origin[stack->top + i] : NULL;
+		const char *other_value_origin = (i * 2 < other_bytes)? other_stack->value_origin[other_stack->top + i] : NULL;
+		new_value_origin[new_top + i] = (this_value_origin == other_value_origin)? this_value_origin : NULL;
+	}
 
-		is_defined = this_defined && other_defined && stack->data[this_index] == other_stack->data[other_index] && this_relative == other_relative;
+	if (new_data != stack->data) {
+		clear_stack(stack);
+		stack->allocated_pages = new_allocated_pages;
+		stack->top = new_top;
+		stack->data = new_data;
+		stack->flags = new_flags;
+		stack->value_origin = new_value_origin;
+	}
 
-		if (is_defined) {
-			new_data[new_index] = stack->data[this_index];
-			new_dnm[new_index / 4 / sizeof(packed_data_t)] |= 1 << (new_index % (4 * sizeof(packed_data_t))) * 2;
-		}
-		else if (this_defined || this_merged || other_defined || other_merged) {
-			new_dnm[new_index / 4 / sizeof(packed_data_t)] &= ~(1 << (new_index % (4 * sizeof(packed_data_t))) * 2);
-			new_dnm[new_index / 4 / sizeof(packed_data_t)] |= 2 << (new_index % (4 * sizeof(packed_data_t))) * 2;
-		}
-		else {
-			new_dnm[new_index / 4 / sizeof(packed_data_t)] &= ~(3 << (new_index % (4 * sizeof(packed_data_t))) * 2);
-		}
+	return 0;
+}
 
-		if (i & 1) {
-			if (this_relative && other_relative) {
-				new_rel[new_index / 16 / sizeof(packed_data_t)] |= 1 << (new_index / 2) % (8 * sizeof(packed_data_t));
-			}
-			else {
-				new_rel[new_index / 16 / sizeof(packed_data_t)] &= ~(1 << (new_index / 2) % (8 * sizeof(packed_data_t)));
-			}
+int changes_on_merging_stacks(const struct Stack *stack, const struct Stack *other_stack) {
+	const unsigned int this_bytes = stack->allocated_pages * STACK_BYTES_PER_PAGE - stack->top * 2;
+	const unsigned int other_bytes = other_stack->allocated_pages * STACK_BYTES_PER_PAGE - other_stack->top * 2;
+	const unsigned int common_bytes = (this_bytes < other_bytes)? this_bytes : other_bytes;
+	unsigned int i;
+
+	if (stack_bytes_lose_definition(stack->flags + stack->top * 2, stack->data + stack->top * 2,
+			other_stack->flags + other_stack->top * 2, other_stack->data + other_stack->top * 2,
+			common_bytes)) {
+		return 1;
+	}
 
-			new_value_origin[new_index / 2] = (this_value_origin == other_value_origin)?
-					this_value_origin : NULL;
+	/* Bytes not present in the other stack will become undefined */
+	for (i = common_bytes; i < this_bytes; i++) {
+		if (stack->flags[stack->top * 2 + i] & STACK_FLAG_DEFINED) {
+			return 1;
 		}
 	}
 
-	clear_stack(stack);
-	stack->allocated_pages = new_allocated_pages;
-	stack->top = new_top;
-	stack->data = new_data;
-	stack->defined_and_merged = new_dnm;
-	stack->relative = new_rel;
-	stack->value_origin = new_value_origin;
-
 	return 0;
 }
 
-int changes_on_merging_stacks(const struct Stack *stack, const struct Stack *other_stack) {
-	int this_bytes = stack->allocated_pages * STACK_BYTES_PER_PAGE - stack->top * 2;
-	int other_bytes = other_stack->allocated_pages * STACK_BYTES_PER_PAGE - other_stack->top * 2;
-	int required_bytes = (this_bytes < other_bytes)? other_bytes : this_bytes;
-
-	int new_allocated_pages;
-	int new_top;
-	int this_relative;
-	int other_relative;
-	int is_defined = 0;
-	int i;
+int widen_stacks(struct Stack *stack, const struct Stack *other_stack) {
+	unsigned int i;
+	int error_code;
 
-	while (required_bytes > 0) {
-		const int this_defined_or_merged = required_bytes + stack->top * 2 - 1 < stack->allocated_pages * STACK_BYTES_PER_PAGE && stack->defined_and_merged[(required_bytes + stack->top * 2 - 1) / 4 / sizeof(packed_data_t)] & 3 << ((required_bytes + stack->top * 2 - 1) % (4 * sizeof(packed_data_t))) * 2;
+	if ((error_code = merge_stacks(stack, other_stack))) {
+		return error_code;
+	}
 
-		if (this_defined_or_merged) {
-			break;
-		}
-		else {
-			const int other_defined_or_merged = required_bytes + other_stack->top * 2 - 1 < other_stack->allocated_pages * STACK_BYTES_PER_PAGE && other_stack->defined_and_merged[(required_bytes + other_stack->top * 2 - 1) / 4 / sizeof(packed_data_t)] & 3 << ((required_bytes + other_stack->top * 2 - 1) % (4 * sizeof(packed_data_t))) * 2;
-			if (other_defined_or_merged) {
-				break;
-			}
-			else {
-				required_bytes--;
-			}
-		}
+	for (i = stack->top * 2; i < stack->allocated_pages * STACK_BYTES_IN_FLAGS_PER_PAGE; i++) {
+		stack->flags[i] &= ~STACK_FLAG_MERGED;
 	}
 
-	if (required_bytes & 1) {
-		required_bytes++;
+	return 0;
+}
+
+unsigned int count_defined_in_stack(const struct Stack *stack) {
+	const unsigned int allocated_bytes = stack->allocated_pages * STACK_BYTES_PER_PAGE;
+	unsigned int count = 0;
+	unsigned int index;
+
+	for (index = stack->top * 2; index < allocated_bytes; index++) {
+		count += stack->flags[index] & STACK_FLAG_DEFINED;
 	}
 
-	new_allocated_pages = (required_bytes + STACK_BYTES_PER_PAGE - 1) / STACK_BYTES_PER_PAGE;
-	new_top = (new_allocated_pages - required_bytes) / 2;
+	return count;
+}
 
-	for (i = 0; i < required_bytes; i++) {
-		const int this_index = stack->top * 2 + i;
-		const int other_index = other_stack->top * 2 + i;
-		const int this_defined = this_index < stack->allocated_pages * STACK_BYTES_PER_PAGE && stack->defined_and_merged[this_index / 4 / sizeof(packed_data_t)] & 1 << (this_index % (4 * sizeof(packed_data_t))) * 2;
-		const int other_defined = other_index < other_stack->allocated_pages * STACK_BYTES_PER_PAGE && other_stack->defined_and_merged[other_index / 4 / sizeof(packed_data_t)] & 1 << (other_index % (4 * sizeof(packed_data_t))) * 2;
-		const int this_merged = this_index < stack->allocated_pages * STACK_BYTES_PER_PAGE && stack->defined_and_merged[this_index / 4 / sizeof(packed_data_t)] & 2 << (this_index % (4 * sizeof(packed_data_t))) * 2;
-		const int other_merged = other_index < other_stack->allocated_pages * STACK_BYTES_PER_PAGE && other_stack->defined_and_merged[other_index / 4 / sizeof(packed_data_t)] & 2 << (other_index % (4 * sizeof(packed_data_t))) * 2;
+int are_stacks_equal(const struct Stack *stack, const struct Stack *other_stack) {
+	const unsigned int used_bytes = stack->allocated_pages * STACK_BYTES_PER_PAGE - stack->top * 2;
+	const unsigned int other_used_bytes = other_stack->allocated_pages * STACK_BYTES_PER_PAGE - other_stack->top * 2;
+	unsigned int index;
 
-		if ((i & 1) == 0) {
-			this_relative = (this_index / 16 / sizeof(packed_data_t)) < stack->allocated_pages * STACK_BYTES_IN_REL_PER_PAGE && stack->relative[this_index / 16 / sizeof(packed_data_t)] & 1 << (this_index / 2) % (8 * sizeof(packed_data_t));
-			other_relative = (other_index / 16 / sizeof(packed_data_t)) < other_stack->allocated_pages * STACK_BYTES_IN_REL_PER_PAGE && other_stack->relative[other_index / 16 / sizeof(packed_data_t)] & 1 << (other_index / 2) % (8 * sizeof(packed_data_t));
-		}
+	if (used_bytes != other_used_bytes) {
+		return 0;
+	}
 
-		is_defined = this_defined && other_defined && stack->data[this_index] == other_stack->data[other_index] && this_relative == other_relative;
+	if (used_bytes == 0) {
+		return 1;
+	}
 
-		if (this_defined && !is_defined) {
-			return 1;
+	if (memcmp(stack->data + stack->top * 2, other_stack->data + other_stack->top * 2, used_bytes) ||
+			memcmp(stack->flags + stack->top * 2, other_stack->flags + other_stack->top * 2, used_bytes)) {
+		return 0;
+	}
+
+	for (index = 0; index < used_bytes / 2; index++) {
+		if (stack->value_origin[stack->top + index] != other_stack->value_origin[other_stack->top + index]) {
+			return 0;
 		}
 	}
 
-	return 0;
+	return 1;
+}
+
+unsigned long hash_stack(const struct Stack *stack) {
+	const unsigned int allocated_bytes = stack->allocated_pages * STACK_BYTES_PER_PAGE;
+	unsigned long hash = allocated_bytes - stack->top * 2;
+	unsigned int index;
+
+	for (index = stack->top * 2; index < allocated_bytes; index++) {
+		hash = hash * 31 + (stack->flags[index] << 8 | stack->data[index]);
+	}
+
+	return hash;
 }
 
 #ifdef DEBUG
@@ -564,14 +685,13 @@ void print_stack(const struct Stack *stack) {
 	fprintf(stderr, "Stack(");
 
 	for (i = stack->top; i < end; i++) {
-		const unsigned int definition = stack->defined_and_merged[(i * 2) / (4 * sizeof(packed_data_t))] >> ((i * 2) % (4 * sizeof(packed_data_t))) * 2;
+		const unsigned int low_flags = stack->flags[i * 2];
+		const unsigned int high_flags = stack->flags[i * 2 + 1];
 
-		if ((definition & 5) == 0) {
+		if (((low_flags | high_flags) & STACK_FLAG_DEFINED) == 0) {
 			unknown_count++;
 		}
 		else {
-			const int relative = stack->relative[i / (8 * sizeof(packed_data_t))] & 1 << i % (8 * sizeof(packed_data_t));
-
 			if (comma_required) {
 				fprintf(stderr, ", ");
 			}
@@ -599,18 +719,18 @@ void print_stack(const struct Stack *stack) {
 			}
 			comma_required = 0;
 
-			if (relative) {
+			if (low_flags & STACK_FLAG_RELATIVE) {
 				fprintf(stderr, "+");
 			}
 
-			if (definition & 4) {
+			if (high_flags & STACK_FLAG_DEFINED) {
 				fprintf(stderr, "%02x", stack->data[i * 2 + 1]);
 			}
 			else {
 				fprintf(stderr, "??");
 			}
 
-			if (definition & 1) {
+			if (low_flags & STACK_FLAG_DEFINED) {
 				fprintf(stderr, "%02x", stack->data[i * 2]);
 			}
 			else {
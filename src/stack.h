@@ -2,7 +2,7 @@
 #define _STACK_H_
 
 #include <stdint.h>
-#include "packed.h"
+#include "arena.h"
 
 struct Stack {
 	/**
@@ -10,13 +10,17 @@ struct Stack {
 	 *
 	 * The actual number of symbols and bytes per page depends on the current
 	 * implementation. But we always can ensure that the actual number of
-	 * allocated bytes for data, defined_and_merged and relative is always
+	 * allocated bytes for data, flags and value_origin is always
 	 * multiple of this number.
 	 */
 	unsigned int allocated_pages;
 
 	/**
 	 * Number of word at the beginning of the data that are not currently in use.
+	 *
+	 * Words are stored at the end of the allocated space, and the stack grows
+	 * downwards into these unused words. They are kept as headroom when
+	 * popping, so that pushing again does not require moving anything.
 	 */
 	unsigned int top;
 
@@ -28,26 +32,26 @@ struct Stack {
 	unsigned char *data;
 
 	/**
-	 * Packed data of 2 bits each, containing if the corresponding byte in the
-	 * data is defined (bit 0) and if the value comes from last merge of stacks (bit 1).
-	 */
-	packed_data_t *defined_and_merged;
-
-	/**
-	 * Whether the corresponding word value in the stack data is actually a
-	 * value relative to the intial CS assigned by the OS.
+	 * One byte of flags for each byte in the data. Bit 0 is set if the byte
+	 * is defined, bit 1 if its value comes from the last merge of stacks, and
+	 * bit 2 if the word it belongs to is relative to the initial CS assigned
+	 * by the OS. The relative bit is set in both bytes of the word.
 	 *
-	 * In the current implementation, we are assuming that only aligned words
-	 * can be relative. Because of this, there is 1 bit here for every 2 bytes
-	 * in the data.
+	 * Keeping one byte per data byte, instead of packing the bits, allows
+	 * merging many bytes at once with plain bitwise operations on whole words.
 	 */
-	packed_data_t *relative;
+	unsigned char *flags;
 
 	/**
 	 * Points to the opcode where the value in the corresponding word was set.
 	 * NULL if it is unknown.
 	 */
 	const char **value_origin;
+
+	/**
+	 * Arena where all the arrays of this stack are allocated, or NULL to allocate them directly with malloc.
+	 */
+	struct Arena *arena;
 };
 
 /**
@@ -59,8 +63,14 @@ struct Stack {
  */
 void initialize_stack(struct Stack *stack);
 
+/**
+ * Initialize the stack structure as an empty stack, whose memory will be taken from the given arena.
+ */
+void initialize_stack_in_arena(struct Stack *stack, struct Arena *arena);
+
 /**
  * Clear an existing stack, freeing any pointer and setting the empty stack again.
+ * The stack will keep using the same arena.
  *
  * This assumes that there was a valid stack initialized in the structure already.
  * If that is not the case, use initialize_stack method instead.
@@ -126,6 +136,17 @@ uint16_t get_from_top(const struct Stack *stack, unsigned int index);
  */
 const char *get_value_origin_from_top(const struct Stack *stack, unsigned int count);
 
+/**
+ * Return the number of words in this stack, either defined or not.
+ */
+unsigned int get_word_count_in_stack(const struct Stack *stack);
+
+/**
+ * Return the flags of both bytes of the word at the given index from the top, the ones of its lower byte in the lower 8 bits.
+ * Their meaning is private to the stack. They are only given so that the word can be restored by push_word_with_flags_in_stack.
+ */
+unsigned int get_word_flags_from_top(const struct Stack *stack, unsigned int index);
+
 /**
  * Push an undefined word value in the stack.
  *
@@ -153,6 +174,16 @@ int push_in_stack(struct Stack *stack, const char *value_origin, uint16_t value)
  */
 int push_relative_in_stack(struct Stack *stack, const char *value_origin, uint16_t value);
 
+/**
+ * Push the given word value in the stack, with the flags returned by get_word_flags_from_top for it.
+ * This restores exactly a word taken from another stack, either defined or not, relative or not, or merged.
+ *
+ * This will move the top of the stack one position and will enlarge the memory reserved for the stack when required.
+ *
+ * This will return something different from 0 in case of error, mainly cause when requesting for memory.
+ */
+int push_word_with_flags_in_stack(struct Stack *stack, const char *value_origin, uint16_t value, unsigned int flags);
+
 /**
  * This returns the word value in the top of the stack, and move the top one position.
  *
@@ -233,6 +264,35 @@ int merge_stacks(struct Stack *stack, const struct Stack *other_stack);
  */
 int changes_on_merging_stacks(const struct Stack *stack, const struct Stack *other_stack);
 
+/**
+ * Merge the given stacks as merge_stacks does, but all values not matching
+ * will be just undefined, without keeping the merged mark on them.
+ *
+ * This is used instead of merge_stacks for blocks that have been evaluated
+ * too many times, in order to reach the fixed point faster.
+ */
+int widen_stacks(struct Stack *stack, const struct Stack *other_stack);
+
+/**
+ * Returns the number of defined bytes in the given stack.
+ *
+ * Merging or widening never increases this number, so it can be used to check
+ * whether widening has actually changed anything.
+ */
+unsigned int count_defined_in_stack(const struct Stack *stack);
+
+/**
+ * Returns something different from 0 if both stacks hold the same words, with the same flags and value origins.
+ * The allocated space and the headroom of each stack are not compared.
+ */
+int are_stacks_equal(const struct Stack *stack, const struct Stack *other_stack);
+
+/**
+ * Returns a hash of the data and flags of the words in use in the given stack.
+ * Stacks that are equal according to are_stacks_equal will always have the same hash.
+ */
+unsigned long hash_stack(const struct Stack *stack);
+
 #ifdef DEBUG
 void print_stack(const struct Stack *stack);
 #endif /* DEBUG */
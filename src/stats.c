@@ -0,0 +1,138 @@
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L
+#define STATS_MONOTONIC_CLOCK_SUPPORTED
+#endif
+
+#include "stats.h"
+#include <assert.h>
+#include <time.h>
+
+static const char *const PHASE_NAMES[STATS_PHASE_COUNT] = {
+	"read_file", "compose_pcontent", "find_functions", "dump"
+};
+
+void initialize_stats(struct AnalysisStats *stats) {
+	int phase;
+	for (phase = 0; phase < STATS_PHASE_COUNT; phase++) {
+		stats->phases[phase].wall_seconds = 0;
+		stats->phases[phase].cpu_seconds = 0;
+	}
+
+	stats->current_phase = -1;
+	stats->phase_wall_start = 0;
+	stats->phase_cpu_start = 0;
+	stats->block_evaluations = 0;
+	stats->avoided_reevaluations = 0;
+	stats->origins_created = 0;
+	stats->snapshots_created = 0;
+	stats->snapshots_shared = 0;
+	stats->snapshots_copied_on_write = 0;
+	stats->register_merges = 0;
+	stats->stack_merges = 0;
+	stats->gvwvmap_merges = 0;
+	stats->register_widenings = 0;
+	stats->stack_widenings = 0;
+	stats->gvwvmap_widenings = 0;
+	stats->register_change_checks = 0;
+	stats->stack_change_checks = 0;
+	stats->gvwvmap_change_checks = 0;
+	stats->fixpoint_iterations = 0;
+	stats->widened_blocks = 0;
+	stats->peak_arena_bytes = 0;
+	stats->heap_allocations = 0;
+	stats->instruction_cache_hits = 0;
+	stats->instruction_cache_misses = 0;
+}
+
+static double get_wall_seconds(void) {
+#ifdef STATS_MONOTONIC_CLOCK_SUPPORTED
+	struct timespec now;
+	if (!clock_gettime(CLOCK_MONOTONIC, &now)) {
+		return now.tv_sec + now.tv_nsec / 1e9;
+	}
+#endif /* STATS_MONOTONIC_CLOCK_SUPPORTED */
+
+	return (double) time(NULL);
+}
+
+static double get_cpu_seconds(void) {
+	return ((double) clock()) / CLOCKS_PER_SEC;
+}
+
+void start_stats_phase(struct AnalysisStats *stats, int phase) {
+	assert(stats->current_phase < 0 && phase >= 0 && phase < STATS_PHASE_COUNT);
+	stats->current_phase = phase;
+	stats->phase_wall_start = get_wall_seconds();
+	stats->phase_cpu_start = get_cpu_seconds();
+}
+
+void end_stats_phase(struct AnalysisStats *stats) {
+	struct PhaseTiming *timing;
+	assert(stats->current_phase >= 0);
+
+	timing = stats->phases + stats->current_phase;
+	timing->wall_seconds += get_wall_seconds() - stats->phase_wall_start;
+	timing->cpu_seconds += get_cpu_seconds() - stats->phase_cpu_start;
+	stats->current_phase = -1;
+}
+
+/**
+ * Write the given text as a JSON string, escaping it when required.
+ */
+static void write_json_string(const char *str, FILE *file) {
+	fputc('"', file);
+	for (; *str; str++) {
+		const unsigned char ch = *str;
+		if (ch == '"' || ch == '\\') {
+			fputc('\\', file);
+			fputc(ch, file);
+		}
+		else if (ch < 0x20) {
+			fprintf(file, "\\u%04x", ch);
+		}
+		else {
+			fputc(ch, file);
+		}
+	}
+	fputc('"', file);
+}
+
+int write_stats_json(const struct AnalysisStats *stats, const char *input_filename, const char *format, FILE *file) {
+	int phase;
+
+	fprintf(file, "{\n  \"input\": ");
+	write_json_string(input_filename, file);
+	fprintf(file, ",\n  \"format\": ");
+	write_json_string(format, file);
+	fprintf(file, ",\n  \"phases\": {\n");
+	for (phase = 0; phase < STATS_PHASE_COUNT; phase++) {
+		fprintf(file, "    \"%s\": {\"wall_seconds\": %.6f, \"cpu_seconds\": %.6f}%s\n",
+				PHASE_NAMES[phase], stats->phases[phase].wall_seconds, stats->phases[phase].cpu_seconds,
+				(phase + 1 < STATS_PHASE_COUNT)? "," : "");
+	}
+
+	fprintf(file, "  },\n  \"counters\": {\n");
+	fprintf(file, "    \"block_evaluations\": %lu,\n", stats->block_evaluations);
+	fprintf(file, "    \"avoided_reevaluations\": %lu,\n", stats->avoided_reevaluations);
+	fprintf(file, "    \"fixpoint_iterations\": %lu,\n", stats->fixpoint_iterations);
+	fprintf(file, "    \"widened_blocks\": %lu,\n", stats->widened_blocks);
+	fprintf(file, "    \"origins_created\": %lu,\n", stats->origins_created);
+	fprintf(file, "    \"snapshots_created\": %lu,\n", stats->snapshots_created);
+	fprintf(file, "    \"snapshots_shared\": %lu,\n", stats->snapshots_shared);
+	fprintf(file, "    \"snapshots_copied_on_write\": %lu,\n", stats->snapshots_copied_on_write);
+	fprintf(file, "    \"register_merges\": %lu,\n", stats->register_merges);
+	fprintf(file, "    \"stack_merges\": %lu,\n", stats->stack_merges);
+	fprintf(file, "    \"gvwvmap_merges\": %lu,\n", stats->gvwvmap_merges);
+	fprintf(file, "    \"register_widenings\": %lu,\n", stats->register_widenings);
+	fprintf(file, "    \"stack_widenings\": %lu,\n", stats->stack_widenings);
+	fprintf(file, "    \"gvwvmap_widenings\": %lu,\n", stats->gvwvmap_widenings);
+	fprintf(file, "    \"register_change_checks\": %lu,\n", stats->register_change_checks);
+	fprintf(file, "    \"stack_change_checks\": %lu,\n", stats->stack_change_checks);
+	fprintf(file, "    \"gvwvmap_change_checks\": %lu,\n", stats->gvwvmap_change_checks);
+	fprintf(file, "    \"instruction_cache_hits\": %lu,\n", stats->instruction_cache_hits);
+	fprintf(file, "    \"instruction_cache_misses\": %lu,\n", stats->instruction_cache_misses);
+	fprintf(file, "    \"peak_arena_bytes\": %lu,\n", stats->peak_arena_bytes);
+	fprintf(file, "    \"heap_allocations\": %lu\n", stats->heap_allocations);
+	fprintf(file, "  }\n}\n");
+	return ferror(file) != 0;
+}
@@ -0,0 +1,89 @@
+#ifndef _STATS_H_
+#define _STATS_H_
+
+#include <stdio.h>
+
+#define STATS_PHASE_READ_FILE 0
+#define STATS_PHASE_COMPOSE_PCONTENT 1
+#define STATS_PHASE_FIND_FUNCTIONS 2
+#define STATS_PHASE_DUMP 3
+#define STATS_PHASE_COUNT 4
+
+struct PhaseTiming {
+	double wall_seconds;
+	double cpu_seconds;
+};
+
+/**
+ * Timing and counters collected along a whole analysis session.
+ */
+struct AnalysisStats {
+	struct PhaseTiming phases[STATS_PHASE_COUNT];
+
+	/**
+	 * One of the STATS_PHASE constants, or -1 if no phase is being measured.
+	 */
+	int current_phase;
+	double phase_wall_start;
+	double phase_cpu_start;
+
+	unsigned long block_evaluations;
+	unsigned long avoided_reevaluations;
+	unsigned long origins_created;
+	unsigned long snapshots_created;
+	unsigned long snapshots_shared;
+	unsigned long snapshots_copied_on_write;
+
+	/**
+	 * Merges and widenings of states into block origins, counted once per origin and state part.
+	 * Joining the origins of a block into its joined state is not counted.
+	 */
+	unsigned long register_merges;
+	unsigned long stack_merges;
+	unsigned long gvwvmap_merges;
+	unsigned long register_widenings;
+	unsigned long stack_widenings;
+	unsigned long gvwvmap_widenings;
+	unsigned long register_change_checks;
+	unsigned long stack_change_checks;
+	unsigned long gvwvmap_change_checks;
+
+	/**
+	 * Values that are not counted while evaluating, but taken from other structures at the end of the session.
+	 */
+	unsigned long fixpoint_iterations;
+	unsigned long widened_blocks;
+	unsigned long peak_arena_bytes;
+	unsigned long heap_allocations;
+	unsigned long instruction_cache_hits;
+	unsigned long instruction_cache_misses;
+};
+
+/**
+ * Increment the given counter within the given stats. Nothing is done if stats is NULL.
+ */
+#define STATS_INCREMENT(stats, counter) ((void) ((stats) && ++(stats)->counter))
+
+/**
+ * Set all its values. After this, all timings and counters will be 0.
+ */
+void initialize_stats(struct AnalysisStats *stats);
+
+/**
+ * Start measuring the time spent in the given phase.
+ * No other phase must be being measured.
+ */
+void start_stats_phase(struct AnalysisStats *stats, int phase);
+
+/**
+ * Stop measuring the current phase, adding the elapsed time to it.
+ */
+void end_stats_phase(struct AnalysisStats *stats);
+
+/**
+ * Write all timings and counters as a JSON object in the given file.
+ * This will return 0 on success, or any other value if the file cannot be written.
+ */
+int write_stats_json(const struct AnalysisStats *stats, const char *input_filename, const char *format, FILE *file);
+
+#endif /* _STATS_H_ */
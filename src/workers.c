@@ -0,0 +1,98 @@
+#if defined(__unix__) || defined(__APPLE__)
+#define _POSIX_C_SOURCE 200112L
+#define WORKERS_SUPPORTED
+#endif
+
+#include "workers.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef WORKERS_SUPPORTED
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif /* WORKERS_SUPPORTED */
+
+void initialize_worker_pool(struct WorkerPool *pool, unsigned int capacity) {
+	pool->capacity = capacity;
+	pool->running_count = 0;
+	pool->failed_count = 0;
+}
+
+#ifdef WORKERS_SUPPORTED
+/**
+ * Wait for any running worker to finish, counting it as failed if it did not exit with 0.
+ */
+static void wait_for_any_worker(struct WorkerPool *pool) {
+	int status;
+	pid_t pid;
+	do {
+		pid = wait(&status);
+	} while (pid < 0 && errno == EINTR);
+
+	if (pid < 0) {
+		if (errno == ECHILD) {
+			/* No child is left to wait for, so nothing else can be counted */
+			pool->running_count = 0;
+		}
+		return;
+	}
+
+	pool->running_count--;
+	if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+		pool->failed_count++;
+	}
+}
+
+int start_worker(struct WorkerPool *pool) {
+	pid_t pid;
+	if (pool->capacity <= 1) {
+		return WORKER_NOT_STARTED;
+	}
+
+	while (pool->running_count >= pool->capacity) {
+		wait_for_any_worker(pool);
+	}
+
+	/* Anything still buffered would be written twice otherwise, once by each process */
+	fflush(NULL);
+	pid = fork();
+	if (pid < 0) {
+		return WORKER_NOT_STARTED;
+	}
+	else if (pid == 0) {
+		return WORKER_STARTED_IN_CHILD;
+	}
+
+	pool->running_count++;
+	return WORKER_STARTED_IN_PARENT;
+}
+
+void finish_worker(int error_code) {
+	/* Streams shared with the parent, like the one it is reading the jobs from, must not be closed or repositioned */
+	fflush(stdout);
+	fflush(stderr);
+	_exit(error_code? 1 : 0);
+}
+
+unsigned int wait_for_workers(struct WorkerPool *pool) {
+	while (pool->running_count) {
+		wait_for_any_worker(pool);
+	}
+
+	return pool->failed_count;
+}
+#else
+int start_worker(struct WorkerPool *pool) {
+	return WORKER_NOT_STARTED;
+}
+
+void finish_worker(int error_code) {
+	exit(error_code? 1 : 0);
+}
+
+unsigned int wait_for_workers(struct WorkerPool *pool) {
+	return pool->failed_count;
+}
+#endif /* WORKERS_SUPPORTED */
@@ -0,0 +1,66 @@
+#ifndef _WORKERS_H_
+#define _WORKERS_H_
+
+/**
+ * Returned by start_worker in the worker process, that must perform the job and then call finish_worker.
+ */
+#define WORKER_STARTED_IN_CHILD 0
+
+/**
+ * Returned by start_worker in the calling process once the worker has started.
+ */
+#define WORKER_STARTED_IN_PARENT 1
+
+/**
+ * Returned by start_worker when no worker can be started. The calling process must perform the job itself.
+ */
+#define WORKER_NOT_STARTED 2
+
+/**
+ * Set of worker processes performing independent jobs at the same time.
+ *
+ * Workers are forked from the calling process, so they start with a copy of its whole memory,
+ * and nothing they change is visible to the calling process, apart from the files they write.
+ * Workers are only available on systems supporting fork. Elsewhere, all jobs are performed by the calling process.
+ */
+struct WorkerPool {
+	/**
+	 * Maximum number of workers running at the same time.
+	 */
+	unsigned int capacity;
+
+	/**
+	 * Number of workers started and not waited for yet.
+	 */
+	unsigned int running_count;
+
+	/**
+	 * Number of workers that finished with an error.
+	 */
+	unsigned int failed_count;
+};
+
+/**
+ * Set all its values. After this, the pool will be empty, but ready to start up to the given number of workers at once.
+ */
+void initialize_worker_pool(struct WorkerPool *pool, unsigned int capacity);
+
+/**
+ * Start a new worker, waiting first for any running one to finish if the pool is full.
+ * This returns one of the WORKER constants above.
+ */
+int start_worker(struct WorkerPool *pool);
+
+/**
+ * Terminate the current worker process, reporting whether its job failed.
+ * This must only be called from a worker process, and it never returns.
+ */
+void finish_worker(int error_code);
+
+/**
+ * Wait for all running workers to finish.
+ * This returns the number of workers that finished with an error since the pool was initialized.
+ */
+unsigned int wait_for_workers(struct WorkerPool *pool);
+
+#endif /* _WORKERS_H_ */